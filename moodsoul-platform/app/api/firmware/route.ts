@@ -1,21 +1,107 @@
 import { NextRequest, NextResponse } from 'next/server';
+import crypto from 'crypto';
 import fs from 'fs';
 import path from 'path';
 
 // CONFIGURATION
 const LATEST_VERSION = "1.1";
-// In a real app, this file would be uploaded by an admin. 
+// In a real app, this file would be uploaded by an admin.
 // For now, we assume it's placed manually in public/firmware.bin
-const FIRMWARE_FILENAME = 'firmware.bin'; 
+const FIRMWARE_FILENAME = 'firmware.bin';
+// Delta patches built with the firmware's native-delta-tool env, named by
+// the version they apply to: public/firmware-delta/<from_version>.patch
+const DELTA_DIR = 'firmware-delta';
+// PEM ECDSA P-256 private key; the matching public key is in the firmware's ota_key.h
+const SIGNING_KEY = process.env.FIRMWARE_SIGNING_KEY;
+
+function sha256Hex(buf: Buffer) {
+  return crypto.createHash('sha256').update(buf).digest('hex');
+}
+
+// Dotted numeric versions ("1.3" < "1.10"); NaN when either isn't one.
+function compareVersions(a: string, b: string) {
+  const pa = a.split('.').map(Number), pb = b.split('.').map(Number);
+  if ([...pa, ...pb].some((n) => !Number.isInteger(n) || n < 0)) return NaN;
+  for (let i = 0; i < Math.max(pa.length, pb.length); i++) {
+    const d = (pa[i] ?? 0) - (pb[i] ?? 0);
+    if (d) return Math.sign(d);
+  }
+  return 0;
+}
+
+function deltaPath(fromVersion: string | null) {
+  if (!fromVersion || !/^[\w.-]+$/.test(fromVersion)) return null;
+  const p = path.join(process.cwd(), 'public', DELTA_DIR, `${fromVersion}.patch`);
+  return fs.existsSync(p) ? p : null;
+}
+
+// key=value lines, signed over the exact body bytes. Devices refuse to
+// update without a valid X-Manifest-Signature.
+function manifestResponse(firmware: Buffer, currentVersion: string | null) {
+  const lines = [
+    `version=${LATEST_VERSION}`,
+    `size=${firmware.length}`,
+    `sha256=${sha256Hex(firmware)}`,
+  ];
+  const patch = deltaPath(currentVersion);
+  if (patch) {
+    lines.push(`delta_from=${currentVersion}`);
+    lines.push(`delta_size=${fs.statSync(patch).size}`);
+  }
+  const body = lines.join('\n') + '\n';
+
+  const headers = new Headers();
+  headers.set('Content-Type', 'text/plain');
+  headers.set('X-Firmware-Version', LATEST_VERSION);
+  if (SIGNING_KEY) {
+    const signature = crypto.sign('sha256', Buffer.from(body), SIGNING_KEY);
+    headers.set('X-Manifest-Signature', signature.toString('base64'));
+  } else {
+    console.warn('[OTA] FIRMWARE_SIGNING_KEY not set; devices will reject this manifest');
+  }
+  return new NextResponse(body, { status: 200, headers });
+}
+
+// Serves a whole file or, with "Range: bytes=<start>-[end]", the tail a
+// device still needs after an interrupted download.
+function binaryResponse(data: Buffer, filename: string, range: string | null) {
+  const headers = new Headers();
+  headers.set('Content-Type', 'application/octet-stream');
+  headers.set('Content-Disposition', `attachment; filename="${filename}"`);
+  headers.set('Accept-Ranges', 'bytes');
+  headers.set('X-Firmware-Version', LATEST_VERSION);
+
+  const match = range ? /^bytes=(\d+)-(\d*)$/.exec(range) : null;
+  if (!match) {
+    headers.set('Content-Length', data.length.toString());
+    return new NextResponse(data, { status: 200, headers });
+  }
+
+  const start = parseInt(match[1], 10);
+  const end = match[2] ? Math.min(parseInt(match[2], 10), data.length - 1) : data.length - 1;
+  if (start >= data.length || start > end) {
+    headers.set('Content-Range', `bytes */${data.length}`);
+    return new NextResponse(null, { status: 416, headers });
+  }
+  const slice = data.subarray(start, end + 1);
+  headers.set('Content-Range', `bytes ${start}-${end}/${data.length}`);
+  headers.set('Content-Length', slice.length.toString());
+  return new NextResponse(slice, { status: 206, headers });
+}
 
 export async function GET(request: NextRequest) {
   const searchParams = request.nextUrl.searchParams;
   const currentVersion = searchParams.get('current_version');
+  const wantsManifest = searchParams.get('manifest') === '1';
+  const wantsDelta = searchParams.get('delta') === '1';
+  const range = request.headers.get('range');
 
-  console.log(`[OTA] Device checking update. Current: ${currentVersion}, Server: ${LATEST_VERSION}`);
+  console.log(`[OTA] Device checking update. Current: ${currentVersion}, Server: ${LATEST_VERSION}` +
+    `${wantsManifest ? ' (manifest)' : ''}${wantsDelta ? ' (delta)' : ''}${range ? ` ${range}` : ''}`);
 
-  // 1. Check Version
-  if (currentVersion === LATEST_VERSION) {
+  // 1. Check Version: only devices older than LATEST_VERSION get an update
+  // (they refuse downgrades anyway)
+  if (currentVersion && !(compareVersions(currentVersion, LATEST_VERSION) < 0)) {
     return new NextResponse(null, { status: 304 }); // Not Modified
   }
 
@@ -25,27 +111,30 @@ export async function GET(request: NextRequest) {
   if (!fs.existsSync(firmwarePath)) {
     console.error(`[OTA] Firmware file not found at ${firmwarePath}`);
     return NextResponse.json(
-      { error: "Firmware binary not found on server" }, 
+      { error: "Firmware binary not found on server" },
       { status: 404 }
     );
   }
 
-  // 3. Serve File
+  // 3. Serve Manifest, Patch or File
   try {
-    const fileBuffer = fs.readFileSync(firmwarePath);
-    const stats = fs.statSync(firmwarePath);
+    if (wantsDelta) {
+      const patch = deltaPath(currentVersion);
+      if (!patch) {
+        return NextResponse.json({ error: "No delta for this version" }, { status: 404 });
+      }
+      return binaryResponse(fs.readFileSync(patch), `moodsoul_${currentVersion}_to_${LATEST_VERSION}.patch`, range);
+    }
 
-    const headers = new Headers();
-    headers.set('Content-Type', 'application/octet-stream');
-    headers.set('Content-Disposition', `attachment; filename="moodsoul_v${LATEST_VERSION}.bin"`);
-    headers.set('Content-Length', stats.size.toString());
-    headers.set('X-Firmware-Version', LATEST_VERSION);
-
-    return new NextResponse(fileBuffer, { status: 200, headers });
+    const fileBuffer = fs.readFileSync(firmwarePath);
+    if (wantsManifest) {
+      return manifestResponse(fileBuffer, currentVersion);
+    }
+    return binaryResponse(fileBuffer, `moodsoul_v${LATEST_VERSION}.bin`, range);
   } catch (error) {
     console.error("[OTA] Error reading firmware file:", error);
     return NextResponse.json(
-      { error: "Internal Server Error" }, 
+      { error: "Internal Server Error" },
       { status: 500 }
     );
   }
@@ -19,7 +19,215 @@ const supabase = createClient(supabaseUrl, supabaseServiceKey);
 // Initialize Gemini
 const genAI = new GoogleGenerativeAI(process.env.GEMINI_API_KEY || '');
 
+// Device trace correlation: the firmware sends X-Trace-Id per turn and
+// records our Server-Timing values next to its own stage timestamps.
+function traceLog(traceId: string | null, fields: Record<string, string | number>) {
+  if (!traceId) return;
+  console.log('[trace]', JSON.stringify({ trace_id: traceId, ...fields }));
+}
+
+function timingHeaders(traceId: string | null, geminiMs: number, ttsMs: number): Record<string, string> {
+  const headers: Record<string, string> = {
+    'Server-Timing': `gemini;dur=${geminiMs.toFixed(1)}, tts;dur=${ttsMs.toFixed(1)}`,
+  };
+  if (traceId) headers['X-Trace-Id'] = traceId;
+  return headers;
+}
+
+// Reply audio format (firmware reply_decoder.h). The device lists what it
+// can play in X-Audio-Caps, best first:
+//   codecs=ima-adpcm,pcm16,mp3; rate=16000; channels=1; buffer-ms=256; adpcm-block=256
+// We take the first codec we can make. Devices without the header get MP3.
+type ReplyCodec = 'mp3' | 'pcm16' | 'ima-adpcm';
+
+const REPLY_RATE = 16000;
+const ADPCM_BLOCK = 256;
+const ADPCM_SAMPLES = (ADPCM_BLOCK - 4) * 2 + 1;
+
+const CODEC_IDS: Record<ReplyCodec, number> = { 'mp3': 0, 'pcm16': 1, 'ima-adpcm': 2 };
+const CODEC_TYPES: Record<ReplyCodec, string> = {
+  'mp3': 'audio/mpeg',
+  'pcm16': `audio/L16;rate=${REPLY_RATE}`,
+  'ima-adpcm': `audio/x-ima-adpcm;rate=${REPLY_RATE}`,
+};
+
+function pickCodec(caps: string | null): ReplyCodec {
+  if (!caps) return 'mp3';
+  const fields: Record<string, string> = {};
+  for (const part of caps.split(';')) {
+    const [key, value] = part.split('=').map((v) => v.trim());
+    if (key && value) fields[key.toLowerCase()] = value;
+  }
+  // PCM and ADPCM come straight from 16 kHz TTS; no resampling here
+  const rateOk = !fields.rate || Number(fields.rate) === REPLY_RATE;
+  for (const name of (fields.codecs || '').split(',').map((c) => c.trim().toLowerCase())) {
+    if (name === 'mp3') return 'mp3';
+    if ((name === 'pcm16' || name === 'ima-adpcm') && rateOk) return name;
+  }
+  return 'mp3';
+}
+
+const IMA_STEPS = [
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767,
+];
+const IMA_INDEX_STEP = [-1, -1, -1, -1, 2, 4, 6, 8];
+
+// Mono IMA-ADPCM in WAV-style blocks: int16 first sample, step index, a
+// reserved byte, then 4-bit codes low nibble first. Same as the firmware's
+// imaAdpcmEncodeBlock(), so both sides track the same predictor.
+function imaAdpcmEncode(pcm: Buffer): Buffer {
+  const total = pcm.length >> 1;
+  const blocks: Buffer[] = [];
+  let index = 0;
+  for (let off = 0; off < total; off += ADPCM_SAMPLES) {
+    const n = Math.min(ADPCM_SAMPLES, total - off);
+    const block = Buffer.alloc(4 + Math.ceil((n - 1) / 2));
+    let pred = pcm.readInt16LE(off * 2);
+    block.writeInt16LE(pred, 0);
+    block.writeUInt8(index, 2);
+    for (let i = 1; i < n; i += 2) {
+      let byte = 0;
+      for (let k = 0; k < 2; k++) {
+        const target = i + k < n ? pcm.readInt16LE((off + i + k) * 2) : pred;
+        let diff = target - pred;
+        const step = IMA_STEPS[index];
+        let code = 0;
+        if (diff < 0) {
+          code = 8;
+          diff = -diff;
+        }
+        if (diff >= step) { code |= 4; diff -= step; }
+        if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+        if (diff >= step >> 2) code |= 1;
+        // The decoder's own update, so the predictors stay in step
+        let delta = step >> 3;
+        if (code & 1) delta += step >> 2;
+        if (code & 2) delta += step >> 1;
+        if (code & 4) delta += step;
+        pred = Math.max(-32768, Math.min(32767, pred + (code & 8 ? -delta : delta)));
+        index = Math.max(0, Math.min(88, index + IMA_INDEX_STEP[code & 7]));
+        byte |= code << (4 * k);
+      }
+      block.writeUInt8(byte, 4 + ((i - 1) >> 1));
+    }
+    blocks.push(block);
+  }
+  return Buffer.concat(blocks);
+}
+
+// Sentence-by-sentence replies (firmware reply_segments.h). Each frame:
+// magic "SG", flags (1 = last), codec (0 = MP3, 1 = PCM16, 2 = IMA-ADPCM),
+// seq, caption length and audio length, little-endian, then the caption
+// and the audio.
+const SEGMENT_CONTENT_TYPE = 'application/x-moodsoul-segments';
+const SEGMENT_MAGIC = 0x4753;
+const SEGMENT_LAST = 0x01;
+const SEGMENT_MAX = 6;
+
+function segmentFrame(seq: number, last: boolean, codec: ReplyCodec, caption: string, audio: Buffer): Buffer {
+  const text = Buffer.from(caption, 'utf8');
+  const header = Buffer.alloc(12);
+  header.writeUInt16LE(SEGMENT_MAGIC, 0);
+  header.writeUInt8(last ? SEGMENT_LAST : 0, 2);
+  header.writeUInt8(CODEC_IDS[codec], 3);
+  header.writeUInt16LE(seq, 4);
+  header.writeUInt16LE(text.length, 6);
+  header.writeUInt32LE(audio.length, 8);
+  return Buffer.concat([header, text, audio]);
+}
+
+// Sentences, with fragments too short to be worth a TTS call folded into
+// the one before. Anything past SEGMENT_MAX goes into the last segment.
+function splitSentences(text: string): string[] {
+  const parts = text.match(/[^.!?。！？]+[.!?。！？]*\s*/g) || [text];
+  const sentences: string[] = [];
+  for (const part of parts) {
+    const trimmed = part.trim();
+    if (!trimmed) continue;
+    if (sentences.length && (trimmed.length < 8 || sentences.length >= SEGMENT_MAX)) {
+      sentences[sentences.length - 1] += ' ' + trimmed;
+    } else {
+      sentences.push(trimmed);
+    }
+  }
+  return sentences.length ? sentences : [text];
+}
+
+interface VoiceTuning {
+  speed_ratio: number;
+  pitch_ratio: number;
+}
+
+const DEFAULT_TUNING: VoiceTuning = { speed_ratio: 1.0, pitch_ratio: 1.0 };
+
+async function synthesize(deviceId: string, voiceId: string | null, text: string,
+                          codec: ReplyCodec, tuning: VoiceTuning = DEFAULT_TUNING): Promise<Buffer> {
+  const response = await axios.post(
+    'https://openspeech.bytedance.com/api/v1/tts',
+    {
+      app: {
+        appid: process.env.VOLCENGINE_APPID,
+        token: process.env.VOLCENGINE_ACCESS_TOKEN,
+        cluster: 'volcano_tts',
+      },
+      user: { uid: deviceId },
+      audio: {
+        voice_type: voiceId || 'BV001_streaming',
+        encoding: codec === 'mp3' ? 'mp3' : 'pcm',
+        rate: REPLY_RATE,
+        speed_ratio: tuning.speed_ratio,
+        volume_ratio: 1.0,
+        pitch_ratio: tuning.pitch_ratio,
+      },
+      request: {
+        reqid: crypto.randomUUID(),
+        text,
+        text_type: 'plain',
+        operation: 'query',
+      },
+    },
+    {
+      headers: {
+        'Authorization': `Bearer;${process.env.VOLCENGINE_ACCESS_TOKEN}`,
+        'Content-Type': 'application/json',
+      },
+      responseType: 'arraybuffer', // Get binary data
+    }
+  );
+  const audio = Buffer.from(response.data);
+  if (codec === 'mp3') return audio;
+  const pcm = audio.subarray(0, audio.length & ~1);
+  return codec === 'ima-adpcm' ? imaAdpcmEncode(pcm) : pcm;
+}
+
+const DAILY_QUOTA = 50;
+const THROTTLE_MS = 5000;
+
+// Lets the device pick its local filler/"tired" clips for the active persona
+// and answer the quota reply itself, without a round trip.
+function soulHeaders(personaId: string | null, remaining: number, feature?: string | null): Record<string, string> {
+  const now = new Date();
+  const midnight = Date.UTC(now.getUTCFullYear(), now.getUTCMonth(), now.getUTCDate() + 1);
+  const headers: Record<string, string> = {
+    'X-Quota-Remaining': Math.max(0, remaining).toString(),
+    'X-Quota-Reset-In': Math.ceil((midnight - now.getTime()) / 1000).toString(),
+  };
+  if (personaId) headers['X-Persona-Id'] = personaId;
+  // The device switches local modes (e.g. WOODEN_FISH) from this
+  headers['X-Feature'] = feature || 'NONE';
+  return headers;
+}
+
 export async function POST(request: Request) {
+  const traceId = request.headers.get('x-trace-id');
+  const codec = pickCodec(request.headers.get('x-audio-caps'));
+  const requestStart = Date.now();
   try {
     const formData = await request.formData();
     const deviceId = formData.get('deviceId') as string;
@@ -72,63 +280,51 @@ export async function POST(request: Request) {
         // }).eq('device_id', deviceId);
     }
     
+    // Unprompted photos don't spend the user's daily turns
+    const counted = trigger !== 'AUTO_OBSERVE';
+
     // 2. Check Throttle (5 seconds)
+    // The device mirrors both limits (turn_quota.h) from these headers
     if (soul.last_interaction_ts) {
         const lastTime = new Date(soul.last_interaction_ts).getTime();
-        if (now.getTime() - lastTime < 5000) {
-            return NextResponse.json({ error: 'Too fast! Slow down.' }, { status: 429 });
+        const waitMs = THROTTLE_MS - (now.getTime() - lastTime);
+        if (waitMs > 0) {
+            return NextResponse.json({ error: 'Too fast! Slow down.' }, {
+              status: 429,
+              headers: {
+                'Retry-After': Math.ceil(waitMs / 1000).toString(),
+                ...soulHeaders(soul.active_persona_id, DAILY_QUOTA - currentCount, soul.current_feature),
+              },
+            });
         }
     }
     
     // 3. Check Quota (50 per day)
-    if (currentCount >= 50) {
+    if (currentCount >= DAILY_QUOTA) {
         // Return "I'm tired" Audio directly
         // We use a fallback text and skip Gemini
         const tiredText = "I am tired. Let's talk tomorrow.";
         
-        const tiredResponse = await axios.post(
-          'https://openspeech.bytedance.com/api/v1/tts',
-          {
-            app: {
-              appid: process.env.VOLCENGINE_APPID,
-              token: process.env.VOLCENGINE_ACCESS_TOKEN,
-              cluster: 'volcano_tts',
-            },
-            user: { uid: deviceId },
-            audio: {
-              voice_type: soul.voice_id || 'BV001_streaming',
-              encoding: 'mp3',
-              speed_ratio: 0.8, // Slow down to sound tired
-              volume_ratio: 1.0,
-              pitch_ratio: 0.9, // Lower pitch
-            },
-            request: {
-              reqid: crypto.randomUUID(),
-              text: tiredText,
-              text_type: 'plain',
-              operation: 'query',
-            },
-          },
-          {
-            headers: {
-              'Authorization': `Bearer;${process.env.VOLCENGINE_ACCESS_TOKEN}`,
-              'Content-Type': 'application/json',
-            },
-            responseType: 'arraybuffer',
-          }
-        );
+        const tiredTtsStart = Date.now();
+        // Slower and lower to sound tired
+        const tiredAudio = await synthesize(deviceId, soul.voice_id, tiredText, codec, { speed_ratio: 0.8, pitch_ratio: 0.9 });
         
-        return new NextResponse(tiredResponse.data, {
+        const tiredTtsMs = Date.now() - tiredTtsStart;
+        traceLog(traceId, { outcome: 'quota', tts_ms: tiredTtsMs, total_ms: Date.now() - requestStart });
+
+        return new NextResponse(tiredAudio, {
           headers: {
-            'Content-Type': 'audio/mpeg',
-            'Content-Length': tiredResponse.data.length.toString(),
+            'Content-Type': CODEC_TYPES[codec],
+            'Content-Length': tiredAudio.length.toString(),
+            ...timingHeaders(traceId, 0, tiredTtsMs),
+            ...soulHeaders(soul.active_persona_id, 0, soul.current_feature),
           },
         });
     }
 
     // UPDATE USAGE (Async, fire and forget to save latency)
     // supabase.from('souls').update({
-    //    daily_interactions_count: currentCount + 1,
+    //    daily_interactions_count: currentCount + (counted ? 1 : 0),
     //    last_interaction_ts: now.toISOString()
     // }).eq('device_id', deviceId).then();
 
@@ -386,7 +582,9 @@ export async function POST(request: Request) {
       });
     }
 
+    const geminiStart = Date.now();
     const result = await model.generateContent(contentParts);
+    const geminiMs = Date.now() - geminiStart;
 
     const generatedText = result.response.text();
     console.log('Gemini JSON Response:', generatedText);
@@ -413,50 +611,82 @@ export async function POST(request: Request) {
     });
 
     // 5. The Voice (Volcengine TTS)
-    const volcResponse = await axios.post(
-      'https://openspeech.bytedance.com/api/v1/tts',
-      {
-        app: {
-          appid: process.env.VOLCENGINE_APPID,
-          token: process.env.VOLCENGINE_ACCESS_TOKEN,
-          cluster: 'volcano_tts',
-        },
-        user: {
-          uid: deviceId,
-        },
-        audio: {
-          voice_type: soul.voice_id || 'BV001_streaming',
-          encoding: 'mp3',
-          speed_ratio: 1.0,
-          volume_ratio: 1.0,
-          pitch_ratio: 1.0,
-        },
-        request: {
-          reqid: crypto.randomUUID(),
-          text: parsedResponse.response, // Speak only the response part
-          text_type: 'plain',
-          operation: 'query',
+    const replyHeaders = (ttsMs: number) => ({
+      ...timingHeaders(traceId, geminiMs, ttsMs),
+      ...soulHeaders(soul.active_persona_id, DAILY_QUOTA - currentCount - (counted ? 1 : 0), soul.current_feature),
+    });
+
+    // Devices that accept segments start playing after the first sentence:
+    // all sentences are synthesized at once and streamed in order
+    if ((request.headers.get('accept') || '').includes(SEGMENT_CONTENT_TYPE)) {
+      const sentences = splitSentences(parsedResponse.response);
+      const ttsStart = Date.now();
+      const clips = sentences.map((text) => synthesize(deviceId, soul.voice_id, text, codec));
+      clips.forEach((clip) => clip.catch(() => {})); // a failure surfaces when its turn to stream comes
+      const first = await clips[0];
+      const firstTtsMs = Date.now() - ttsStart;
+
+      let audioBytes = 0;
+      const stream = new ReadableStream({
+        async start(controller) {
+          try {
+            for (let i = 0; i < sentences.length; i++) {
+              const audio = i === 0 ? first : await clips[i];
+              audioBytes += audio.length;
+              controller.enqueue(segmentFrame(i, i === sentences.length - 1, codec, sentences[i], audio));
+            }
+            traceLog(traceId, {
+              outcome: 'ok',
+              trigger: trigger || '',
+              gemini_ms: geminiMs,
+              tts_ms: firstTtsMs,
+              segments: sentences.length,
+              codec,
+              audio_bytes: audioBytes,
+              total_ms: Date.now() - requestStart,
+            });
+            controller.close();
+          } catch (e) {
+            // The device sees a stream without its last segment
+            console.error('Segment TTS failed:', e);
+            controller.error(e);
+          }
         },
-      },
-      {
+      });
+      return new NextResponse(stream, {
         headers: {
-          'Authorization': `Bearer;${process.env.VOLCENGINE_ACCESS_TOKEN}`,
-          'Content-Type': 'application/json',
+          'Content-Type': SEGMENT_CONTENT_TYPE,
+          ...replyHeaders(firstTtsMs),
         },
-        responseType: 'arraybuffer', // Get binary data
-      }
-    );
+      });
+    }
+
+    const ttsStart = Date.now();
+    const audio = await synthesize(deviceId, soul.voice_id, parsedResponse.response, codec); // Speak only the response part
+
+    const ttsMs = Date.now() - ttsStart;
+    traceLog(traceId, {
+      outcome: 'ok',
+      trigger: trigger || '',
+      gemini_ms: geminiMs,
+      tts_ms: ttsMs,
+      codec,
+      audio_bytes: audio.length,
+      total_ms: Date.now() - requestStart,
+    });
 
     // 6. Return Audio Stream
-    return new NextResponse(volcResponse.data, {
+    return new NextResponse(audio, {
       headers: {
-        'Content-Type': 'audio/mpeg',
-        'Content-Length': volcResponse.data.length.toString(),
+        'Content-Type': CODEC_TYPES[codec],
+        'Content-Length': audio.length.toString(),
+        ...replyHeaders(ttsMs),
       },
     });
 
   } catch (error: any) {
     console.error('Error in interact API:', error);
+    traceLog(traceId, { outcome: 'error', total_ms: Date.now() - requestStart });
     return NextResponse.json({ error: error.message || 'Internal Server Error' }, { status: 500 });
   }
 }
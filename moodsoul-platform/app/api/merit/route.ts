@@ -0,0 +1,66 @@
+import { NextResponse } from 'next/server';
+import { createClient } from '@supabase/supabase-js';
+
+// Cyber Zen (wooden fish) taps. The device counts taps locally and sends
+// coalesced batches: { deviceId, seq, taps }. A batch is resent until it's
+// acked, so each seq is applied once (app_data.fish_seq) and a retry just
+// gets the ack again. taps = 0 is a plain check-in: X-Feature, and
+// X-Merit-Seq for a device whose flash was wiped.
+
+const envUrl = process.env.NEXT_PUBLIC_SUPABASE_URL;
+const envKey = process.env.SUPABASE_SERVICE_ROLE_KEY || process.env.NEXT_PUBLIC_SUPABASE_ANON_KEY;
+
+const isValidUrl = (url: string | undefined) => url && url.startsWith('http') && url !== 'your_supabase_url';
+
+const supabaseUrl = isValidUrl(envUrl) ? envUrl! : 'https://placeholder-project.supabase.co';
+const supabaseServiceKey = (envKey && envKey !== 'your_supabase_service_key') ? envKey : 'placeholder-key';
+
+const supabase = createClient(supabaseUrl, supabaseServiceKey);
+
+const MAX_BATCH_TAPS = 10000; // ~15 min of frantic tapping
+
+export async function POST(request: Request) {
+  try {
+    const { deviceId, seq, taps } = await request.json();
+    if (!deviceId || !Number.isInteger(seq) || !Number.isInteger(taps) || seq < 0 ||
+        taps < 0 || taps > MAX_BATCH_TAPS) {
+      return NextResponse.json({ error: 'Missing deviceId or bad batch' }, { status: 400 });
+    }
+
+    const { data: soul, error } = await supabase
+      .from('souls')
+      .select('app_data, current_feature')
+      .eq('device_id', deviceId)
+      .single();
+    if (error || !soul) {
+      return NextResponse.json({ error: 'Soul not found' }, { status: 404 });
+    }
+
+    const appData = soul.app_data || {};
+    let total: number = appData.fish_count || 0;
+    let lastSeq: number = appData.fish_seq || 0;
+    if (taps > 0 && seq > lastSeq) {
+      total += taps;
+      lastSeq = seq;
+      const { error: updateError } = await supabase
+        .from('souls')
+        .update({ app_data: { ...appData, fish_count: total, fish_seq: lastSeq } })
+        .eq('device_id', deviceId);
+      if (updateError) {
+        // No ack: the device keeps the batch and resends it
+        return NextResponse.json({ error: 'Failed to save merit' }, { status: 500 });
+      }
+    }
+
+    return NextResponse.json({ total, ack: seq }, {
+      headers: {
+        'X-Merit-Ack': String(seq),
+        'X-Merit-Total': String(total),
+        'X-Merit-Seq': String(lastSeq), // lets a wiped device carry on after it
+        'X-Feature': soul.current_feature || 'NONE',
+      },
+    });
+  } catch (error: any) {
+    return NextResponse.json({ error: error.message }, { status: 500 });
+  }
+}
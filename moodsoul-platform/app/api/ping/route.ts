@@ -1,6 +1,14 @@
 import { NextResponse } from 'next/server';
 import { createClient } from '@supabase/supabase-js';
 
+// Device heartbeat. Old firmware sends JSON { deviceId }; current firmware
+// sends its fleet telemetry blob (pio/.../telemetry.h) as application/cbor
+// with the id in X-Device-Id, every ~5 min between turns. Either way the
+// soul's last_seen_at moves; the blob goes into device_telemetry
+// (db_telemetry_upgrade.sql). A 200 tells the device to start a new
+// interval, so telemetry that can't be stored is still acked: a failed
+// insert must not make the device resend stale data forever.
+
 // Create a Supabase client with the SERVICE ROLE KEY for admin access
 const envUrl = process.env.NEXT_PUBLIC_SUPABASE_URL;
 // Fallback to ANON_KEY if SERVICE_ROLE_KEY is missing (handles user misconfiguration where Service Key is put in Anon var)
@@ -9,13 +17,128 @@ const envKey = process.env.SUPABASE_SERVICE_ROLE_KEY || process.env.NEXT_PUBLIC_
 const isValidUrl = (url: string | undefined) => url && url.startsWith('http') && url !== 'your_supabase_url';
 
 const supabaseUrl = isValidUrl(envUrl) ? envUrl! : 'https://placeholder-project.supabase.co';
-const supabaseServiceKey = (envKey && envKey !== 'your_supabase_service_key') ? envKey : 'placeholder-key'; 
+const supabaseServiceKey = (envKey && envKey !== 'your_supabase_service_key') ? envKey : 'placeholder-key';
 
 const supabase = createClient(supabaseUrl, supabaseServiceKey);
 
+const MAX_BLOB_BYTES = 512; // TELEMETRY_MAX_BYTES
+
+// Indexed like the firmware's TelemetryStage / TelemetryCounter enums
+const STAGES = ['connect', 'upload', 'server', 'decode', 'reply', 'playback'];
+const COUNTERS = ['wifi_reconnects', 'wifi_roams', 'playback_underruns', 'connect_failures',
+  'send_failures', 'response_timeouts', 'prewarm_misses', 'barge_ins', 'mic_overruns'];
+
+// Just what the firmware writes: unsigned/negative ints, text, arrays and
+// maps (definite or indefinite length).
+function decodeCbor(buf: Uint8Array): any {
+  let pos = 0;
+  const byte = () => {
+    if (pos >= buf.length) throw new Error('truncated');
+    return buf[pos++];
+  };
+  const arg = (info: number) => {
+    if (info < 24) return info;
+    const n = info === 24 ? 1 : info === 25 ? 2 : info === 26 ? 4 : 0;
+    if (!n) throw new Error('unsupported length');
+    let v = 0;
+    for (let i = 0; i < n; i++) v = v * 256 + byte();
+    return v;
+  };
+  const item = (): any => {
+    const b = byte();
+    const major = b >> 5, info = b & 31;
+    if (major === 4 || major === 5) {
+      const indefinite = info === 31;
+      const n = indefinite ? Infinity : arg(info);
+      if (major === 4) {
+        const out: any[] = [];
+        for (let i = 0; i < n && !(indefinite && buf[pos] === 0xFF); i++) out.push(item());
+        if (indefinite) pos++;
+        return out;
+      }
+      const out: Record<string, any> = {};
+      for (let i = 0; i < n && !(indefinite && buf[pos] === 0xFF); i++) {
+        const k = item();
+        out[k] = item();
+      }
+      if (indefinite) pos++;
+      return out;
+    }
+    const v = arg(info);
+    if (major === 0) return v;
+    if (major === 1) return -1 - v;
+    if (major === 3) {
+      if (pos + v > buf.length) throw new Error('truncated');
+      const s = new TextDecoder().decode(buf.subarray(pos, pos + v));
+      pos += v;
+      return s;
+    }
+    throw new Error(`unsupported major type ${major}`);
+  };
+  return item();
+}
+
+// Half-octave ms buckets: 0 is < 1 ms, 2k+1 starts at 2^k, 2k+2 at 2^k * 1.41
+const bucketLowMs = (b: number) => (b === 0 ? 0 : Math.round(2 ** ((b - 1) / 2)));
+
+function stageSummary(h: number[]) {
+  const [maxMs, first, ...counts] = h;
+  const count = counts.reduce((a, c) => a + c, 0);
+  // Upper edge of the bucket holding the quantile, capped at the max seen
+  const quantile = (q: number) => {
+    let seen = 0;
+    for (let i = 0; i < counts.length; i++) {
+      seen += counts[i];
+      if (seen >= q * count) return Math.min(bucketLowMs(first + i + 1), maxMs);
+    }
+    return maxMs;
+  };
+  return { max_ms: maxMs, p50_ms: quantile(0.5), p90_ms: quantile(0.9), count, first_bucket: first, counts };
+}
+
+function telemetryRow(deviceId: string, t: any) {
+  const named = (names: string[], m: Record<string, any> | undefined, f: (v: any) => any) =>
+    Object.fromEntries(Object.entries(m || {}).map(([k, v]) => [names[Number(k)] || `#${k}`, f(v)]));
+  const [minHeap, heapLowWater, minPsram] = t[8] || [];
+  const [rssiMin, rssiMean, rssiMax] = t[9] || [];
+  return {
+    device_id: deviceId,
+    seq: t[1],
+    interval_s: t[2],
+    uptime_s: t[3],
+    firmware: t[4] ?? null,
+    reset_reason: t[5],
+    turns: t[6],
+    failed_turns: t[7],
+    min_free_heap: minHeap ?? null,
+    heap_low_water: heapLowWater ?? null,
+    min_free_psram: minPsram ?? null,
+    rssi_min: rssiMin ?? null,
+    rssi_mean: rssiMean ?? null,
+    rssi_max: rssiMax ?? null,
+    counters: named(COUNTERS, t[10], (v) => v),
+    stages: named(STAGES, t[11], stageSummary),
+  };
+}
+
 export async function POST(request: Request) {
   try {
-    const { deviceId } = await request.json();
+    let deviceId: string | null;
+    let telemetry: any = null;
+    if ((request.headers.get('content-type') || '').startsWith('application/cbor')) {
+      deviceId = request.headers.get('x-device-id');
+      const body = new Uint8Array(await request.arrayBuffer());
+      if (body.length > MAX_BLOB_BYTES) {
+        return NextResponse.json({ error: 'Telemetry too large' }, { status: 413 });
+      }
+      try {
+        telemetry = decodeCbor(body);
+      } catch (e: any) {
+        console.error('Bad telemetry from', deviceId, e.message);
+      }
+    } else {
+      ({ deviceId } = await request.json());
+    }
 
     if (!deviceId) {
       return NextResponse.json({ error: 'Missing deviceId' }, { status: 400 });
@@ -23,8 +146,7 @@ export async function POST(request: Request) {
 
     const { error } = await supabase
       .from('souls')
-      // .update({ last_seen_at: new Date().toISOString() }) // Removed: Column might be missing
-      .select('id') // Just check existence instead
+      .update({ last_seen_at: new Date().toISOString() })
       .eq('device_id', deviceId);
 
     if (error) {
@@ -32,6 +154,13 @@ export async function POST(request: Request) {
       return NextResponse.json({ error: 'Failed to update heartbeat' }, { status: 500 });
     }
 
+    if (telemetry && telemetry[0] === 1) {
+      const { error: insertError } = await supabase
+        .from('device_telemetry')
+        .insert(telemetryRow(deviceId, telemetry));
+      if (insertError) console.error('Telemetry insert failed:', insertError);
+    }
+
     return NextResponse.json({ status: 'ok', timestamp: new Date().toISOString() });
   } catch (error: any) {
     return NextResponse.json({ error: error.message }, { status: 500 });
@@ -0,0 +1,106 @@
+import { NextResponse } from 'next/server';
+import { createClient } from '@supabase/supabase-js';
+import { GoogleGenerativeAI } from '@google/generative-ai';
+import axios from 'axios';
+
+// Reaction clips the device prefetches while idle on the charger, so shake
+// and flip can answer from flash instead of a Gemini + TTS round trip.
+// Returns one clip as 16 kHz mono PCM16 WAV (what the device plays without
+// decoding) plus X-Persona-Id, which the device keys its cache on.
+
+const envUrl = process.env.NEXT_PUBLIC_SUPABASE_URL;
+const envKey = process.env.SUPABASE_SERVICE_ROLE_KEY || process.env.NEXT_PUBLIC_SUPABASE_ANON_KEY;
+
+const isValidUrl = (url: string | undefined) => url && url.startsWith('http') && url !== 'your_supabase_url';
+
+const supabaseUrl = isValidUrl(envUrl) ? envUrl! : 'https://placeholder-project.supabase.co';
+const supabaseServiceKey = (envKey && envKey !== 'your_supabase_service_key') ? envKey : 'placeholder-key';
+
+const supabase = createClient(supabaseUrl, supabaseServiceKey);
+const genAI = new GoogleGenerativeAI(process.env.GEMINI_API_KEY || '');
+
+const TRIGGER_TASKS: Record<string, string> = {
+  SHAKE_EVENT: `The user just shook you violently!
+       React to being shaken. You are dizzy, angry, or about to puke.
+       Complain loudly! Threaten to vomit electrons.`,
+  UPSIDE_DOWN: `You are being held upside down!
+       Blood is rushing to your head. Demand to be put down immediately! Panic!`,
+};
+
+export async function POST(request: Request) {
+  try {
+    const { deviceId, trigger } = await request.json();
+    const task = TRIGGER_TASKS[trigger];
+    if (!deviceId || !task) {
+      return NextResponse.json({ error: 'Missing deviceId or unknown trigger' }, { status: 400 });
+    }
+
+    const { data: soulData, error: soulError } = await supabase
+      .from('souls')
+      .select('*, personas!active_persona_id(*)')
+      .eq('device_id', deviceId)
+      .single();
+
+    if (soulError || !soulData) {
+      return NextResponse.json({ error: 'Soul not found' }, { status: 404 });
+    }
+    const soul = soulData as any;
+    const persona = soul.personas;
+
+    // The device keeps a few of these per trigger: ask for variety
+    const prompt = `${persona ? `You are ${persona.name}. Catchphrase: "${persona.catchphrase || ''}".
+       Sassiness Level: ${persona.toxicity_level || 50}/100. Chaos Level: ${persona.chaos_level || 50}/100.`
+      : `You are ${soul.archetype}.`}
+
+       CURRENT TASK:
+       ${task}
+       One short exclamation, under 12 words. Be inventive: don't reuse a stock phrase.
+       Output only the words to speak.`;
+
+    const result = await genAI.getGenerativeModel({ model: 'gemini-1.5-flash' }).generateContent(prompt);
+    const text = result.response.text().trim().replace(/^"|"$/g, '');
+
+    const volcResponse = await axios.post(
+      'https://openspeech.bytedance.com/api/v1/tts',
+      {
+        app: {
+          appid: process.env.VOLCENGINE_APPID,
+          token: process.env.VOLCENGINE_ACCESS_TOKEN,
+          cluster: 'volcano_tts',
+        },
+        user: { uid: deviceId },
+        audio: {
+          voice_type: soul.voice_id || 'BV001_streaming',
+          encoding: 'wav',
+          rate: 16000,
+          speed_ratio: 1.1,
+          volume_ratio: 1.0,
+          pitch_ratio: 1.0,
+        },
+        request: {
+          reqid: crypto.randomUUID(),
+          text,
+          text_type: 'plain',
+          operation: 'query',
+        },
+      },
+      {
+        headers: {
+          'Authorization': `Bearer;${process.env.VOLCENGINE_ACCESS_TOKEN}`,
+          'Content-Type': 'application/json',
+        },
+        responseType: 'arraybuffer',
+      }
+    );
+
+    const headers: Record<string, string> = {
+      'Content-Type': 'audio/wav',
+      'Content-Length': volcResponse.data.length.toString(),
+    };
+    if (soul.active_persona_id) headers['X-Persona-Id'] = soul.active_persona_id;
+    return new NextResponse(volcResponse.data, { headers });
+  } catch (error: any) {
+    console.error('Error in reactions API:', error);
+    return NextResponse.json({ error: error.message || 'Internal Server Error' }, { status: 500 });
+  }
+}
@@ -0,0 +1,25 @@
+-- Fleet telemetry carried by the device heartbeat (/api/ping)
+ALTER TABLE souls ADD COLUMN IF NOT EXISTS last_seen_at TIMESTAMP WITH TIME ZONE;
+
+CREATE TABLE IF NOT EXISTS device_telemetry (
+  id BIGSERIAL PRIMARY KEY,
+  device_id TEXT NOT NULL,
+  received_at TIMESTAMP WITH TIME ZONE DEFAULT NOW(),
+  seq INTEGER,
+  interval_s INTEGER,
+  uptime_s INTEGER,
+  firmware TEXT,
+  reset_reason INTEGER,
+  turns INTEGER,
+  failed_turns INTEGER,
+  min_free_heap INTEGER,
+  heap_low_water INTEGER,
+  min_free_psram INTEGER,
+  rssi_min INTEGER,
+  rssi_mean INTEGER,
+  rssi_max INTEGER,
+  counters JSONB,  -- { "wifi_reconnects": 2, ... } deltas over the interval
+  stages JSONB     -- { "reply": { "max_ms": 2400, "p50_ms": 1448, "p90_ms": 2048, "count": 12, "first_bucket": 19, "counts": [...] } }
+);
+
+CREATE INDEX IF NOT EXISTS device_telemetry_device_time ON device_telemetry (device_id, received_at DESC);
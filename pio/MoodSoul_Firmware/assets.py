@@ -0,0 +1,35 @@
+# pio run -t uploadassets
+# Builds the host asset tool, packs assets/ and writes the pack to the
+# "assets" partition, leaving the app image alone.
+import csv
+import os
+
+Import("env")
+
+PROJECT = env.subst("$PROJECT_DIR")
+PACK = os.path.join(env.subst("$BUILD_DIR"), "assets.bin")
+TOOL = os.path.join(PROJECT, ".pio", "build", "native-asset-tool", "program")
+
+
+def assets_offset():
+    with open(os.path.join(PROJECT, "partitions.csv")) as f:
+        for row in csv.reader(line for line in f if not line.startswith("#")):
+            if row and row[0].strip() == "assets":
+                return row[3].strip()
+    raise SystemExit("partitions.csv has no assets partition")
+
+
+def upload_assets(*args, **kwargs):
+    version = os.environ.get("MOODSOUL_ASSET_VERSION", "1")
+    if env.Execute("pio run -d \"%s\" -e native-asset-tool" % PROJECT):
+        raise SystemExit(1)
+    if env.Execute("\"%s\" pack \"%s\" \"%s\" --version %s" % (TOOL, os.path.join(PROJECT, "assets"), PACK, version)):
+        raise SystemExit(1)
+    env.AutodetectUploadPort()
+    esptool = os.path.join(env.PioPlatform().get_package_dir("tool-esptoolpy"), "esptool.py")
+    env.Execute("\"$PYTHONEXE\" \"%s\" --chip esp32s3 --port \"$UPLOAD_PORT\" --baud $UPLOAD_SPEED write_flash %s \"%s\""
+                % (esptool, assets_offset(), PACK))
+
+
+env.AddCustomTarget("uploadassets", None, upload_assets, title="Upload Assets",
+                    description="Pack assets/ and flash the assets partition")
@@ -0,0 +1,91 @@
+#include "aec.h"
+#include "dsp_q15.h"
+#include <math.h>
+#include <string.h>
+
+#define AEC_MU        0.5f
+#define AEC_EPS       (AEC_TAPS * 32.0f * 32.0f)  // regularizer: -60 dBFS reference
+
+#define FAR_MIN       (64.0f * 64.0f)    // reference below this counts as silence (-54 dBFS)
+#define NEAR_RATIO    8.0f               // residual over expected leakage (9 dB)
+#define NEAR_MIN      (200.0f * 200.0f)  // and at least -44 dBFS
+#define WARM_BLOCKS   30                 // 300 ms of far end before trusting `leak`
+#define LEAK_RATE     0.05f
+#define NOISE_RISE    1.01f              // per block, ~4 dB/s
+
+void aecInit(Aec& a) {
+    memset(a.w, 0, sizeof(a.w));
+    memset(a.hist, 0, sizeof(a.hist));
+    a.power = 0.0f;
+    dspInit();
+}
+
+AecLevels aecProcess(Aec& a, const int16_t* mic, const int16_t* ref, int16_t* out, bool freeze) {
+    // Slide the reference history: the last AEC_TAPS - 1 samples stay
+    memmove(a.hist, a.hist + AEC_BLOCK, (AEC_TAPS - 1) * sizeof(float));
+    float* in = a.hist + AEC_TAPS - 1;
+    AecLevels lv = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < AEC_BLOCK; i++) {
+        in[i] = ref[i];
+        lv.ref += in[i] * in[i];
+    }
+    // Recomputed per block rather than tracked per sample: no drift
+    a.power = dspDotF32(a.hist, a.hist, AEC_TAPS - 1);
+
+    for (int i = 0; i < AEC_BLOCK; i++) {
+        const float* x = a.hist + i; // x[AEC_TAPS - 1] is the newest sample
+        a.power += x[AEC_TAPS - 1] * x[AEC_TAPS - 1];
+        float e = mic[i] - dspDotF32(a.w, x, AEC_TAPS);
+        if (!freeze && a.power > 0.0f) {
+            float g = AEC_MU * e / (a.power + AEC_EPS);
+            for (int k = 0; k < AEC_TAPS; k++) a.w[k] += g * x[k];
+        }
+        a.power -= x[0] * x[0];
+        if (a.power < 0.0f) a.power = 0.0f;
+
+        float m = mic[i];
+        lv.mic += m * m;
+        lv.out += e * e;
+        out[i] = (int16_t)(e < -32768.0f ? -32768 : e > 32767.0f ? 32767 : lrintf(e));
+    }
+    lv.mic /= AEC_BLOCK;
+    lv.ref /= AEC_BLOCK;
+    lv.out /= AEC_BLOCK;
+    return lv;
+}
+
+void bargeInit(BargeDetector& d) {
+    d.noise = 0.0f;
+    d.leak = 1.0f;
+    d.farBlocks = 0;
+    d.run = 0;
+    d.nearEnd = false;
+    d.erleDb = 0.0f;
+}
+
+bool bargeUpdate(BargeDetector& d, const AecLevels& lv) {
+    bool far = lv.ref > FAR_MIN;
+    if (d.noise == 0.0f) d.noise = lv.out > 1.0f ? lv.out : 1.0f;
+    float expected = d.leak * lv.ref + d.noise;
+    bool warm = d.farBlocks >= WARM_BLOCKS;
+
+    d.nearEnd = warm && lv.out > NEAR_RATIO * expected && lv.out > NEAR_MIN;
+    if (!d.nearEnd) {
+        // Floor: follows drops at once, creeps up otherwise
+        if (!far) d.noise = lv.out < d.noise ? lv.out : d.noise * NOISE_RISE;
+        if (far) {
+            float ratio = lv.out / lv.ref;
+            // Warm-up takes whatever the filter leaves; after that, leak
+            // only creeps upwards so a soft voice can't raise the bar
+            if (!warm || ratio < d.leak) d.leak += (ratio - d.leak) * (warm ? LEAK_RATE : 0.2f);
+            else d.leak *= 1.0f + LEAK_RATE * 0.2f;
+            if (d.farBlocks < WARM_BLOCKS) d.farBlocks++;
+            if (lv.out > 0.0f) {
+                float erle = 10.0f * log10f((lv.mic + 1.0f) / (lv.out + 1.0f));
+                d.erleDb += (erle - d.erleDb) * 0.05f;
+            }
+        }
+    }
+    d.run = d.nearEnd ? d.run + 1 : 0;
+    return d.run == BARGE_RUN_BLOCKS;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// ECHO CANCELLER + BARGE-IN DETECTOR
+// ==========================================
+// While the device talks, the mic hears its own speaker. Aec subtracts an
+// NLMS estimate of that echo, using the samples sent to the speaker as the
+// reference; BargeDetector then decides from the residual whether the user
+// is talking over the playback.
+//
+// The reference must already be aligned for the bulk output-to-input delay
+// (the I2S DMA depth, see audio_duplex.cpp); AEC_TAPS then covers the
+// acoustic path inside the enclosure plus some slack. Float: the S3 FPU
+// does a multiply-add per cycle and NLMS in Q15 loses too much on quiet
+// references.
+//
+// The detector compares the residual with what the canceller usually leaves
+// behind (leak x reference power) plus the noise floor, and fires after
+// BARGE_RUN_BLOCKS near-end blocks in a row. Adaptation freezes on such
+// blocks so the user's voice doesn't pull the filter off.
+
+#define AEC_BLOCK        160  // 10 ms at 16 kHz
+#define AEC_TAPS         256  // 16 ms of echo tail after the bulk delay
+#define BARGE_RUN_BLOCKS 4    // 40 ms of talk before playback is cut
+
+struct Aec {
+    float w[AEC_TAPS];                      // filter, reversed (w[0] = oldest tap)
+    float hist[AEC_TAPS - 1 + AEC_BLOCK];   // reference, oldest first
+    float power;                            // reference energy over the taps
+};
+
+// Mean-square levels of one block, int16 scale.
+struct AecLevels {
+    float mic, ref, out;
+};
+
+struct BargeDetector {
+    float    noise;      // residual floor without far end
+    float    leak;       // residual / reference power while only the far end plays
+    uint16_t farBlocks;  // far-end blocks seen (convergence warm-up)
+    uint8_t  run;        // consecutive near-end blocks
+    bool     nearEnd;    // last block looked like the user: freeze adaptation
+    float    erleDb;     // smoothed echo return loss enhancement, for stats
+};
+
+void aecInit(Aec& a);
+// One AEC_BLOCK: out = mic - echo estimate. Adapts unless `freeze`.
+AecLevels aecProcess(Aec& a, const int16_t* mic, const int16_t* ref, int16_t* out, bool freeze);
+
+void bargeInit(BargeDetector& d);
+// Feeds one block's levels. True on the block that completes a run of
+// near-end talk; the talk started BARGE_RUN_BLOCKS - 1 blocks earlier.
+bool bargeUpdate(BargeDetector& d, const AecLevels& lv);
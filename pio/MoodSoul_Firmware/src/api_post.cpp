@@ -0,0 +1,12 @@
+#include "api_post.h"
+
+bool apiPostBegin(HTTPClient& http, WiFiClientSecure& client, const String& url, uint32_t timeoutMs,
+                  const char* contentType, const char* headers[], size_t headerCount) {
+    client.setInsecure();
+    http.setConnectTimeout(timeoutMs);
+    http.setTimeout(timeoutMs);
+    if (!http.begin(client, url)) return false;
+    if (headerCount) http.collectHeaders(headers, headerCount);
+    http.addHeader("Content-Type", contentType);
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// BACKGROUND API POSTS
+// ==========================================
+// The small HTTPS POSTs the background tasks make to the server's /api
+// routes (heartbeat, wooden fish, reaction prefetch), one connection per
+// request. TLS is the same as the interaction path's: no cert pinning yet.
+
+// Opens `http` on `client` for a POST to `url`: connect and read timeouts
+// of timeoutMs, the Content-Type set, and the `headers` of the reply kept
+// for http.header(). False if it can't begin. The caller POSTs, reads
+// the reply and calls http.end().
+bool apiPostBegin(HTTPClient& http, WiFiClientSecure& client, const String& url, uint32_t timeoutMs,
+                  const char* contentType, const char* headers[] = nullptr, size_t headerCount = 0);
@@ -0,0 +1,294 @@
+#include "asset_pack.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ4_MINMATCH     4
+#define LZ4_LASTLITERALS 5
+#define LZ4_MFLIMIT      12
+#define LZ4_HASH_LOG     12
+
+static_assert(sizeof(AssetPackHeader) == 64, "pack header layout");
+static_assert(sizeof(AssetEntry) == 24, "pack entry layout");
+
+uint32_t assetHash(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h ? h : 1; // 0 marks an empty slot
+}
+
+uint32_t assetCrc32(const uint8_t* data, size_t len, uint32_t crc) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static bool isPow2(uint32_t v) {
+    return v && !(v & (v - 1));
+}
+
+bool assetPackOpen(AssetPack& pack, const void* base, size_t size, bool verify) {
+    memset(&pack, 0, sizeof(pack));
+    if (!base || size < sizeof(AssetPackHeader)) return false;
+    const AssetPackHeader* h = (const AssetPackHeader*)base;
+    if (h->magic != ASSET_MAGIC || h->format != ASSET_FORMAT) return false;
+    if (!isPow2(h->align) || !isPow2(h->slots)) return false;
+    if (h->totalSize > size || h->totalSize < sizeof(AssetPackHeader)) return false;
+    if (h->tableOffset < sizeof(AssetPackHeader) ||
+        (uint64_t)h->tableOffset + (uint64_t)h->slots * sizeof(AssetEntry) > h->namesOffset ||
+        h->namesOffset > h->dataOffset || h->dataOffset > h->totalSize) {
+        return false;
+    }
+    const uint8_t* p = (const uint8_t*)base;
+    if (verify && assetCrc32(p + sizeof(AssetPackHeader), h->totalSize - sizeof(AssetPackHeader)) != h->crc32) {
+        return false;
+    }
+    pack.base = p;
+    pack.header = h;
+    pack.table = (const AssetEntry*)(p + h->tableOffset);
+    return true;
+}
+
+// Stored entries are their raw bytes: readers size buffers by rawSize
+static bool entryOk(const AssetPack& pack, const AssetEntry& e) {
+    const AssetPackHeader* h = pack.header;
+    return e.nameOff < h->dataOffset - h->namesOffset && e.offset >= h->dataOffset &&
+           (uint64_t)e.offset + e.size <= h->totalSize && ((e.flags & ASSET_LZ4) || e.size == e.rawSize);
+}
+
+bool assetFind(const AssetPack& pack, const char* name, AssetInfo& info) {
+    if (!pack.header) return false;
+    uint32_t hash = assetHash(name);
+    uint32_t mask = pack.header->slots - 1;
+    const char* names = (const char*)pack.base + pack.header->namesOffset;
+    for (uint32_t i = 0, slot = hash & mask; i <= mask; i++, slot = (slot + 1) & mask) {
+        const AssetEntry& e = pack.table[slot];
+        if (e.hash == 0) return false;
+        if (e.hash != hash || !entryOk(pack, e)) continue;
+        if (strncmp(names + e.nameOff, name, pack.header->dataOffset - pack.header->namesOffset - e.nameOff) != 0) {
+            continue;
+        }
+        info.data = pack.base + e.offset;
+        info.size = e.size;
+        info.rawSize = e.rawSize;
+        info.flags = e.flags;
+        info.type = e.type;
+        return true;
+    }
+    return false;
+}
+
+const uint8_t* assetDirect(const AssetInfo& info) {
+    return (info.flags & ASSET_LZ4) ? nullptr : info.data;
+}
+
+size_t assetRead(const AssetInfo& info, void* out, size_t cap) {
+    if (info.rawSize > cap) return 0;
+    if (!(info.flags & ASSET_LZ4)) {
+        if (info.size > cap) return 0;
+        memcpy(out, info.data, info.size);
+        return info.size;
+    }
+    size_t n = lz4Decompress(info.data, info.size, (uint8_t*)out, cap);
+    return n == info.rawSize ? n : 0;
+}
+
+void assetForEach(const AssetPack& pack, void (*fn)(const char* name, const AssetEntry& e, void* ctx), void* ctx) {
+    if (!pack.header) return;
+    const char* names = (const char*)pack.base + pack.header->namesOffset;
+    for (uint32_t i = 0; i < pack.header->slots; i++) {
+        const AssetEntry& e = pack.table[i];
+        if (e.hash && entryOk(pack, e)) fn(names + e.nameOff, e, ctx);
+    }
+}
+
+// ------------------------------------------
+// LZ4 block
+// ------------------------------------------
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Length continuation bytes for a 4-bit field that overflowed.
+static bool putLength(uint8_t* dst, size_t cap, size_t& op, size_t n) {
+    for (; n >= 255; n -= 255) {
+        if (op >= cap) return false;
+        dst[op++] = 255;
+    }
+    if (op >= cap) return false;
+    dst[op++] = (uint8_t)n;
+    return true;
+}
+
+static bool emit(uint8_t* dst, size_t cap, size_t& op, const uint8_t* lit, size_t litLen,
+                 size_t offset, size_t matchLen) {
+    if (op >= cap) return false;
+    size_t m = matchLen ? matchLen - LZ4_MINMATCH : 0;
+    size_t token = op++;
+    dst[token] = (uint8_t)((litLen < 15 ? litLen : 15) << 4 | (m < 15 ? m : 15));
+    if (litLen >= 15 && !putLength(dst, cap, op, litLen - 15)) return false;
+    if (op + litLen > cap) return false;
+    memcpy(dst + op, lit, litLen);
+    op += litLen;
+    if (!matchLen) return true;
+    if (op + 2 > cap) return false;
+    dst[op++] = (uint8_t)offset;
+    dst[op++] = (uint8_t)(offset >> 8);
+    return m < 15 || putLength(dst, cap, op, m - 15);
+}
+
+size_t lz4Compress(const uint8_t* src, size_t len, uint8_t* dst, size_t cap) {
+    uint32_t* table = (uint32_t*)calloc(1u << LZ4_HASH_LOG, sizeof(uint32_t)); // position + 1
+    if (!table) return 0;
+    size_t ip = 0, anchor = 0, op = 0;
+    bool ok = true;
+    if (len > LZ4_MFLIMIT) {
+        size_t limit = len - LZ4_MFLIMIT;
+        size_t matchEnd = len - LZ4_LASTLITERALS;
+        while (ok && ip < limit) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - LZ4_HASH_LOG);
+            size_t ref = table[h];
+            table[h] = (uint32_t)ip + 1;
+            if (!ref || ip - (ref - 1) > 65535 || read32(src + ref - 1) != seq) {
+                ip++;
+                continue;
+            }
+            ref--;
+            size_t n = LZ4_MINMATCH;
+            while (ip + n < matchEnd && src[ip + n] == src[ref + n]) n++;
+            ok = emit(dst, cap, op, src + anchor, ip - anchor, ip - ref, n);
+            ip += n;
+            anchor = ip;
+        }
+    }
+    ok = ok && emit(dst, cap, op, src + anchor, len - anchor, 0, 0);
+    free(table);
+    return ok ? op : 0;
+}
+
+size_t lz4Decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t cap) {
+    size_t ip = 0, op = 0;
+    while (ip < len) {
+        uint8_t token = src[ip++];
+        size_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= len) return 0;
+                b = src[ip++];
+                lit += b;
+            } while (b == 255);
+        }
+        if (ip + lit > len || op + lit > cap) return 0;
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip >= len) break; // the last sequence is literals only
+
+        if (ip + 2 > len) return 0;
+        size_t offset = src[ip] | src[ip + 1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > op) return 0;
+        size_t n = token & 15;
+        if (n == 15) {
+            uint8_t b;
+            do {
+                if (ip >= len) return 0;
+                b = src[ip++];
+                n += b;
+            } while (b == 255);
+        }
+        n += LZ4_MINMATCH;
+        if (op + n > cap) return 0;
+        // Byte by byte: the match may overlap what it's copying
+        for (size_t i = 0; i < n; i++, op++) dst[op] = dst[op - offset];
+    }
+    return op;
+}
+
+// ------------------------------------------
+// Building
+// ------------------------------------------
+static uint32_t tableSlots(size_t count) {
+    uint32_t slots = 2;
+    while (slots < count * 2) slots <<= 1;
+    return slots;
+}
+
+static size_t alignUp(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+size_t assetPackBound(const AssetSource* src, size_t count, uint16_t align) {
+    size_t n = sizeof(AssetPackHeader) + tableSlots(count) * sizeof(AssetEntry) + align;
+    for (size_t i = 0; i < count; i++) n += strlen(src[i].name) + 1 + src[i].len + align;
+    return n;
+}
+
+size_t assetPackBuild(const AssetSource* src, size_t count, uint32_t packVersion, uint16_t align,
+                      uint8_t* out, size_t cap) {
+    if (!isPow2(align) || cap < assetPackBound(src, count, align)) return 0;
+    memset(out, 0, cap);
+    AssetPackHeader h = {};
+    h.magic = ASSET_MAGIC;
+    h.format = ASSET_FORMAT;
+    h.align = align;
+    h.packVersion = packVersion;
+    h.count = (uint32_t)count;
+    h.slots = tableSlots(count);
+    h.tableOffset = sizeof(AssetPackHeader);
+    h.namesOffset = h.tableOffset + h.slots * sizeof(AssetEntry);
+    AssetEntry* table = (AssetEntry*)(out + h.tableOffset);
+
+    size_t namesLen = 0;
+    for (size_t i = 0; i < count; i++) namesLen += strlen(src[i].name) + 1;
+    h.dataOffset = (uint32_t)alignUp(h.namesOffset + namesLen, align);
+
+    size_t nameAt = h.namesOffset, dataAt = h.dataOffset;
+    for (size_t i = 0; i < count; i++) {
+        const AssetSource& s = src[i];
+        uint32_t hash = assetHash(s.name);
+        uint32_t slot = hash & (h.slots - 1);
+        for (; table[slot].hash; slot = (slot + 1) & (h.slots - 1)) {
+            if (table[slot].hash == hash && strcmp((const char*)out + h.namesOffset + table[slot].nameOff, s.name) == 0) {
+                return 0; // duplicate
+            }
+        }
+        AssetEntry& e = table[slot];
+        e.hash = hash;
+        e.nameOff = (uint32_t)(nameAt - h.namesOffset);
+        size_t nameLen = strlen(s.name) + 1;
+        memcpy(out + nameAt, s.name, nameLen);
+        nameAt += nameLen;
+
+        e.offset = (uint32_t)dataAt;
+        e.rawSize = s.len;
+        e.type = s.type;
+        size_t packed = s.compress ? lz4Compress(s.data, s.len, out + dataAt, s.len - s.len / 8) : 0;
+        if (packed) {
+            e.size = (uint32_t)packed;
+            e.flags = ASSET_LZ4;
+        } else {
+            memcpy(out + dataAt, s.data, s.len);
+            e.size = s.len;
+        }
+        dataAt = alignUp(dataAt + e.size, align);
+    }
+    h.totalSize = (uint32_t)dataAt;
+    h.crc32 = assetCrc32(out + sizeof(AssetPackHeader), h.totalSize - sizeof(AssetPackHeader));
+    memcpy(out, &h, sizeof(h));
+    return h.totalSize;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// ASSET PACK FORMAT
+// ==========================================
+// Read-only bundle of named blobs (sounds, icons, setup screens) flashed
+// to its own partition and read in place through esp_partition_mmap
+// (asset_store.h), so an uncompressed entry is a pointer, not a copy.
+// Built on the host by asset-tool (env:native-asset-tool).
+//
+//   AssetPackHeader      64 bytes, little-endian
+//   AssetEntry[slots]    open-addressed hash table, slots a power of two
+//   names                NUL-terminated, referenced by AssetEntry.nameOff
+//   data                 each entry aligned to header.align
+//
+// The table is keyed by FNV-1a of the name with linear probing; hash 0
+// marks an empty slot. Entries may be LZ4-block compressed when that saves
+// enough; `size` is the stored length, `rawSize` the decoded one.
+// header.crc32 covers everything after the header, and the header is
+// written last, so a half-written pack never opens. packVersion is the
+// content's own version: packs update independently of the app image.
+
+#define ASSET_MAGIC        0x5041534D // "MSAP"
+#define ASSET_FORMAT       1
+#define ASSET_DEFAULT_ALIGN 16
+
+enum AssetFlags : uint16_t {
+    ASSET_LZ4 = 1 << 0,
+};
+
+// AssetEntry.type, set by the packer from the file extension
+enum AssetType : uint16_t {
+    ASSET_TYPE_RAW = 0,
+    ASSET_TYPE_WAV,     // 16 kHz mono PCM16, see clip_store.h
+    ASSET_TYPE_RGB565,  // little-endian pixels, width/height from the name
+    ASSET_TYPE_JPEG,
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint16_t format;       // ASSET_FORMAT
+    uint16_t align;        // data alignment, power of two
+    uint32_t packVersion;
+    uint32_t count;        // entries
+    uint32_t slots;        // hash table size
+    uint32_t tableOffset;
+    uint32_t namesOffset;
+    uint32_t dataOffset;
+    uint32_t totalSize;    // header through the last data byte
+    uint32_t crc32;        // of bytes [sizeof(header), totalSize)
+    uint8_t  reserved[24];
+};
+
+struct AssetEntry {
+    uint32_t hash;
+    uint32_t nameOff;      // from namesOffset
+    uint32_t offset;       // from the pack start
+    uint32_t size;         // stored bytes
+    uint32_t rawSize;      // decoded bytes
+    uint16_t flags;        // AssetFlags
+    uint16_t type;         // AssetType
+};
+
+struct AssetPack {
+    const uint8_t*         base;
+    const AssetPackHeader* header;
+    const AssetEntry*      table;
+};
+
+struct AssetInfo {
+    const uint8_t* data;   // stored bytes, inside the pack
+    uint32_t       size;
+    uint32_t       rawSize;
+    uint16_t       flags;
+    uint16_t       type;
+};
+
+uint32_t assetHash(const char* name);
+uint32_t assetCrc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+// Checks magic, format and bounds; the CRC too if `verify` (a full read
+// of the pack, so skip it on hot paths once a pack is known good).
+bool assetPackOpen(AssetPack& pack, const void* base, size_t size, bool verify);
+bool assetFind(const AssetPack& pack, const char* name, AssetInfo& info);
+// Uncompressed data straight from the pack, nullptr if the entry is
+// compressed (use assetRead).
+const uint8_t* assetDirect(const AssetInfo& info);
+// Decodes or copies into `out`; returns rawSize, 0 on error or if it
+// doesn't fit.
+size_t assetRead(const AssetInfo& info, void* out, size_t cap);
+// Calls fn for every entry (table order).
+void assetForEach(const AssetPack& pack, void (*fn)(const char* name, const AssetEntry& e, void* ctx), void* ctx);
+
+// LZ4 block format, no frame. Compress returns 0 if it didn't fit in cap.
+size_t lz4Compress(const uint8_t* src, size_t len, uint8_t* dst, size_t cap);
+size_t lz4Decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t cap);
+
+// ------------------------------------------
+// Building (host tool, benchmarks)
+// ------------------------------------------
+struct AssetSource {
+    const char*    name;
+    const uint8_t* data;
+    uint32_t       len;
+    uint16_t       type;
+    bool           compress; // try LZ4, kept only if it saves >= 1/8
+};
+
+// Size assetPackBuild() needs at most.
+size_t assetPackBound(const AssetSource* src, size_t count, uint16_t align);
+// Writes the pack into `out`; returns its size, 0 on failure (duplicate
+// name, bad alignment, too small).
+size_t assetPackBuild(const AssetSource* src, size_t count, uint32_t packVersion, uint16_t align,
+                      uint8_t* out, size_t cap);
@@ -0,0 +1,136 @@
+#include "asset_store.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_partition.h>
+
+static const esp_partition_t* part = nullptr;
+static spi_flash_mmap_handle_t mapHandle = 0;
+static const uint8_t*  mapped = nullptr;
+static size_t          mappedSize = 0;
+static AssetPack       pack;
+static bool            ready = false;
+static AssetPackHeader pending;     // update: the header goes in last
+static uint32_t        pendingSize = 0, pendingAt = 0;
+
+static Gauge metricAssetVersion("moodsoul_asset_pack_version", "Asset pack version in flash, 0 if none");
+static Gauge metricAssetBytes("moodsoul_asset_pack_bytes", "Asset pack size in flash");
+
+static void unmap() {
+    ready = false;
+    memset(&pack, 0, sizeof(pack));
+    if (mapped) spi_flash_munmap(mapHandle);
+    mapped = nullptr;
+    mappedSize = 0;
+    metricAssetVersion.set(0);
+    metricAssetBytes.set(0);
+}
+
+static const esp_partition_t* findPartition() {
+    if (!part) {
+        part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_PARTITION_SUBTYPE,
+                                        ASSET_PARTITION_LABEL);
+    }
+    return part;
+}
+
+bool assetStoreBegin() {
+    if (ready) return true;
+    if (!findPartition()) {
+        Serial.println("[ASSET] no assets partition");
+        return false;
+    }
+    AssetPackHeader h;
+    if (esp_partition_read(part, 0, &h, sizeof(h)) != ESP_OK || h.magic != ASSET_MAGIC ||
+        h.totalSize > part->size || h.totalSize < sizeof(h)) {
+        Serial.println("[ASSET] no pack flashed");
+        return false;
+    }
+    const void* ptr;
+    if (esp_partition_mmap(part, 0, h.totalSize, SPI_FLASH_MMAP_DATA, &ptr, &mapHandle) != ESP_OK) {
+        Serial.println("[ASSET] mmap failed");
+        return false;
+    }
+    mapped = (const uint8_t*)ptr;
+    mappedSize = h.totalSize;
+
+    // A full CRC pass reads the whole pack: only for a pack not seen before
+    Preferences p;
+    p.begin("moodsoul", false);
+    bool known = p.getUInt("asset_crc", 0) == h.crc32 && h.crc32 != 0;
+    uint32_t t0 = millis();
+    ready = assetPackOpen(pack, mapped, mappedSize, !known);
+    if (ready && !known) {
+        p.putUInt("asset_crc", h.crc32);
+        Serial.printf("[ASSET] pack v%u verified in %lu ms\n", h.packVersion, (unsigned long)(millis() - t0));
+    }
+    p.end();
+    if (!ready) {
+        Serial.println("[ASSET] pack failed its check");
+        unmap();
+        return false;
+    }
+    metricAssetVersion.set(h.packVersion);
+    metricAssetBytes.set(h.totalSize);
+    Serial.printf("[ASSET] pack v%u: %u entries, %u KB\n", h.packVersion, h.count, h.totalSize / 1024);
+    return true;
+}
+
+const AssetPack* assetStorePack() {
+    return ready ? &pack : nullptr;
+}
+
+uint32_t assetStoreVersion() {
+    return ready ? pack.header->packVersion : 0;
+}
+
+bool assetStoreGet(const char* name, AssetInfo& info) {
+    return ready && assetFind(pack, name, info);
+}
+
+bool assetStoreOwns(const void* p) {
+    return mapped && (const uint8_t*)p >= mapped && (const uint8_t*)p < mapped + mappedSize;
+}
+
+bool assetStoreUpdateBegin(uint32_t size) {
+    if (!findPartition() || size < sizeof(AssetPackHeader) || size > part->size) return false;
+    unmap();
+    uint32_t eraseLen = (size + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    if (esp_partition_erase_range(part, 0, eraseLen) != ESP_OK) return false;
+    memset(&pending, 0, sizeof(pending));
+    pendingSize = size;
+    pendingAt = 0;
+    return true;
+}
+
+bool assetStoreUpdateWrite(const uint8_t* data, size_t len) {
+    if (!pendingSize || pendingAt + len > pendingSize) return false;
+    // Hold the header back: until it's written the partition reads as empty
+    while (len && pendingAt < sizeof(pending)) {
+        ((uint8_t*)&pending)[pendingAt++] = *data++;
+        len--;
+    }
+    if (!len) return true;
+    if (esp_partition_write(part, pendingAt, data, len) != ESP_OK) return false;
+    pendingAt += len;
+    return true;
+}
+
+bool assetStoreUpdateEnd() {
+    bool ok = pendingSize && pendingAt == pendingSize && pending.magic == ASSET_MAGIC &&
+              pending.format == ASSET_FORMAT && pending.totalSize == pendingSize;
+    if (ok) {
+        uint8_t buf[1024];
+        uint32_t crc = 0;
+        for (uint32_t at = sizeof(pending); ok && at < pendingSize; at += sizeof(buf)) {
+            uint32_t n = std::min<uint32_t>(sizeof(buf), pendingSize - at);
+            ok = esp_partition_read(part, at, buf, n) == ESP_OK;
+            crc = assetCrc32(buf, n, crc);
+        }
+        ok = ok && crc == pending.crc32;
+    }
+    ok = ok && esp_partition_write(part, 0, &pending, sizeof(pending)) == ESP_OK;
+    Serial.printf("[ASSET] update to v%u %s\n", pending.packVersion, ok ? "written, active after reboot" : "failed");
+    pendingSize = 0;
+    return ok;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "asset_pack.h"
+
+// ==========================================
+// ASSET STORE (FLASH PARTITION)
+// ==========================================
+// The asset pack (asset_pack.h) lives in its own "assets" data partition
+// (partitions.csv) and is mapped into the address space with
+// esp_partition_mmap: lookups walk the table in flash and uncompressed
+// entries are used in place. The CRC is checked once per pack, the first
+// time it's seen, and remembered in NVS.
+//
+// Packs are flashed with `pio run -t uploadassets` or streamed in through
+// assetStoreUpdate*(), independently of the app image. An update takes
+// effect at the next boot; pointers into the old pack go stale as soon as
+// it starts, so update before anything is loaded from it, or reboot.
+
+#define ASSET_PARTITION_LABEL   "assets"
+#define ASSET_PARTITION_SUBTYPE 0x40
+
+// Maps the pack. False if there is no partition or no valid pack in it.
+bool assetStoreBegin();
+const AssetPack* assetStorePack(); // nullptr without a pack
+uint32_t assetStoreVersion();      // packVersion, 0 without a pack
+bool assetStoreGet(const char* name, AssetInfo& info);
+// True if p points into the mapped pack (so it must not be freed).
+bool assetStoreOwns(const void* p);
+
+bool assetStoreUpdateBegin(uint32_t size);
+bool assetStoreUpdateWrite(const uint8_t* data, size_t len);
+// Checks the CRC and commits the header. False leaves no valid pack.
+bool assetStoreUpdateEnd();
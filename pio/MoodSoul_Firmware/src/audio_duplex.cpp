@@ -0,0 +1,272 @@
+#include "audio_duplex.h"
+#include "aec.h"
+#include "lockfree_ring.h"
+#include "mic_stream.h"
+#include "metrics.h"
+#include <M5Unified.h>
+#include <driver/i2s.h>
+#include <esp_timer.h>
+
+// CoreS3 wiring (same pins M5Unified uses for the mic and the speaker)
+#define DUPLEX_PORT     I2S_NUM_1
+#define PIN_MCK         GPIO_NUM_0
+#define PIN_BCK         GPIO_NUM_34
+#define PIN_WS          GPIO_NUM_33
+#define PIN_DOUT        GPIO_NUM_13
+#define PIN_DIN         GPIO_NUM_14
+#define AW88298_ADDR    0x36
+#define AW9523_ADDR     0x58
+
+// The task writes one TX block per RX block, so the TX queue stays at the
+// prefill depth and a speaker sample reaches the mic that many blocks
+// later. The reference is taken a little earlier than that, so the echo
+// lands inside the AEC taps even if the acoustic path is long.
+#define TX_DMA_BUFS     4
+#define TX_PREFILL      2
+#define REF_DELAY       (TX_PREFILL * AEC_BLOCK - 48)
+#define REF_LINE        1024                     // power of two > REF_DELAY + AEC_BLOCK
+#define PLAY_RING       16384                    // 1 s of queued speech, PSRAM
+
+static Aec               aec;
+static BargeDetector     det;
+static TaskHandle_t      task = nullptr;
+static volatile bool     runFlag = false;
+static int16_t*          playBuf = nullptr;
+static SpscRing<int16_t> play;                   // duplexPlay() -> task
+static int16_t           refLine[REF_LINE];
+static uint32_t          refPos = 0;
+static volatile bool     muted = false;
+static volatile bool     bargePending = false;
+static volatile uint32_t bargeMark = 0;
+static volatile uint32_t bargeIns = 0;
+static volatile uint32_t lastLatencyMs = 0;
+static volatile uint64_t busyUs = 0;
+static int64_t           startUs = 0;
+static uint32_t          lastCpuPermille = 0;
+
+static Histogram metricAecCycles("moodsoul_aec_cycles", "Echo canceller + barge-in detector CPU cycles per 10 ms block");
+static Counter   metricBargeIns("moodsoul_barge_in_total", "Playback interrupted by the user talking");
+static Histogram metricBargeLatency("moodsoul_barge_in_latency_ms", "Barge-in speech onset to speaker muted, ms");
+
+static void aw88298Write(uint8_t reg, uint16_t value) {
+    uint8_t b[2] = { (uint8_t)(value >> 8), (uint8_t)value };
+    M5.In_I2C.writeRegister(AW88298_ADDR, reg, b, 2, 400000);
+}
+
+// The same register setup M5Unified's CoreS3 speaker callback does. The
+// ES7210 ADC keeps the setup from the last M5.Mic.begin().
+static void ampEnable(bool on, uint32_t rate) {
+    if (on) {
+        static const uint8_t rateTbl[] = { 4, 5, 6, 8, 10, 11, 15, 20, 22, 44 };
+        uint16_t idx = 0;
+        uint32_t r = (rate + 1102) / 2205;
+        while (idx < sizeof(rateTbl) - 1 && r > rateTbl[idx]) idx++;
+        M5.In_I2C.bitOn(AW9523_ADDR, 0x02, 0b00000100, 400000);
+        aw88298Write(0x61, 0x0673); // boost off
+        aw88298Write(0x04, 0x4040); // I2S on, amp on
+        aw88298Write(0x05, 0x0008); // unmute
+        aw88298Write(0x06, 0x14C0 | idx);
+        aw88298Write(0x0C, 0x0064); // volume
+    } else {
+        aw88298Write(0x04, 0x4000);
+        M5.In_I2C.bitOff(AW9523_ADDR, 0x02, 0b00000100, 400000);
+    }
+}
+
+static bool installPort(uint32_t rate) {
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX);
+    cfg.sample_rate = rate;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.dma_buf_count = TX_DMA_BUFS;
+    cfg.dma_buf_len = AEC_BLOCK;
+    cfg.tx_desc_auto_clear = true; // underruns play silence, not a loop
+    cfg.mclk_multiple = I2S_MCLK_MULTIPLE_256;
+    if (i2s_driver_install(DUPLEX_PORT, &cfg, 0, nullptr) != ESP_OK) return false;
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = PIN_MCK;
+    pins.bck_io_num = PIN_BCK;
+    pins.ws_io_num = PIN_WS;
+    pins.data_out_num = PIN_DOUT;
+    pins.data_in_num = PIN_DIN;
+    if (i2s_set_pin(DUPLEX_PORT, &pins) != ESP_OK) {
+        i2s_driver_uninstall(DUPLEX_PORT);
+        return false;
+    }
+    return true;
+}
+
+static void duplexTask(void*) {
+    int16_t frames[AEC_BLOCK * 2];
+    int16_t mic[AEC_BLOCK], ref[AEC_BLOCK], spk[AEC_BLOCK], out[AEC_BLOCK];
+    int64_t blockUs[BARGE_RUN_BLOCKS] = {};
+    uint32_t block = 0;
+    size_t done;
+
+    memset(frames, 0, sizeof(frames));
+    for (int i = 0; i < TX_PREFILL; i++) i2s_write(DUPLEX_PORT, frames, sizeof(frames), &done, portMAX_DELAY);
+
+    while (runFlag) {
+        if (i2s_read(DUPLEX_PORT, frames, sizeof(frames), &done, pdMS_TO_TICKS(100)) != ESP_OK ||
+            done != sizeof(frames)) {
+            continue;
+        }
+        int64_t t0 = esp_timer_get_time();
+        blockUs[block % BARGE_RUN_BLOCKS] = t0;
+        for (int i = 0; i < AEC_BLOCK; i++) mic[i] = frames[2 * i]; // ES7210 MIC1
+
+        // Next speaker block, and the reference it lines up with
+        uint32_t got = play.pop(spk, AEC_BLOCK);
+        if (muted) got = 0;
+        for (int i = 0; i < AEC_BLOCK; i++) {
+            if ((uint32_t)i >= got) spk[i] = 0;
+            refLine[(refPos + i) & (REF_LINE - 1)] = spk[i];
+            ref[i] = refLine[(refPos + i - REF_DELAY) & (REF_LINE - 1)];
+        }
+        refPos += AEC_BLOCK;
+
+        uint32_t c0 = ESP.getCycleCount();
+        AecLevels lv = aecProcess(aec, mic, ref, out, det.nearEnd);
+        bool fired = bargeUpdate(det, lv);
+        metricAecCycles.record(ESP.getCycleCount() - c0);
+
+        if (fired && !muted) {
+            // Cut the speaker now: drop what's queued in DMA and in the ring
+            muted = true;
+            i2s_zero_dma_buffer(DUPLEX_PORT);
+            play.discard();
+            // Onset block's first sample was captured one block before its read returned
+            int64_t onsetUs = blockUs[(block + 1) % BARGE_RUN_BLOCKS] - AEC_BLOCK * 1000000LL / 16000;
+            lastLatencyMs = (uint32_t)((esp_timer_get_time() - onsetUs) / 1000);
+            metricBargeLatency.record(lastLatencyMs);
+            metricBargeIns.inc();
+            bargeIns++;
+            bargeMark = micStreamMark() - (BARGE_RUN_BLOCKS - 1) * AEC_BLOCK;
+            bargePending = true;
+            Serial.printf("[BARGE] user talking, speaker cut in %lu ms\n", (unsigned long)lastLatencyMs);
+        }
+        micStreamInject(out, AEC_BLOCK);
+
+        for (int i = 0; i < AEC_BLOCK; i++) frames[2 * i] = frames[2 * i + 1] = muted ? 0 : spk[i];
+        busyUs += esp_timer_get_time() - t0;
+        i2s_write(DUPLEX_PORT, frames, sizeof(frames), &done, pdMS_TO_TICKS(100));
+        block++;
+    }
+    task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool duplexStart(uint32_t sampleRate) {
+    if (task) return true;
+    if (!micStreamRunning()) return false;
+    if (!playBuf) {
+        playBuf = (int16_t*)heap_caps_malloc(SpscRing<int16_t>::bytesFor(PLAY_RING), MALLOC_CAP_SPIRAM);
+        if (!playBuf) return false;
+    }
+    micStreamPause(); // M5.Mic lets go of I2S1
+    if (M5.Speaker.isEnabled()) M5.Speaker.end();
+    if (!installPort(sampleRate)) {
+        micStreamResume();
+        return false;
+    }
+    ampEnable(true, sampleRate);
+
+    aecInit(aec);
+    bargeInit(det);
+    memset(refLine, 0, sizeof(refLine));
+    refPos = 0;
+    play.init(playBuf, PLAY_RING);
+    muted = false;
+    bargePending = false;
+    busyUs = 0;
+    startUs = esp_timer_get_time();
+    runFlag = true;
+    // Same core and priority as the mic task it stands in for
+    if (xTaskCreatePinnedToCore(duplexTask, "duplex", 6144, nullptr, 3, &task, 1) != pdPASS) {
+        runFlag = false;
+        ampEnable(false, sampleRate);
+        i2s_driver_uninstall(DUPLEX_PORT);
+        micStreamResume();
+        return false;
+    }
+    return true;
+}
+
+void duplexStop() {
+    if (!task) return;
+    runFlag = false;
+    while (task) delay(2);
+    uint64_t wall = esp_timer_get_time() - startUs;
+    lastCpuPermille = wall ? (uint32_t)(busyUs * 1000 / wall) : 0;
+    ampEnable(false, 0);
+    i2s_driver_uninstall(DUPLEX_PORT);
+    micStreamResume(); // the mic task reinstalls M5.Mic's driver
+}
+
+bool duplexRunning() {
+    return task != nullptr;
+}
+
+size_t duplexPlay(const int16_t* pcm, size_t n) {
+    if (!task || muted) return 0;
+    return play.push(pcm, (uint32_t)n);
+}
+
+size_t duplexQueued() {
+    return play.size();
+}
+
+bool duplexBargedIn(uint32_t* mark) {
+    if (!bargePending) return false;
+    bargePending = false;
+    *mark = bargeMark;
+    return true;
+}
+
+size_t duplexLoopback(const int16_t* spk, size_t nSpk, int16_t* mic, size_t nMic, uint32_t sampleRate) {
+    if (task) return 0;
+    bool resume = micStreamRunning();
+    if (resume) micStreamPause();
+    if (M5.Speaker.isEnabled()) M5.Speaker.end();
+    if (M5.Mic.isEnabled()) M5.Mic.end();
+    if (!installPort(sampleRate)) {
+        if (resume) micStreamResume();
+        return 0;
+    }
+    ampEnable(true, sampleRate);
+
+    // Same lock-step as duplexTask: one TX block per RX block
+    int16_t frames[AEC_BLOCK * 2];
+    size_t done, got = 0, sent = 0;
+    memset(frames, 0, sizeof(frames));
+    for (int i = 0; i < TX_PREFILL; i++) i2s_write(DUPLEX_PORT, frames, sizeof(frames), &done, portMAX_DELAY);
+    while (got < nMic) {
+        if (i2s_read(DUPLEX_PORT, frames, sizeof(frames), &done, pdMS_TO_TICKS(100)) != ESP_OK ||
+            done != sizeof(frames)) {
+            break;
+        }
+        for (int i = 0; i < AEC_BLOCK && got < nMic; i++) mic[got++] = frames[2 * i];
+        for (int i = 0; i < AEC_BLOCK; i++, sent++) {
+            int16_t v = sent < nSpk ? spk[sent] : 0;
+            frames[2 * i] = frames[2 * i + 1] = v;
+        }
+        i2s_write(DUPLEX_PORT, frames, sizeof(frames), &done, pdMS_TO_TICKS(100));
+    }
+
+    ampEnable(false, 0);
+    i2s_driver_uninstall(DUPLEX_PORT);
+    if (resume) micStreamResume();
+    return got;
+}
+
+DuplexStats duplexStats() {
+    DuplexStats s;
+    s.bargeIns = bargeIns;
+    s.lastLatencyMs = lastLatencyMs;
+    s.aecP99Cycles = metricAecCycles.quantile(0.99f);
+    s.cpuPermille = lastCpuPermille;
+    s.erleDb = det.erleDb;
+    return s;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// FULL-DUPLEX AUDIO (barge-in)
+// ==========================================
+// M5Unified treats the CoreS3 mic and speaker as exclusive: both codecs
+// share one I2S bus. For barge-in this module takes the bus over for the
+// length of a response with one TX+RX driver, so the mic keeps listening
+// while the speaker plays. Each 10 ms the duplex task reads a mic block, runs
+// the echo canceller (aec.h) against what it sent to the speaker, feeds
+// the residual into the mic_stream ring (so pre-roll still works) and
+// writes the next speaker block. When the user talks over the playback the
+// speaker is cut at once and duplexBargedIn() reports where they started.
+//
+// Needs the always-on mic (the ring carries the residual).
+
+struct DuplexStats {
+    uint32_t bargeIns;
+    uint32_t lastLatencyMs;  // speech onset to speaker muted
+    uint32_t aecP99Cycles;   // AEC + detector per 10 ms block
+    uint32_t cpuPermille;    // duplex task busy time, last session
+    float    erleDb;         // echo reduction, last session
+};
+
+// Pauses mic_stream, powers the amp and starts the duplex task.
+bool duplexStart(uint32_t sampleRate);
+// Stops the task, releases the port and resumes mic_stream.
+void duplexStop();
+bool duplexRunning();
+// Queues mono speaker samples; returns how many fit.
+size_t duplexPlay(const int16_t* pcm, size_t n);
+// Samples queued and not yet sent, for callers that pace themselves.
+size_t duplexQueued();
+// True once per barge-in. *mark is the mic_stream ring position where the
+// user's speech started.
+bool duplexBargedIn(uint32_t* mark);
+DuplexStats duplexStats();
+
+// Factory test: plays `spk` from the first block while recording `nMic` raw
+// mic samples (no echo canceller) on the same clock, so the speaker-to-mic
+// delay is an exact sample count. Blocking; not while duplexStart() runs.
+// Returns the samples recorded.
+size_t duplexLoopback(const int16_t* spk, size_t nSpk, int16_t* mic, size_t nMic, uint32_t sampleRate);
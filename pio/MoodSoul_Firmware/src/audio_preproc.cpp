@@ -0,0 +1,245 @@
+#include "audio_preproc.h"
+#include "dsp_q15.h"
+#include <math.h>
+#include <string.h>
+
+#define WINDOW       (2 * PREPROC_BLOCK)
+#define DC_POLE      32604               // 0.995, Q15
+#define HP_CUTOFF_HZ 100.0f
+
+// Noise floor: settle on the first frames, then fall fast and rise slowly
+#define NOISE_INIT_FRAMES 10
+#define NOISE_RISE        655             // 0.01 log2/frame = 3 dB/s, Q16
+#define NOISE_FALL_SHIFT  3
+#define NOISE_BIAS        96              // log-min underestimates the mean, Q6 (~4.5 dB)
+#define GAIN_LUT_SIZE     512             // SNR 0..8 log2 units (0..24 dB), Q6 steps
+#define GAIN_FLOOR        3277            // 0.1 (-20 dB), Q15
+#define OVERSUBTRACT      2.0f
+#define SPEECH_LO_BIN     10              // 312 Hz
+#define SPEECH_HI_BIN     109             // 3400 Hz
+#define SPEECH_GATE       13107           // mean gain 0.4
+
+#define AGC_UNITY     4096                // Q12
+#define AGC_MIN       1024                // -12 dB
+#define AGC_MAX       65536               // +24 dB
+#define AGC_TARGET    2600                // RMS, ~-22 dBFS
+#define AGC_LIMIT     32000
+
+static bool     ready = false;
+static int16_t  window[WINDOW];           // sqrt-Hann, Q15 (analysis and synthesis)
+static uint16_t gainLut[GAIN_LUT_SIZE];   // Q15
+static int64_t  hpB0, hpA1, hpA2;         // Q30; b1 = -2 b0, b2 = b0
+
+static void initTables() {
+    if (ready) return;
+    dspInit();
+    for (int i = 0; i < WINDOW; i++) window[i] = (int16_t)lrintf(sinf((float)M_PI * i / WINDOW) * 32767.0f);
+    for (int i = 0; i < GAIN_LUT_SIZE; i++) {
+        float g2 = 1.0f - OVERSUBTRACT * exp2f(-i / 64.0f);
+        float floor2 = (GAIN_FLOOR / 32768.0f) * (GAIN_FLOOR / 32768.0f);
+        gainLut[i] = (uint16_t)lrintf(sqrtf(g2 > floor2 ? g2 : floor2) * 32767.0f);
+    }
+    // Bilinear Butterworth high-pass
+    double k = tan(M_PI * HP_CUTOFF_HZ / PREPROC_RATE);
+    double norm = 1.0 / (1.0 + sqrt(2.0) * k + k * k);
+    hpB0 = llrint(norm * 1073741824.0);
+    hpA1 = llrint(2.0 * (k * k - 1.0) * norm * 1073741824.0);
+    hpA2 = llrint((1.0 - sqrt(2.0) * k + k * k) * norm * 1073741824.0);
+    ready = true;
+}
+
+void audioPreprocInit(AudioPreproc& p, bool ns, bool agc) {
+    initTables();
+    p.ns = ns;
+    p.agc = agc;
+    audioPreprocReset(p);
+}
+
+void audioPreprocReset(AudioPreproc& p) {
+    p.dcX1 = p.dcY1 = 0;
+    p.hpX1 = p.hpX2 = p.hpY1 = p.hpY2 = 0;
+    memset(p.prevIn, 0, sizeof(p.prevIn));
+    memset(p.olaTail, 0, sizeof(p.olaTail));
+    memset(p.noise, 0, sizeof(p.noise));
+    for (int k = 0; k < PREPROC_BINS; k++) p.gain[k] = 32767;
+    p.frames = 0;
+    p.speech = 0;
+    p.agcGain = AGC_UNITY;
+}
+
+static inline int16_t sat16(int32_t v) {
+    return (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+}
+
+static void filterBlock(AudioPreproc& p, int16_t* x) {
+    for (int i = 0; i < PREPROC_BLOCK; i++) {
+        // y = x - x1 + a y1, with y kept in Q8
+        int32_t in = x[i];
+        p.dcY1 = ((in - p.dcX1) << 8) + (int32_t)(((int64_t)p.dcY1 * DC_POLE) >> 15);
+        p.dcX1 = in;
+
+        // Q30 coefficients on Q8 state: the poles sit close to z = 1, so
+        // the feedback needs the extra precision
+        int32_t xs = p.dcY1;
+        int64_t acc = hpB0 * (xs - 2 * p.hpX1 + p.hpX2) - hpA1 * p.hpY1 - hpA2 * p.hpY2;
+        int32_t y = (int32_t)((acc + (1 << 29)) >> 30);
+        p.hpX2 = p.hpX1;
+        p.hpX1 = xs;
+        p.hpY2 = p.hpY1;
+        p.hpY1 = y;
+        x[i] = sat16((y + 128) >> 8);
+    }
+}
+
+// Block-floating-point exponent that brings `peak` to 14 bits.
+static int normShift(int32_t peak) {
+    int s = 0;
+    while (peak && (peak << s) < (1 << 13) && s < 14) s++;
+    while (s <= 0 && (peak >> -s) >= (1 << 14)) s--;
+    return s;
+}
+
+static void suppressBlock(AudioPreproc& p, int16_t* x) {
+    int16_t* d = p.fft;
+    int32_t peak = 0;
+    for (int i = 0; i < PREPROC_BLOCK; i++) {
+        int32_t a = p.prevIn[i] < 0 ? -p.prevIn[i] : p.prevIn[i];
+        int32_t b = x[i] < 0 ? -x[i] : x[i];
+        if (a > peak) peak = a;
+        if (b > peak) peak = b;
+    }
+    int s = normShift(peak);
+    for (int i = 0; i < WINDOW; i++) {
+        int32_t v = i < PREPROC_BLOCK ? p.prevIn[i] : x[i - PREPROC_BLOCK];
+        v = s >= 0 ? v << s : v >> -s;
+        d[2 * i] = (int16_t)((v * window[i]) >> 15);
+        d[2 * i + 1] = 0;
+    }
+    memset(d + 2 * WINDOW, 0, (PREPROC_FFT - WINDOW) * 2 * sizeof(int16_t));
+    memcpy(p.prevIn, x, sizeof(p.prevIn));
+
+    dspFft(d, PREPROC_FFT);
+
+    // Per-bin log power in absolute units (the block scaling taken out)
+    const uint64_t floor = s > 0 ? 1ull << (2 * s) : 1;
+    uint32_t speechSum = 0;
+    for (int k = 0; k < PREPROC_BINS; k++) {
+        int32_t re = d[2 * k], im = d[2 * k + 1];
+        uint64_t pw = (uint64_t)(uint32_t)(re * re) + (uint32_t)(im * im);
+        int32_t level = dspLog2Q6(pw + floor) - 2 * s * 64;
+
+        int32_t l16 = level << 10;
+        int32_t& n = p.noise[k];
+        if (p.frames < NOISE_INIT_FRAMES) {
+            n = p.frames == 0 ? l16 : n + (l16 - n) / (p.frames + 1);
+        } else if (l16 < n) {
+            n += (l16 - n) >> NOISE_FALL_SHIFT;
+        } else {
+            n += NOISE_RISE;
+        }
+
+        int32_t snr = level - (n >> 10) - NOISE_BIAS;
+        uint32_t g = snr <= 0 ? gainLut[0] : snr >= GAIN_LUT_SIZE ? 32767 : gainLut[snr];
+        g = (g + p.gain[k]) >> 1; // one frame of smoothing tames musical noise
+        p.gain[k] = (uint16_t)g;
+        if (k >= SPEECH_LO_BIN && k < SPEECH_HI_BIN) speechSum += g;
+    }
+    if (p.frames < NOISE_INIT_FRAMES) p.frames++;
+    p.speech = (uint16_t)(speechSum / (SPEECH_HI_BIN - SPEECH_LO_BIN));
+
+    // Apply the gains and conjugate, so the forward FFT inverts
+    int32_t ypeak = 0;
+    for (int k = 0; k < PREPROC_FFT; k++) {
+        int32_t g = p.gain[k <= PREPROC_FFT / 2 ? k : PREPROC_FFT - k];
+        int32_t re = (d[2 * k] * g) >> 15;
+        int32_t im = -((d[2 * k + 1] * g) >> 15);
+        d[2 * k] = (int16_t)re;
+        d[2 * k + 1] = (int16_t)im;
+        if (re < 0) re = -re;
+        if (im < 0) im = -im;
+        if (re > ypeak) ypeak = re;
+        if (im > ypeak) ypeak = im;
+    }
+    // Renormalize so the inverse keeps its precision
+    int t = normShift(ypeak);
+    if (t > 0) {
+        for (int i = 0; i < 2 * PREPROC_FFT; i++) d[i] = (int16_t)(d[i] << t);
+    } else {
+        t = 0;
+    }
+
+    dspFft(d, PREPROC_FFT);
+
+    // Output = ifft * 2^(log2 N - s - t); synthesis window and overlap-add
+    const int e = 9 - s - t;
+    for (int i = 0; i < WINDOW; i++) {
+        int32_t y = (d[2 * i] * window[i]) >> 15;
+        y = e >= 0 ? y << e : y >> -e;
+        if (i < PREPROC_BLOCK) {
+            x[i] = sat16(p.olaTail[i] + y);
+        } else {
+            p.olaTail[i - PREPROC_BLOCK] = y;
+        }
+    }
+}
+
+static uint32_t isqrt(uint32_t v) {
+    uint32_t r = 0, bit = 1u << 30;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+static void agcBlock(AudioPreproc& p, int16_t* x) {
+    uint64_t energy = 0;
+    int32_t peak = 0;
+    for (int i = 0; i < PREPROC_BLOCK; i++) {
+        int32_t v = x[i];
+        energy += (uint64_t)(v * v);
+        if (v < 0) v = -v;
+        if (v > peak) peak = v;
+    }
+    uint32_t rms = isqrt((uint32_t)(energy / PREPROC_BLOCK));
+
+    int32_t g0 = p.agcGain, g1 = g0;
+    // Adapt on speech only, so pauses don't pump the noise floor up
+    if ((!p.ns || p.speech >= SPEECH_GATE) && rms > 0) {
+        int64_t want = (int64_t)AGC_TARGET * AGC_UNITY / rms;
+        int32_t desired = (int32_t)(want < AGC_MIN ? AGC_MIN : want > AGC_MAX ? AGC_MAX : want);
+        if (desired < g1) {
+            g1 -= (g1 - desired) >> 2;      // attack ~40 ms
+        } else {
+            g1 += g1 >> 7;                  // release ~7 dB/s
+            if (g1 > desired) g1 = desired;
+        }
+    }
+    if (peak > 0 && ((int64_t)peak * g1 >> 12) > AGC_LIMIT) g1 = (int32_t)((int64_t)AGC_LIMIT * AGC_UNITY / peak);
+    p.agcGain = g1;
+
+    // Ramp across the block: no zipper noise on gain steps
+    for (int i = 0; i < PREPROC_BLOCK; i++) {
+        int32_t g = g0 + (int32_t)((int64_t)(g1 - g0) * (i + 1) / PREPROC_BLOCK);
+        x[i] = sat16((int32_t)(((int64_t)x[i] * g + 2048) >> 12));
+    }
+}
+
+void audioPreprocRun(AudioPreproc& p, int16_t* samples, size_t n) {
+    for (size_t off = 0; off + PREPROC_BLOCK <= n; off += PREPROC_BLOCK) {
+        int16_t* x = samples + off;
+        filterBlock(p, x);
+        if (p.ns) suppressBlock(p, x);
+        if (p.agc) agcBlock(p, x);
+    }
+}
+
+float audioPreprocGainDb(const AudioPreproc& p) {
+    return 20.0f * log10f((float)p.agcGain / AGC_UNITY);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// CAPTURE PRE-PROCESSING (fixed-point)
+// ==========================================
+// Runs on 10 ms blocks as the mic delivers them, before audio is stored or
+// uploaded:
+//   1. DC blocker (~12 Hz)
+//   2. 2nd-order Butterworth high-pass at 100 Hz (desk and fan rumble)
+//   3. Spectral-subtraction noise suppression: 20 ms sqrt-Hann STFT, 10 ms
+//      hop, per-bin noise floor tracked in the log domain, gain from a
+//      table with a -20 dB floor. Adds one block (10 ms) of delay.
+//   4. AGC towards -22 dBFS RMS, adapting only on blocks the suppressor
+//      marks as speech, with a peak limiter.
+// The FFTs go through dsp_q15 (esp-dsp's S3 SIMD kernels on the device).
+//
+// Budget: PREPROC_BLOCK_CYCLE_BUDGET cycles per block on the S3 (5% of one
+// core); mic_stream counts blocks that exceed it.
+
+#define PREPROC_RATE               16000
+#define PREPROC_BLOCK              160    // 10 ms
+#define PREPROC_FFT                512
+#define PREPROC_BINS               (PREPROC_FFT / 2 + 1)
+#define PREPROC_BLOCK_CYCLE_BUDGET 120000 // 0.5 ms at 240 MHz
+
+struct AudioPreproc {
+    bool     ns, agc;
+    // DC blocker and high-pass (Q8 state)
+    int32_t  dcX1, dcY1;
+    int32_t  hpX1, hpX2, hpY1, hpY2;
+    // Noise suppression
+    int16_t  prevIn[PREPROC_BLOCK];
+    int32_t  olaTail[PREPROC_BLOCK];
+    int32_t  noise[PREPROC_BINS];     // log2 power, Q16
+    uint16_t gain[PREPROC_BINS];      // last per-bin gain, Q15
+    uint16_t frames;
+    uint16_t speech;                  // speech-band mean gain of the last block, Q15
+    int16_t  fft[PREPROC_FFT * 2];
+    // AGC
+    int32_t  agcGain;                 // Q12
+};
+
+// Builds the shared tables on first use.
+void audioPreprocInit(AudioPreproc& p, bool ns, bool agc);
+// Forgets all signal history (new recording).
+void audioPreprocReset(AudioPreproc& p);
+// Processes n samples in place; n must be a multiple of PREPROC_BLOCK.
+void audioPreprocRun(AudioPreproc& p, int16_t* samples, size_t n);
+// Current AGC gain in dB, for logs.
+float audioPreprocGainDb(const AudioPreproc& p);
@@ -0,0 +1,39 @@
+#include "audio_ring.h"
+#include <string.h>
+
+void audioRingInit(AudioRing& r, int16_t* buf, uint32_t capacity) {
+    r.buf = buf;
+    r.mask = capacity - 1;
+    r.writePos.store(0, std::memory_order_relaxed);
+}
+
+void audioRingWrite(AudioRing& r, const int16_t* samples, uint32_t n) {
+    uint32_t pos = r.writePos.load(std::memory_order_relaxed);
+    uint32_t at = pos & r.mask;
+    uint32_t first = r.mask + 1 - at;
+    if (first > n) first = n;
+    memcpy(r.buf + at, samples, first * sizeof(int16_t));
+    memcpy(r.buf, samples + first, (n - first) * sizeof(int16_t));
+    r.writePos.store(pos + n, std::memory_order_release);
+}
+
+uint32_t audioRingPos(const AudioRing& r) {
+    return r.writePos.load(std::memory_order_acquire);
+}
+
+bool audioRingCopy(const AudioRing& r, uint32_t from, uint32_t n, int16_t* out) {
+    uint32_t cap = r.mask + 1;
+    uint32_t safe = cap - AUDIO_RING_MAX_WRITE; // how far back a reader may reach
+    uint32_t end = audioRingPos(r);
+    // Not yet written, or about to be overwritten
+    if ((int32_t)(end - (from + n)) < 0 || end - from > safe) return false;
+
+    uint32_t at = from & r.mask;
+    uint32_t first = cap - at;
+    if (first > n) first = n;
+    memcpy(out, r.buf + at, first * sizeof(int16_t));
+    memcpy(out + first, r.buf, (n - first) * sizeof(int16_t));
+
+    // The writer may have caught up with the start of the range meanwhile
+    return audioRingPos(r) - from <= safe;
+}
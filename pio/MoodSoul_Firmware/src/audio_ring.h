@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// AUDIO RING (single writer, any readers)
+// ==========================================
+// Fixed power-of-two ring of 16-bit samples addressed by an absolute,
+// wrapping sample position. The writer (mic task) appends and then
+// publishes the new end; readers copy any range that is both written and
+// not yet overwritten. Positions compare with wrap-safe subtraction.
+
+// Largest single write. Readers stay this far clear of the writer so a
+// write still in progress can't tear a copy.
+#define AUDIO_RING_MAX_WRITE 1024
+
+struct AudioRing {
+    int16_t*              buf;
+    uint32_t              mask;      // capacity - 1
+    std::atomic<uint32_t> writePos;  // samples ever written (wraps)
+};
+
+// capacity must be a power of two; buf holds capacity samples.
+void audioRingInit(AudioRing& r, int16_t* buf, uint32_t capacity);
+// n <= AUDIO_RING_MAX_WRITE.
+void audioRingWrite(AudioRing& r, const int16_t* samples, uint32_t n);
+uint32_t audioRingPos(const AudioRing& r);
+// Copies [from, from + n). False if part of it is not written yet or has
+// already been overwritten.
+bool audioRingCopy(const AudioRing& r, uint32_t from, uint32_t n, int16_t* out);
@@ -0,0 +1,137 @@
+#include "bench.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <esp_timer.h>
+#define BENCH_TARGET     "esp32s3"
+#define BENCH_MIN_TIME_S 0.1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TARGET     "host"
+#define BENCH_MIN_TIME_S 0.25
+#else
+#define BENCH_TARGET     "host"
+#define BENCH_MIN_TIME_S 0.25
+#endif
+
+#ifndef MOODSOUL_GIT_REV
+#define MOODSOUL_GIT_REV ""
+#endif
+
+static BenchRegistration* first = nullptr;
+static BenchRegistration* last = nullptr;
+
+BenchRegistration::BenchRegistration(const char* name, BenchFn fn)
+    : name(name), fn(fn), next(nullptr) {
+    if (last) last->next = this;
+    else first = this;
+    last = this;
+}
+
+// CPU cycles: CCOUNT on the device, TSC on x86 hosts (reference cycles,
+// not core cycles), 0 where neither exists.
+static uint64_t benchCycles() {
+#if defined(ARDUINO)
+    // CCOUNT is only 32 bits and wraps every ~18 s at 240 MHz. Take the
+    // high bits from esp_timer (same crystal) and the low bits from CCOUNT,
+    // picking whichever wrap is nearest the esp_timer estimate.
+    uint32_t cc  = ESP.getCycleCount();
+    uint64_t est = (uint64_t)esp_timer_get_time() * getCpuFrequencyMhz();
+    uint64_t t   = (est & ~0xFFFFFFFFull) | cc;
+    if (t > est + 0x80000000ull) t -= 0x100000000ull;
+    else if (t + 0x80000000ull < est) t += 0x100000000ull;
+    return t;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+bool BenchState::keepRunning() {
+    if (done == 0) {
+        startTicks = traceNow();
+        startCycles = benchCycles();
+    }
+    if (done < iterations) {
+        done++;
+        return true;
+    }
+    endCycles = benchCycles();
+    endTicks = traceNow();
+    return false;
+}
+
+static double runOnce(BenchRegistration* b, uint32_t iterations, BenchState& st) {
+    memset(&st, 0, sizeof(st));
+    st.iterations = iterations;
+    b->fn(st);
+    if (st.endTicks == 0) return -1; // benchmark never finished its loop
+    return (double)(st.endTicks - st.startTicks) / traceTicksPerUs() / 1e6;
+}
+
+void benchRunAll(const char* filter, const char* executable, void (*out)(const char* line)) {
+    char line[384];
+
+    out("{");
+    out("  \"context\": {");
+    snprintf(line, sizeof(line), "    \"executable\": \"%s\",", executable);
+    out(line);
+    snprintf(line, sizeof(line), "    \"target\": \"%s\",", BENCH_TARGET);
+    out(line);
+#if defined(ARDUINO)
+    snprintf(line, sizeof(line), "    \"mhz_per_cpu\": %lu,", (unsigned long)getCpuFrequencyMhz());
+    out(line);
+#endif
+    snprintf(line, sizeof(line), "    \"git_rev\": \"%s\",", MOODSOUL_GIT_REV);
+    out(line);
+    out("    \"library_build_type\": \"release\"");
+    out("  },");
+    out("  \"benchmarks\": [");
+
+    bool firstResult = true;
+    for (BenchRegistration* b = first; b; b = b->next) {
+        if (filter && filter[0] && !strstr(b->name, filter)) continue;
+
+        // Grow the iteration count until one run lasts BENCH_MIN_TIME_S
+        BenchState st;
+        uint32_t iters = 1;
+        double secs = runOnce(b, iters, st);
+        while (secs >= 0 && secs < BENCH_MIN_TIME_S && iters < 1000000000u) {
+            double mult = secs > 0 ? BENCH_MIN_TIME_S * 1.4 / secs : 10.0;
+            if (mult > 10.0) mult = 10.0;
+            if (mult < 2.0) mult = 2.0;
+            iters = (uint32_t)(iters * mult);
+            secs = runOnce(b, iters, st);
+        }
+
+        if (secs < 0) continue;
+        double ns = secs * 1e9 / iters;
+        double cycles = (double)(st.endCycles - st.startCycles) / iters;
+
+        if (!firstResult) out("    },");
+        firstResult = false;
+        out("    {");
+        snprintf(line, sizeof(line),
+                 "      \"name\": \"%s\", \"run_name\": \"%s\", \"run_type\": \"iteration\",",
+                 b->name, b->name);
+        out(line);
+        snprintf(line, sizeof(line),
+                 "      \"iterations\": %lu, \"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\",",
+                 (unsigned long)iters, ns, ns);
+        out(line);
+        if (st.bytesPerIteration) {
+            snprintf(line, sizeof(line), "      \"bytes_per_second\": %.0f,",
+                     st.bytesPerIteration / (ns / 1e9));
+            out(line);
+        }
+        snprintf(line, sizeof(line), "      \"cycles_per_iteration\": %.1f", cycles);
+        out(line);
+    }
+    if (!firstResult) out("    }");
+    out("  ]");
+    out("}");
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// MICRO-BENCHMARK HARNESS
+// ==========================================
+// A small Google Benchmark-style runner that builds for both the host
+// (env:native-bench) and the CoreS3 (env:m5stack-cores3-bench), so the same
+// kernels report ns/iteration on the host and CPU cycles/iteration on the
+// device. Results use Google Benchmark's JSON schema.
+//
+//   static void BM_Thing(BenchState& state) {
+//       setup();                       // not timed
+//       while (state.keepRunning()) thing();
+//       state.setBytesPerIteration(n); // optional
+//   }
+//   BENCH(BM_Thing);
+
+struct BenchState {
+    uint32_t iterations;     // requested by the runner
+    uint32_t done;
+    uint64_t startTicks, endTicks;
+    uint64_t startCycles, endCycles;
+    uint64_t bytesPerIteration;
+
+    bool keepRunning();
+    void setBytesPerIteration(uint64_t n) { bytesPerIteration = n; }
+};
+
+typedef void (*BenchFn)(BenchState&);
+
+struct BenchRegistration {
+    const char*        name;
+    BenchFn            fn;
+    BenchRegistration* next;
+    BenchRegistration(const char* name, BenchFn fn);
+};
+
+#define BENCH(fn) static BenchRegistration benchReg_##fn(#fn, fn)
+
+// Runs every benchmark whose name contains `filter` (nullptr = all) and
+// writes the JSON report one line at a time through `out`.
+void benchRunAll(const char* filter, const char* executable, void (*out)(const char* line));
+
+// Keeps the optimizer from deleting a benchmarked result.
+template <typename T>
+inline void benchDoNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
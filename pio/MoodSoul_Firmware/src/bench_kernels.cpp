@@ -0,0 +1,438 @@
+#include "bench.h"
+#include "asset_pack.h"
+#include "http_response.h"
+#include "interaction_request.h"
+#include "lipsync.h"
+#include "lockfree_ring.h"
+#include "motion.h"
+#include "reply_decoder.h"
+#include "view_convert.h"
+#ifdef ARDUINO
+#include "asset_store.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#endif
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// ==========================================
+// PER-TURN HOT PATHS
+// ==========================================
+// Sizes match a real turn: ~20 KB QVGA JPEG, 3 s of 16 kHz PCM, 1 KB
+// response chunks.
+
+#define BENCH_JPEG_BYTES  20000
+#define BENCH_AUDIO_BYTES (3 * 16000 * 2)
+
+static uint8_t* benchBuffer(size_t len, uint32_t seed) {
+    uint8_t* buf = (uint8_t*)malloc(len);
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = (uint8_t)(seed >> 24);
+    }
+    return buf;
+}
+
+// Copies into a small scratch ring, standing in for the socket send buffer.
+struct ScratchSink : ByteSink {
+    uint8_t scratch[2048];
+    size_t  pos = 0;
+    size_t write(const uint8_t* data, size_t len) override {
+        if (pos + len > sizeof(scratch)) pos = 0;
+        memcpy(scratch + pos, data, len);
+        pos += len;
+        return len;
+    }
+};
+
+static void BM_MultipartAssembly(BenchState& state) {
+    static uint8_t* jpeg = benchBuffer(BENCH_JPEG_BYTES, 1);
+    static uint8_t* audio = benchBuffer(BENCH_AUDIO_BYTES, 2);
+
+    InteractionParts parts = {};
+    parts.host = "moodsoul-platform-gb2h.vercel.app";
+    parts.path = "/api/interact";
+    parts.boundary = "------------------------123456";
+    parts.deviceId = "3C8427C1A2B4";
+    parts.trigger = "";
+    parts.traceId = "0123456789abcdef";
+    parts.image = jpeg;
+    parts.imageLen = BENCH_JPEG_BYTES;
+    parts.audio = audio;
+    parts.audioLen = BENCH_AUDIO_BYTES;
+
+    ScratchSink sink;
+    while (state.keepRunning()) {
+        bool ok = interactionWriteRequest(sink, parts);
+        benchDoNotOptimize(ok);
+    }
+    state.setBytesPerIteration(interactionBodyLength(parts));
+}
+BENCH(BM_MultipartAssembly);
+
+static void BM_ResponseHeadParse(BenchState& state) {
+    static const char* LINES[] = {
+        "HTTP/1.1 200 OK\r",
+        "Date: Sun, 18 Oct 2026 10:00:00 GMT\r",
+        "Content-Type: audio/mpeg\r",
+        "Content-Length: 48213\r",
+        "Connection: keep-alive\r",
+        "Server: Vercel\r",
+        "Server-Timing: gemini;dur=812.3, tts;dur=420.0\r",
+        "X-Trace-Id: 0123456789abcdef\r",
+        "X-Vercel-Id: sfo1::iad1::abcde-1700000000000-0123456789ab\r",
+        "\r",
+    };
+    static size_t lens[sizeof(LINES) / sizeof(LINES[0])];
+    for (size_t i = 0; i < sizeof(LINES) / sizeof(LINES[0]); i++) lens[i] = strlen(LINES[i]);
+
+    HttpResponseHead head;
+    while (state.keepRunning()) {
+        httpHeadReset(head);
+        for (size_t i = 0; i < sizeof(LINES) / sizeof(LINES[0]); i++) {
+            if (httpHeadFeedLine(head, LINES[i], lens[i])) break;
+        }
+        benchDoNotOptimize(head.contentLength);
+    }
+}
+BENCH(BM_ResponseHeadParse);
+
+static void BM_LipSyncLevel(BenchState& state) {
+    static uint8_t* chunk = benchBuffer(1024, 3);
+    while (state.keepRunning()) {
+        int level = lipSyncLevel(chunk, 1024);
+        benchDoNotOptimize(level);
+    }
+    state.setBytesPerIteration(1024);
+}
+BENCH(BM_LipSyncLevel);
+
+static void BM_MotionUpdate(BenchState& state) {
+    MotionState st;
+    motionInit(st);
+    uint32_t now = 0;
+    float wobble = 0;
+    while (state.keepRunning()) {
+        wobble = wobble > 1.5f ? -1.5f : wobble + 0.01f;
+        MotionEvents ev = motionUpdate(st, wobble, 0.9f, 0.1f, now += 10, true, 0);
+        benchDoNotOptimize(ev);
+    }
+}
+BENCH(BM_MotionUpdate);
+
+// ==========================================
+// VIEWFINDER PIXELS
+// ==========================================
+// One preview frame: a QVGA sensor frame byte-swapped as it would be from
+// a little-endian source, and a VGA frame halved to QVGA. The scalar swap
+// is there for scale.
+
+#define BENCH_VIEW_W 320
+#define BENCH_VIEW_H 240
+
+static void BM_ViewSwap565(BenchState& state) {
+    static const uint16_t* src = (const uint16_t*)benchBuffer(BENCH_VIEW_W * BENCH_VIEW_H * 2, 30);
+    static uint16_t* dst = (uint16_t*)malloc(BENCH_VIEW_W * BENCH_VIEW_H * 2);
+    while (state.keepRunning()) {
+        viewCopy565(src, dst, BENCH_VIEW_W * BENCH_VIEW_H, true);
+        benchDoNotOptimize(dst[0]);
+    }
+    state.setBytesPerIteration(BENCH_VIEW_W * BENCH_VIEW_H * 2);
+}
+BENCH(BM_ViewSwap565);
+
+static void BM_ViewSwap565Scalar(BenchState& state) {
+    static const uint16_t* src = (const uint16_t*)benchBuffer(BENCH_VIEW_W * BENCH_VIEW_H * 2, 30);
+    static uint16_t* dst = (uint16_t*)malloc(BENCH_VIEW_W * BENCH_VIEW_H * 2);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < BENCH_VIEW_W * BENCH_VIEW_H; i++) dst[i] = (uint16_t)((src[i] << 8) | (src[i] >> 8));
+        benchDoNotOptimize(dst[0]);
+    }
+    state.setBytesPerIteration(BENCH_VIEW_W * BENCH_VIEW_H * 2);
+}
+BENCH(BM_ViewSwap565Scalar);
+
+static void BM_ViewHalve565(BenchState& state) {
+    static const uint16_t* src = (const uint16_t*)benchBuffer(BENCH_VIEW_W * BENCH_VIEW_H * 8, 31);
+    static uint16_t* dst = (uint16_t*)malloc(BENCH_VIEW_W * BENCH_VIEW_H * 2);
+    while (state.keepRunning()) {
+        for (int y = 0; y < BENCH_VIEW_H; y++) {
+            const uint16_t* row = src + (size_t)y * 4 * BENCH_VIEW_W;
+            viewHalve565(row, row + 2 * BENCH_VIEW_W, dst + y * BENCH_VIEW_W, BENCH_VIEW_W, true);
+        }
+        benchDoNotOptimize(dst[0]);
+    }
+    state.setBytesPerIteration(BENCH_VIEW_W * BENCH_VIEW_H * 8);
+}
+BENCH(BM_ViewHalve565);
+
+// ==========================================
+// REPLY DECODERS
+// ==========================================
+// Per reply codec (reply_decoder.h): decoding 1 s of 16 kHz reply audio
+// fed in the firmware's 1 KB socket reads (ns per 1 s of audio on the
+// host, so 1e6 ns = 0.1% of a core; cycles on the device), and the cost
+// up to the first PCM sample out, which is what a codec adds to
+// time-to-first-audio on top of the bytes it needs on the wire. MP3 is
+// device-only and decodes silent frames, so it is a floor.
+
+#define BENCH_REPLY_SAMPLES REPLY_RATE
+
+struct NullPcm : PcmSink {
+    size_t samples = 0;
+    void pcm(const int16_t* s, size_t n) override {
+        benchDoNotOptimize(s[0]);
+        samples += n;
+    }
+};
+
+static const std::vector<uint8_t>* benchReply(uint8_t codec);
+
+static void benchDecode(BenchState& state, uint8_t codec) {
+    const std::vector<uint8_t>& in = *benchReply(codec);
+    NullPcm sink;
+    while (state.keepRunning()) {
+        ReplyDecoder* d = replyDecoder(codec);
+        if (!d) continue;
+        for (size_t off = 0; off < in.size(); off += 1024) {
+            d->decode(in.data() + off, in.size() - off < 1024 ? in.size() - off : 1024, sink);
+        }
+        d->flush(sink);
+    }
+    state.setBytesPerIteration(in.size());
+}
+
+static void benchFirstAudio(BenchState& state, uint8_t codec) {
+    const std::vector<uint8_t>& in = *benchReply(codec);
+    NullPcm sink;
+    while (state.keepRunning()) {
+        ReplyDecoder* d = replyDecoder(codec);
+        if (!d) continue;
+        sink.samples = 0;
+        for (size_t off = 0; off < in.size() && !sink.samples; off += 1024) {
+            d->decode(in.data() + off, in.size() - off < 1024 ? in.size() - off : 1024, sink);
+        }
+    }
+}
+
+static const std::vector<uint8_t>* benchReply(uint8_t codec) {
+    static std::vector<uint8_t> pcm, adpcm, mp3;
+    if (pcm.empty()) {
+        // Speech-like: a wobbling 180 Hz voice with some hiss
+        uint32_t seed = 5;
+        for (int i = 0; i < BENCH_REPLY_SAMPLES; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            float env = 0.5f + 0.5f * sinf(i * 6.2832f * 3 / REPLY_RATE);
+            int16_t v = (int16_t)(9000 * env * sinf(i * 6.2832f * 180 / REPLY_RATE) + (int16_t)(seed >> 16) / 64);
+            pcm.push_back((uint8_t)(v & 0xFF));
+            pcm.push_back((uint8_t)((v >> 8) & 0xFF));
+        }
+        const int16_t* s = (const int16_t*)pcm.data();
+        int index = 0;
+        uint8_t block[REPLY_ADPCM_BLOCK];
+        for (int off = 0; off < BENCH_REPLY_SAMPLES; off += REPLY_ADPCM_SAMPLES) {
+            int n = BENCH_REPLY_SAMPLES - off < REPLY_ADPCM_SAMPLES ? BENCH_REPLY_SAMPLES - off : REPLY_ADPCM_SAMPLES;
+            size_t len = imaAdpcmEncodeBlock(s + off, n, index, block);
+            adpcm.insert(adpcm.end(), block, block + len);
+        }
+        // MPEG-2 Layer III, 32 kbps, 16 kHz mono: 144-byte frames of 576
+        // samples, zero side info
+        for (int i = 0; i < BENCH_REPLY_SAMPLES / 576 + 1; i++) {
+            uint8_t frame[144] = { 0xFF, 0xF3, 0x48, 0xC4 };
+            mp3.insert(mp3.end(), frame, frame + sizeof(frame));
+        }
+    }
+    return codec == SEGMENT_CODEC_PCM16 ? &pcm : codec == SEGMENT_CODEC_IMA_ADPCM ? &adpcm : &mp3;
+}
+
+static void BM_ReplyDecodePcm16(BenchState& state) { benchDecode(state, SEGMENT_CODEC_PCM16); }
+BENCH(BM_ReplyDecodePcm16);
+static void BM_ReplyDecodeImaAdpcm(BenchState& state) { benchDecode(state, SEGMENT_CODEC_IMA_ADPCM); }
+BENCH(BM_ReplyDecodeImaAdpcm);
+static void BM_ReplyFirstAudioPcm16(BenchState& state) { benchFirstAudio(state, SEGMENT_CODEC_PCM16); }
+BENCH(BM_ReplyFirstAudioPcm16);
+static void BM_ReplyFirstAudioImaAdpcm(BenchState& state) { benchFirstAudio(state, SEGMENT_CODEC_IMA_ADPCM); }
+BENCH(BM_ReplyFirstAudioImaAdpcm);
+#ifdef ARDUINO
+static void BM_ReplyDecodeMp3(BenchState& state) { benchDecode(state, SEGMENT_CODEC_MP3); }
+BENCH(BM_ReplyDecodeMp3);
+static void BM_ReplyFirstAudioMp3(BenchState& state) { benchFirstAudio(state, SEGMENT_CODEC_MP3); }
+BENCH(BM_ReplyFirstAudioMp3);
+#endif
+
+// ==========================================
+// ASSET PACK
+// ==========================================
+// A pack shaped like the real one: flat-colour 32x64 RGB565 icons (LZ4
+// packs them well) and short PCM clips, stored raw.
+
+#define BENCH_ICONS      48
+#define BENCH_ICON_BYTES (32 * 64 * 2)
+#define BENCH_CLIPS      4
+#define BENCH_CLIP_BYTES 32000
+
+struct BenchPack {
+    AssetPack pack;
+    char      names[BENCH_ICONS + BENCH_CLIPS][40];
+};
+
+static BenchPack* benchPack() {
+    static BenchPack* bp = nullptr;
+    if (bp) return bp;
+    bp = (BenchPack*)calloc(1, sizeof(BenchPack));
+    AssetSource src[BENCH_ICONS + BENCH_CLIPS];
+    uint16_t* icons = (uint16_t*)malloc(BENCH_ICONS * BENCH_ICON_BYTES);
+    for (int i = 0; i < BENCH_ICONS; i++) {
+        uint16_t* px = icons + i * BENCH_ICON_BYTES / 2;
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 32; x++) px[y * 32 + x] = ((x - 16) * (x - 16) + (y - 32) * (y - 32) < 200) ? 0xF800 + i : 0;
+        }
+        snprintf(bp->names[i], sizeof(bp->names[i]), "icons/icon%d_32x64.rgb565", i);
+        src[i] = { bp->names[i], (const uint8_t*)px, BENCH_ICON_BYTES, ASSET_TYPE_RGB565, true };
+    }
+    for (int i = 0; i < BENCH_CLIPS; i++) {
+        int n = BENCH_ICONS + i;
+        snprintf(bp->names[n], sizeof(bp->names[n]), "fillers/default/think%d.wav", i + 1);
+        src[n] = { bp->names[n], benchBuffer(BENCH_CLIP_BYTES, 10 + i), BENCH_CLIP_BYTES, ASSET_TYPE_WAV, false };
+    }
+    size_t cap = assetPackBound(src, BENCH_ICONS + BENCH_CLIPS, ASSET_DEFAULT_ALIGN);
+    uint8_t* out = (uint8_t*)malloc(cap);
+    size_t size = assetPackBuild(src, BENCH_ICONS + BENCH_CLIPS, 1, ASSET_DEFAULT_ALIGN, out, cap);
+    assetPackOpen(bp->pack, out, size, true);
+    return bp;
+}
+
+static void BM_AssetLookup(BenchState& state) {
+    BenchPack* bp = benchPack();
+    AssetInfo info;
+    int i = 0;
+    while (state.keepRunning()) {
+        bool found = assetFind(bp->pack, bp->names[i], info);
+        benchDoNotOptimize(found);
+        if (++i == BENCH_ICONS + BENCH_CLIPS) i = 0;
+    }
+}
+BENCH(BM_AssetLookup);
+
+static void BM_AssetReadLz4Icon(BenchState& state) {
+    BenchPack* bp = benchPack();
+    AssetInfo info;
+    assetFind(bp->pack, bp->names[0], info);
+    static uint8_t out[BENCH_ICON_BYTES];
+    while (state.keepRunning()) {
+        size_t n = assetRead(info, out, sizeof(out));
+        benchDoNotOptimize(n);
+    }
+    state.setBytesPerIteration(BENCH_ICON_BYTES);
+}
+BENCH(BM_AssetReadLz4Icon);
+
+#ifdef ARDUINO
+// The flashed pack through the mmap: one lookup plus touching every cache
+// line of its first raw entry. Skipped (zero iterations) without a pack.
+struct FlashEntry {
+    const char* name;
+    uint32_t    size;
+};
+
+static void firstRaw(const char* name, const AssetEntry& e, void* ctx) {
+    FlashEntry* fe = (FlashEntry*)ctx;
+    if (!fe->name && !(e.flags & ASSET_LZ4) && e.size >= 4096) *fe = { name, e.size };
+}
+
+static void BM_AssetReadFlash(BenchState& state) {
+    FlashEntry fe = { nullptr, 0 };
+    if (assetStoreBegin()) assetForEach(*assetStorePack(), firstRaw, &fe);
+    AssetInfo info;
+    while (state.keepRunning()) {
+        if (!fe.name || !assetStoreGet(fe.name, info)) continue;
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i + 4 <= info.size; i += 32) sum += *(const uint32_t*)(info.data + i);
+        benchDoNotOptimize(sum);
+    }
+    state.setBytesPerIteration(fe.size);
+}
+BENCH(BM_AssetReadFlash);
+#endif
+
+// ==========================================
+// TASK HAND-OFF RINGS
+// ==========================================
+// One producer/consumer round trip per iteration on a single task, so the
+// numbers are the cost of the primitive, not of the scheduler. The
+// FreeRTOS queue versions (device only) move the same data for scale.
+
+#define BENCH_RING       2048
+#define BENCH_RING_BLOCK 160 // 10 ms of 16 kHz audio
+
+static void BM_SpscRingBlock(BenchState& state) {
+    static SpscRing<int16_t> ring;
+    static int16_t mem[BENCH_RING];
+    ring.init(mem, BENCH_RING);
+    static const int16_t* in = (const int16_t*)benchBuffer(BENCH_RING_BLOCK * 2, 20);
+    int16_t out[BENCH_RING_BLOCK];
+    while (state.keepRunning()) {
+        ring.push(in, BENCH_RING_BLOCK);
+        uint32_t n = ring.pop(out, BENCH_RING_BLOCK);
+        benchDoNotOptimize(n);
+    }
+    state.setBytesPerIteration(BENCH_RING_BLOCK * 2);
+}
+BENCH(BM_SpscRingBlock);
+
+static void BM_SpscRingItem(BenchState& state) {
+    static SpscRing<uint32_t> ring;
+    static uint32_t mem[BENCH_RING];
+    ring.init(mem, BENCH_RING);
+    uint32_t v = 0, out = 0;
+    while (state.keepRunning()) {
+        ring.push(v++);
+        ring.pop(out);
+        benchDoNotOptimize(out);
+    }
+}
+BENCH(BM_SpscRingItem);
+
+static void BM_MpscRingItem(BenchState& state) {
+    static MpscRing<uint32_t> ring;
+    alignas(4) static uint8_t mem[BENCH_RING * 8];
+    ring.init(mem, BENCH_RING);
+    uint32_t v = 0, out = 0;
+    while (state.keepRunning()) {
+        ring.push(v++);
+        ring.pop(out);
+        benchDoNotOptimize(out);
+    }
+}
+BENCH(BM_MpscRingItem);
+
+#ifdef ARDUINO
+static void BM_FreeRtosQueueItem(BenchState& state) {
+    static QueueHandle_t q = xQueueCreate(BENCH_RING, sizeof(uint32_t));
+    uint32_t v = 0, out = 0;
+    while (state.keepRunning()) {
+        xQueueSend(q, &v, 0);
+        v++;
+        xQueueReceive(q, &out, 0);
+        benchDoNotOptimize(out);
+    }
+}
+BENCH(BM_FreeRtosQueueItem);
+
+// The usual workaround for per-sample cost: one queue item per block
+static void BM_FreeRtosQueueBlock(BenchState& state) {
+    static QueueHandle_t q = xQueueCreate(8, BENCH_RING_BLOCK * 2);
+    static const int16_t* in = (const int16_t*)benchBuffer(BENCH_RING_BLOCK * 2, 20);
+    int16_t out[BENCH_RING_BLOCK];
+    while (state.keepRunning()) {
+        xQueueSend(q, in, 0);
+        xQueueReceive(q, out, 0);
+        benchDoNotOptimize(out[0]);
+    }
+    state.setBytesPerIteration(BENCH_RING_BLOCK * 2);
+}
+BENCH(BM_FreeRtosQueueBlock);
+#endif
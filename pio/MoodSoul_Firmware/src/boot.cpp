@@ -0,0 +1,86 @@
+#include "boot.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <freertos/event_groups.h>
+
+static const char* const PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "peripherals", "psram", "wifi", "binding", "interactive", "ota",
+};
+
+static volatile uint32_t phaseStart[BOOT_PHASE_COUNT];
+static volatile uint32_t phaseEnd[BOOT_PHASE_COUNT];
+static volatile bool     phaseSeen[BOOT_PHASE_COUNT];
+static char              phaseNote[BOOT_PHASE_COUNT][16];
+
+static Gauge metricBootInteractiveMs("moodsoul_boot_to_interactive_ms", "App start to Touch Me, ms");
+static Gauge metricBootWifiMs("moodsoul_boot_wifi_ms", "Wi-Fi join time at boot, ms");
+
+void bootPhaseBegin(BootPhase p) {
+    phaseStart[p] = millis();
+    phaseSeen[p] = true;
+}
+
+void bootPhaseEnd(BootPhase p) {
+    phaseEnd[p] = millis();
+    phaseSeen[p] = true;
+    if (p == BOOT_INTERACTIVE) metricBootInteractiveMs.set(phaseEnd[p]);
+    if (p == BOOT_WIFI) metricBootWifiMs.set(phaseEnd[p] - phaseStart[p]);
+}
+
+void bootPhaseNote(BootPhase p, const char* note) {
+    strlcpy(phaseNote[p], note, sizeof(phaseNote[p]));
+}
+
+struct StepRun {
+    const BootStep*    step;
+    EventGroupHandle_t done;
+    EventBits_t        bit;
+};
+
+static void runStep(StepRun* r) {
+    bootPhaseBegin(r->step->phase);
+    r->step->fn();
+    bootPhaseEnd(r->step->phase);
+    xEventGroupSetBits(r->done, r->bit);
+}
+
+static void stepTask(void* arg) {
+    runStep((StepRun*)arg);
+    vTaskDelete(nullptr);
+}
+
+void bootRunParallel(const BootStep* steps, int count) {
+    if (count > BOOT_MAX_PARALLEL) count = BOOT_MAX_PARALLEL;
+    EventGroupHandle_t done = xEventGroupCreate();
+    StepRun runs[BOOT_MAX_PARALLEL];
+    EventBits_t all = 0;
+
+    for (int i = 0; i < count; i++) {
+        runs[i] = { &steps[i], done, (EventBits_t)1 << i };
+        all |= runs[i].bit;
+        if (xTaskCreatePinnedToCore(stepTask, steps[i].taskName, steps[i].stackSize, &runs[i], 1,
+                                    nullptr, steps[i].core) != pdPASS) {
+            runStep(&runs[i]); // out of memory for a task: run it here instead
+        }
+    }
+    xEventGroupWaitBits(done, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    vEventGroupDelete(done);
+}
+
+void bootReport(void (*out)(const char* line)) {
+    char line[96];
+    for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+        if (!phaseSeen[p]) {
+            snprintf(line, sizeof(line), "boot %-12s -", PHASE_NAMES[p]);
+        } else if (p == BOOT_INTERACTIVE) {
+            snprintf(line, sizeof(line), "boot %-12s at=%lu", PHASE_NAMES[p], (unsigned long)phaseEnd[p]);
+        } else if (phaseEnd[p] < phaseStart[p]) {
+            snprintf(line, sizeof(line), "boot %-12s start=%lu running", PHASE_NAMES[p], (unsigned long)phaseStart[p]);
+        } else {
+            snprintf(line, sizeof(line), "boot %-12s start=%lu end=%lu dur=%lu %s", PHASE_NAMES[p],
+                     (unsigned long)phaseStart[p], (unsigned long)phaseEnd[p],
+                     (unsigned long)(phaseEnd[p] - phaseStart[p]), phaseNote[p]);
+        }
+        out(line);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// BOOT SEQUENCER
+// ==========================================
+// Runs independent init steps as parallel tasks and stamps when each boot
+// phase started and ended (ms since the app started). The serial "boot"
+// command prints the table; boot-to-interactive is also a metric.
+
+enum BootPhase : uint8_t {
+    BOOT_PERIPHERALS = 0, // camera, IMU, mic
+    BOOT_PSRAM,
+    BOOT_WIFI,
+    BOOT_BINDING,
+    BOOT_INTERACTIVE,     // "Touch Me" on screen; only the end is stamped
+    BOOT_OTA,             // background, after interactive
+    BOOT_PHASE_COUNT
+};
+
+struct BootStep {
+    const char* taskName;
+    BootPhase   phase;
+    void      (*fn)();
+    uint32_t    stackSize;
+    int         core;
+};
+
+#define BOOT_MAX_PARALLEL 8
+
+void bootPhaseBegin(BootPhase p);
+void bootPhaseEnd(BootPhase p);
+// Short free-form detail shown in the report (e.g. "fast", "portal").
+void bootPhaseNote(BootPhase p, const char* note);
+// Runs each step in its own task (phase stamped around fn) and returns
+// once all of them have finished.
+void bootRunParallel(const BootStep* steps, int count);
+void bootReport(void (*out)(const char* line));
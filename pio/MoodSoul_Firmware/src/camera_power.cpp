@@ -0,0 +1,183 @@
+#include "camera_power.h"
+#include "metrics.h"
+#include <M5CoreS3.h>
+#include <esp_timer.h>
+
+// GC0308 (CoreS3): page 0, 0x25 enables the data, PCLK, HSYNC and VSYNC
+// output pads. Cleared, the sensor keeps running but sends nothing.
+#define GC0308_PAGE_SELECT  0xFE
+#define GC0308_OUTPUT_EN    0x25
+
+static CameraPower state = CAMERA_OFF;
+static uint8_t     outputEn = 0x0F;    // read back at init
+static bool        canStandby = false; // sensor driver exposes registers
+static bool        settled = false;    // first good frame since the resume
+static int64_t     resumeUs = 0;
+static bool        resumeCold = false;
+static uint32_t    lastUseMs = 0;
+static uint32_t    lingerMs = CAMERA_LINGER_MS;
+static int64_t     streamSinceUs = 0;
+static int64_t     streamTotalUs = 0;
+static int64_t     bootUs = 0;
+static CameraStats stats = {};
+static int         savedVflip = -1, savedHmirror = -1; // orientation across OFF
+
+static Histogram metricResumeMs("moodsoul_camera_resume_ms", "Camera standby/off to first settled frame, ms");
+static Counter   metricBudgetMisses("moodsoul_camera_resume_over_budget_total", "Camera resumes slower than their budget");
+static Gauge     metricDuty("moodsoul_camera_duty_permille", "Share of time the camera streamed, permille");
+static Gauge     metricState("moodsoul_camera_power_state", "0 off, 1 standby, 2 streaming");
+
+const char* cameraPowerName(CameraPower p) {
+    static const char* const NAMES[] = { "off", "standby", "streaming" };
+    return p <= CAMERA_STREAMING ? NAMES[p] : "?";
+}
+
+static void setState(CameraPower s) {
+    int64_t now = esp_timer_get_time();
+    if (state == CAMERA_STREAMING && s != CAMERA_STREAMING) streamTotalUs += now - streamSinceUs;
+    if (s == CAMERA_STREAMING && state != CAMERA_STREAMING) streamSinceUs = now;
+    state = s;
+    metricState.set(s);
+}
+
+static bool setOutputs(bool on) {
+    sensor_t* s = esp_camera_sensor_get();
+    if (!s || !s->set_reg) return false;
+    s->set_reg(s, GC0308_PAGE_SELECT, 0xFF, 0x00);
+    return s->set_reg(s, GC0308_OUTPUT_EN, 0xFF, on ? outputEn : 0x00) == 0;
+}
+
+static bool initSensor() {
+    if (!CoreS3.Camera.begin()) return false;
+    sensor_t* s = esp_camera_sensor_get();
+    if (s && savedVflip >= 0) {
+        s->set_vflip(s, savedVflip);
+        s->set_hmirror(s, savedHmirror);
+    }
+    canStandby = s && s->set_reg && s->get_reg;
+    if (canStandby) {
+        s->set_reg(s, GC0308_PAGE_SELECT, 0xFF, 0x00);
+        int v = s->get_reg(s, GC0308_OUTPUT_EN, 0xFF);
+        if (v > 0) outputEn = (uint8_t)v;
+    }
+    return true;
+}
+
+bool cameraPowerBegin() {
+    bootUs = esp_timer_get_time();
+    if (!initSensor()) {
+        Serial.println("[CAM] init failed");
+        return false;
+    }
+    setState(CAMERA_STREAMING);
+    if (!canStandby) Serial.println("[CAM] sensor has no register access: no standby");
+    else if (setOutputs(false)) setState(CAMERA_STANDBY);
+    return true;
+}
+
+static bool resume() {
+    if (state == CAMERA_STREAMING) return true;
+    resumeUs = esp_timer_get_time();
+    resumeCold = state == CAMERA_OFF;
+    settled = false;
+    if (resumeCold) {
+        if (!initSensor()) return false;
+    } else if (!setOutputs(true)) {
+        return false;
+    }
+    setState(CAMERA_STREAMING);
+    return true;
+}
+
+void cameraPrepare() {
+    if (!resume()) return;
+    lastUseMs = millis();
+    lingerMs = CAMERA_PREPARE_HOLD_MS;
+}
+
+// Exposure has settled when two frames in a row agree on brightness. JPEG
+// size tracks it closely enough; raw frames are sampled.
+static uint32_t frameLevel(const camera_fb_t* fb) {
+    if (fb->format == PIXFORMAT_JPEG) return fb->len;
+    const uint16_t* px = (const uint16_t*)fb->buf;
+    size_t n = fb->len / 2, step = n / 64 + 1;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i += step) {
+        uint16_t p = __builtin_bswap16(px[i]); // sensor sends RGB565 big-endian
+        sum += ((p >> 11) << 1) + ((p >> 5) & 0x3F) + ((p & 0x1F) << 1);
+    }
+    return sum;
+}
+
+static bool levelsAgree(uint32_t a, uint32_t b) {
+    uint32_t d = a > b ? a - b : b - a;
+    return d * 16 <= (a > b ? a : b); // within ~6%
+}
+
+camera_fb_t* cameraCapture(uint32_t timeoutMs) {
+    uint32_t t0 = millis();
+    if (!resume()) return nullptr;
+    lastUseMs = millis();
+    lingerMs = CAMERA_LINGER_MS;
+    uint32_t prevLevel = 0, frames = 0;
+    while (millis() - t0 < timeoutMs) {
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (!fb) continue;
+        int64_t capturedUs = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+        if (settled) return fb;
+        // Buffers filled before standby are stale
+        if (capturedUs < resumeUs) {
+            esp_camera_fb_return(fb);
+            continue;
+        }
+        uint32_t level = frameLevel(fb);
+        frames++;
+        if ((frames > 1 && levelsAgree(level, prevLevel)) || frames >= CAMERA_SETTLE_MAX_FRAMES) {
+            settled = true;
+            // Capture time, not now: a prepared camera settles while nobody waits
+            uint32_t ms = (uint32_t)((capturedUs - resumeUs) / 1000);
+            stats.lastResumeMs = ms;
+            stats.lastSettleFrames = frames;
+            if (resumeCold) stats.coldStarts++;
+            else stats.resumes++;
+            if (ms > (resumeCold ? CAMERA_COLD_BUDGET_MS : CAMERA_RESUME_BUDGET_MS)) {
+                stats.budgetMisses++;
+                metricBudgetMisses.inc();
+            }
+            metricResumeMs.record(ms);
+            return fb;
+        }
+        prevLevel = level;
+        esp_camera_fb_return(fb);
+    }
+    return nullptr;
+}
+
+void cameraRelease(camera_fb_t* fb) {
+    if (fb) esp_camera_fb_return(fb);
+    lastUseMs = millis();
+}
+
+void cameraIdle(uint32_t nowMs) {
+    if (state != CAMERA_STREAMING || nowMs - lastUseMs < lingerMs) return;
+    if (setOutputs(false)) setState(CAMERA_STANDBY);
+}
+
+void cameraPowerOff() {
+    if (state == CAMERA_OFF) return;
+    if (sensor_t* s = esp_camera_sensor_get()) {
+        savedVflip = s->status.vflip;
+        savedHmirror = s->status.hmirror;
+    }
+    esp_camera_deinit();
+    setState(CAMERA_OFF);
+}
+
+CameraStats cameraStats() {
+    int64_t now = esp_timer_get_time();
+    int64_t streamed = streamTotalUs + (state == CAMERA_STREAMING ? now - streamSinceUs : 0);
+    stats.state = state;
+    stats.dutyPermille = now > bootUs ? (uint32_t)(streamed * 1000 / (now - bootUs)) : 0;
+    metricDuty.set(stats.dutyPermille);
+    return stats;
+}
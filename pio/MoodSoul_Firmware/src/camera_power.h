@@ -0,0 +1,60 @@
+#pragma once
+#include <esp_camera.h>
+#include <stdint.h>
+
+// ==========================================
+// CAMERA POWER STATES
+// ==========================================
+// Frames are only needed for a turn or an auto-observe, so the sensor
+// doesn't stream between them:
+//
+//   OFF        driver torn down, XCLK stopped, frame buffers freed. A
+//              resume is a full init: a few hundred ms.
+//   STANDBY    sensor clocked with its registers (and exposure) kept but
+//              its outputs off, so no DMA, no VSYNC interrupts and no PSRAM
+//              traffic. Resume is one register write plus settling.
+//   STREAMING  capturing; kept for CAMERA_LINGER_MS after the last frame
+//              so back-to-back captures don't pay a resume.
+//
+// cameraCapture() resumes as needed and skips frames captured before the
+// resume and frames still settling (auto-exposure), so what it returns is
+// usable. CAMERA_RESUME_BUDGET_MS is what a resume from STANDBY should
+// take; misses are counted.
+
+#define CAMERA_LINGER_MS         2000
+#define CAMERA_PREPARE_HOLD_MS   10000 // cameraPrepare() with no capture after it
+#define CAMERA_RESUME_BUDGET_MS  250   // STANDBY -> first settled frame
+#define CAMERA_COLD_BUDGET_MS    900   // OFF -> first settled frame
+#define CAMERA_SETTLE_MAX_FRAMES 8
+
+enum CameraPower : uint8_t {
+    CAMERA_OFF = 0,
+    CAMERA_STANDBY,
+    CAMERA_STREAMING,
+};
+
+struct CameraStats {
+    CameraPower state;
+    uint32_t resumes;        // from STANDBY
+    uint32_t coldStarts;     // from OFF
+    uint32_t lastResumeMs;   // to the first settled frame
+    uint32_t lastSettleFrames;
+    uint32_t budgetMisses;
+    uint32_t dutyPermille;   // time streaming since boot
+};
+
+// Initializes the sensor and leaves it in STANDBY.
+bool cameraPowerBegin();
+// A settled frame, or nullptr after timeoutMs. Hand it back with
+// cameraRelease().
+camera_fb_t* cameraCapture(uint32_t timeoutMs = 1500);
+void cameraRelease(camera_fb_t* fb);
+// Someone is about to want a frame (presence approach): resume now and let
+// the exposure settle before cameraCapture() is called.
+void cameraPrepare();
+// Call from loop(): drops to STANDBY after the linger time.
+void cameraIdle(uint32_t nowMs);
+// Nobody around (presence DEEP): all the way off.
+void cameraPowerOff();
+CameraStats cameraStats();
+const char* cameraPowerName(CameraPower p);
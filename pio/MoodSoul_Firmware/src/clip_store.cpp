@@ -0,0 +1,103 @@
+#include "clip_store.h"
+#include "asset_store.h"
+#include <LittleFS.h>
+#include <SD.h>
+#include <SPI.h>
+
+fs::FS* clipStoreFs(bool sd) {
+    static bool lfsTried = false, lfsOk = false, sdTried = false, sdOk = false;
+    if (!sd) {
+        if (!lfsTried) {
+            lfsTried = true;
+            lfsOk = LittleFS.begin(true); // formats a blank partition
+        }
+        return lfsOk ? &LittleFS : nullptr;
+    }
+    if (!sdTried) {
+        sdTried = true;
+        // CoreS3: microSD on the display's SPI bus, CS on GPIO 4
+        sdOk = SD.begin(GPIO_NUM_4, SPI, 25000000);
+    }
+    return sdOk ? &SD : nullptr;
+}
+
+static uint32_t readLe32(File& f) {
+    uint8_t b[4] = {};
+    f.read(b, 4);
+    return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+bool clipStoreLoadWav(fs::FS& fs, const char* path, uint32_t maxSamples,
+                      int16_t** pcm, uint32_t* len) {
+    File f = fs.open(path, "r");
+    if (!f) return false;
+    char tag[4];
+    bool ok = false;
+    if (f.read((uint8_t*)tag, 4) == 4 && !memcmp(tag, "RIFF", 4)) {
+        readLe32(f);
+        f.read((uint8_t*)tag, 4);
+        bool fmtOk = false;
+        while (!ok && f.read((uint8_t*)tag, 4) == 4) {
+            uint32_t size = readLe32(f);
+            if (!memcmp(tag, "fmt ", 4)) {
+                uint8_t fmt[16] = {};
+                f.read(fmt, sizeof(fmt));
+                uint32_t rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t)fmt[7] << 24;
+                fmtOk = fmt[0] == 1 && fmt[2] == 1 && rate == CLIP_RATE && fmt[14] == 16;
+                f.seek(f.position() + size - sizeof(fmt) + (size & 1));
+            } else if (!memcmp(tag, "data", 4) && fmtOk) {
+                // Streamed WAVs may carry a placeholder size: trust the file
+                uint32_t n = size / 2;
+                uint32_t left = (f.size() - f.position()) / 2;
+                if (n > left) n = left;
+                if (n > maxSamples) n = maxSamples;
+                int16_t* buf = (int16_t*)heap_caps_malloc(n * 2, MALLOC_CAP_SPIRAM);
+                if (!buf) break;
+                if (f.read((uint8_t*)buf, n * 2) != n * 2) {
+                    heap_caps_free(buf);
+                    break;
+                }
+                *pcm = buf;
+                *len = n;
+                ok = n > 0;
+            } else {
+                f.seek(f.position() + size + (size & 1));
+            }
+        }
+    }
+    f.close();
+    if (!ok) Serial.printf("[CLIP] %s: not 16 kHz mono PCM16\n", path);
+    return ok;
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool clipStoreFindWav(const char* name, const int16_t** pcm, uint32_t* len) {
+    AssetInfo info;
+    if (!assetStoreGet(name, info)) return false;
+    const uint8_t* p = assetDirect(info);
+    if (!p || info.size < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4)) return false;
+    bool fmtOk = false;
+    for (uint32_t at = 12; at + 8 <= info.size;) {
+        uint32_t size = le32(p + at + 4);
+        if (size > info.size) break;
+        const uint8_t* body = p + at + 8;
+        if (!memcmp(p + at, "fmt ", 4) && size >= 16) {
+            fmtOk = body[0] == 1 && body[2] == 1 && le32(body + 4) == CLIP_RATE && body[14] == 16;
+        } else if (!memcmp(p + at, "data", 4) && fmtOk && !((uintptr_t)body & 1)) {
+            uint32_t n = std::min(size, info.size - at - 8) / 2;
+            *pcm = (const int16_t*)body;
+            *len = n;
+            return n > 0;
+        }
+        at += 8 + size + (size & 1);
+    }
+    Serial.printf("[CLIP] pack %s: not 16 kHz mono PCM16\n", name);
+    return false;
+}
+
+void clipStoreFree(const int16_t* pcm) {
+    if (pcm && !assetStoreOwns(pcm)) heap_caps_free((void*)pcm);
+}
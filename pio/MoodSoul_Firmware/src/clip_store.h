@@ -0,0 +1,25 @@
+#pragma once
+#include <FS.h>
+#include <stdint.h>
+
+// ==========================================
+// LOCAL CLIP STORE
+// ==========================================
+// Short speech clips kept on flash (LittleFS) or the SD card and played
+// without a round trip: fillers, the quota reply, cached reactions. Clips
+// are 16 kHz mono PCM16 WAVs, so playback never waits on a decoder.
+// Clips shipped in the asset pack (asset_store.h) play straight from
+// flash; clips on a filesystem are copied into PSRAM.
+
+#define CLIP_RATE 16000
+
+// LittleFS (sd = false) or the SD card, mounted on first use. Null if the
+// medium isn't there.
+fs::FS* clipStoreFs(bool sd);
+// Reads a WAV into PSRAM, at most maxSamples. Free with clipStoreFree().
+bool clipStoreLoadWav(fs::FS& fs, const char* path, uint32_t maxSamples,
+                      int16_t** pcm, uint32_t* len);
+// A WAV in the asset pack, in place: no copy, nothing to free.
+bool clipStoreFindWav(const char* name, const int16_t** pcm, uint32_t* len);
+// Frees a clip from clipStoreLoadWav(); pack clips are left alone.
+void clipStoreFree(const int16_t* pcm);
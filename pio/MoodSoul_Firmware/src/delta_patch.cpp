@@ -0,0 +1,210 @@
+#include "delta_patch.h"
+#include <string.h>
+
+enum {
+    ST_DIFF_LEN = 0,
+    ST_EXTRA_LEN,
+    ST_SEEK,
+    ST_DIFF,
+    ST_EXTRA,
+    ST_DONE,
+};
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t deltaPutVarint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+void deltaInit(DeltaDecoder& d, DeltaReadOld readOld, DeltaWriteOut writeOut, void* ctx) {
+    memset(&d, 0, sizeof(d));
+    d.readOld = readOld;
+    d.writeOut = writeOut;
+    d.ctx = ctx;
+    d.state = ST_DIFF_LEN;
+}
+
+bool deltaHeaderReady(const DeltaDecoder& d) {
+    return d.headerLen == DELTA_HEADER_SIZE;
+}
+
+static bool parseHeader(DeltaDecoder& d) {
+    const uint8_t* h = d.headerBuf;
+    if (memcmp(h, DELTA_MAGIC, 4) != 0 || h[4] != DELTA_VERSION) return false;
+    d.header.windowBits = h[5];
+    d.header.lookaheadBits = h[6];
+    if (d.header.windowBits < 4 || d.header.windowBits > DELTA_MAX_WINDOW_BITS) return false;
+    if (d.header.lookaheadBits < 2 || d.header.lookaheadBits >= d.header.windowBits) return false;
+    d.header.baseSize = readLe32(h + 8);
+    d.header.targetSize = readLe32(h + 12);
+    memcpy(d.header.baseSha256, h + 16, 32);
+    memcpy(d.header.targetSha256, h + 48, 32);
+    return true;
+}
+
+// ==========================================
+// OUTPUT SIDE
+// ==========================================
+static bool flushOut(DeltaDecoder& d) {
+    if (d.outLen == 0) return true;
+    bool ok = d.writeOut(d.ctx, d.out, d.outLen);
+    d.outLen = 0;
+    return ok;
+}
+
+static bool emit(DeltaDecoder& d, uint8_t b) {
+    d.out[d.outLen++] = b;
+    d.newPos++;
+    if (d.outLen == DELTA_OUT_BUF || d.newPos == d.header.targetSize) return flushOut(d);
+    return true;
+}
+
+static bool oldByte(DeltaDecoder& d, uint8_t& b) {
+    if (d.oldPos >= d.header.baseSize) return false;
+    if (d.oldPos < d.oldCacheStart || d.oldPos >= d.oldCacheStart + d.oldCacheLen) {
+        uint32_t len = d.header.baseSize - d.oldPos;
+        if (len > DELTA_OLD_CACHE) len = DELTA_OLD_CACHE;
+        if (!d.readOld(d.ctx, d.oldPos, d.oldCache, len)) {
+            d.status = DELTA_ERR_READ;
+            return false;
+        }
+        d.oldCacheStart = d.oldPos;
+        d.oldCacheLen = len;
+    }
+    b = d.oldCache[d.oldPos - d.oldCacheStart];
+    return true;
+}
+
+// Consumes one decompressed byte of the record stream.
+static DeltaStatus recordByte(DeltaDecoder& d, uint8_t b) {
+    switch (d.state) {
+    case ST_DIFF_LEN:
+    case ST_EXTRA_LEN:
+    case ST_SEEK:
+        if (d.varShift > 28) return DELTA_ERR_CORRUPT;
+        d.varValue |= (uint32_t)(b & 0x7F) << d.varShift;
+        d.varShift += 7;
+        if (b & 0x80) return DELTA_OK;
+        if (d.state == ST_DIFF_LEN) d.diffLeft = d.varValue;
+        else if (d.state == ST_EXTRA_LEN) d.extraLeft = d.varValue;
+        else d.seek = deltaUnZigZag(d.varValue);
+        d.varValue = 0;
+        d.varShift = 0;
+        if (d.state != ST_SEEK) {
+            d.state++;
+            return DELTA_OK;
+        }
+        if ((uint64_t)d.newPos + d.diffLeft + d.extraLeft > d.header.targetSize) return DELTA_ERR_CORRUPT;
+        d.state = d.diffLeft ? ST_DIFF : d.extraLeft ? ST_EXTRA : ST_DIFF_LEN;
+        if (d.state == ST_DIFF_LEN) {
+            // Empty record: apply the seek right away
+            d.oldPos += d.seek;
+        }
+        return DELTA_OK;
+
+    case ST_DIFF: {
+        uint8_t o;
+        if (!oldByte(d, o)) return d.status ? d.status : DELTA_ERR_CORRUPT;
+        d.oldPos++;
+        if (!emit(d, (uint8_t)(o + b))) return DELTA_ERR_WRITE;
+        if (--d.diffLeft == 0) {
+            if (d.extraLeft) {
+                d.state = ST_EXTRA;
+            } else {
+                d.oldPos += d.seek;
+                d.state = ST_DIFF_LEN;
+            }
+        }
+        break;
+    }
+
+    case ST_EXTRA:
+        if (!emit(d, b)) return DELTA_ERR_WRITE;
+        if (--d.extraLeft == 0) {
+            d.oldPos += d.seek;
+            d.state = ST_DIFF_LEN;
+        }
+        break;
+
+    default:
+        return DELTA_OK; // trailing padding after the target is complete
+    }
+
+    if (d.newPos == d.header.targetSize) {
+        d.state = ST_DONE;
+        return DELTA_DONE;
+    }
+    return DELTA_OK;
+}
+
+// ==========================================
+// LZSS BIT STREAM
+// ==========================================
+// Items, MSB first: 1 + 8-bit literal, or 0 + (windowBits) distance-1 +
+// (lookaheadBits) length-1.
+static DeltaStatus decodeBits(DeltaDecoder& d) {
+    const uint8_t wb = d.header.windowBits;
+    const uint8_t lb = d.header.lookaheadBits;
+    const uint32_t mask = (1u << wb) - 1;
+
+    while (d.bitCount >= 1 && d.state != ST_DONE) {
+        bool literal = (d.bitReg >> (d.bitCount - 1)) & 1;
+        uint8_t need = literal ? 9 : 1 + wb + lb;
+        if (d.bitCount < need) return DELTA_OK;
+        d.bitCount -= need;
+        uint32_t item = (d.bitReg >> d.bitCount) & ((1u << (need - 1)) - 1);
+
+        if (literal) {
+            uint8_t b = (uint8_t)item;
+            d.window[d.windowPos++ & mask] = b;
+            DeltaStatus st = recordByte(d, b);
+            if (st != DELTA_OK) return st;
+        } else {
+            uint32_t dist = (item >> lb) + 1;
+            uint32_t count = (item & ((1u << lb) - 1)) + 1;
+            if (dist > d.windowPos) return DELTA_ERR_CORRUPT;
+            for (uint32_t i = 0; i < count; i++) {
+                uint8_t b = d.window[(d.windowPos - dist) & mask];
+                d.window[d.windowPos++ & mask] = b;
+                DeltaStatus st = recordByte(d, b);
+                if (st != DELTA_OK) return st;
+            }
+        }
+    }
+    return d.state == ST_DONE ? DELTA_DONE : DELTA_OK;
+}
+
+DeltaStatus deltaFeed(DeltaDecoder& d, const uint8_t* in, size_t len) {
+    if (d.status != DELTA_OK) return d.status;
+
+    while (len > 0 && d.headerLen < DELTA_HEADER_SIZE) {
+        d.headerBuf[d.headerLen++] = *in++;
+        len--;
+        if (d.headerLen == DELTA_HEADER_SIZE && !parseHeader(d)) {
+            return d.status = DELTA_ERR_HEADER;
+        }
+    }
+    if (d.headerLen == DELTA_HEADER_SIZE && d.header.targetSize == 0) {
+        return d.status = DELTA_DONE;
+    }
+
+    while (len > 0) {
+        // Top up the bit register; an item is at most 1 + 12 + 11 bits
+        while (len > 0 && d.bitCount <= 24) {
+            d.bitReg = (d.bitReg << 8) | *in++;
+            d.bitCount += 8;
+            len--;
+        }
+        DeltaStatus st = decodeBits(d);
+        if (st != DELTA_OK) return d.status = st;
+    }
+    return DELTA_OK;
+}
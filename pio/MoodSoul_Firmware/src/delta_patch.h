@@ -0,0 +1,98 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// DELTA PATCH DECODER
+// ==========================================
+// Streaming decoder for firmware delta patches produced by the host tool
+// (env:native-delta-tool). The patch is bsdiff-style: a sequence of
+//   (diffLen, extraLen, seek)
+// records, where diffLen bytes are added byte-wise to the base image at
+// the current old position, extraLen bytes are copied verbatim, and the old
+// position then moves by seek. The record stream is LZSS-compressed
+// (heatshrink-style bit stream) so the long runs of zero diff bytes
+// collapse.
+//
+// RAM is bounded by the LZSS window (2^windowBits) plus two small buffers,
+// independent of image size. Base bytes are pulled through a callback, so
+// on the device they come straight from the running app partition.
+//
+// File layout (little endian):
+//   "MSDP" u8 version=1, u8 windowBits, u8 lookaheadBits, u8 reserved
+//   u32 baseSize, u32 targetSize, u8 baseSha256[32], u8 targetSha256[32]
+//   compressed records...
+
+#define DELTA_MAGIC          "MSDP"
+#define DELTA_VERSION        1
+#define DELTA_HEADER_SIZE    80
+#define DELTA_MAX_WINDOW_BITS 12
+#define DELTA_OLD_CACHE      256
+#define DELTA_OUT_BUF        512
+
+struct DeltaHeader {
+    uint8_t  windowBits;
+    uint8_t  lookaheadBits;
+    uint32_t baseSize;
+    uint32_t targetSize;
+    uint8_t  baseSha256[32];
+    uint8_t  targetSha256[32];
+};
+
+enum DeltaStatus {
+    DELTA_OK = 0,        // need more input
+    DELTA_DONE,          // targetSize bytes produced
+    DELTA_ERR_HEADER,
+    DELTA_ERR_CORRUPT,   // record points outside the base or past the target
+    DELTA_ERR_READ,      // base read callback failed
+    DELTA_ERR_WRITE,     // output callback failed
+};
+
+typedef bool (*DeltaReadOld)(void* ctx, uint32_t offset, uint8_t* buf, size_t len);
+typedef bool (*DeltaWriteOut)(void* ctx, const uint8_t* buf, size_t len);
+
+struct DeltaDecoder {
+    DeltaHeader   header;
+    DeltaReadOld  readOld;
+    DeltaWriteOut writeOut;
+    void*         ctx;
+
+    // header collection
+    uint8_t  headerBuf[DELTA_HEADER_SIZE];
+    uint32_t headerLen;
+
+    // LZSS bit reader + window
+    uint32_t bitReg;
+    uint8_t  bitCount;
+    uint8_t  window[1 << DELTA_MAX_WINDOW_BITS];
+    uint32_t windowPos;
+
+    // record parser
+    uint8_t  state;
+    uint8_t  varShift;
+    uint32_t varValue;
+    uint32_t diffLeft, extraLeft;
+    int32_t  seek;
+    uint32_t oldPos;
+    uint32_t newPos;
+
+    // base read cache and output buffer
+    uint8_t  oldCache[DELTA_OLD_CACHE];
+    uint32_t oldCacheStart, oldCacheLen;
+    uint8_t  out[DELTA_OUT_BUF];
+    uint32_t outLen;
+
+    DeltaStatus status;
+};
+
+void deltaInit(DeltaDecoder& d, DeltaReadOld readOld, DeltaWriteOut writeOut, void* ctx);
+// Feeds raw patch bytes (header first). Returns DELTA_OK while more input
+// is needed, DELTA_DONE once the whole target has been written out.
+DeltaStatus deltaFeed(DeltaDecoder& d, const uint8_t* in, size_t len);
+// True once the header has been parsed (d.header is valid).
+bool deltaHeaderReady(const DeltaDecoder& d);
+
+// Varint helpers shared with the encoder.
+size_t deltaPutVarint(uint8_t* out, uint32_t v);
+inline uint32_t deltaZigZag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t deltaUnZigZag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
@@ -0,0 +1,97 @@
+#include "dsp_q15.h"
+#include <math.h>
+
+#if defined(ARDUINO) && __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define DSP_ESP 1
+#else
+#define DSP_ESP 0
+#endif
+
+static bool    ready = false;
+static uint8_t log2Frac[256];        // log2(1 + i/256), Q6
+#if !DSP_ESP
+static int16_t twiddle[DSP_FFT_MAX]; // cos/-sin pairs for DSP_FFT_MAX, Q15
+#endif
+
+void dspInit() {
+    if (ready) return;
+    for (int i = 0; i < 256; i++) log2Frac[i] = (uint8_t)lrintf(log2f(1.0f + i / 256.0f) * 64.0f);
+#if DSP_ESP
+    // One table serves every size up to DSP_FFT_MAX
+    dsps_fft2r_init_sc16(nullptr, DSP_FFT_MAX);
+#else
+    for (int i = 0; i < DSP_FFT_MAX / 2; i++) {
+        twiddle[2 * i]     = (int16_t)lrintf(cosf(2.0f * (float)M_PI * i / DSP_FFT_MAX) * 32767.0f);
+        twiddle[2 * i + 1] = (int16_t)lrintf(-sinf(2.0f * (float)M_PI * i / DSP_FFT_MAX) * 32767.0f);
+    }
+#endif
+    ready = true;
+}
+
+void dspFft(int16_t* d, int n) {
+#if DSP_ESP
+    dsps_fft2r_sc16(d, n);
+    dsps_bit_rev_sc16_ansi(d, n);
+#else
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            int16_t re = d[2 * i], im = d[2 * i + 1];
+            d[2 * i] = d[2 * j];
+            d[2 * i + 1] = d[2 * j + 1];
+            d[2 * j] = re;
+            d[2 * j + 1] = im;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len >> 1, step = DSP_FFT_MAX / len;
+        for (int start = 0; start < n; start += len) {
+            for (int k = 0; k < half; k++) {
+                int32_t wr = twiddle[2 * k * step], wi = twiddle[2 * k * step + 1];
+                int16_t* a = d + 2 * (start + k);
+                int16_t* b = d + 2 * (start + k + half);
+                int32_t tr = (b[0] * wr - b[1] * wi + 16384) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr + 16384) >> 15;
+                int32_t ar = a[0], ai = a[1];
+                a[0] = (int16_t)((ar + tr + 1) >> 1);
+                a[1] = (int16_t)((ai + ti + 1) >> 1);
+                b[0] = (int16_t)((ar - tr + 1) >> 1);
+                b[1] = (int16_t)((ai - ti + 1) >> 1);
+            }
+        }
+    }
+#endif
+}
+
+int16_t dspDot16(const int16_t* a, const int16_t* b, int len) {
+#if DSP_ESP
+    int16_t r;
+    dsps_dotprod_s16(a, b, &r, len, 0);
+    return r;
+#else
+    int64_t acc = 0x7fff;
+    for (int i = 0; i < len; i++) acc += (int32_t)a[i] * b[i];
+    return (int16_t)(acc >> 15);
+#endif
+}
+
+float dspDotF32(const float* a, const float* b, int len) {
+#if DSP_ESP
+    float r;
+    dsps_dotprod_f32(a, b, &r, len);
+    return r;
+#else
+    float acc = 0.0f;
+    for (int i = 0; i < len; i++) acc += a[i] * b[i];
+    return acc;
+#endif
+}
+
+int32_t dspLog2Q6(uint64_t v) {
+    int msb = 63 - __builtin_clzll(v);
+    uint32_t frac = msb >= 8 ? (uint32_t)(v >> (msb - 8)) & 0xFF : (uint32_t)(v << (8 - msb)) & 0xFF;
+    return msb * 64 + log2Frac[frac];
+}
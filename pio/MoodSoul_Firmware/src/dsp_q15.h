@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// FIXED-POINT DSP KERNELS
+// ==========================================
+// The few kernels the audio paths share. On the ESP32-S3 they map to
+// esp-dsp's S3 (PIE SIMD) implementations; elsewhere, and for the host
+// tools, to plain C with the same scaling. The echo canceller's float dot
+// product lives here too, for the same reason.
+
+#define DSP_FFT_MAX 512
+
+// Builds the twiddle tables. Idempotent.
+void dspInit();
+// In-place complex FFT of n (power of two, <= DSP_FFT_MAX) interleaved
+// re/im pairs, natural order out. Each stage halves, so the result is
+// X[k] / n. For the inverse, conjugate the input: the real part of the
+// output is then ifft(Y).
+void dspFft(int16_t* d, int n);
+// (sum(a[i] * b[i]) + 0x7fff) >> 15. 16-byte aligned inputs with len a
+// multiple of 8 take the SIMD path.
+int16_t dspDot16(const int16_t* a, const int16_t* b, int len);
+// sum(a[i] * b[i]) in float.
+float dspDotF32(const float* a, const float* b, int len);
+// log2(v) in Q6; v > 0.
+int32_t dspLog2Q6(uint64_t v);
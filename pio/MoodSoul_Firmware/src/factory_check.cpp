@@ -0,0 +1,118 @@
+#include "factory_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// First-batch numbers with margin; tighten once there's line data.
+static const FactoryLimit LIMITS[FT_ITEM_COUNT] = {
+    { "display_fill_mpx_s", 1.5f,             FACTORY_NO_LIMIT },
+    { "display_push_fps",   15.0f,            FACTORY_NO_LIMIT },
+    { "camera_fps",         10.0f,            FACTORY_NO_LIMIT },
+    { "camera_jpeg_kb",     2.0f,             40.0f },
+    { "mic_noise_dbfs",     FACTORY_NO_LIMIT, -50.0f },
+    { "mic_snr_db",         20.0f,            FACTORY_NO_LIMIT },
+    { "loopback_ms",        10.0f,            60.0f },
+    { "psram_mb_s",         20.0f,            FACTORY_NO_LIMIT },
+    { "flash_mb_s",         5.0f,             FACTORY_NO_LIMIT },
+    { "wifi_down_mbps",     4.0f,             FACTORY_NO_LIMIT },
+    { "wifi_up_mbps",       4.0f,             FACTORY_NO_LIMIT },
+};
+
+const FactoryLimit& factoryLimit(FactoryItem item) {
+    return LIMITS[item < FT_ITEM_COUNT ? item : 0];
+}
+
+void factoryInit(FactoryReport& r) {
+    for (int i = 0; i < FT_ITEM_COUNT; i++) r.items[i] = { 0, false, false, "not run" };
+}
+
+void factorySet(FactoryReport& r, FactoryItem item, float value) {
+    const FactoryLimit& l = LIMITS[item];
+    bool ok = !isnan(value) && (l.min == FACTORY_NO_LIMIT || value >= l.min) &&
+              (l.max == FACTORY_NO_LIMIT || value <= l.max);
+    r.items[item] = { value, true, ok, nullptr };
+}
+
+void factoryFail(FactoryReport& r, FactoryItem item, const char* error) {
+    r.items[item] = { 0, false, false, error };
+}
+
+bool factoryPassed(const FactoryReport& r) {
+    for (int i = 0; i < FT_ITEM_COUNT; i++) {
+        if (!r.items[i].pass) return false;
+    }
+    return true;
+}
+
+size_t factoryReportJson(const FactoryReport& r, const char* device, const char* firmware, char* buf,
+                         size_t cap) {
+    if (!cap) return 0;
+    size_t len = 0;
+    auto put = [&](const char* fmt, auto... args) {
+        if (len >= cap) return;
+        int n = snprintf(buf + len, cap - len, fmt, args...);
+        if (n > 0) len += (size_t)n;
+    };
+    put("{\"device\":\"%s\",\"firmware\":\"%s\",\"pass\":%s,\"items\":[", device, firmware,
+        factoryPassed(r) ? "true" : "false");
+    for (int i = 0; i < FT_ITEM_COUNT; i++) {
+        const FactoryLimit& l = LIMITS[i];
+        const FactoryResult& res = r.items[i];
+        put("%s{\"name\":\"%s\"", i ? "," : "", l.name);
+        if (res.measured) put(",\"value\":%.2f", res.value);
+        if (l.min != FACTORY_NO_LIMIT) put(",\"min\":%g", l.min);
+        if (l.max != FACTORY_NO_LIMIT) put(",\"max\":%g", l.max);
+        put(",\"pass\":%s", res.pass ? "true" : "false");
+        if (!res.measured) put(",\"error\":\"%s\"", res.error ? res.error : "");
+        put("}");
+    }
+    put("]}");
+    if (len >= cap) len = cap - 1; // snprintf kept it terminated
+    return len;
+}
+
+// ==========================================
+// AUDIO ANALYSIS
+// ==========================================
+float factoryRmsDbfs(const int16_t* x, size_t n) {
+    if (!n) return -120.0f;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) sum += (double)x[i] * x[i];
+    double rms = sqrt(sum / n) / 32768.0;
+    return rms > 1e-6 ? (float)(20.0 * log10(rms)) : -120.0f;
+}
+
+float factoryToneSnrDb(const int16_t* x, size_t n, float toneHz, uint32_t rate) {
+    if (!n) return 0;
+    double mean = 0;
+    for (size_t i = 0; i < n; i++) mean += x[i];
+    mean /= n;
+    // Goertzel at the tone; its power is amplitude^2 / 2 like the total's
+    double coeff = 2.0 * cos(2.0 * M_PI * toneHz / rate);
+    double s1 = 0, s2 = 0, total = 0;
+    for (size_t i = 0; i < n; i++) {
+        double v = x[i] - mean;
+        total += v * v;
+        double s0 = v + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double mag2 = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    double tone = 2.0 * mag2 / ((double)n * n);
+    double rest = total / n - tone;
+    if (tone <= 0) return -120.0f;
+    if (rest <= tone * 1e-9) return 90.0f;
+    return (float)(10.0 * log10(tone / rest));
+}
+
+long factoryOnset(const int16_t* x, size_t n, size_t from, int threshold) {
+    for (size_t i = from; i < n; i++) {
+        if (x[i] >= threshold || x[i] <= -threshold) return (long)i;
+    }
+    return -1;
+}
+
+void factoryTone(int16_t* out, size_t n, float toneHz, uint32_t rate, int16_t amplitude) {
+    double w = 2.0 * M_PI * toneHz / rate;
+    for (size_t i = 0; i < n; i++) out[i] = (int16_t)lrint(amplitude * sin(w * i));
+}
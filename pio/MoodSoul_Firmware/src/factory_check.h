@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// FACTORY CHARACTERIZATION
+// ==========================================
+// What factory test mode measures, the limits a good unit falls inside, and
+// the report. The measuring is device-only (factory_test.h); the limits,
+// the audio analysis and the report are plain code that builds on the
+// host too (env:native-factory-check). The station
+// (env:native-factory-station) collects reports.
+//
+// The report is one line of JSON, on serial after FACTORY_REPORT_TAG and
+// POSTed to the station:
+//
+//   {"device":"...","firmware":"1.3","pass":false,"items":[
+//     {"name":"mic_snr_db","value":31.2,"min":20,"pass":true}, ...
+//     {"name":"wifi_down_mbps","pass":false,"error":"no station"}]}
+//
+// An item that couldn't be measured fails with an error instead of a value.
+
+#define FACTORY_REPORT_TAG "FACTORY_REPORT "
+#define FACTORY_NO_LIMIT   (-1e30f)
+
+enum FactoryItem : uint8_t {
+    FT_DISPLAY_FILL = 0,  // solid fills, Mpx/s
+    FT_DISPLAY_PUSH,      // full-screen RGB565 frames, fps
+    FT_CAMERA_FPS,        // settled frames back to back
+    FT_CAMERA_JPEG,       // mean JPEG size, KB (encoded here for raw sensors)
+    FT_MIC_NOISE,         // speaker idle, dBFS
+    FT_MIC_SNR,           // 1 kHz through the speaker, dB
+    FT_LOOPBACK,          // speaker sample out to mic sample in, ms
+    FT_PSRAM,             // memcpy PSRAM to PSRAM, MB/s
+    FT_FLASH,             // flash reads, MB/s
+    FT_WIFI_DOWN,         // from the station, Mbit/s
+    FT_WIFI_UP,           // to the station, Mbit/s
+    FT_ITEM_COUNT
+};
+
+struct FactoryLimit {
+    const char* name;
+    float       min, max; // FACTORY_NO_LIMIT = unbounded
+};
+
+struct FactoryResult {
+    float       value;
+    bool        measured;
+    bool        pass;
+    const char* error;    // when not measured
+};
+
+struct FactoryReport {
+    FactoryResult items[FT_ITEM_COUNT];
+};
+
+const FactoryLimit& factoryLimit(FactoryItem item);
+void factoryInit(FactoryReport& r);
+// Records a value and judges it against the limits.
+void factorySet(FactoryReport& r, FactoryItem item, float value);
+void factoryFail(FactoryReport& r, FactoryItem item, const char* error);
+// Every item measured and inside its limits.
+bool factoryPassed(const FactoryReport& r);
+// The JSON line (no tag, no newline). Returns its length, truncating at cap.
+size_t factoryReportJson(const FactoryReport& r, const char* device, const char* firmware, char* buf,
+                         size_t cap);
+
+// Audio analysis for the loopback capture (16-bit mono).
+float factoryRmsDbfs(const int16_t* x, size_t n);
+// Tone power against everything else in x, DC removed. n should hold a
+// whole number of tone periods.
+float factoryToneSnrDb(const int16_t* x, size_t n, float toneHz, uint32_t rate);
+// First index at or after `from` where |x| reaches `threshold`, or -1.
+long factoryOnset(const int16_t* x, size_t n, size_t from, int threshold);
+void factoryTone(int16_t* out, size_t n, float toneHz, uint32_t rate, int16_t amplitude);
@@ -0,0 +1,347 @@
+#include "factory_test.h"
+#include "audio_duplex.h"
+#include "camera_power.h"
+#include "viewfinder.h"
+#include <M5Unified.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <img_converters.h>
+
+#define SCRATCH_BYTES    (1024 * 1024)      // PSRAM, freed at the end
+#define SCREEN_W         320
+#define SCREEN_H         240
+#define FILL_ROUNDS      20
+#define PUSH_ROUNDS      20
+#define CAMERA_FRAMES    20
+#define JPEG_FRAMES      5
+#define JPEG_QUALITY     80                 // what a raw frame would be sent at
+#define AUDIO_RATE       16000
+#define TONE_HZ          1000.0f
+#define TONE_AMPLITUDE   8000               // -12 dBFS
+#define TONE_START       (AUDIO_RATE / 4)   // 250 ms of silence first
+#define TONE_LEN         (AUDIO_RATE / 2)
+#define CAPTURE_LEN      AUDIO_RATE         // 1 s
+#define NOISE_FROM       (AUDIO_RATE / 20)  // skip the codec's start-up click
+#define SNR_SKIP         (AUDIO_RATE / 10)  // let the speaker ring up
+#define SNR_LEN          4800               // 300 ms, whole 1 kHz periods
+#define ONSET_MIN        300
+#define PSRAM_ROUNDS     8
+#define FLASH_BYTES      (1024 * 1024)
+#define FLASH_CHUNK      (64 * 1024)
+#define WIFI_JOIN_MS     8000
+#define WIFI_TIMEOUT_MS  10000
+#define WIFI_DOWN_BYTES  (2 * 1024 * 1024)
+#define WIFI_UP_BYTES    (1024 * 1024)
+
+static void status(const char* what) {
+    M5.Lcd.fillRect(0, 40, SCREEN_W, 20, BLACK);
+    M5.Lcd.setTextDatum(TL_DATUM);
+    M5.Lcd.setTextColor(WHITE, BLACK);
+    M5.Lcd.setTextSize(2);
+    M5.Lcd.drawString(what, 10, 40);
+    Serial.printf("[FACTORY] %s\n", what);
+}
+
+static double secondsSince(int64_t t0) {
+    return (esp_timer_get_time() - t0) / 1e6;
+}
+
+// ==========================================
+// DISPLAY
+// ==========================================
+static void testDisplay(FactoryReport& r, uint8_t* scratch) {
+    static const uint16_t colors[] = { RED, GREEN, BLUE, WHITE };
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < FILL_ROUNDS; i++) M5.Lcd.fillScreen(colors[i % 4]);
+    factorySet(r, FT_DISPLAY_FILL, FILL_ROUNDS * SCREEN_W * SCREEN_H / secondsSince(t0) / 1e6);
+
+    // color565() is native order: say so, or pushImage takes it as swapped
+    lgfx::rgb565_t* frame = (lgfx::rgb565_t*)scratch;
+    for (int y = 0; y < SCREEN_H; y++) {
+        for (int x = 0; x < SCREEN_W; x++) {
+            frame[y * SCREEN_W + x] = M5.Lcd.color565(x * 255 / SCREEN_W, y * 255 / SCREEN_H, 128);
+        }
+    }
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < PUSH_ROUNDS; i++) M5.Lcd.pushImage(0, 0, SCREEN_W, SCREEN_H, frame);
+    factorySet(r, FT_DISPLAY_PUSH, PUSH_ROUNDS / secondsSince(t0));
+    M5.Lcd.fillScreen(BLACK);
+}
+
+// ==========================================
+// CAMERA
+// ==========================================
+static void testCamera(FactoryReport& r) {
+    camera_fb_t* fb = cameraCapture(3000); // resume and settle, not timed
+    if (!fb) {
+        factoryFail(r, FT_CAMERA_FPS, "no frame");
+        factoryFail(r, FT_CAMERA_JPEG, "no frame");
+        return;
+    }
+    cameraRelease(fb);
+
+    int64_t t0 = esp_timer_get_time();
+    int frames = 0;
+    for (int i = 0; i < CAMERA_FRAMES; i++) {
+        if (!(fb = cameraCapture())) break;
+        frames++;
+        cameraRelease(fb);
+    }
+    if (frames == CAMERA_FRAMES) factorySet(r, FT_CAMERA_FPS, frames / secondsSince(t0));
+    else factoryFail(r, FT_CAMERA_FPS, "frames dropped");
+
+    size_t total = 0;
+    int sized = 0;
+    for (int i = 0; i < JPEG_FRAMES; i++) {
+        if (!(fb = cameraCapture())) break;
+        if (fb->format == PIXFORMAT_JPEG) {
+            // A truncated frame is a bad cable or a starved DMA
+            if (fb->len > 4 && fb->buf[0] == 0xFF && fb->buf[1] == 0xD8) {
+                total += fb->len;
+                sized++;
+            }
+        } else {
+            uint8_t* jpg = nullptr;
+            size_t len = 0;
+            if (frame2jpg(fb, JPEG_QUALITY, &jpg, &len)) {
+                total += len;
+                sized++;
+            }
+            free(jpg);
+        }
+        if (i == JPEG_FRAMES - 1) viewfinderShow(fb);
+        cameraRelease(fb);
+    }
+    if (sized == JPEG_FRAMES) factorySet(r, FT_CAMERA_JPEG, total / (float)sized / 1024);
+    else factoryFail(r, FT_CAMERA_JPEG, "bad frames");
+}
+
+// ==========================================
+// AUDIO
+// ==========================================
+static void testAudio(FactoryReport& r, uint8_t* scratch) {
+    int16_t* spk = (int16_t*)scratch;
+    int16_t* mic = spk + TONE_START + TONE_LEN;
+    memset(spk, 0, TONE_START * sizeof(int16_t));
+    factoryTone(spk + TONE_START, TONE_LEN, TONE_HZ, AUDIO_RATE, TONE_AMPLITUDE);
+
+    if (duplexLoopback(spk, TONE_START + TONE_LEN, mic, CAPTURE_LEN, AUDIO_RATE) != CAPTURE_LEN) {
+        factoryFail(r, FT_MIC_NOISE, "i2s");
+        factoryFail(r, FT_MIC_SNR, "i2s");
+        factoryFail(r, FT_LOOPBACK, "i2s");
+        return;
+    }
+    float noiseDb = factoryRmsDbfs(mic + NOISE_FROM, TONE_START - NOISE_FROM);
+    factorySet(r, FT_MIC_NOISE, noiseDb);
+
+    // Well clear of the noise: 8x its RMS
+    int threshold = (int)(32768.0f * powf(10.0f, noiseDb / 20) * 8);
+    if (threshold < ONSET_MIN) threshold = ONSET_MIN;
+    long onset = factoryOnset(mic, CAPTURE_LEN, TONE_START, threshold);
+    if (onset < 0) {
+        factoryFail(r, FT_LOOPBACK, "tone not heard");
+        onset = TONE_START;
+    } else {
+        factorySet(r, FT_LOOPBACK, (onset - TONE_START) * 1000.0f / AUDIO_RATE);
+    }
+    if (onset + SNR_SKIP + SNR_LEN <= CAPTURE_LEN) {
+        factorySet(r, FT_MIC_SNR, factoryToneSnrDb(mic + onset + SNR_SKIP, SNR_LEN, TONE_HZ, AUDIO_RATE));
+    } else {
+        factoryFail(r, FT_MIC_SNR, "tone too late");
+    }
+}
+
+// ==========================================
+// MEMORY
+// ==========================================
+static void testMemory(FactoryReport& r, uint8_t* scratch) {
+    size_t half = SCRATCH_BYTES / 2;
+    memset(scratch, 0x5A, half);
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < PSRAM_ROUNDS; i++) memcpy(scratch + half, scratch, half);
+    factorySet(r, FT_PSRAM, PSRAM_ROUNDS * half / secondsSince(t0) / 1e6);
+
+    // The running app partition is always there to read
+    const esp_partition_t* app = esp_ota_get_running_partition();
+    if (!app) {
+        factoryFail(r, FT_FLASH, "no partition");
+        return;
+    }
+    size_t bytes = app->size < FLASH_BYTES ? app->size : FLASH_BYTES;
+    t0 = esp_timer_get_time();
+    for (size_t off = 0; off < bytes; off += FLASH_CHUNK) {
+        if (esp_partition_read(app, off, scratch + off % half, FLASH_CHUNK) != ESP_OK) {
+            factoryFail(r, FT_FLASH, "read error");
+            return;
+        }
+    }
+    factorySet(r, FT_FLASH, bytes / secondsSince(t0) / 1e6);
+}
+
+// ==========================================
+// WI-FI
+// ==========================================
+static bool stationAddress(String& host, uint16_t& port) {
+    Preferences p;
+    p.begin("moodsoul", true);
+    String saved = p.getString("factory_srv", "");
+    p.end();
+    int colon = saved.lastIndexOf(':');
+    if (colon > 0) {
+        host = saved.substring(0, colon);
+        port = (uint16_t)saved.substring(colon + 1).toInt();
+        return port != 0;
+    }
+    host = WiFi.gatewayIP().toString();
+    port = FACTORY_STATION_PORT;
+    return host != "0.0.0.0";
+}
+
+// Request head, then the body from `body` (nullptr = none). Returns the
+// response status, leaving the client at the response body.
+static int request(WiFiClient& c, const String& host, const char* method, const String& path, const uint8_t* body,
+                   size_t len, const char* type) {
+    c.printf("%s %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n", method, path.c_str(), host.c_str());
+    if (body) c.printf("Content-Type: %s\r\nContent-Length: %u\r\n", type, (unsigned)len);
+    c.print("\r\n");
+    for (size_t off = 0; body && off < len;) {
+        size_t n = c.write(body + off, len - off < 4096 ? len - off : 4096);
+        if (!n) return -1;
+        off += n;
+    }
+    String status = c.readStringUntil('\n');
+    if (!status.startsWith("HTTP/1.")) return -1;
+    int code = status.substring(9, 12).toInt();
+    while (c.connected() || c.available()) {
+        String h = c.readStringUntil('\n');
+        if (h == "\r" || h.length() == 0) break;
+    }
+    return code;
+}
+
+static void testWifi(FactoryReport& r, uint8_t* scratch, const String& host, uint16_t port) {
+    WiFiClient c;
+    c.setTimeout(WIFI_TIMEOUT_MS / 1000);
+    int64_t t0 = esp_timer_get_time();
+    size_t got = 0;
+    if (c.connect(host.c_str(), port, WIFI_TIMEOUT_MS) &&
+        request(c, host, "GET", String("/factory/download?bytes=") + WIFI_DOWN_BYTES, nullptr, 0, nullptr) == 200) {
+        int64_t last = esp_timer_get_time();
+        while (got < WIFI_DOWN_BYTES && esp_timer_get_time() - last < WIFI_TIMEOUT_MS * 1000LL) {
+            int n = c.read(scratch, 16384);
+            if (n > 0) {
+                got += n;
+                last = esp_timer_get_time();
+            } else if (!c.connected()) {
+                break;
+            } else {
+                delay(1);
+            }
+        }
+    }
+    if (got == WIFI_DOWN_BYTES) factorySet(r, FT_WIFI_DOWN, got * 8 / secondsSince(t0) / 1e6);
+    else factoryFail(r, FT_WIFI_DOWN, got ? "short read" : "no station");
+    c.stop();
+
+    t0 = esp_timer_get_time();
+    if (c.connect(host.c_str(), port, WIFI_TIMEOUT_MS) &&
+        request(c, host, "POST", "/factory/upload", scratch, WIFI_UP_BYTES, "application/octet-stream") == 200) {
+        factorySet(r, FT_WIFI_UP, WIFI_UP_BYTES * 8 / secondsSince(t0) / 1e6);
+    } else {
+        factoryFail(r, FT_WIFI_UP, "no station");
+    }
+    c.stop();
+}
+
+static void postReport(const String& host, uint16_t port, const char* json, size_t len) {
+    WiFiClient c;
+    c.setTimeout(WIFI_TIMEOUT_MS / 1000);
+    if (!c.connect(host.c_str(), port, WIFI_TIMEOUT_MS)) return;
+    int code = request(c, host, "POST", "/factory/report", (const uint8_t*)json, len, "application/json");
+    if (code != 200) Serial.printf("[FACTORY] station report: HTTP %d\n", code);
+    c.stop();
+}
+
+// ==========================================
+// REPORT
+// ==========================================
+static void drawReport(const FactoryReport& r) {
+    M5.Lcd.fillScreen(BLACK);
+    M5.Lcd.setTextDatum(TL_DATUM);
+    M5.Lcd.setTextSize(1);
+    for (int i = 0; i < FT_ITEM_COUNT; i++) {
+        const FactoryResult& res = r.items[i];
+        int y = 4 + i * 17;
+        M5.Lcd.setTextColor(WHITE, BLACK);
+        M5.Lcd.drawString(factoryLimit((FactoryItem)i).name, 6, y);
+        M5.Lcd.drawString(res.measured ? String(res.value, 1) : String(res.error ? res.error : "-"), 170, y);
+        M5.Lcd.setTextColor(res.pass ? GREEN : RED, BLACK);
+        M5.Lcd.drawString(res.pass ? "PASS" : "FAIL", 280, y);
+    }
+    bool pass = factoryPassed(r);
+    M5.Lcd.fillRect(0, 196, SCREEN_W, 44, pass ? GREEN : RED);
+    M5.Lcd.setTextDatum(MC_DATUM);
+    M5.Lcd.setTextColor(BLACK);
+    M5.Lcd.setTextSize(3);
+    M5.Lcd.drawString(pass ? "PASS" : "FAIL", SCREEN_W / 2, 218);
+}
+
+void factoryTestRun(FactoryReport& r, const char* deviceId, const char* firmware) {
+    factoryInit(r);
+    M5.Lcd.fillScreen(BLACK);
+    M5.Lcd.setTextColor(WHITE, BLACK);
+    M5.Lcd.setTextSize(2);
+    M5.Lcd.drawString("FACTORY TEST", 10, 10);
+
+    String host;
+    uint16_t port = 0;
+    bool online = WiFi.status() == WL_CONNECTED;
+    uint8_t* scratch = (uint8_t*)heap_caps_malloc(SCRATCH_BYTES, MALLOC_CAP_SPIRAM);
+    if (!scratch) {
+        for (int i = 0; i < FT_ITEM_COUNT; i++) factoryFail(r, (FactoryItem)i, "no psram");
+    } else {
+        status("Display...");
+        testDisplay(r, scratch);
+        status("Camera...");
+        testCamera(r);
+        delay(1000); // the frame stays up for a look
+        status("Audio loopback...");
+        testAudio(r, scratch);
+        status("Memory...");
+        testMemory(r, scratch);
+
+        if (!online) {
+            status("Wi-Fi join...");
+            WiFi.begin(); // saved credentials
+            for (uint32_t t0 = millis(); millis() - t0 < WIFI_JOIN_MS && WiFi.status() != WL_CONNECTED;) delay(100);
+            online = WiFi.status() == WL_CONNECTED;
+        }
+        online = online && stationAddress(host, port);
+        if (online) {
+            status("Wi-Fi throughput...");
+            testWifi(r, scratch, host, port);
+        } else {
+            factoryFail(r, FT_WIFI_DOWN, "no wifi");
+            factoryFail(r, FT_WIFI_UP, "no wifi");
+        }
+        heap_caps_free(scratch);
+    }
+
+    static char json[1536];
+    size_t len = factoryReportJson(r, deviceId, firmware, json, sizeof(json));
+    Serial.print(FACTORY_REPORT_TAG);
+    Serial.println(json);
+    if (online) postReport(host, port, json, len);
+    drawReport(r);
+}
+
+void factorySetStation(const char* hostPort) {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putString("factory_srv", hostPort);
+    p.end();
+}
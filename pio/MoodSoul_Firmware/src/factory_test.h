@@ -0,0 +1,28 @@
+#pragma once
+#include "factory_check.h"
+
+// ==========================================
+// FACTORY TEST MODE
+// ==========================================
+// Measures the unit against factory_check.h's limits:
+//   display    solid fills and full-screen RGB565 pushes
+//   camera     settled frames per second, JPEG size (encoded here when the
+//              sensor gives raw frames); the last frame stays on screen
+//   audio      one loopback capture on a shared I2S clock
+//              (duplexLoopback()): 250 ms of silence for the noise floor,
+//              then 500 ms of 1 kHz for the SNR and the speaker-to-mic
+//              delay (includes the TX DMA queue, which the AEC also sees)
+//   memory     PSRAM memcpy, flash reads of the running app partition
+//   Wi-Fi      2 MB down and 1 MB up over plain HTTP to the station
+//              (env:native-factory-station on the test PC)
+// then prints the report on serial, POSTs it to the station and shows it.
+//
+// The station is host:port from NVS ("factory <host:port>" on the serial
+// console), else the Wi-Fi gateway on FACTORY_STATION_PORT.
+
+#define FACTORY_STATION_PORT 8090
+
+// Runs everything (about 15 s) and fills `report`.
+void factoryTestRun(FactoryReport& report, const char* deviceId, const char* firmware);
+// Saves the station address ("" = back to the gateway default).
+void factorySetStation(const char* hostPort);
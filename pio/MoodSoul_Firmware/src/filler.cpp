@@ -0,0 +1,208 @@
+#include "filler.h"
+#include "filler_mix.h"
+#include "audio_duplex.h"
+#include "clip_store.h"
+#include "lockfree_ring.h"
+#include "metrics.h"
+#include <M5Unified.h>
+
+#define BLOCK          320     // 20 ms
+#define SPK_CHANNEL    0
+#define REPLY_RING     4096    // reply samples waiting to be mixed, 256 ms
+#define MAX_CLIP_LEN   (FILLER_MAX_CLIP_MS * FILLER_RATE / 1000)
+
+static FillerClip        clips[FILLER_MAX_CLIPS];
+static uint8_t           clipCount = 0;
+static FillerClip        tired = { nullptr, 0 };
+static char              persona[40] = "";
+static FillerMix         mix;
+static TaskHandle_t      task = nullptr;
+static volatile bool     runFlag = false;
+static volatile bool     replyReady = false;
+static int16_t           replyBuf[REPLY_RING];
+static SpscRing<int16_t> replyRing;          // fillerReply() -> task
+static int16_t           spkBuf[3][BLOCK];   // M5.Speaker plays from these in place
+
+static Counter metricFillerPlays("moodsoul_filler_turns_total", "Turns that played filler clips while waiting");
+static Counter metricLocalTired("moodsoul_quota_local_replies_total", "Quota replies served from flash with no request");
+
+static void freeClip(FillerClip& c) {
+    clipStoreFree(c.pcm);
+    c.pcm = nullptr;
+    c.len = 0;
+}
+
+static bool loadWav(fs::FS& fs, const String& path, FillerClip& out) {
+    int16_t* pcm;
+    uint32_t len;
+    if (!clipStoreLoadWav(fs, path.c_str(), MAX_CLIP_LEN, &pcm, &len)) return false;
+    out.pcm = pcm;
+    out.len = len;
+    return true;
+}
+
+// Loads whatever one directory has. Returns the filler count.
+static int loadDir(fs::FS& fs, const String& dir) {
+    File d = fs.open(dir);
+    if (!d || !d.isDirectory()) return 0;
+    File f;
+    while ((f = d.openNextFile())) {
+        String name = f.name();
+        int slash = name.lastIndexOf('/');
+        if (slash >= 0) name = name.substring(slash + 1);
+        f.close();
+        String path = dir + "/" + name;
+        if (name == "tired.wav") {
+            if (!tired.pcm) loadWav(fs, path, tired);
+        } else if (name.startsWith("think") && name.endsWith(".wav") && clipCount < FILLER_MAX_CLIPS) {
+            if (loadWav(fs, path, clips[clipCount])) clipCount++;
+        }
+    }
+    d.close();
+    return clipCount;
+}
+
+// Same names in the asset pack, used in place. Returns the filler count.
+static int loadPack(const String& dir) {
+    const int16_t* pcm;
+    uint32_t len;
+    if (!tired.pcm && clipStoreFindWav((dir + "/tired.wav").c_str(), &pcm, &len)) tired = { pcm, len };
+    for (int i = 1; i <= FILLER_MAX_CLIPS && clipCount < FILLER_MAX_CLIPS; i++) {
+        if (clipStoreFindWav((dir + "/think" + i + ".wav").c_str(), &pcm, &len)) {
+            clips[clipCount++] = { pcm, std::min<uint32_t>(len, MAX_CLIP_LEN) };
+        }
+    }
+    return clipCount;
+}
+
+int fillerLoad(const char* id) {
+    fillerStop();
+    for (int i = 0; i < clipCount; i++) freeClip(clips[i]);
+    clipCount = 0;
+    freeClip(tired);
+    strncpy(persona, id ? id : "", sizeof(persona) - 1);
+    persona[sizeof(persona) - 1] = '\0';
+
+    if (persona[0]) loadPack(String("fillers/") + persona);
+    if (clipCount == 0) loadPack("fillers/default");
+    for (int sd = 0; sd < 2 && clipCount == 0; sd++) {
+        fs::FS* fs = clipStoreFs(sd);
+        if (!fs) continue;
+        if (persona[0]) loadDir(*fs, String("/fillers/") + persona);
+        if (clipCount == 0 || !tired.pcm) loadDir(*fs, "/fillers/default");
+    }
+    size_t bytes = tired.len * 2;
+    for (int i = 0; i < clipCount; i++) bytes += clips[i].len * 2;
+    Serial.printf("[FILLER] persona '%s': %u clips%s, %u KB\n", persona, clipCount,
+                  tired.pcm ? " + tired" : "", (unsigned)(bytes / 1024));
+    return clipCount;
+}
+
+const char* fillerPersona() {
+    return persona;
+}
+
+// Waits for room in the sink, then queues one block.
+static void sinkWrite(const int16_t* pcm, size_t n, int slot) {
+    if (duplexRunning()) {
+        while (runFlag && duplexQueued() > 2 * BLOCK) vTaskDelay(2);
+        duplexPlay(pcm, n);
+    } else {
+        while (runFlag && M5.Speaker.isPlaying(SPK_CHANNEL) >= 2) vTaskDelay(2);
+        memcpy(spkBuf[slot], pcm, n * sizeof(int16_t));
+        M5.Speaker.playRaw(spkBuf[slot], n, FILLER_RATE, false, 1, SPK_CHANNEL);
+    }
+}
+
+static void fillerTask(void*) {
+    int16_t reply[BLOCK], out[BLOCK];
+    int slot = 0;
+    while (runFlag) {
+        if (replyReady) fillerMixCrossfade(mix);
+        uint32_t avail = replyRing.size();
+        if (mix.done && avail == 0) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        // Reply audio only joins once the crossfade has started; after it,
+        // pass through what there is rather than pad the reply with silence
+        const int16_t* r = nullptr;
+        uint32_t n = BLOCK;
+        if (mix.fading) {
+            uint32_t take = avail < BLOCK ? avail : BLOCK;
+            if (mix.fadeLeft == 0) n = take;
+            if (n == 0) {
+                vTaskDelay(pdMS_TO_TICKS(5));
+                continue;
+            }
+            take = replyRing.pop(reply, take);
+            memset(reply + take, 0, (BLOCK - take) * sizeof(int16_t));
+            r = reply;
+        }
+        fillerMixRender(mix, r, out, n);
+        sinkWrite(out, n, slot);
+        slot = (slot + 1) % 3;
+    }
+    task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void fillerStart() {
+    if (task) return;
+    // Without clips the mix is silence until the reply: the task still runs
+    // because the reply plays through it
+    fillerMixStart(mix, clips, clipCount, esp_random());
+    replyReady = false;
+    replyRing.init(replyBuf, REPLY_RING); // the task isn't running yet
+    runFlag = true;
+    if (clipCount) metricFillerPlays.inc();
+    // Above loop(), which is busy reading the response meanwhile
+    if (xTaskCreatePinnedToCore(fillerTask, "filler", 3072, nullptr, 2, &task, 1) != pdPASS) runFlag = false;
+}
+
+void fillerReplyReady() {
+    replyReady = true;
+}
+
+size_t fillerReply(const int16_t* pcm, size_t n) {
+    if (!task) return 0;
+    return replyRing.push(pcm, (uint32_t)n);
+}
+
+bool fillerRunning() {
+    return task != nullptr;
+}
+
+void fillerReplyDrain(uint32_t timeoutMs) {
+    unsigned long t0 = millis();
+    while (task && replyRing.size() && millis() - t0 < timeoutMs) delay(5);
+    if (duplexRunning()) {
+        while (duplexQueued() > 0 && millis() - t0 < timeoutMs) delay(5);
+    } else {
+        while (M5.Speaker.isPlaying(SPK_CHANNEL) && millis() - t0 < timeoutMs) delay(5);
+    }
+}
+
+void fillerStop() {
+    if (!task) return;
+    runFlag = false;
+    while (task) delay(2);
+    if (!duplexRunning()) M5.Speaker.stop(SPK_CHANNEL);
+}
+
+bool fillerPlayTired() {
+    if (!tired.pcm) return false;
+    metricLocalTired.inc();
+    if (duplexRunning()) {
+        for (uint32_t off = 0; off < tired.len;) {
+            size_t n = duplexPlay(tired.pcm + off, tired.len - off);
+            off += n;
+            if (n == 0) delay(10);
+        }
+        while (duplexQueued() > 0) delay(10);
+    } else {
+        M5.Speaker.playRaw(tired.pcm, tired.len, FILLER_RATE, false, 1, SPK_CHANNEL);
+        while (M5.Speaker.isPlaying(SPK_CHANNEL)) delay(10);
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// LATENCY MASKING FILLERS
+// ==========================================
+// Plays persona filler clips from the moment the upload is done until the
+// reply starts (see filler_mix.h), and the quota "I am tired" reply with
+// no round trip at all. Clips are pre-decoded 16 kHz mono PCM16 WAVs,
+// loaded when the persona changes so playback starts at once:
+//   /fillers/<persona id>/think*.wav   fillers, up to FILLER_MAX_CLIPS
+//   /fillers/<persona id>/tired.wav    daily quota used up
+// taken from the asset pack in place (think1..6.wav under the same path,
+// no leading slash), else read from LittleFS, then from the SD card; a
+// persona without its own clips uses the default ones.
+//
+// Output goes to whoever holds the speaker for the turn: the duplex engine
+// in barge-in mode, M5.Speaker otherwise.
+
+#define FILLER_MAX_CLIPS   6
+#define FILLER_MAX_CLIP_MS 2500
+
+// Loads the persona's clips (replacing the current set). Returns the
+// number of filler clips found. Call between turns.
+int fillerLoad(const char* persona);
+const char* fillerPersona();
+// Upload done: start the fillers (silence without clips). The reply plays
+// through the same task, so it runs either way.
+void fillerStart();
+bool fillerRunning();
+// The reply's first audio is in: crossfade into it.
+void fillerReplyReady();
+// Reply PCM through the mixer (crossfaded in, then passed through).
+// Returns samples accepted.
+size_t fillerReply(const int16_t* pcm, size_t n);
+// Waits until the queued reply audio has left the speaker.
+void fillerReplyDrain(uint32_t timeoutMs);
+// End of turn (or error): stops at once.
+void fillerStop();
+// Plays the local quota reply to the end. False if there is none.
+bool fillerPlayTired();
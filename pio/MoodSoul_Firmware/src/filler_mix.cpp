@@ -0,0 +1,78 @@
+#include "filler_mix.h"
+#include <string.h>
+
+#define GAP_SAMPLES   (FILLER_GAP_MS * FILLER_RATE / 1000)
+#define XFADE_SAMPLES (FILLER_XFADE_MS * FILLER_RATE / 1000)
+
+static int8_t pickClip(FillerMix& m) {
+    if (m.count == 0) return -1;
+    m.seed = m.seed * 1664525u + 1013904223u;
+    int8_t c = (int8_t)((m.seed >> 16) % m.count);
+    if (c == m.last && m.count > 1) c = (int8_t)((c + 1) % m.count);
+    m.last = c;
+    return c;
+}
+
+void fillerMixStart(FillerMix& m, const FillerClip* clips, uint8_t count, uint32_t seed) {
+    m.clips = clips;
+    m.count = count;
+    m.last = -1;
+    m.seed = seed;
+    m.plays = 0;
+    m.pos = 0;
+    m.fadeLeft = 0;
+    m.fading = false;
+    m.current = pickClip(m);
+    m.done = m.current < 0;
+    if (!m.done) m.plays = 1;
+}
+
+void fillerMixCrossfade(FillerMix& m) {
+    if (m.fading) return;
+    m.fading = true;
+    m.fadeLeft = XFADE_SAMPLES;
+}
+
+// Next filler sample: clip, pause, next clip ... silence after the last.
+static int16_t fillerSample(FillerMix& m) {
+    if (m.done) return 0;
+    if (m.current >= 0) {
+        const FillerClip& c = m.clips[m.current];
+        int16_t s = m.pos < c.len ? c.pcm[m.pos] : 0;
+        if (++m.pos >= c.len) {
+            m.current = -1;
+            m.pos = 0;
+        }
+        return s;
+    }
+    if (++m.pos >= GAP_SAMPLES) {
+        m.pos = 0;
+        if (m.plays < FILLER_MAX_PLAYS) {
+            m.current = pickClip(m);
+            m.plays++;
+        } else {
+            m.done = true; // said enough; wait in silence
+        }
+    }
+    return 0;
+}
+
+void fillerMixRender(FillerMix& m, const int16_t* reply, int16_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t r = reply ? reply[i] : 0;
+        if (!m.fading) {
+            out[i] = fillerSample(m);
+            continue;
+        }
+        if (m.fadeLeft == 0) {
+            m.done = true;
+            out[i] = (int16_t)r;
+            continue;
+        }
+        // Linear: filler * t + reply * (1 - t), t going 1 -> 0
+        int32_t t = (int32_t)(((uint32_t)m.fadeLeft << 15) / XFADE_SAMPLES);
+        int32_t v = (fillerSample(m) * t + r * (32768 - t)) >> 15;
+        out[i] = (int16_t)v;
+        m.fadeLeft--;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// FILLER SEQUENCER + CROSSFADE
+// ==========================================
+// What plays between "upload done" and the reply: a short persona clip
+// ("hmm...", "let me look"), a pause, another clip, up to FILLER_MAX_PLAYS,
+// never the same clip twice in a row. Once the reply's first audio is
+// ready the filler fades out over FILLER_XFADE_MS while the reply fades
+// in, so the hand-over has no click and no gap.
+
+#define FILLER_RATE      16000
+#define FILLER_GAP_MS    700
+#define FILLER_XFADE_MS  60
+#define FILLER_MAX_PLAYS 3
+
+struct FillerClip {
+    const int16_t* pcm;
+    uint32_t       len;
+};
+
+struct FillerMix {
+    const FillerClip* clips;
+    uint8_t  count;
+    int8_t   current;   // clip playing, -1 in a pause
+    int8_t   last;
+    uint8_t  plays;
+    uint32_t pos;       // samples into the clip or pause
+    uint32_t fadeLeft;  // crossfade samples still to go
+    bool     fading;
+    bool     done;      // filler finished (faded out, or out of plays)
+    uint32_t seed;
+};
+
+void fillerMixStart(FillerMix& m, const FillerClip* clips, uint8_t count, uint32_t seed);
+// The reply is ready: start the crossfade.
+void fillerMixCrossfade(FillerMix& m);
+// Renders n samples. `reply` holds the reply's audio for the same span, or
+// nullptr before it exists (it only counts once the crossfade starts).
+void fillerMixRender(FillerMix& m, const int16_t* reply, int16_t* out, size_t n);
@@ -0,0 +1,143 @@
+#include "heartbeat.h"
+#include "api_post.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "trace.h"
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <string.h>
+
+#define POLL_MS 1000
+
+static Telemetry         tele;     // under lock
+static portMUX_TYPE      lock = portMUX_INITIALIZER_UNLOCKED;
+static Counter*          counters[TELE_COUNTER_COUNT];
+static TaskHandle_t      task = nullptr;
+static String            url;
+static String            deviceId;
+static const char*       firmware = "";
+static volatile uint32_t lastTurnMs = 0;
+static volatile uint32_t nextMs = 0;
+static volatile bool     forced = false;
+static volatile uint32_t sent = 0, failed = 0, lastBytes = 0;
+static volatile int      lastStatus = 0;
+
+static Counter metricHeartbeats("moodsoul_heartbeats_total", "Heartbeats acked by /api/ping");
+static Counter metricHeartbeatFailures("moodsoul_heartbeat_failures_total", "Heartbeats that failed (telemetry kept for the next)");
+static Gauge   metricHeartbeatBytes("moodsoul_heartbeat_bytes", "Size of the last telemetry blob");
+
+static void onTraceEnd(const TraceRecord& rec) {
+    portENTER_CRITICAL(&lock);
+    telemetryTrace(tele, rec, traceTicksPerUs());
+    portEXIT_CRITICAL(&lock);
+    lastTurnMs = millis();
+}
+
+// Not during a turn, nor right after one (follow-ups come quickly)
+static bool quiet(uint32_t now) {
+    if (wifiLinkQuality().tier == LINK_DOWN || wifiLinkBusy() || traceActive()) return false;
+    return lastTurnMs == 0 || now - lastTurnMs >= HEARTBEAT_QUIET_MS;
+}
+
+static int post(const uint8_t* blob, size_t len) {
+    WiFiClientSecure client;
+    HTTPClient http;
+    if (!apiPostBegin(http, client, url, HEARTBEAT_TIMEOUT_MS, "application/cbor")) return -1;
+    http.addHeader("X-Device-Id", deviceId);
+    int code = http.POST((uint8_t*)blob, len);
+    http.end();
+    return code;
+}
+
+static void heartbeatTask(void*) {
+    static Telemetry snap; // copied under the lock, encoded outside it
+    uint8_t blob[TELEMETRY_MAX_BYTES];
+    uint32_t backoff = HEARTBEAT_RETRY_MS;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+        uint32_t now = millis();
+        if (!forced && (int32_t)(now - nextMs) < 0) continue;
+        if (!quiet(now)) continue;
+
+        portENTER_CRITICAL(&lock);
+        snap = tele;
+        portEXIT_CRITICAL(&lock);
+        TelemetryInfo info = { firmware, now / 1000, (uint8_t)esp_reset_reason() };
+        uint32_t stagesSent;
+        size_t len = telemetryEncode(snap, now, info, blob, sizeof(blob), &stagesSent);
+        lastBytes = len;
+        metricHeartbeatBytes.set(len);
+        forced = false;
+
+        int code = post(blob, len);
+        lastStatus = code;
+        now = millis();
+        if (code == 200) {
+            portENTER_CRITICAL(&lock);
+            telemetryCommit(tele, snap, stagesSent, now);
+            portEXIT_CRITICAL(&lock);
+            sent++;
+            metricHeartbeats.inc();
+            backoff = HEARTBEAT_RETRY_MS;
+            nextMs = now + HEARTBEAT_MS;
+        } else {
+            // The interval just gets longer; nothing queues up
+            Serial.printf("[HEARTBEAT] seq %lu: HTTP %d, retry in %lu s\n", (unsigned long)snap.seq, code,
+                          (unsigned long)(backoff / 1000));
+            failed++;
+            metricHeartbeatFailures.inc();
+            nextMs = now + backoff;
+            backoff = backoff * 2 > HEARTBEAT_BACKOFF_MAX ? HEARTBEAT_BACKOFF_MAX : backoff * 2;
+        }
+    }
+}
+
+void heartbeatBegin(const char* host, const char* path, const char* id, const char* fw) {
+    if (task) return;
+    url = String("https://") + host + path;
+    deviceId = id;
+    firmware = fw;
+    telemetryInit(tele, millis());
+    // Counters are globals registered before setup(): look them up once
+    for (int c = 0; c < TELE_COUNTER_COUNT; c++) {
+        const char* name = telemetryCounterName((TelemetryCounter)c);
+        for (Metric* m = metricsFirst(); m; m = m->next) {
+            if (m->type == METRIC_COUNTER && !strcmp(m->name, name)) counters[c] = (Counter*)m;
+        }
+    }
+    traceSetEndHook(onTraceEnd);
+    // First one soon after boot: that's when last_seen_at matters most
+    nextMs = millis() + HEARTBEAT_QUIET_MS;
+    xTaskCreatePinnedToCore(heartbeatTask, "heartbeat", 6144, nullptr, 1, &task, 0);
+}
+
+void heartbeatSample() {
+    uint32_t values[TELE_COUNTER_COUNT];
+    for (int c = 0; c < TELE_COUNTER_COUNT; c++) values[c] = counters[c] ? counters[c]->get() : 0;
+    uint32_t heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    uint32_t lowWater = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    uint32_t psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    int rssi = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+    portENTER_CRITICAL(&lock);
+    telemetrySample(tele, heap, lowWater, psram, rssi);
+    telemetryCounters(tele, values);
+    portEXIT_CRITICAL(&lock);
+}
+
+void heartbeatNow() {
+    forced = true;
+}
+
+HeartbeatStats heartbeatStats() {
+    HeartbeatStats s;
+    s.sent = sent;
+    s.failed = failed;
+    s.lastBytes = lastBytes;
+    s.lastStatus = lastStatus;
+    int32_t left = (int32_t)(nextMs - millis());
+    s.nextInMs = forced || left < 0 ? 0 : left;
+    return s;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// HEARTBEAT
+// ==========================================
+// A background task POSTs to /api/ping every HEARTBEAT_MS so the dashboard
+// knows the device is alive (souls.last_seen_at), carrying the fleet
+// telemetry blob (telemetry.h) as application/cbor. It stays out of the
+// way of interactions: it never starts while a turn holds the link
+// (wifiLinkBusy()) or within HEARTBEAT_QUIET_MS of one ending, gives up
+// after short timeouts, and backs off when the server doesn't answer,
+// while the telemetry keeps aggregating in fixed-size counters.
+
+#define HEARTBEAT_MS          300000  // 5 min
+#define HEARTBEAT_QUIET_MS    15000   // after a turn
+#define HEARTBEAT_RETRY_MS    30000   // first retry, doubling
+#define HEARTBEAT_BACKOFF_MAX (4 * HEARTBEAT_MS)
+#define HEARTBEAT_TIMEOUT_MS  5000
+
+struct HeartbeatStats {
+    uint32_t sent;
+    uint32_t failed;
+    uint32_t lastBytes;  // size of the last blob
+    int      lastStatus; // HTTP status of the last attempt, 0 = none yet
+    uint32_t nextInMs;   // until the next attempt
+};
+
+// Hooks into traceEnd() and starts the task.
+void heartbeatBegin(const char* host, const char* path, const char* deviceId, const char* firmware);
+// Heap, RSSI and counters; call about once a second from loop().
+void heartbeatSample();
+// Sends at the next quiet moment instead of waiting out the interval.
+void heartbeatNow();
+HeartbeatStats heartbeatStats();
@@ -0,0 +1,196 @@
+// Echo canceller / barge-in harness (env:native-aec-tool), running aec.cpp
+// unchanged against a simulated speaker-to-mic path.
+//
+//   program sim --speech DIR [--ser-db -10,-5,0] [--echo-gain-db 6] [--clip]
+//
+// Every clip in DIR takes a turn as the far end (what the device says,
+// looped to 4 s) and the next one as the user, who starts talking 2 s in.
+// The echo is the far end through a synthetic 12 ms room/enclosure
+// response, `--echo-gain-db` louder than the reference (speaker next to the
+// mic), optionally soft-clipped like an overdriven speaker, plus a -60 dBFS
+// noise floor. The user's level is set by the signal-to-echo ratio at the
+// mic. Reports:
+//   ERLE        echo reduction over 1-2 s (far end only, after convergence)
+//   detected    runs where the detector fired after the user started
+//   latency     from the user's first voiced block to the firing block's end
+//   false/min   firings with no user, per minute of playback
+// plus the AEC cost per 10 ms block on this host.
+#include "../aec.h"
+#include "wav_io.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kLen   = 4 * 16000;
+static const size_t kOnset = 2 * 16000;
+static std::vector<double> blockUs;
+
+struct RunResult {
+    double erleDb;
+    int    fireBlock;  // -1 if it never fired after the onset
+    int    falseFires; // before the onset
+};
+
+static std::vector<float> roomResponse() {
+    std::vector<float> h(192, 0.0f);
+    uint32_t seed = 12345;
+    h[6] = 1.0f; // direct path
+    for (size_t i = 7; i < h.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float r = ((seed >> 8) / 8388608.0f) - 1.0f;
+        h[i] = 0.35f * r * expf(-(float)(i - 7) / 36.0f);
+    }
+    return h;
+}
+
+static std::vector<int16_t> loopTo(const std::vector<int16_t>& v, size_t n) {
+    std::vector<int16_t> out(n);
+    for (size_t i = 0; i < n; i++) out[i] = v[i % v.size()];
+    return out;
+}
+
+static RunResult runOne(const std::vector<int16_t>& far, const std::vector<int16_t>* nearClip, double serDb,
+                        double echoGainDb, bool clip) {
+    static const std::vector<float> h = roomResponse();
+    std::vector<int16_t> ref = loopTo(far, kLen);
+
+    std::vector<float> echo(kLen, 0.0f);
+    float g = powf(10.0f, (float)echoGainDb / 20.0f);
+    for (size_t i = 0; i < kLen; i++) {
+        float acc = 0.0f;
+        for (size_t k = 0; k < h.size() && k <= i; k++) acc += h[k] * ref[i - k];
+        acc *= g;
+        if (clip) acc = 20000.0f * tanhf(acc / 20000.0f);
+        echo[i] = acc;
+    }
+
+    std::vector<float> nearSig(kLen, 0.0f);
+    if (nearClip) {
+        double ee = 0.0, ne = 0.0;
+        for (size_t i = kOnset; i < kLen; i++) {
+            float v = (*nearClip)[(i - kOnset) % nearClip->size()];
+            nearSig[i] = v;
+            ne += (double)v * v;
+            ee += (double)echo[i] * echo[i];
+        }
+        float s = ne > 0 ? (float)sqrt(ee / ne * pow(10.0, serDb / 10.0)) : 0.0f;
+        for (size_t i = kOnset; i < kLen; i++) nearSig[i] *= s;
+    }
+
+    std::vector<int16_t> mic(kLen);
+    uint32_t seed = 777;
+    for (size_t i = 0; i < kLen; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float n = (((seed >> 8) / 8388608.0f) - 1.0f) * 57.0f; // ~-60 dBFS
+        float v = echo[i] + nearSig[i] + n;
+        mic[i] = (int16_t)(v < -32768.0f ? -32768 : v > 32767.0f ? 32767 : lrintf(v));
+    }
+
+    static Aec aec;
+    BargeDetector det;
+    aecInit(aec);
+    bargeInit(det);
+    RunResult r = { 0.0, -1, 0 };
+    double micE = 0.0, outE = 0.0;
+    int16_t out[AEC_BLOCK];
+    int voicedBlock = -1;
+    for (size_t b = 0; b * AEC_BLOCK + AEC_BLOCK <= kLen; b++) {
+        size_t off = b * AEC_BLOCK;
+        auto t0 = Clock::now();
+        AecLevels lv = aecProcess(aec, mic.data() + off, ref.data() + off, out, det.nearEnd);
+        bool fired = bargeUpdate(det, lv);
+        blockUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+
+        if (off >= 16000 && off < kOnset) {
+            micE += lv.mic;
+            outE += lv.out;
+        }
+        if (off >= kOnset && voicedBlock < 0) {
+            double e = 0.0;
+            for (int i = 0; i < AEC_BLOCK; i++) e += (double)nearSig[off + i] * nearSig[off + i];
+            if (e / AEC_BLOCK > 200.0 * 200.0) voicedBlock = (int)b;
+        }
+        if (fired) {
+            if (off < kOnset) r.falseFires++;
+            else if (r.fireBlock < 0) r.fireBlock = voicedBlock < 0 ? 0 : (int)b - voicedBlock + 1;
+        }
+    }
+    r.erleDb = 10.0 * log10((micE + 1.0) / (outE + 1.0));
+    return r;
+}
+
+static int cmdSim(int argc, char** argv) {
+    const char* dir = nullptr;
+    std::vector<double> sers = { -10.0, -5.0, 0.0 };
+    double echoGainDb = 6.0;
+    bool clip = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--speech") && i + 1 < argc) dir = argv[++i];
+        else if (!strcmp(argv[i], "--echo-gain-db") && i + 1 < argc) echoGainDb = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--clip")) clip = true;
+        else if (!strcmp(argv[i], "--ser-db") && i + 1 < argc) {
+            sers.clear();
+            for (char* tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ",")) sers.push_back(atof(tok));
+        }
+    }
+    std::vector<std::vector<int16_t>> clips;
+    if (dir) {
+        for (const std::string& path : listWavs(dir)) {
+            std::vector<int16_t> pcm;
+            if (readWav(path, pcm) && !pcm.empty()) clips.push_back(pcm);
+        }
+    }
+    if (clips.size() < 2) {
+        fprintf(stderr, "sim needs --speech DIR with at least two 16 kHz mono WAVs\n");
+        return 2;
+    }
+
+    // Far end alone: convergence and false firings
+    double erleSum = 0.0;
+    int falseFires = 0;
+    for (const auto& far : clips) {
+        RunResult r = runOne(far, nullptr, 0.0, echoGainDb, clip);
+        erleSum += r.erleDb;
+        falseFires += r.falseFires + (r.fireBlock >= 0);
+    }
+    double minutes = clips.size() * kLen / 16000.0 / 60.0;
+    printf("%zu clips, echo %+.0f dB%s, taps %d, run %d blocks\n", clips.size(), echoGainDb, clip ? " clipped" : "",
+           AEC_TAPS, BARGE_RUN_BLOCKS);
+    printf("far end only: ERLE %.1f dB, %.1f false/min\n", erleSum / clips.size(), falseFires / minutes);
+
+    printf("%8s %10s %12s %12s %10s\n", "SER dB", "detected", "latency ms", "max ms", "false");
+    for (double ser : sers) {
+        int detected = 0, falsePre = 0;
+        double latSum = 0.0, latMax = 0.0;
+        for (size_t c = 0; c < clips.size(); c++) {
+            RunResult r = runOne(clips[c], &clips[(c + 1) % clips.size()], ser, echoGainDb, clip);
+            falsePre += r.falseFires;
+            if (r.fireBlock >= 0) {
+                double ms = r.fireBlock * 10.0;
+                detected++;
+                latSum += ms;
+                latMax = std::max(latMax, ms);
+            }
+        }
+        printf("%8.1f %6d/%-3zu %12.0f %12.0f %10d\n", ser, detected, clips.size(), detected ? latSum / detected : 0.0,
+               latMax, falsePre);
+    }
+
+    std::vector<double> v = blockUs;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    printf("AEC + detector per 10 ms block: %.1f us mean, %.1f us p95 (%zu blocks)\n", sum / v.size(),
+           v[v.size() * 95 / 100], v.size());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && !strcmp(argv[1], "sim")) return cmdSim(argc, argv);
+    fprintf(stderr, "usage: %s sim --speech DIR [--ser-db -10,-5,0] [--echo-gain-db 6] [--clip]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,245 @@
+// Asset pack tool (env:native-asset-tool).
+//
+//   program pack  DIR OUT.bin [--version N] [--align 16] [--no-compress] [--max-size BYTES]
+//   program list  PACK.bin
+//   program bench PACK.bin [--iters N]
+//
+// `pack` puts every file under DIR in a pack (asset_pack.h) named by its
+// path relative to DIR, e.g. fillers/default/think1.wav. WAVs are stored
+// as they are, so the device plays them in place; LZ4 is tried on
+// everything else and kept when it saves at least 1/8. The result is reopened with the device reader and every entry
+// read back before it's kept. `bench` times lookups and reads per entry.
+#include "../asset_pack.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+typedef std::chrono::steady_clock Clock;
+
+#define DEFAULT_MAX_SIZE 0x180000 // the assets partition in partitions.csv
+
+struct File {
+    std::string name;
+    Bytes       data;
+};
+
+static bool readFile(const std::string& path, Bytes& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const uint8_t* data, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+static bool walk(const std::string& root, const std::string& rel, std::vector<File>& files) {
+    std::string dir = rel.empty() ? root : root + "/" + rel;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    struct dirent* e;
+    while ((e = readdir(d)) != nullptr) {
+        if (e->d_name[0] == '.') continue;
+        std::string name = rel.empty() ? e->d_name : rel + "/" + e->d_name;
+        struct stat st;
+        if (stat((root + "/" + name).c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            walk(root, name, files);
+        } else if (S_ISREG(st.st_mode)) {
+            File f;
+            f.name = name;
+            if (readFile(root + "/" + name, f.data)) files.push_back(std::move(f));
+        }
+    }
+    closedir(d);
+    return true;
+}
+
+static uint16_t typeFor(const std::string& name) {
+    auto ends = [&](const char* ext) {
+        size_t n = strlen(ext);
+        return name.size() >= n && name.compare(name.size() - n, n, ext) == 0;
+    };
+    if (ends(".wav")) return ASSET_TYPE_WAV;
+    if (ends(".rgb565")) return ASSET_TYPE_RGB565;
+    if (ends(".jpg") || ends(".jpeg")) return ASSET_TYPE_JPEG;
+    return ASSET_TYPE_RAW;
+}
+
+static const char* typeName(uint16_t t) {
+    switch (t) {
+    case ASSET_TYPE_WAV: return "wav";
+    case ASSET_TYPE_RGB565: return "rgb565";
+    case ASSET_TYPE_JPEG: return "jpeg";
+    default: return "raw";
+    }
+}
+
+static bool openPack(const char* path, Bytes& data, AssetPack& pack) {
+    if (!readFile(path, data)) {
+        fprintf(stderr, "can't read %s\n", path);
+        return false;
+    }
+    if (!assetPackOpen(pack, data.data(), data.size(), true)) {
+        fprintf(stderr, "%s: not a valid asset pack (format %d)\n", path, ASSET_FORMAT);
+        return false;
+    }
+    return true;
+}
+
+static int cmdPack(int argc, char** argv) {
+    const char* dir = argv[0];
+    const char* out = argv[1];
+    uint32_t version = 1, maxSize = DEFAULT_MAX_SIZE;
+    uint16_t align = ASSET_DEFAULT_ALIGN;
+    bool compress = true;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--version") && i + 1 < argc) version = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--align") && i + 1 < argc) align = (uint16_t)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--max-size") && i + 1 < argc) maxSize = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--no-compress")) compress = false;
+    }
+
+    std::vector<File> files;
+    if (!walk(dir, "", files)) {
+        fprintf(stderr, "can't open %s\n", dir);
+        return 1;
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.name < b.name; });
+    std::vector<AssetSource> src;
+    size_t raw = 0;
+    for (const File& f : files) {
+        uint16_t type = typeFor(f.name);
+        src.push_back({ f.name.c_str(), f.data.data(), (uint32_t)f.data.size(), type, compress && type != ASSET_TYPE_WAV });
+        raw += f.data.size();
+    }
+
+    Bytes pack(assetPackBound(src.data(), src.size(), align));
+    size_t size = assetPackBuild(src.data(), src.size(), version, align, pack.data(), pack.size());
+    if (!size) {
+        fprintf(stderr, "pack failed (duplicate name or bad --align)\n");
+        return 1;
+    }
+    if (size > maxSize) {
+        fprintf(stderr, "pack is %zu bytes, partition holds %u\n", size, maxSize);
+        return 1;
+    }
+
+    // Read everything back through the device code before keeping it
+    AssetPack check;
+    if (!assetPackOpen(check, pack.data(), size, true)) {
+        fprintf(stderr, "pack doesn't reopen\n");
+        return 1;
+    }
+    Bytes buf;
+    for (const File& f : files) {
+        AssetInfo info;
+        buf.resize(f.data.size() + 1);
+        if (!assetFind(check, f.name.c_str(), info) || assetRead(info, buf.data(), buf.size()) != f.data.size() ||
+            memcmp(buf.data(), f.data.data(), f.data.size()) != 0) {
+            fprintf(stderr, "%s doesn't read back\n", f.name.c_str());
+            return 1;
+        }
+    }
+    if (!writeFile(out, pack.data(), size)) {
+        fprintf(stderr, "can't write %s\n", out);
+        return 1;
+    }
+    printf("%s: version %u, %zu entries, %zu bytes (%zu raw), %.1f%% of %u\n", out, version, files.size(), size,
+           raw, 100.0 * size / maxSize, maxSize);
+    return 0;
+}
+
+static void listEntry(const char* name, const AssetEntry& e, void*) {
+    printf("  %-40s %-6s %8u %8u%s  @0x%06x\n", name, typeName(e.type), e.rawSize, e.size,
+           (e.flags & ASSET_LZ4) ? " lz4" : "    ", e.offset);
+}
+
+static int cmdList(char** argv) {
+    Bytes data;
+    AssetPack pack;
+    if (!openPack(argv[0], data, pack)) return 1;
+    const AssetPackHeader& h = *pack.header;
+    printf("format %u, version %u, %u entries, %u slots, align %u, %u bytes, crc32 %08x\n", h.format, h.packVersion,
+           h.count, h.slots, h.align, h.totalSize, h.crc32);
+    printf("  %-40s %-6s %8s %8s\n", "name", "type", "raw", "stored");
+    assetForEach(pack, listEntry, nullptr);
+    return 0;
+}
+
+struct BenchCtx {
+    std::vector<std::string> names;
+};
+
+static void collectName(const char* name, const AssetEntry&, void* ctx) {
+    ((BenchCtx*)ctx)->names.push_back(name);
+}
+
+static int cmdBench(int argc, char** argv) {
+    Bytes data;
+    AssetPack pack;
+    if (!openPack(argv[0], data, pack)) return 1;
+    int iters = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iters") && i + 1 < argc) iters = atoi(argv[++i]);
+    }
+    BenchCtx ctx;
+    assetForEach(pack, collectName, &ctx);
+    if (ctx.names.empty()) {
+        fprintf(stderr, "empty pack\n");
+        return 1;
+    }
+
+    volatile uint32_t sink = 0;
+    AssetInfo info;
+    auto t0 = Clock::now();
+    for (int i = 0; i < iters; i++) {
+        for (const std::string& n : ctx.names) sink += assetFind(pack, n.c_str(), info);
+    }
+    double hitNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / iters / ctx.names.size();
+    t0 = Clock::now();
+    for (int i = 0; i < iters; i++) sink += assetFind(pack, "no/such/asset.bin", info);
+    double missNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / iters;
+    printf("lookup: hit %.1f ns, miss %.1f ns (%zu entries, %u slots)\n", hitNs, missNs, ctx.names.size(),
+           pack.header->slots);
+
+    // Reads: uncompressed ones are a pointer on the device; time the copy
+    // and the LZ4 decode that a caller needing RAM would pay
+    Bytes buf;
+    for (const std::string& n : ctx.names) {
+        assetFind(pack, n.c_str(), info);
+        buf.resize(info.rawSize + 1);
+        int reps = std::max(1, (int)(8u * 1024 * 1024 / (info.rawSize + 1)));
+        t0 = Clock::now();
+        for (int r = 0; r < reps; r++) sink += assetRead(info, buf.data(), buf.size());
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / reps;
+        printf("  %-40s %8u bytes %s %9.2f us %8.1f MB/s\n", n.c_str(), info.rawSize,
+               (info.flags & ASSET_LZ4) ? "lz4 " : "copy", us, info.rawSize / us);
+    }
+    return sink ? 0 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[1], "pack")) return cmdPack(argc - 2, argv + 2);
+    if (argc >= 3 && !strcmp(argv[1], "list")) return cmdList(argv + 2);
+    if (argc >= 3 && !strcmp(argv[1], "bench")) return cmdBench(argc - 2, argv + 2);
+    fprintf(stderr, "usage: %s pack DIR OUT.bin [--version N] [--align 16] [--no-compress] [--max-size BYTES]\n"
+                    "       %s list PACK.bin\n"
+                    "       %s bench PACK.bin [--iters N]\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,35 @@
+// Host runner for the firmware benchmarks (env:native-bench).
+//
+//   .pio/build/native-bench/program [--benchmark_filter=Multipart]
+//                                   [--benchmark_out=results.json]
+#include "../bench.h"
+#include <stdio.h>
+#include <string.h>
+
+static FILE* outFile = stdout;
+
+static void writeLine(const char* line) {
+    fputs(line, outFile);
+    fputc('\n', outFile);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            filter = argv[i] + 19;
+        } else if (strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            outFile = fopen(argv[i] + 16, "w");
+            if (!outFile) {
+                perror(argv[i] + 16);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [--benchmark_filter=substr] [--benchmark_out=file]\n", argv[0]);
+            return 2;
+        }
+    }
+    benchRunAll(filter, argv[0], writeLine);
+    if (outFile != stdout) fclose(outFile);
+    return 0;
+}
@@ -0,0 +1,393 @@
+// Firmware delta patch tool (env:native-delta-tool).
+//
+//   program diff  OLD.bin NEW.bin OUT.patch [--window-bits 11] [--lookahead-bits 8]
+//   program apply OLD.bin IN.patch OUT.bin
+//   program info  IN.patch
+//
+// `diff` writes the MSDP format decoded on the device by delta_patch.cpp,
+// then applies it with that same decoder and refuses to keep a patch that
+// doesn't reproduce NEW.bin. Publish patches as
+// moodsoul-platform/public/firmware-delta/<from_version>.patch.
+#include "sha256.h"
+#include "../delta_patch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void sha256(const Bytes& data, uint8_t out[32]) {
+    Sha256 s;
+    s.update(data.data(), data.size());
+    s.finish(out);
+}
+
+static std::string hex(const uint8_t* p, size_t n) {
+    std::string s;
+    char b[3];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(b, sizeof(b), "%02x", p[i]);
+        s += b;
+    }
+    return s;
+}
+
+// ==========================================
+// DIFF (bsdiff-style approximate matches)
+// ==========================================
+#define MATCH_KEY_LEN   8
+#define MATCH_MIN_LEN   16
+#define HASH_BITS       22
+#define CHAIN_DEPTH     64
+
+struct Match {
+    uint32_t newPos, oldPos, len;
+};
+
+static uint32_t keyHash(const uint8_t* p) {
+    uint64_t k;
+    memcpy(&k, p, 8);
+    return (uint32_t)((k * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+}
+
+static std::vector<Match> findMatches(const Bytes& oldB, const Bytes& newB) {
+    std::vector<Match> matches;
+    if (oldB.size() < MATCH_KEY_LEN || newB.size() < MATCH_KEY_LEN) return matches;
+
+    std::vector<int32_t> heads(1u << HASH_BITS, -1);
+    std::vector<int32_t> chain(oldB.size(), -1);
+    for (uint32_t i = 0; i + MATCH_KEY_LEN <= oldB.size(); i++) {
+        uint32_t h = keyHash(&oldB[i]);
+        chain[i] = heads[h];
+        heads[h] = (int32_t)i;
+    }
+
+    const uint32_t n = (uint32_t)newB.size();
+    const uint32_t m = (uint32_t)oldB.size();
+    uint32_t p = 0;
+    uint32_t lastNewEnd = 0, lastOldEnd = 0;
+
+    while (p + MATCH_KEY_LEN <= n) {
+        // Best exact match, preferring the position that continues the
+        // previous match's alignment (keeps seeks at zero)
+        uint32_t bestO = 0, bestL = 0;
+        uint32_t aligned = lastOldEnd + (p - lastNewEnd);
+        if (aligned < m) {
+            uint32_t l = 0;
+            while (p + l < n && aligned + l < m && newB[p + l] == oldB[aligned + l]) l++;
+            if (l >= MATCH_MIN_LEN) {
+                bestO = aligned;
+                bestL = l;
+            }
+        }
+        int depth = 0;
+        for (int32_t o = heads[keyHash(&newB[p])]; o >= 0 && depth < CHAIN_DEPTH; o = chain[o], depth++) {
+            uint32_t l = 0;
+            while (p + l < n && (uint32_t)o + l < m && newB[p + l] == oldB[o + l]) l++;
+            if (l > bestL + 8) { // only abandon the aligned candidate for a clearly longer one
+                bestL = l;
+                bestO = (uint32_t)o;
+            }
+        }
+        if (bestL < MATCH_MIN_LEN) {
+            p++;
+            continue;
+        }
+
+        // Extend forward through small differences (relocated pointers,
+        // changed constants) while equal bytes still dominate
+        int score = 0, bestScore = 0;
+        uint32_t bestEnd = bestL;
+        for (uint32_t i = bestL; p + i < n && bestO + i < m; i++) {
+            score += newB[p + i] == oldB[bestO + i] ? 1 : -1;
+            if (score > bestScore) {
+                bestScore = score;
+                bestEnd = i + 1;
+            }
+            if (score < bestScore - 32) break;
+        }
+
+        // Pull the start back into the unmatched gap while bytes agree
+        uint32_t back = 0;
+        while (p - back > lastNewEnd && bestO > back && newB[p - back - 1] == oldB[bestO - back - 1]) back++;
+
+        matches.push_back({ p - back, bestO - back, bestEnd + back });
+        p += bestEnd;
+        lastNewEnd = p;
+        lastOldEnd = bestO + bestEnd;
+    }
+    return matches;
+}
+
+static void putRecord(Bytes& out, uint32_t diffLen, uint32_t extraLen, int32_t seek) {
+    uint8_t v[5];
+    out.insert(out.end(), v, v + deltaPutVarint(v, diffLen));
+    out.insert(out.end(), v, v + deltaPutVarint(v, extraLen));
+    out.insert(out.end(), v, v + deltaPutVarint(v, deltaZigZag(seek)));
+}
+
+static Bytes buildRecords(const Bytes& oldB, const Bytes& newB, const std::vector<Match>& matches) {
+    Bytes out;
+    const uint32_t n = (uint32_t)newB.size();
+
+    // Record 0 carries no diff: the literal prefix, then a seek to match 0
+    uint32_t firstNew = matches.empty() ? n : matches[0].newPos;
+    int32_t firstSeek = matches.empty() ? 0 : (int32_t)matches[0].oldPos;
+    putRecord(out, 0, firstNew, firstSeek);
+    out.insert(out.end(), newB.begin(), newB.begin() + firstNew);
+
+    for (size_t k = 0; k < matches.size(); k++) {
+        const Match& mt = matches[k];
+        uint32_t diffEnd = mt.newPos + mt.len;
+        uint32_t nextNew = k + 1 < matches.size() ? matches[k + 1].newPos : n;
+        int32_t seek = k + 1 < matches.size() ? (int32_t)(matches[k + 1].oldPos - (mt.oldPos + mt.len)) : 0;
+        putRecord(out, mt.len, nextNew - diffEnd, seek);
+        for (uint32_t i = 0; i < mt.len; i++) out.push_back((uint8_t)(newB[mt.newPos + i] - oldB[mt.oldPos + i]));
+        out.insert(out.end(), newB.begin() + diffEnd, newB.begin() + nextNew);
+    }
+    return out;
+}
+
+// ==========================================
+// LZSS ENCODER (matches delta_patch.cpp)
+// ==========================================
+struct BitWriter {
+    Bytes&   out;
+    uint32_t reg = 0;
+    int      count = 0;
+    explicit BitWriter(Bytes& o) : out(o) {}
+    void put(uint32_t v, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            reg = (reg << 1) | ((v >> i) & 1);
+            if (++count == 8) {
+                out.push_back((uint8_t)reg);
+                reg = 0;
+                count = 0;
+            }
+        }
+    }
+    void flush() {
+        if (count) out.push_back((uint8_t)(reg << (8 - count)));
+        reg = 0;
+        count = 0;
+    }
+};
+
+static void compress(const Bytes& in, int wb, int lb, Bytes& out) {
+    const uint32_t window = 1u << wb;
+    const uint32_t maxLen = 1u << lb;
+    const uint32_t minLen = (1 + wb + lb) / 9 + 1; // break-even vs literals
+    std::vector<int32_t> heads(1u << 16, -1);
+    std::vector<int32_t> prev(in.size(), -1);
+    auto h3 = [&](uint32_t i) { return ((in[i] << 8) ^ (in[i + 1] << 4) ^ in[i + 2]) & 0xFFFF; };
+
+    BitWriter bw(out);
+    uint32_t i = 0;
+    const uint32_t n = (uint32_t)in.size();
+    auto insert = [&](uint32_t j) {
+        if (j + 2 < n) {
+            uint32_t h = h3(j);
+            prev[j] = heads[h];
+            heads[h] = (int32_t)j;
+        }
+    };
+
+    while (i < n) {
+        uint32_t bestLen = 0, bestDist = 0;
+        if (i + 2 < n) {
+            int depth = 0;
+            for (int32_t c = heads[h3(i)]; c >= 0 && i - c <= window && depth < 256; c = prev[c], depth++) {
+                uint32_t l = 0;
+                while (l < maxLen && i + l < n && in[c + l] == in[i + l]) l++;
+                if (l > bestLen) {
+                    bestLen = l;
+                    bestDist = i - c;
+                    if (l == maxLen) break;
+                }
+            }
+        }
+        if (bestLen >= minLen && bestLen >= 3) {
+            bw.put(0, 1);
+            bw.put(bestDist - 1, wb);
+            bw.put(bestLen - 1, lb);
+            for (uint32_t k = 0; k < bestLen; k++) insert(i + k);
+            i += bestLen;
+        } else {
+            bw.put(1, 1);
+            bw.put(in[i], 8);
+            insert(i);
+            i++;
+        }
+    }
+    bw.flush();
+}
+
+// ==========================================
+// APPLY (through the device decoder)
+// ==========================================
+struct ApplyCtx {
+    const Bytes* oldB;
+    Bytes        out;
+};
+
+static bool readOld(void* ctx, uint32_t off, uint8_t* buf, size_t len) {
+    const Bytes& o = *((ApplyCtx*)ctx)->oldB;
+    if (off + len > o.size()) return false;
+    memcpy(buf, o.data() + off, len);
+    return true;
+}
+
+static bool writeOut(void* ctx, const uint8_t* buf, size_t len) {
+    Bytes& o = ((ApplyCtx*)ctx)->out;
+    o.insert(o.end(), buf, buf + len);
+    return true;
+}
+
+static bool apply(const Bytes& oldB, const Bytes& patch, Bytes& out, std::string& err) {
+    DeltaDecoder* d = new DeltaDecoder;
+    ApplyCtx ctx = { &oldB, {} };
+    deltaInit(*d, readOld, writeOut, &ctx);
+
+    // Feed in uneven slices to exercise the streaming paths
+    DeltaStatus st = DELTA_OK;
+    size_t off = 0, slice = 1;
+    while (off < patch.size() && st == DELTA_OK) {
+        size_t n = patch.size() - off < slice ? patch.size() - off : slice;
+        st = deltaFeed(*d, patch.data() + off, n);
+        off += n;
+        slice = slice * 3 % 1500 + 1;
+    }
+    bool ok = st == DELTA_DONE;
+    if (!ok) err = "decoder status " + std::to_string(st);
+    else if (oldB.size() != d->header.baseSize) ok = false, err = "base size mismatch";
+    else {
+        uint8_t h[32];
+        sha256(oldB, h);
+        if (memcmp(h, d->header.baseSha256, 32) != 0) ok = false, err = "base sha256 mismatch";
+        sha256(ctx.out, h);
+        if (ok && memcmp(h, d->header.targetSha256, 32) != 0) ok = false, err = "target sha256 mismatch";
+    }
+    delete d;
+    out.swap(ctx.out);
+    return ok;
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static int cmdDiff(int argc, char** argv) {
+    int wb = 11, lb = 8; // long matches matter: most of a diff stream is zero runs
+    for (int i = 5; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--window-bits")) wb = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--lookahead-bits")) lb = atoi(argv[i + 1]);
+    }
+    if (wb < 4 || wb > DELTA_MAX_WINDOW_BITS || lb < 2 || lb >= wb) {
+        fprintf(stderr, "bad window/lookahead bits\n");
+        return 2;
+    }
+    Bytes oldB, newB;
+    if (!readFile(argv[2], oldB) || !readFile(argv[3], newB)) {
+        fprintf(stderr, "cannot read inputs\n");
+        return 1;
+    }
+
+    std::vector<Match> matches = findMatches(oldB, newB);
+    Bytes records = buildRecords(oldB, newB, matches);
+
+    Bytes patch(DELTA_HEADER_SIZE, 0);
+    memcpy(&patch[0], DELTA_MAGIC, 4);
+    patch[4] = DELTA_VERSION;
+    patch[5] = (uint8_t)wb;
+    patch[6] = (uint8_t)lb;
+    putLe32(&patch[8], (uint32_t)oldB.size());
+    putLe32(&patch[12], (uint32_t)newB.size());
+    sha256(oldB, &patch[16]);
+    sha256(newB, &patch[48]);
+    compress(records, wb, lb, patch);
+
+    Bytes check;
+    std::string err;
+    if (!apply(oldB, patch, check, err) || check != newB) {
+        fprintf(stderr, "self-check failed: %s\n", err.empty() ? "output differs" : err.c_str());
+        return 1;
+    }
+    if (!writeFile(argv[4], patch)) {
+        perror(argv[4]);
+        return 1;
+    }
+    printf("old %zu B, new %zu B, %zu matches, records %zu B, patch %zu B (%.1f%% of new)\n",
+           oldB.size(), newB.size(), matches.size(), records.size(), patch.size(),
+           100.0 * patch.size() / (newB.empty() ? 1 : newB.size()));
+    return 0;
+}
+
+static int cmdApply(char** argv) {
+    Bytes oldB, patch, out;
+    if (!readFile(argv[2], oldB) || !readFile(argv[3], patch)) {
+        fprintf(stderr, "cannot read inputs\n");
+        return 1;
+    }
+    std::string err;
+    if (!apply(oldB, patch, out, err)) {
+        fprintf(stderr, "apply failed: %s\n", err.c_str());
+        return 1;
+    }
+    if (!writeFile(argv[4], out)) {
+        perror(argv[4]);
+        return 1;
+    }
+    printf("wrote %zu B\n", out.size());
+    return 0;
+}
+
+static int cmdInfo(char** argv) {
+    Bytes patch;
+    if (!readFile(argv[2], patch) || patch.size() < DELTA_HEADER_SIZE) {
+        fprintf(stderr, "cannot read patch\n");
+        return 1;
+    }
+    DeltaDecoder* d = new DeltaDecoder;
+    deltaInit(*d, readOld, writeOut, nullptr);
+    DeltaStatus st = deltaFeed(*d, patch.data(), DELTA_HEADER_SIZE);
+    if (st != DELTA_OK && st != DELTA_DONE) {
+        fprintf(stderr, "bad header\n");
+        delete d;
+        return 1;
+    }
+    printf("window_bits=%u lookahead_bits=%u\nbase_size=%u\nbase_sha256=%s\ntarget_size=%u\ntarget_sha256=%s\npatch_size=%zu\n",
+           d->header.windowBits, d->header.lookaheadBits, d->header.baseSize,
+           hex(d->header.baseSha256, 32).c_str(), d->header.targetSize,
+           hex(d->header.targetSha256, 32).c_str(), patch.size());
+    delete d;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 5 && !strcmp(argv[1], "diff")) return cmdDiff(argc, argv);
+    if (argc == 5 && !strcmp(argv[1], "apply")) return cmdApply(argv);
+    if (argc == 3 && !strcmp(argv[1], "info")) return cmdInfo(argv);
+    fprintf(stderr, "usage: %s diff OLD NEW OUT.patch [--window-bits N] [--lookahead-bits N]\n"
+                    "       %s apply OLD IN.patch OUT\n"
+                    "       %s info IN.patch\n", argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,95 @@
+// Factory analysis and report check (env:native-factory-check).
+//
+//   program
+//
+// Runs factory_check.cpp's loopback analysis on synthetic captures with
+// known answers (a clean tone, a tone under set noise, a delayed onset)
+// and renders reports: a passing one, one with an unmeasured item, and
+// one into a short buffer. Exits non-zero if any check fails.
+#include "../factory_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define RATE    16000
+#define TONE_HZ 1000.0f
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Uniform noise in [-a, a]; its power is a^2 / 3
+static void addNoise(int16_t* x, size_t n, int a) {
+    srand(7);
+    for (size_t i = 0; i < n; i++) x[i] = (int16_t)(x[i] + rand() % (2 * a + 1) - a);
+}
+
+int main() {
+    // 500 ms of 1 kHz is a whole number of periods
+    std::vector<int16_t> x(RATE / 2);
+    factoryTone(x.data(), x.size(), TONE_HZ, RATE, 10000);
+    float rms = factoryRmsDbfs(x.data(), x.size());
+    printf("tone rms %.2f dBFS\n", rms);
+    check(fabsf(rms - 20 * log10f(10000 / 32768.0f / sqrtf(2))) < 0.1f, "tone rms matches amplitude");
+    check(factoryToneSnrDb(x.data(), x.size(), TONE_HZ, RATE) > 60, "clean tone: high snr");
+
+    // Tone power 10000^2/2 over noise 300^2/3: 10 log10(1666.7) = 32.2 dB
+    addNoise(x.data(), x.size(), 300);
+    float snr = factoryToneSnrDb(x.data(), x.size(), TONE_HZ, RATE);
+    printf("noisy tone snr %.2f dB\n", snr);
+    check(fabsf(snr - 32.2f) < 1.0f, "noisy tone: snr within 1 dB of expected");
+    check(factoryToneSnrDb(x.data(), x.size(), 3000.0f, RATE) < 0, "wrong tone: negative snr");
+
+    std::vector<int16_t> silent(RATE / 4);
+    check(factoryRmsDbfs(silent.data(), silent.size()) <= -120, "silence floors at -120 dBFS");
+
+    // Onset: quiet room noise, then the tone from sample 480 (30 ms)
+    std::vector<int16_t> cap(RATE / 2);
+    factoryTone(cap.data() + 480, cap.size() - 480, TONE_HZ, RATE, 8000);
+    addNoise(cap.data(), cap.size(), 50);
+    long at = factoryOnset(cap.data(), cap.size(), 0, 1000);
+    printf("onset at %ld\n", at);
+    check(at >= 480 && at < 480 + RATE / 1000, "onset within 1 ms of the tone");
+    check(factoryOnset(cap.data(), 400, 0, 1000) == -1, "no onset in the quiet part");
+    check(factoryOnset(cap.data(), cap.size(), cap.size(), 1000) == -1, "from past the end: none");
+
+    // Reports
+    FactoryReport r;
+    factoryInit(r);
+    check(!factoryPassed(r), "fresh report does not pass");
+    for (int i = 0; i < FT_ITEM_COUNT; i++) {
+        const FactoryLimit& l = factoryLimit((FactoryItem)i);
+        factorySet(r, (FactoryItem)i, l.min != FACTORY_NO_LIMIT ? l.min + 1 : l.max - 1);
+    }
+    check(factoryPassed(r), "every item inside its limits passes");
+    factorySet(r, FT_LOOPBACK, 61);
+    check(!r.items[FT_LOOPBACK].pass && !factoryPassed(r), "over the max fails");
+    factorySet(r, FT_LOOPBACK, NAN);
+    check(!r.items[FT_LOOPBACK].pass, "nan fails");
+    factorySet(r, FT_LOOPBACK, 20);
+    factoryFail(r, FT_WIFI_UP, "no station");
+
+    char buf[2048];
+    size_t n = factoryReportJson(r, "cube-01", "1.3", buf, sizeof(buf));
+    printf("%s\n", buf);
+    check(n == strlen(buf) && n < sizeof(buf) - 1, "report fits and length matches");
+    check(!strncmp(buf, "{\"device\":\"cube-01\",\"firmware\":\"1.3\",\"pass\":false,", 50), "report head");
+    check(n > 2 && !strcmp(buf + n - 2, "]}"), "report closes");
+    check(strstr(buf, "{\"name\":\"wifi_up_mbps\",\"min\":4,\"pass\":false,\"error\":\"no station\"}") != nullptr,
+          "unmeasured item carries its error");
+    check(strstr(buf, "{\"name\":\"loopback_ms\",\"value\":20.00,\"min\":10,\"max\":60,\"pass\":true}") != nullptr,
+          "measured item carries value and limits");
+
+    char small[64];
+    n = factoryReportJson(r, "cube-01", "1.3", small, sizeof(small));
+    check(n == sizeof(small) - 1 && strlen(small) == n, "short buffer: cut and terminated");
+    check(factoryReportJson(r, "cube-01", "1.3", small, 0) == 0, "zero buffer: nothing");
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
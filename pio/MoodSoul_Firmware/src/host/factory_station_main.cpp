@@ -0,0 +1,138 @@
+// Factory test station (env:native-factory-station).
+//
+//   program [--port 8090] [--out factory_reports.jsonl]
+//
+// Runs on the test PC next to the line, on the same network as the units
+// (the default station address is the Wi-Fi gateway, so a laptop sharing
+// its own hotspot needs no setup). Plain HTTP:
+//
+//   GET  /factory/download?bytes=N   N bytes, as fast as TCP allows
+//   POST /factory/upload             reads and drops the body
+//   POST /factory/report             one report (factory_check.h), appended
+//                                    to --out and summarized on stdout
+#include "net_posix.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <signal.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static std::string outPath = "factory_reports.jsonl";
+static std::mutex  outLock;
+
+static void respond(int fd, int status, const char* reason, const std::string& body) {
+    char head[160];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+             status, reason, body.size());
+    if (netSendAll(fd, head, strlen(head))) netSendAll(fd, body.data(), body.size());
+}
+
+// "AABBCC PASS" or "AABBCC FAIL mic_snr_db wifi_up_mbps"
+static void summarize(const std::string& report) {
+    auto field = [&](const char* key, size_t from) {
+        size_t p = report.find(key, from);
+        if (p == std::string::npos) return std::string();
+        p += strlen(key);
+        size_t end = report.find('"', p);
+        return report.substr(p, end == std::string::npos ? std::string::npos : end - p);
+    };
+    bool pass = report.find("\"pass\":true") < report.find("\"items\"");
+    std::string line = field("\"device\":\"", 0) + (pass ? " PASS" : " FAIL");
+    for (size_t p = report.find("{\"name\":\""); p != std::string::npos; p = report.find("{\"name\":\"", p + 1)) {
+        size_t end = report.find('}', p);
+        if (report.substr(p, end - p).find("\"pass\":false") != std::string::npos) line += " " + field("{\"name\":\"", p);
+    }
+    printf("%s\n", line.c_str());
+    fflush(stdout);
+}
+
+static void handleConnection(int fd) {
+    timeval tv = { 30, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    SocketReader reader(fd);
+    std::string requestLine, line;
+    long contentLength = 0;
+    if (!reader.readLine(requestLine)) {
+        close(fd);
+        return;
+    }
+    while (reader.readLine(line)) {
+        if (line == "\r\n" || line == "\n") break;
+        if (strncasecmp(line.c_str(), "content-length:", 15) == 0) contentLength = atol(line.c_str() + 15);
+    }
+
+    uint8_t buf[16384];
+    if (requestLine.compare(0, 28, "GET /factory/download?bytes=") == 0) {
+        size_t bytes = strtoul(requestLine.c_str() + 28, nullptr, 10);
+        char head[160];
+        snprintf(head, sizeof(head),
+                 "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n"
+                 "Connection: close\r\n\r\n",
+                 bytes);
+        memset(buf, 0xA5, sizeof(buf));
+        bool ok = netSendAll(fd, head, strlen(head));
+        for (size_t off = 0; ok && off < bytes; off += sizeof(buf)) {
+            ok = netSendAll(fd, buf, bytes - off < sizeof(buf) ? bytes - off : sizeof(buf));
+        }
+    } else if (requestLine.compare(0, 20, "POST /factory/upload") == 0) {
+        long got = 0;
+        while (got < contentLength) {
+            size_t n = reader.read(buf, sizeof(buf));
+            if (n == 0) break;
+            got += n;
+        }
+        respond(fd, got == contentLength ? 200 : 400, got == contentLength ? "OK" : "Bad Request",
+                "{\"bytes\":" + std::to_string(got) + "}");
+    } else if (requestLine.compare(0, 20, "POST /factory/report") == 0 && contentLength > 0 &&
+               contentLength < 65536) {
+        std::string report;
+        while ((long)report.size() < contentLength) {
+            size_t n = reader.read(buf, sizeof(buf));
+            if (n == 0) break;
+            report.append((const char*)buf, n);
+        }
+        if ((long)report.size() != contentLength) {
+            respond(fd, 400, "Bad Request", "{\"error\":\"short body\"}");
+        } else {
+            while (!report.empty() && (report.back() == '\n' || report.back() == '\r')) report.pop_back();
+            std::lock_guard<std::mutex> g(outLock);
+            FILE* f = fopen(outPath.c_str(), "a");
+            if (f) {
+                fprintf(f, "%s\n", report.c_str());
+                fclose(f);
+            }
+            summarize(report);
+            respond(fd, f ? 200 : 500, f ? "OK" : "Internal Server Error", "{}");
+        }
+    } else {
+        respond(fd, 404, "Not Found", "{\"error\":\"not found\"}");
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    int port = 8090;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--port P] [--out FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+    int listenFd = netListen(port, 64);
+    if (listenFd < 0) {
+        perror("listen");
+        return 1;
+    }
+    fprintf(stderr, "factory station on :%d, reports to %s\n", port, outPath.c_str());
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::thread(handleConnection, fd).detach();
+    }
+}
@@ -0,0 +1,322 @@
+// Wake-word harness (env:native-kws-tool), running the firmware's front end
+// and int8 model code unchanged.
+//
+//   program eval --model M.bin --positive DIR --negative DIR [--threshold 0.8]
+//   program features IN.wav OUT.raw
+//   program embed M.bin > ../kws_model_data.h
+//   program dummy-model OUT.bin [--seed N]
+//
+// `eval` runs every 16 kHz mono 16-bit WAV in both directories. Each
+// positive clip should hold one utterance of the keyword; it is missed
+// (false reject) if it never triggers. Negative files are streamed whole
+// and every trigger is a false accept, reported per hour of audio. Rates
+// are printed for a sweep of thresholds, plus the time per front-end frame
+// and per inference on this host.
+//
+// `features` writes the int16 MFCC frames (KWS_MFCC per 20 ms) a training
+// pipeline should consume so it sees exactly what the device computes.
+// `dummy-model` writes a DS-CNN-S shaped model with random weights, only
+// useful for timing and for checking the blob format.
+#include "../kws.h"
+#include "wav_io.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const void* data, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+static bool loadModel(const char* path, Bytes& blob, KwsModel& model) {
+    if (!readFile(path, blob)) {
+        perror(path);
+        return false;
+    }
+    if (!kwsModelLoad(model, blob.data(), blob.size())) {
+        fprintf(stderr, "%s: %s\n", path, model.error);
+        return false;
+    }
+    return true;
+}
+
+// ==========================================
+// EVAL
+// ==========================================
+static const float SWEEP[] = { 0.5f, 0.6f, 0.7f, 0.75f, 0.8f, 0.85f, 0.9f, 0.95f };
+#define SWEEP_COUNT (sizeof(SWEEP) / sizeof(SWEEP[0]) + 1) // plus --threshold
+
+typedef std::chrono::steady_clock Clock;
+
+struct Timing {
+    std::vector<double> frameUs, inferUs;
+};
+
+// Feeds whole hops through the detector and every trigger, adding each
+// trigger's detections to hits[].
+static void runStream(KwsDetector& k, const std::vector<int16_t>& pcm, KwsTrigger* triggers,
+                      uint32_t* hits, Timing& t) {
+    for (size_t off = 0; off + KWS_HOP <= pcm.size(); off += KWS_HOP) {
+        auto t0 = Clock::now();
+        KwsResult r = kwsPush(k, pcm.data() + off);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        (r.ran ? t.inferUs : t.frameUs).push_back(us);
+        for (size_t i = 0; i < SWEEP_COUNT; i++) {
+            if (kwsTriggerUpdate(triggers[i], r)) hits[i]++;
+        }
+    }
+}
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static double mean(const std::vector<double>& v) {
+    double s = 0.0;
+    for (double x : v) s += x;
+    return v.empty() ? 0.0 : s / v.size();
+}
+
+static int cmdEval(int argc, char** argv) {
+    const char *modelPath = nullptr, *posDir = nullptr, *negDir = nullptr;
+    float threshold = 0.8f;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--model")) modelPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--positive")) posDir = argv[i + 1];
+        else if (!strcmp(argv[i], "--negative")) negDir = argv[i + 1];
+        else if (!strcmp(argv[i], "--threshold")) threshold = (float)atof(argv[i + 1]);
+    }
+    if (!modelPath || (!posDir && !negDir)) {
+        fprintf(stderr, "eval needs --model and at least one of --positive/--negative\n");
+        return 2;
+    }
+
+    Bytes blob;
+    static KwsModel model;
+    if (!loadModel(modelPath, blob, model)) return 1;
+    static KwsDetector det;
+    kwsInit(det, &model);
+
+    float thresholds[SWEEP_COUNT];
+    memcpy(thresholds, SWEEP, sizeof(SWEEP));
+    thresholds[SWEEP_COUNT - 1] = threshold;
+    Timing timing;
+
+    // Positives: 1 s of silence to fill the window, the clip, 0.5 s tail
+    uint32_t missed[SWEEP_COUNT] = {}, posClips = 0;
+    if (posDir) {
+        for (const std::string& path : listWavs(posDir)) {
+            std::vector<int16_t> pcm;
+            if (!readWav(path, pcm)) continue;
+            pcm.insert(pcm.begin(), KWS_SAMPLE_RATE, 0);
+            pcm.insert(pcm.end(), KWS_SAMPLE_RATE / 2, 0);
+            KwsTrigger trig[SWEEP_COUNT];
+            uint32_t hits[SWEEP_COUNT] = {};
+            for (size_t i = 0; i < SWEEP_COUNT; i++) kwsTriggerInit(trig[i], thresholds[i]);
+            kwsReset(det);
+            runStream(det, pcm, trig, hits, timing);
+            for (size_t i = 0; i < SWEEP_COUNT; i++) missed[i] += hits[i] == 0;
+            posClips++;
+        }
+    }
+
+    uint32_t accepts[SWEEP_COUNT] = {};
+    double negSeconds = 0.0;
+    if (negDir) {
+        for (const std::string& path : listWavs(negDir)) {
+            std::vector<int16_t> pcm;
+            if (!readWav(path, pcm)) continue;
+            KwsTrigger trig[SWEEP_COUNT];
+            for (size_t i = 0; i < SWEEP_COUNT; i++) kwsTriggerInit(trig[i], thresholds[i]);
+            kwsReset(det);
+            runStream(det, pcm, trig, accepts, timing);
+            negSeconds += (double)pcm.size() / KWS_SAMPLE_RATE;
+        }
+    }
+
+    printf("positives: %u clips, negatives: %.2f h\n", (unsigned)posClips, negSeconds / 3600.0);
+    printf("%-10s %10s %12s %10s\n", "threshold", "FRR %", "FA / hour", "FA count");
+    for (size_t i = 0; i < SWEEP_COUNT; i++) {
+        if (i == SWEEP_COUNT - 1) printf("--threshold\n");
+        double frr = posClips ? 100.0 * missed[i] / posClips : 0.0;
+        double faPerHour = negSeconds > 0 ? accepts[i] / (negSeconds / 3600.0) : 0.0;
+        printf("%-10.2f %10.2f %12.2f %10u\n", thresholds[i], frr, faPerHour, (unsigned)accepts[i]);
+    }
+    printf("front end: %.1f us/frame (mean)\n", mean(timing.frameUs));
+    printf("inference: %.3f ms mean, %.3f ms p50, %.3f ms p95, %.3f ms max (%zu runs, includes its frame)\n",
+           mean(timing.inferUs) / 1000.0, percentile(timing.inferUs, 0.5) / 1000.0,
+           percentile(timing.inferUs, 0.95) / 1000.0, percentile(timing.inferUs, 1.0) / 1000.0,
+           timing.inferUs.size());
+    kwsModelFree(model);
+    return 0;
+}
+
+// ==========================================
+// FEATURES
+// ==========================================
+static int cmdFeatures(char** argv) {
+    std::vector<int16_t> pcm;
+    if (!readWav(argv[2], pcm)) return 1;
+    kwsFrontendInit();
+    static KwsFrontend fe;
+    kwsFrontendReset(fe);
+    std::vector<int16_t> out;
+    for (size_t off = 0; off + KWS_HOP <= pcm.size(); off += KWS_HOP) {
+        int16_t mfcc[KWS_MFCC];
+        kwsFrontendFrame(fe, pcm.data() + off, mfcc);
+        out.insert(out.end(), mfcc, mfcc + KWS_MFCC);
+    }
+    if (!writeFile(argv[3], out.data(), out.size() * sizeof(int16_t))) {
+        perror(argv[3]);
+        return 1;
+    }
+    printf("%zu frames x %d coefficients (int16, Q%d log2) -> %s\n", out.size() / KWS_MFCC, KWS_MFCC,
+           KWS_MFCC_FRAC, argv[3]);
+    return 0;
+}
+
+// ==========================================
+// EMBED
+// ==========================================
+static int cmdEmbed(char** argv) {
+    Bytes blob;
+    static KwsModel model;
+    if (!loadModel(argv[2], blob, model)) return 1;
+    kwsModelFree(model);
+    printf("#pragma once\n#include <stddef.h>\n#include <stdint.h>\n\n");
+    printf("// Wake-word model, generated by `native-kws-tool embed %s`.\n", argv[2]);
+    printf("// Keyword label %u of %u.\n", model.header.keywordLabel, model.header.labelCount);
+    printf("alignas(4) static const uint8_t KWS_MODEL_DATA[] = {");
+    for (size_t i = 0; i < blob.size(); i++) printf("%s0x%02x,", i % 16 ? " " : "\n    ", blob[i]);
+    printf("\n};\nstatic const size_t KWS_MODEL_SIZE = sizeof(KWS_MODEL_DATA);\n");
+    return 0;
+}
+
+// ==========================================
+// DUMMY MODEL (DS-CNN-S shape, random weights)
+// ==========================================
+struct BlobWriter {
+    Bytes b;
+    void put(const void* p, size_t n) { b.insert(b.end(), (const uint8_t*)p, (const uint8_t*)p + n); }
+    void pad() { while (b.size() & 3) b.push_back(0); }
+};
+
+static uint32_t rng = 1;
+static int8_t randWeight() {
+    rng = rng * 1664525u + 1013904223u;
+    return (int8_t)((rng >> 24) % 61 - 30);
+}
+
+static void addLayer(BlobWriter& w, KwsLayerType type, int kh, int kw, int s, int padTop, int padLeft,
+                     int outH, int outW, int outC, int weights, bool relu) {
+    KwsLayerDesc d = {};
+    d.type = type;
+    d.relu = relu;
+    d.kh = kh;
+    d.kw = kw;
+    d.sh = d.sw = s;
+    d.padTop = padTop;
+    d.padLeft = padLeft;
+    d.outH = outH;
+    d.outW = outW;
+    d.outC = outC;
+    d.outZeroPoint = relu ? -128 : 0;
+    w.put(&d, sizeof(d));
+    if (type == KWS_AVGPOOL) return;
+    for (int i = 0; i < weights; i++) {
+        int8_t v = randWeight();
+        w.put(&v, 1);
+    }
+    w.pad();
+    // Keep random activations mid-range: scale by ~1 / (weight std * sqrt(fan-in))
+    int fanIn = type == KWS_DWCONV ? kh * kw : weights / outC;
+    int shift = -(int)lrintf(log2f(18.0f * sqrtf((float)fanIn)));
+    for (int c = 0; c < outC; c++) {
+        int32_t bias = 0;
+        w.put(&bias, 4);
+    }
+    for (int c = 0; c < outC; c++) {
+        int32_t mult = 1 << 30;
+        w.put(&mult, 4);
+    }
+    for (int c = 0; c < outC; c++) {
+        int8_t sh = (int8_t)shift;
+        w.put(&sh, 1);
+    }
+    w.pad();
+}
+
+static int cmdDummyModel(int argc, char** argv) {
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--seed")) rng = (uint32_t)atoi(argv[i + 1]);
+    }
+    const int C = 64, LABELS = 12, BLOCKS = 4;
+    KwsBlobHeader h = {};
+    memcpy(h.magic, "MSKW", 4);
+    h.version = 1;
+    h.layerCount = 1 + 2 * BLOCKS + 2;
+    h.frames = KWS_FRAMES;
+    h.coeffs = KWS_MFCC;
+    h.labelCount = LABELS;
+    h.keywordLabel = 2;
+    h.inputScale = 0.25f;
+    h.inputZeroPoint = 0;
+    h.outputScale = 0.1f;
+
+    BlobWriter w;
+    w.put(&h, sizeof(h));
+    // 10x4 stride 2 conv, TF "same": 49x10 -> 25x5
+    addLayer(w, KWS_CONV, 10, 4, 2, 4, 1, 25, 5, C, C * 10 * 4, true);
+    for (int b = 0; b < BLOCKS; b++) {
+        addLayer(w, KWS_DWCONV, 3, 3, 1, 1, 1, 25, 5, C, 3 * 3 * C, true);
+        addLayer(w, KWS_CONV, 1, 1, 1, 0, 0, 25, 5, C, C * C, true);
+    }
+    addLayer(w, KWS_AVGPOOL, 0, 0, 0, 0, 0, 1, 1, C, 0, false);
+    addLayer(w, KWS_FC, 0, 0, 0, 0, 0, 1, 1, LABELS, LABELS * C, false);
+
+    static KwsModel model;
+    if (!kwsModelLoad(model, w.b.data(), w.b.size())) {
+        fprintf(stderr, "dummy model rejected: %s\n", model.error);
+        return 1;
+    }
+    kwsModelFree(model);
+    if (!writeFile(argv[2], w.b.data(), w.b.size())) {
+        perror(argv[2]);
+        return 1;
+    }
+    printf("%zu-byte DS-CNN-S shaped model (random weights) -> %s\n", w.b.size(), argv[2]);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[1], "eval")) return cmdEval(argc, argv);
+    if (argc == 4 && !strcmp(argv[1], "features")) return cmdFeatures(argv);
+    if (argc == 3 && !strcmp(argv[1], "embed")) return cmdEmbed(argv);
+    if (argc >= 3 && !strcmp(argv[1], "dummy-model")) return cmdDummyModel(argc, argv);
+    fprintf(stderr, "usage: %s eval --model M.bin [--positive DIR] [--negative DIR] [--threshold T]\n"
+                    "       %s features IN.wav OUT.raw\n"
+                    "       %s embed M.bin > kws_model_data.h\n"
+                    "       %s dummy-model OUT.bin [--seed N]\n", argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+}
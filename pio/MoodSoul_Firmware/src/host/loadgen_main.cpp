@@ -0,0 +1,430 @@
+// Virtual device fleet (env:native-loadgen).
+//
+// Runs N virtual CoreS3s against /api/interact using the firmware's own
+// request builder (interaction_request) and response head parser
+// (http_response). Each device replays recorded turns, or synthetic ones,
+// separated by think times, then the run reports p50/p99 latency and
+// throughput.
+//
+//   program --host 127.0.0.1 --port 8080 --devices 200 --duration 60
+//           [--think-ms 2000:8000] [--replay DIR] [--shake-ratio 0.1]
+//           [--observe-ratio 0.05] [--timeout-ms 15000] [--json FILE]
+//           [--codecs ima-adpcm,pcm16,mp3]
+//
+// Exits non-zero if any turn failed (connect, send, timeout, non-200 other
+// than 429, or a short body), including failures injected by the mock.
+// Segmented replies (reply_segments.h) are decoded like the firmware does;
+// a stream that ends before its last segment is a short body.
+//
+// --codecs goes out in X-Audio-Caps (reply_decoder.h). PCM16 and
+// IMA-ADPCM replies are decoded with the firmware's decoders and "first
+// audio" is the first decoded sample; MP3 isn't decoded on the host, so
+// there it is the first audio byte. Run once per codec to compare them.
+//
+// Replay directory layout (all optional):
+//   DIR/audio/*.pcm   16 kHz 16-bit mono captures
+//   DIR/frames/*.jpg  camera frames
+//   DIR/events.txt    "touch|shake|observe <think_ms>" per line, replayed
+//                     in order by every device (offset by device index)
+#include "net_posix.h"
+#include "../http_response.h"
+#include "../interaction_request.h"
+#include "../lipsync.h"
+#include "../reply_decoder.h"
+#include "../reply_segments.h"
+#include "../metrics.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+enum EventType { EV_TOUCH, EV_SHAKE, EV_OBSERVE };
+
+struct ReplayEvent {
+    EventType type;
+    uint32_t  thinkMs;
+};
+
+struct Config {
+    std::string host = "127.0.0.1";
+    int         port = 8080;
+    int         devices = 10;
+    int         durationS = 30;
+    uint32_t    thinkMinMs = 2000, thinkMaxMs = 8000;
+    std::string replayDir;
+    double      shakeRatio = 0.1;
+    double      observeRatio = 0.05;
+    int         timeoutMs = 15000;
+    std::string jsonPath;
+    std::string codecs = "ima-adpcm,pcm16,mp3";
+};
+
+static Config cfg;
+static std::vector<std::vector<uint8_t>> audioClips;
+static std::vector<std::vector<uint8_t>> frames;
+static std::vector<ReplayEvent> events;
+static std::vector<uint8_t> triggerAudio(1024, 0); // firmware sends 1 KB of silence
+static std::string audioCaps;
+
+// Fleet-wide results, recorded lock-free from every device thread
+Histogram e2eMs("loadgen_e2e_ms", "Connect to last response byte");
+Histogram ttfbMs("loadgen_ttfb_ms", "Last request byte to response head");
+Histogram firstAudioMs("loadgen_first_audio_ms", "Last request byte to first decoded audio");
+Histogram decodeUs("loadgen_decode_us", "Reply decode CPU per turn, us");
+Counter   replyCodecs[] = {
+    { "loadgen_replies_total{codec=\"mp3\"}", "Replies by codec" },
+    { "loadgen_replies_total{codec=\"pcm16\"}", "Replies by codec" },
+    { "loadgen_replies_total{codec=\"ima-adpcm\"}", "Replies by codec" },
+};
+Histogram uploadMs("loadgen_upload_ms", "Request upload time");
+Counter   turnsOk("loadgen_turns_ok_total", "Turns with a 200 and full body");
+Counter   turnsThrottled("loadgen_turns_429_total", "Turns rejected with 429");
+Counter   turnsFailed("loadgen_turns_failed_total", "Connect/send/timeout/5xx/short body");
+Counter   bytesUp("loadgen_bytes_up_total", "Request bytes sent");
+Counter   bytesDown("loadgen_bytes_down_total", "Response body bytes received");
+
+// ==========================================
+// REPLAY DATA
+// ==========================================
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return data;
+    uint8_t buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+static void loadDir(const std::string& dir, const char* ext, std::vector<std::vector<uint8_t>>& out) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > strlen(ext) && name.compare(name.size() - strlen(ext), strlen(ext), ext) == 0) {
+            std::vector<uint8_t> data = readFile(dir + "/" + name);
+            if (!data.empty()) out.push_back(std::move(data));
+        }
+    }
+    closedir(d);
+}
+
+static void loadReplay() {
+    if (!cfg.replayDir.empty()) {
+        loadDir(cfg.replayDir + "/audio", ".pcm", audioClips);
+        loadDir(cfg.replayDir + "/frames", ".jpg", frames);
+        FILE* f = fopen((cfg.replayDir + "/events.txt").c_str(), "r");
+        if (f) {
+            char type[16];
+            unsigned think;
+            while (fscanf(f, "%15s %u", type, &think) == 2) {
+                EventType t = strcmp(type, "shake") == 0 ? EV_SHAKE
+                            : strcmp(type, "observe") == 0 ? EV_OBSERVE : EV_TOUCH;
+                events.push_back({ t, think });
+            }
+            fclose(f);
+        }
+    }
+    // Synthetic fallbacks sized like a real turn
+    std::mt19937 rng(42);
+    if (audioClips.empty()) {
+        std::vector<uint8_t> pcm(3 * 16000 * 2);
+        for (auto& b : pcm) b = (uint8_t)(rng() & 0x0F);
+        audioClips.push_back(std::move(pcm));
+    }
+    if (frames.empty()) {
+        std::vector<uint8_t> jpg(20000);
+        for (auto& b : jpg) b = (uint8_t)rng();
+        jpg[0] = 0xFF; jpg[1] = 0xD8; jpg[jpg.size() - 2] = 0xFF; jpg[jpg.size() - 1] = 0xD9;
+        frames.push_back(std::move(jpg));
+    }
+}
+
+// ==========================================
+// ONE TURN
+// ==========================================
+static double msSince(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+struct CountingSink : ByteSink {
+    ByteSink& inner;
+    size_t    total = 0;
+    explicit CountingSink(ByteSink& s) : inner(s) {}
+    size_t write(const uint8_t* data, size_t len) override {
+        size_t n = inner.write(data, len);
+        total += n;
+        return n;
+    }
+};
+
+static void runTurn(int device, const char* deviceId, EventType type, std::mt19937& rng) {
+    char traceId[17];
+    snprintf(traceId, sizeof(traceId), "%08x%08x", (unsigned)rng(), (unsigned)rng());
+    char boundary[48];
+    snprintf(boundary, sizeof(boundary), "------------------------%d%u", device, (unsigned)rng());
+
+    const std::vector<uint8_t>& frame = frames[rng() % frames.size()];
+    const std::vector<uint8_t>& audio = audioClips[rng() % audioClips.size()];
+
+    // Same shapes as loop(): touch = frame + full recording, shake = no
+    // frame + 1 KB silence, observe = frame + 1 KB silence
+    InteractionParts parts = {};
+    parts.host = cfg.host.c_str();
+    parts.path = "/api/interact";
+    parts.boundary = boundary;
+    parts.deviceId = deviceId;
+    parts.traceId = traceId;
+    parts.audioCaps = audioCaps.c_str();
+    parts.trigger = type == EV_SHAKE ? "SHAKE_EVENT" : type == EV_OBSERVE ? "AUTO_OBSERVE" : "";
+    parts.image = type == EV_SHAKE ? nullptr : frame.data();
+    parts.imageLen = type == EV_SHAKE ? 0 : frame.size();
+    parts.audio = type == EV_TOUCH ? audio.data() : triggerAudio.data();
+    parts.audioLen = type == EV_TOUCH ? audio.size() : triggerAudio.size();
+
+    Clock::time_point start = Clock::now();
+    int fd = netConnect(cfg.host.c_str(), cfg.port, cfg.timeoutMs);
+    if (fd < 0) {
+        turnsFailed.inc();
+        return;
+    }
+
+    SocketSink socketSink(fd);
+    CountingSink sink(socketSink);
+    Clock::time_point uploadStart = Clock::now();
+    bool sent = interactionWriteRequest(sink, parts);
+    bytesUp.inc(sink.total);
+    if (!sent) {
+        turnsFailed.inc();
+        close(fd);
+        return;
+    }
+    uploadMs.record((uint32_t)msSince(uploadStart));
+    Clock::time_point lastByte = Clock::now();
+
+    SocketReader reader(fd);
+    HttpResponseHead head;
+    httpHeadReset(head);
+    std::string line;
+    bool first = true;
+    while (reader.readLine(line)) {
+        if (first) {
+            ttfbMs.record((uint32_t)msSince(lastByte));
+            first = false;
+        }
+        if (httpHeadFeedLine(head, line.c_str(), line.size())) break;
+    }
+    if (!head.complete) {
+        turnsFailed.inc();
+        close(fd);
+        return;
+    }
+
+    // Body, consumed in the firmware's 1 KB chunks through its decoders and
+    // the lip-sync kernel
+    struct AudioSink : SegmentEvents, PcmSink {
+        Clock::time_point lastByte;
+        bool first = true;
+        int codec = -1;
+        std::unique_ptr<ReplyDecoder> decoder; // own instance: devices run in parallel
+        std::chrono::nanoseconds busy{0};
+        void begin(int c) {
+            if (c == codec) return;
+            finish();
+            codec = c;
+            if (c >= 0 && c < 3) replyCodecs[c].inc();
+            decoder.reset(c >= 0 ? replyDecoderCreate((uint8_t)c) : nullptr);
+        }
+        void finish() {
+            if (decoder) decoder->flush(*this);
+        }
+        void firstAudio() {
+            if (!first) return;
+            firstAudioMs.record((uint32_t)msSince(lastByte));
+            first = false;
+        }
+        void pcm(const int16_t* s, size_t n) override {
+            firstAudio();
+            volatile int level = lipSyncLevelPcm(s, n);
+            (void)level;
+        }
+        void segmentBegin(const SegmentHeader& h, const char*) override { begin(h.codec); }
+        void segmentAudio(const uint8_t* data, size_t len) override {
+            if (!len) return;
+            Clock::time_point t0 = Clock::now();
+            if (decoder) {
+                decoder->decode(data, len, *this);
+            } else {
+                firstAudio();
+                volatile int level = lipSyncLevel(data, len);
+                (void)level;
+            }
+            busy += Clock::now() - t0;
+        }
+        // Segments are encoded one by one: play out each one's last block
+        void segmentEnd(const SegmentHeader&) override {
+            if (decoder) decoder->flush(*this);
+        }
+    } player;
+    player.lastByte = lastByte;
+    bool segmented = strncmp(head.contentType, SEGMENT_CONTENT_TYPE, strlen(SEGMENT_CONTENT_TYPE)) == 0;
+    if (!segmented && head.status == 200) {
+        int c = replyCodecForType(head.contentType);
+        player.begin(c >= 0 ? c : SEGMENT_CODEC_MP3);
+    }
+    ChunkedDecoder chunks;
+    chunkedInit(chunks);
+    SegmentParser segs;
+    segmentParserInit(segs);
+    uint8_t chunk[1024];
+    long got = 0;
+    for (;;) {
+        if (head.chunked ? chunks.state >= CHUNK_DONE : head.contentLength >= 0 && got >= head.contentLength) break;
+        size_t n = reader.read(chunk, sizeof(chunk));
+        if (n == 0) break;
+        got += n;
+        if (head.chunked) n = chunkedDecode(chunks, chunk, n);
+        if (segmented) segmentFeed(segs, chunk, n, player);
+        else player.segmentAudio(chunk, n);
+    }
+    player.finish();
+    if (head.status == 200) decodeUs.record((uint32_t)(player.busy.count() / 1000));
+    close(fd);
+    bytesDown.inc(got);
+
+    bool shortBody = segmented ? segs.state != SEG_DONE
+                   : head.chunked ? chunks.state != CHUNK_DONE
+                   : head.contentLength >= 0 && got < head.contentLength;
+    if (head.status == 429) {
+        turnsThrottled.inc();
+    } else if (head.status != 200 || shortBody) {
+        turnsFailed.inc();
+    } else {
+        turnsOk.inc();
+        e2eMs.record((uint32_t)msSince(start));
+    }
+}
+
+// ==========================================
+// VIRTUAL DEVICE
+// ==========================================
+static void deviceThread(int device, Clock::time_point deadline) {
+    std::mt19937 rng(1000 + device);
+    char deviceId[16];
+    snprintf(deviceId, sizeof(deviceId), "VDEV%04d", device);
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> think(cfg.thinkMinMs, cfg.thinkMaxMs);
+    size_t eventIdx = device; // stagger replay across the fleet
+
+    // Spread the first turns over one think period so devices don't start in lockstep
+    std::this_thread::sleep_for(std::chrono::milliseconds(rng() % (cfg.thinkMaxMs + 1)));
+
+    while (Clock::now() < deadline) {
+        EventType type;
+        uint32_t thinkMs;
+        if (!events.empty()) {
+            const ReplayEvent& ev = events[eventIdx++ % events.size()];
+            type = ev.type;
+            thinkMs = ev.thinkMs;
+        } else {
+            double r = unit(rng);
+            type = r < cfg.shakeRatio ? EV_SHAKE
+                 : r < cfg.shakeRatio + cfg.observeRatio ? EV_OBSERVE : EV_TOUCH;
+            thinkMs = think(rng);
+        }
+        runTurn(device, deviceId, type, rng);
+        if (Clock::now() + std::chrono::milliseconds(thinkMs) >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+    }
+}
+
+// ==========================================
+// MAIN
+// ==========================================
+static bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) return false;
+        if (a == "--host") cfg.host = v;
+        else if (a == "--port") cfg.port = atoi(v);
+        else if (a == "--devices") cfg.devices = atoi(v);
+        else if (a == "--duration") cfg.durationS = atoi(v);
+        else if (a == "--think-ms") {
+            if (sscanf(v, "%u:%u", &cfg.thinkMinMs, &cfg.thinkMaxMs) != 2) return false;
+        }
+        else if (a == "--replay") cfg.replayDir = v;
+        else if (a == "--shake-ratio") cfg.shakeRatio = atof(v);
+        else if (a == "--observe-ratio") cfg.observeRatio = atof(v);
+        else if (a == "--timeout-ms") cfg.timeoutMs = atoi(v);
+        else if (a == "--json") cfg.jsonPath = v;
+        else if (a == "--codecs") cfg.codecs = v;
+        else return false;
+        i++;
+    }
+    return cfg.devices > 0 && cfg.thinkMinMs <= cfg.thinkMaxMs;
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        fprintf(stderr, "usage: %s --host H --port P --devices N --duration S "
+                        "[--think-ms MIN:MAX] [--replay DIR] [--shake-ratio R] "
+                        "[--observe-ratio R] [--timeout-ms MS] [--json FILE] [--codecs LIST]\n", argv[0]);
+        return 2;
+    }
+    loadReplay();
+    audioCaps = "codecs=" + cfg.codecs + "; rate=16000; channels=1; buffer-ms=256; adpcm-block=256";
+    fprintf(stderr, "loadgen: %d devices, %d s, %zu audio clips, %zu frames, %zu replay events\n",
+            cfg.devices, cfg.durationS, audioClips.size(), frames.size(), events.size());
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::seconds(cfg.durationS);
+    std::vector<std::thread> fleet;
+    for (int d = 0; d < cfg.devices; d++) fleet.emplace_back(deviceThread, d, deadline);
+    for (auto& t : fleet) t.join();
+    double elapsed = msSince(start) / 1000.0;
+
+    uint32_t ok = turnsOk.get();
+    printf("turns: ok=%u throttled=%u failed=%u in %.1f s\n",
+           ok, turnsThrottled.get(), turnsFailed.get(), elapsed);
+    printf("throughput: %.2f turns/s, up %.1f KB/s, down %.1f KB/s\n",
+           ok / elapsed, bytesUp.get() / 1024.0 / elapsed, bytesDown.get() / 1024.0 / elapsed);
+    printf("e2e ms:    p50=%u p99=%u max=%u\n", e2eMs.quantile(0.5f), e2eMs.quantile(0.99f), e2eMs.max.load());
+    printf("ttfb ms:   p50=%u p99=%u\n", ttfbMs.quantile(0.5f), ttfbMs.quantile(0.99f));
+    printf("audio ms:  p50=%u p99=%u (first decoded audio)\n", firstAudioMs.quantile(0.5f), firstAudioMs.quantile(0.99f));
+    printf("decode us: p50=%u p99=%u per reply, codecs mp3=%u pcm16=%u ima-adpcm=%u\n",
+           decodeUs.quantile(0.5f), decodeUs.quantile(0.99f),
+           replyCodecs[0].get(), replyCodecs[1].get(), replyCodecs[2].get());
+    printf("upload ms: p50=%u p99=%u\n", uploadMs.quantile(0.5f), uploadMs.quantile(0.99f));
+
+    if (!cfg.jsonPath.empty()) {
+        FILE* f = fopen(cfg.jsonPath.c_str(), "w");
+        if (!f) {
+            perror(cfg.jsonPath.c_str());
+            return 1;
+        }
+        fprintf(f, "{\"devices\": %d, \"duration_s\": %.1f, \"turns_ok\": %u, \"turns_429\": %u, "
+                   "\"turns_failed\": %u, \"turns_per_s\": %.3f, "
+                   "\"e2e_ms\": {\"p50\": %u, \"p99\": %u, \"max\": %u}, "
+                   "\"ttfb_ms\": {\"p50\": %u, \"p99\": %u}, "
+                   "\"first_audio_ms\": {\"p50\": %u, \"p99\": %u}, "
+                   "\"decode_us\": {\"p50\": %u, \"p99\": %u}, \"codecs\": \"%s\"}\n",
+                cfg.devices, elapsed, ok, turnsThrottled.get(), turnsFailed.get(), ok / elapsed,
+                e2eMs.quantile(0.5f), e2eMs.quantile(0.99f), e2eMs.max.load(),
+                ttfbMs.quantile(0.5f), ttfbMs.quantile(0.99f),
+                firstAudioMs.quantile(0.5f), firstAudioMs.quantile(0.99f),
+                decodeUs.quantile(0.5f), decodeUs.quantile(0.99f), cfg.codecs.c_str());
+        fclose(f);
+    }
+    return turnsFailed.get() == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+// Wooden-fish upload simulation (env:native-merit-sim).
+//
+//   program [--taps-per-s 10] [--minutes 10] [--loss 0.05] [--ack-loss 0.05]
+//           [--latency-ms 400] [--reboots 3] [--offline-minutes 0]
+//
+// Drives merit_batch.cpp the way wooden_fish.cpp does (drain taps every
+// poll, save to "NVS" on the same cadence, one request at a time) against
+// a server that applies each batch seq once. Requests and acks get lost,
+// and the device reboots at random, restoring its last save. Like
+// /api/merit, the server refuses batches over MERIT_MAX_BATCH taps. With
+// --offline-minutes every request fails for that long first, so taps pile
+// up past one batch (20 minutes at 10 taps/s is 12000). Reports the
+// request rate and checks the server ends up with exactly the taps the
+// device kept: none lost once saved, none counted twice.
+#include "../merit_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POLL_MS    250  // wooden_fish.cpp upload task period
+#define TIMEOUT_MS 5000 // a lost request or ack shows up as this
+
+struct Server {
+    uint32_t lastSeq;
+    uint64_t count;
+};
+
+static double frand() {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+int main(int argc, char** argv) {
+    double tapsPerS = 10, minutes = 10, loss = 0.05, ackLoss = 0.05;
+    double offlineMinutes = 0;
+    uint32_t latencyMs = 400, reboots = 3;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--taps-per-s") && i + 1 < argc) tapsPerS = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) loss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--ack-loss") && i + 1 < argc) ackLoss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--latency-ms") && i + 1 < argc) latencyMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--reboots") && i + 1 < argc) reboots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--offline-minutes") && i + 1 < argc) offlineMinutes = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--taps-per-s N] [--minutes M] [--loss P] [--ack-loss P] "
+                            "[--latency-ms MS] [--reboots N] [--offline-minutes M]\n", argv[0]);
+            return 2;
+        }
+    }
+    srand(42);
+    uint32_t tapEndMs = (uint32_t)(minutes * 60000);
+    uint32_t offlineMs = (uint32_t)(offlineMinutes * 60000);
+    uint32_t endMs = tapEndMs + 10 * MERIT_RETRY_MAX_MS; // then let it drain
+
+    MeritBatch m, nvs;
+    meritInit(m, 0, 0, 0, 0);
+    nvs = m;
+    Server server = {};
+    uint64_t taps = 0, lostToReboot = 0, requests = 0, tapPhaseRequests = 0, duplicates = 0, refused = 0;
+    uint32_t unsaved = 0, lastSaveMs = 0, maxPending = 0;
+    double nextTapMs = 0;
+    // One request in flight: what it carries and when its fate is known
+    bool busy = false, delivered = false, ackOk = false;
+    MeritUpload req = {};
+    uint32_t doneAtMs = 0;
+
+    for (uint32_t now = 0; now < endMs; now += POLL_MS) {
+        // Taps since the last poll (jittered around the mean rate)
+        while (now < tapEndMs && nextTapMs <= now) {
+            unsaved++;
+            taps++;
+            nextTapMs += 1000.0 / tapsPerS * (0.5 + frand());
+        }
+        if (reboots && now < tapEndMs && frand() < reboots * (double)POLL_MS / tapEndMs) {
+            // Power cut: RAM state and the request in flight are gone
+            lostToReboot += unsaved + (m.total - nvs.total);
+            unsaved = 0;
+            meritInit(m, nvs.total, nvs.acked, nvs.seq, nvs.inflight);
+            busy = false;
+            continue;
+        }
+        meritAdd(m, unsaved, now);
+        unsaved = 0;
+        if (meritPending(m) > maxPending) maxPending = meritPending(m);
+        if (now - lastSaveMs >= MERIT_SAVE_MS) {
+            nvs = m;
+            lastSaveMs = now;
+        }
+
+        if (busy && now >= doneAtMs) {
+            busy = false;
+            if (delivered && ackOk) meritAcked(m, req.seq);
+            else meritFailed(m, now);
+            nvs = m;
+        }
+        bool cut;
+        if (!busy && meritDue(m, now, req, &cut)) {
+            if (cut) nvs = m; // the seq must survive a reboot before it's sent
+            requests++;
+            if (now < tapEndMs) tapPhaseRequests++;
+            busy = true;
+            delivered = now >= offlineMs && frand() >= loss;
+            ackOk = frand() >= ackLoss;
+            if (delivered && req.taps > MERIT_MAX_BATCH) {
+                // 400: not applied, and the device sees a failure
+                refused++;
+                ackOk = false;
+            }
+            doneAtMs = now + (delivered && ackOk ? latencyMs : TIMEOUT_MS);
+            if (delivered && req.taps <= MERIT_MAX_BATCH) {
+                if (req.seq > server.lastSeq) {
+                    server.lastSeq = req.seq;
+                    server.count += req.taps;
+                } else {
+                    duplicates++;
+                }
+            }
+        }
+    }
+
+    uint64_t kept = taps - lostToReboot;
+    bool ok = server.count == kept && m.total == kept && meritPending(m) == 0 && m.inflight == 0 && !refused;
+    printf("taps              %llu (%.1f/s for %.1f min)\n", (unsigned long long)taps, tapsPerS, minutes);
+    printf("lost to reboots   %llu (unsaved, at most %u ms of taps each)\n", (unsigned long long)lostToReboot,
+           MERIT_SAVE_MS);
+    printf("requests          %llu, %.3f/s while tapping (%.0f taps each)\n", (unsigned long long)requests,
+           tapPhaseRequests / (tapEndMs / 1000.0), tapPhaseRequests ? (double)kept / requests : 0.0);
+    printf("naive requests    %llu (one per tap), %.1fx more\n", (unsigned long long)taps,
+           requests ? (double)taps / requests : 0.0);
+    printf("duplicates        %llu absorbed by the server\n", (unsigned long long)duplicates);
+    printf("max pending       %u taps\n", maxPending);
+    printf("refused           %llu batches over %u taps\n", (unsigned long long)refused, MERIT_MAX_BATCH);
+    printf("server count      %llu, device kept %llu: %s\n", (unsigned long long)server.count,
+           (unsigned long long)kept, ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
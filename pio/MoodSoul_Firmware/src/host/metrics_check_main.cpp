@@ -0,0 +1,92 @@
+// /metrics page check (env:native-metrics-check).
+//
+//   program
+//
+// Registers more metrics than the device has (labelled families,
+// histograms with wide values) and renders them the way the metrics server
+// does: the page must come out whole, the measured length must match what
+// is written, a short buffer must report the cut, and a page that grows
+// after the buffer was sized (values gaining digits) must still come out
+// whole. Exits non-zero if any check fails.
+#include "../metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define CHECK_COUNTERS   64
+#define CHECK_GAUGES     42
+#define CHECK_HISTOGRAMS 30
+
+static std::vector<std::string> names; // metrics keep the pointers
+
+static const char* name(const char* fmt, int i) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), fmt, i / 4, i % 4);
+    names.push_back(buf);
+    return names.back().c_str();
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+int main() {
+    names.reserve(CHECK_COUNTERS + CHECK_GAUGES + CHECK_HISTOGRAMS);
+    std::vector<Counter*> counters;
+    std::vector<Gauge*> gauges;
+    std::vector<Histogram*> hists;
+    for (int i = 0; i < CHECK_COUNTERS; i++) {
+        counters.push_back(new Counter(name("moodsoul_check_events_%d_total{kind=\"k%d\"}", i),
+                                       "Check counter, one of a labelled family"));
+    }
+    for (int i = 0; i < CHECK_GAUGES; i++) {
+        gauges.push_back(new Gauge(name("moodsoul_check_level_%d{slot=\"s%d\"}", i), "Check gauge"));
+    }
+    for (int i = 0; i < CHECK_HISTOGRAMS; i++) {
+        hists.push_back(new Histogram(name("moodsoul_check_stage_%d_us{stage=\"t%d\"}", i),
+                                      "Check histogram, microseconds"));
+    }
+    for (size_t i = 0; i < counters.size(); i++) counters[i]->inc(7);
+    for (size_t i = 0; i < gauges.size(); i++) gauges[i]->set(-3);
+    for (Histogram* h : hists) {
+        for (uint32_t v = 1; v < 100000; v = v * 3 + 1) h->record(v);
+    }
+
+    // Histogram lines carry a quantile label, so look for the family
+    std::string last = names.back().substr(0, names.back().find('{'));
+    size_t need = metricsRender(nullptr, 0);
+    printf("page %zu bytes\n", need);
+    check(need > 12288, "page bigger than the old fixed buffer");
+
+    std::vector<char> exact(need + 1);
+    size_t n = metricsRender(exact.data(), exact.size());
+    check(n == need && strlen(exact.data()) == need, "measured length matches the render");
+    check(need && exact[need - 1] == '\n', "render ends on a full line");
+    check(strstr(exact.data(), last.c_str()) != nullptr, "last metric on the page");
+
+    std::vector<char> small(4096);
+    n = metricsRender(small.data(), small.size());
+    check(n == need && strlen(small.data()) == small.size() - 1, "short buffer reports the cut");
+
+    MetricsPage page = { nullptr, 0, realloc };
+    const char* text = metricsRenderPage(page);
+    check(strlen(text) == need, "server page whole on first scrape");
+
+    // Values gain digits after the buffer was sized
+    for (Counter* c : counters) c->inc(4000000000u);
+    for (Gauge* g : gauges) g->set(-2000000000);
+    for (Histogram* h : hists) h->record(0xFFFFFFFFu);
+    size_t grown = metricsRender(nullptr, 0);
+    text = metricsRenderPage(page);
+    check(grown > need && strlen(text) == grown, "server page whole after values grow");
+    check(strstr(text, last.c_str()) != nullptr, "last metric still on the page");
+
+    free(page.buf);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
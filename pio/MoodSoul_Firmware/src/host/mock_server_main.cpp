@@ -0,0 +1,407 @@
+// Local mock of /api/interact (env:native-mock-server).
+//
+// Accepts the firmware's multipart POST, discards the body and answers with
+// a canned MP3 after an injected think delay, optionally paced to a
+// bandwidth cap and with injected failures. Pair with env:native-loadgen.
+//
+//   program --port 8080 [--mp3 reply.mp3] [--latency-ms 1500] [--jitter-ms 300]
+//           [--bandwidth-kbps 256] [--error-rate 0.01] [--throttle-rate 0.02]
+//           [--drop-rate 0.01] [--segments 3] [--segment-ms 400]
+//           [--segment-jitter-ms 150] [--codecs ima-adpcm,pcm16,mp3]
+//
+// --bandwidth-kbps 0 means unlimited. --drop-rate closes the socket halfway
+// through the body, which the device must treat as a failed turn.
+//
+// Requests that accept SEGMENT_CONTENT_TYPE get the reply split into
+// --segments sentences, sent chunked: the first
+// after --latency-ms (Gemini), each after another --segment-ms (TTS for
+// that sentence). --segments 0 always sends the single reply. Like the
+// server, each sentence is encoded on its own: an ADPCM one ends in a short
+// block, and MP3 ones are cut at frame syncs.
+//
+// The reply codec is the first one in the request's X-Audio-Caps that
+// --codecs offers (reply_decoder.h); MP3 without the header. PCM16 and
+// IMA-ADPCM replies are 3 s of synthetic 16 kHz speech-like tone.
+#include "net_posix.h"
+#include "../reply_decoder.h"
+#include "../reply_segments.h"
+#include <strings.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Config {
+    int         port = 8080;
+    std::string mp3Path;
+    int         latencyMs = 1500;
+    int         jitterMs = 300;
+    int         bandwidthKbps = 0;
+    double      errorRate = 0;
+    double      throttleRate = 0;
+    double      dropRate = 0;
+    int         segments = 3;
+    int         segmentMs = 400;
+    int         segmentJitterMs = 150;
+    std::string codecs = "ima-adpcm,pcm16,mp3";
+};
+
+static Config cfg;
+static std::vector<uint8_t> replies[3]; // by SEGMENT_CODEC_*
+static std::atomic<uint32_t> served{0}, errors{0}, throttled{0}, dropped{0};
+static std::mutex rngLock;
+static std::mt19937 rng(7);
+
+static double uniform() {
+    std::lock_guard<std::mutex> g(rngLock);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+// ~3 s of silent MPEG-1 Layer III frames (128 kbps, 44.1 kHz, 417 bytes).
+static std::vector<uint8_t> silentMp3() {
+    std::vector<uint8_t> mp3;
+    for (int f = 0; f < 115; f++) {
+        uint8_t frame[417] = { 0xFF, 0xFB, 0x90, 0x64 };
+        mp3.insert(mp3.end(), frame, frame + sizeof(frame));
+    }
+    return mp3;
+}
+
+static std::vector<uint8_t> imaAdpcmEncode(const int16_t* pcm, size_t count) {
+    std::vector<uint8_t> out;
+    int index = 0;
+    uint8_t block[REPLY_ADPCM_BLOCK];
+    for (size_t off = 0; off < count; off += REPLY_ADPCM_SAMPLES) {
+        size_t n = count - off < REPLY_ADPCM_SAMPLES ? count - off : REPLY_ADPCM_SAMPLES;
+        size_t len = imaAdpcmEncodeBlock(pcm + off, n, index, block);
+        out.insert(out.end(), block, block + len);
+    }
+    return out;
+}
+
+// ~3 s of 16 kHz mono: a wobbling 180 Hz tone, as PCM16 and as IMA-ADPCM.
+static void synthReplies() {
+    std::vector<int16_t> pcm(3 * REPLY_RATE);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        double env = 0.5 + 0.5 * sin(i * 2 * M_PI * 3 / REPLY_RATE);
+        pcm[i] = (int16_t)(9000 * env * sin(i * 2 * M_PI * 180 / REPLY_RATE));
+    }
+    const uint8_t* raw = (const uint8_t*)pcm.data();
+    replies[SEGMENT_CODEC_PCM16].assign(raw, raw + pcm.size() * 2);
+    replies[SEGMENT_CODEC_IMA_ADPCM] = imaAdpcmEncode(pcm.data(), pcm.size());
+}
+
+// First codec in the device's list that we offer
+static int pickCodec(const std::string& caps) {
+    const char* list = strcasestr(caps.c_str(), "codecs=");
+    if (!list) return SEGMENT_CODEC_MP3;
+    list += 7;
+    while (*list && *list != ';') {
+        size_t len = strcspn(list, ",; \r\n");
+        int c = replyCodecFromName(list, len);
+        std::string name(list, len);
+        if (c >= 0 && ("," + cfg.codecs + ",").find("," + name + ",") != std::string::npos) return c;
+        list += len;
+        while (*list == ',' || *list == ' ') list++;
+    }
+    return SEGMENT_CODEC_MP3;
+}
+
+static const char* contentType(int codec) {
+    return codec == SEGMENT_CODEC_PCM16 ? "audio/L16;rate=16000"
+         : codec == SEGMENT_CODEC_IMA_ADPCM ? "audio/x-ima-adpcm;rate=16000" : "audio/mpeg";
+}
+
+static bool sendStr(int fd, const std::string& s) {
+    return netSendAll(fd, s.data(), s.size());
+}
+
+static void sendJsonError(int fd, int status, const char* reason, const char* msg) {
+    char body[96];
+    int n = snprintf(body, sizeof(body), "{\"error\":\"%s\"}", msg);
+    char head[256];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+             "Connection: close\r\n\r\n", status, reason, n);
+    sendStr(fd, head) && netSendAll(fd, body, n);
+}
+
+// MPEG audio frame sync: 11 set bits
+static bool mp3Sync(const uint8_t* p) {
+    return p[0] == 0xFF && (p[1] & 0xE0) == 0xE0;
+}
+
+// Splits the reply into n parts that each start on a frame sync (MP3) or a
+// sample (PCM16).
+static std::vector<size_t> segmentCuts(const std::vector<uint8_t>& reply, int codec, int n) {
+    std::vector<size_t> cuts = { 0 };
+    for (int i = 1; i < n; i++) {
+        size_t at = reply.size() * i / n;
+        if (codec == SEGMENT_CODEC_MP3) {
+            while (at + 1 < reply.size() && !mp3Sync(&reply[at])) at++;
+        } else {
+            at -= at % 2;
+        }
+        if (at + 1 < reply.size() && at > cuts.back()) cuts.push_back(at);
+    }
+    cuts.push_back(reply.size());
+    return cuts;
+}
+
+// The sentences' audio. ADPCM ones are cut from the PCM and each encoded
+// separately, the way the server synthesizes them.
+static std::vector<std::vector<uint8_t>> segmentAudio(int codec, int n) {
+    bool adpcm = codec == SEGMENT_CODEC_IMA_ADPCM;
+    const std::vector<uint8_t>& reply = replies[adpcm ? SEGMENT_CODEC_PCM16 : codec];
+    std::vector<size_t> cuts = segmentCuts(reply, adpcm ? SEGMENT_CODEC_PCM16 : codec, n);
+    std::vector<std::vector<uint8_t>> parts;
+    for (size_t i = 0; i + 1 < cuts.size(); i++) {
+        if (adpcm) {
+            parts.push_back(imaAdpcmEncode((const int16_t*)&reply[cuts[i]], (cuts[i + 1] - cuts[i]) / 2));
+        } else {
+            parts.emplace_back(reply.begin() + cuts[i], reply.begin() + cuts[i + 1]);
+        }
+    }
+    return parts;
+}
+
+static bool sendChunk(int fd, const void* data, size_t len) {
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", len);
+    return netSendAll(fd, size, n) && netSendAll(fd, data, len) && netSendAll(fd, "\r\n", 2);
+}
+
+static int jittered(int ms, int jitterMs) {
+    if (jitterMs > 0) ms += (int)((uniform() * 2 - 1) * jitterMs);
+    return ms < 0 ? 0 : ms;
+}
+
+// One sentence per segment, each after its own synthesis delay. A drop
+// cuts the stream after the first segment.
+static bool sendSegments(int fd, int codec, bool drop) {
+    std::vector<std::vector<uint8_t>> parts = segmentAudio(codec, cfg.segments);
+    size_t count = parts.size();
+    for (size_t i = 0; i < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(jittered(cfg.segmentMs, cfg.segmentJitterMs)));
+        char caption[48];
+        int captionLen = snprintf(caption, sizeof(caption), "Sentence %zu of %zu.", i + 1, count);
+        SegmentHeader h = {};
+        h.flags = i + 1 == count ? SEGMENT_LAST : 0;
+        h.codec = (uint8_t)codec;
+        h.seq = (uint16_t)i;
+        h.captionLen = (uint16_t)captionLen;
+        h.audioLen = (uint32_t)parts[i].size();
+        std::vector<uint8_t> frame(SEGMENT_HEADER_LEN);
+        segmentWriteHeader(frame.data(), h);
+        frame.insert(frame.end(), caption, caption + captionLen);
+        frame.insert(frame.end(), parts[i].begin(), parts[i].end());
+        if (!sendChunk(fd, frame.data(), frame.size())) return false;
+        if (drop) return false;
+        if (cfg.bandwidthKbps > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)frame.size() * 8000 / cfg.bandwidthKbps));
+        }
+    }
+    return netSendAll(fd, "0\r\n\r\n", 5);
+}
+
+static void handleConnection(int fd) {
+    timeval tv = { 30, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // Request head: only Content-Length, Accept, X-Audio-Caps and X-Trace-Id matter here
+    SocketReader reader(fd);
+    std::string line, traceId, caps;
+    long contentLength = 0;
+    bool chunked = false;
+    bool segmented = false;
+    bool headDone = false;
+    while (reader.readLine(line)) {
+        if (line == "\r\n" || line == "\n") {
+            headDone = true;
+            break;
+        }
+        if (strncasecmp(line.c_str(), "content-length:", 15) == 0) contentLength = atol(line.c_str() + 15);
+        if (strncasecmp(line.c_str(), "transfer-encoding:", 18) == 0 && strcasestr(line.c_str(), "chunked")) chunked = true;
+        if (strncasecmp(line.c_str(), "accept:", 7) == 0 && strstr(line.c_str(), SEGMENT_CONTENT_TYPE)) segmented = true;
+        if (strncasecmp(line.c_str(), "x-audio-caps:", 13) == 0) caps = line.substr(13);
+        if (strncasecmp(line.c_str(), "x-trace-id:", 11) == 0) {
+            traceId = line.substr(11);
+            while (!traceId.empty() && (traceId[0] == ' ')) traceId.erase(0, 1);
+            while (!traceId.empty() && (traceId.back() == '\r' || traceId.back() == '\n')) traceId.pop_back();
+        }
+    }
+    if (!headDone) {
+        close(fd);
+        return;
+    }
+
+    // Body: fixed length, or chunked from a pre-warmed device connection
+    uint8_t sink[4096];
+    auto discard = [&](long remaining) {
+        while (remaining > 0) {
+            size_t n = reader.read(sink, remaining < (long)sizeof(sink) ? remaining : sizeof(sink));
+            if (n == 0) return false;
+            remaining -= n;
+        }
+        return true;
+    };
+    if (chunked) {
+        for (;;) {
+            if (!reader.readLine(line)) break;
+            long size = strtol(line.c_str(), nullptr, 16);
+            if (size <= 0) {
+                reader.readLine(line); // blank line after the last chunk
+                break;
+            }
+            if (!discard(size) || !reader.readLine(line)) break;
+        }
+    } else {
+        discard(contentLength);
+    }
+
+    // Server think time (Gemini + TTS, or just Gemini when segmented)
+    segmented = segmented && cfg.segments > 0;
+    int delayMs = jittered(cfg.latencyMs, cfg.jitterMs);
+    std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+    double r = uniform();
+    if (r < cfg.errorRate) {
+        errors++;
+        sendJsonError(fd, 500, "Internal Server Error", "Injected failure");
+        close(fd);
+        return;
+    }
+    if (r < cfg.errorRate + cfg.throttleRate) {
+        throttled++;
+        sendJsonError(fd, 429, "Too Many Requests", "Too fast! Slow down.");
+        close(fd);
+        return;
+    }
+    bool drop = r < cfg.errorRate + cfg.throttleRate + cfg.dropRate;
+    int codec = pickCodec(caps);
+    const std::vector<uint8_t>& reply = replies[codec];
+
+    char head[512];
+    int n;
+    if (segmented) {
+        n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\nContent-Type: " SEGMENT_CONTENT_TYPE "\r\n"
+                     "Transfer-Encoding: chunked\r\nServer-Timing: gemini;dur=%d, tts;dur=%d\r\n",
+                     delayMs, cfg.segmentMs);
+    } else {
+        n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                     "Server-Timing: gemini;dur=%d, tts;dur=%d\r\n",
+                     contentType(codec), reply.size(), delayMs * 2 / 3, delayMs - delayMs * 2 / 3);
+    }
+    if (!traceId.empty()) n += snprintf(head + n, sizeof(head) - n, "X-Trace-Id: %s\r\n", traceId.c_str());
+    snprintf(head + n, sizeof(head) - n, "Connection: close\r\n\r\n");
+    if (!sendStr(fd, head)) {
+        close(fd);
+        return;
+    }
+
+    if (segmented) {
+        bool ok = sendSegments(fd, codec, drop);
+        if (drop) dropped++;
+        else if (ok) served++;
+        close(fd);
+        return;
+    }
+
+    // Body, paced in 1 KB chunks when a bandwidth cap is set
+    size_t limit = drop ? reply.size() / 2 : reply.size();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < limit; off += 1024) {
+        size_t len = limit - off < 1024 ? limit - off : 1024;
+        if (!netSendAll(fd, reply.data() + off, len)) break;
+        if (cfg.bandwidthKbps > 0) {
+            auto due = start + std::chrono::microseconds((uint64_t)(off + len) * 8000 / cfg.bandwidthKbps);
+            std::this_thread::sleep_until(due);
+        }
+    }
+    if (drop) dropped++;
+    else served++;
+    close(fd);
+}
+
+static bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) return false;
+        if (a == "--port") cfg.port = atoi(v);
+        else if (a == "--mp3") cfg.mp3Path = v;
+        else if (a == "--latency-ms") cfg.latencyMs = atoi(v);
+        else if (a == "--jitter-ms") cfg.jitterMs = atoi(v);
+        else if (a == "--bandwidth-kbps") cfg.bandwidthKbps = atoi(v);
+        else if (a == "--error-rate") cfg.errorRate = atof(v);
+        else if (a == "--throttle-rate") cfg.throttleRate = atof(v);
+        else if (a == "--drop-rate") cfg.dropRate = atof(v);
+        else if (a == "--segments") cfg.segments = atoi(v);
+        else if (a == "--segment-ms") cfg.segmentMs = atoi(v);
+        else if (a == "--segment-jitter-ms") cfg.segmentJitterMs = atoi(v);
+        else if (a == "--codecs") cfg.codecs = v;
+        else return false;
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        fprintf(stderr, "usage: %s --port P [--mp3 FILE] [--latency-ms MS] [--jitter-ms MS] "
+                        "[--bandwidth-kbps K] [--error-rate R] [--throttle-rate R] [--drop-rate R] "
+                        "[--segments N] [--segment-ms MS] [--segment-jitter-ms MS] [--codecs LIST]\n",
+                argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!cfg.mp3Path.empty()) {
+        FILE* f = fopen(cfg.mp3Path.c_str(), "rb");
+        if (!f) {
+            perror(cfg.mp3Path.c_str());
+            return 1;
+        }
+        uint8_t buf[8192];
+        size_t n;
+        std::vector<uint8_t>& mp3 = replies[SEGMENT_CODEC_MP3];
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) mp3.insert(mp3.end(), buf, buf + n);
+        fclose(f);
+    } else {
+        replies[SEGMENT_CODEC_MP3] = silentMp3();
+    }
+    synthReplies();
+
+    int listenFd = netListen(cfg.port, 512);
+    if (listenFd < 0) {
+        perror("listen");
+        return 1;
+    }
+    fprintf(stderr, "mock /api/interact on :%d, mp3 %zu bytes, latency %d+-%d ms, %d kbps, "
+                    "%d segments at %d+-%d ms, codecs %s\n",
+            cfg.port, replies[SEGMENT_CODEC_MP3].size(), cfg.latencyMs, cfg.jitterMs, cfg.bandwidthKbps,
+            cfg.segments, cfg.segmentMs, cfg.segmentJitterMs, cfg.codecs.c_str());
+
+    std::thread([] {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+            fprintf(stderr, "served=%u 500=%u 429=%u dropped=%u\n",
+                    served.load(), errors.load(), throttled.load(), dropped.load());
+        }
+    }).detach();
+
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::thread(handleConnection, fd).detach();
+    }
+}
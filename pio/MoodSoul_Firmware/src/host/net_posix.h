@@ -0,0 +1,119 @@
+#pragma once
+// ==========================================
+// POSIX SOCKET HELPERS (HOST TOOLS ONLY)
+// ==========================================
+// Just enough plumbing for the load generator and mock server to drive the
+// firmware's request builder and response parser over real TCP.
+#include "../interaction_request.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <string>
+
+// Connects with a timeout. Returns the fd, or -1.
+inline int netConnect(const char* host, int port, int timeoutMs) {
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%d", port);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host, portStr, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        timeval tv = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+inline int netListen(int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, backlog) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool netSendAll(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+struct SocketSink : ByteSink {
+    int fd;
+    explicit SocketSink(int fd) : fd(fd) {}
+    size_t write(const uint8_t* data, size_t len) override {
+        return netSendAll(fd, data, len) ? len : 0;
+    }
+};
+
+// Buffered reader: lines for the head, raw bytes for the body.
+struct SocketReader {
+    int     fd;
+    uint8_t buf[4096];
+    size_t  pos = 0, len = 0;
+    explicit SocketReader(int fd) : fd(fd) {}
+
+    bool fill() {
+        pos = 0;
+        ssize_t n;
+        do {
+            n = recv(fd, buf, sizeof(buf), 0);
+        } while (n < 0 && errno == EINTR);
+        len = n > 0 ? (size_t)n : 0;
+        return n > 0;
+    }
+
+    // Reads up to and including '\n'; false on EOF/timeout before any byte.
+    bool readLine(std::string& line) {
+        line.clear();
+        for (;;) {
+            if (pos == len && !fill()) return !line.empty();
+            uint8_t c = buf[pos++];
+            line.push_back((char)c);
+            if (c == '\n') return true;
+        }
+    }
+
+    // Returns bytes read (0 on EOF/timeout).
+    size_t read(uint8_t* out, size_t cap) {
+        if (pos == len && !fill()) return 0;
+        size_t n = len - pos < cap ? len - pos : cap;
+        memcpy(out, buf + pos, n);
+        pos += n;
+        return n;
+    }
+};
@@ -0,0 +1,155 @@
+// Capture pre-processing harness (env:native-preproc-tool), running
+// audio_preproc.cpp unchanged.
+//
+//   program snr --clean DIR --noise NOISE.wav [--snr-db 0,5,10] [--no-ns] [--no-agc]
+//   program process IN.wav OUT.wav [--no-ns] [--no-agc]
+//
+// `snr` mixes every clean 16 kHz mono WAV with the noise (looped, 0.5 s of
+// noise alone in front so the floor can settle, as the always-on ring
+// has) at each input SNR, runs the chain and reports scale-invariant SNR
+// before and after, plus the time per 10 ms block on this host. The
+// reference is the clean speech through the same DC blocker and high-pass,
+// so their phase shift on low voices isn't scored as noise. AGC gain
+// changes do count as distortion, so use --no-agc to score the suppressor
+// alone.
+#include "../audio_preproc.h"
+#include "wav_io.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static bool useNs = true, useAgc = true;
+static std::vector<double> blockUs;
+
+static void runChain(std::vector<int16_t>& pcm, bool ns, bool agc, bool timed) {
+    static AudioPreproc p;
+    audioPreprocInit(p, ns, agc);
+    pcm.resize(pcm.size() / PREPROC_BLOCK * PREPROC_BLOCK);
+    for (size_t off = 0; off < pcm.size(); off += PREPROC_BLOCK) {
+        auto t0 = Clock::now();
+        audioPreprocRun(p, pcm.data() + off, PREPROC_BLOCK);
+        if (timed) blockUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+    }
+}
+
+// SI-SNR of `est` against `ref`, comparing est[i + delay] with ref[i].
+static double siSnr(const std::vector<int16_t>& ref, const std::vector<int16_t>& est, size_t delay) {
+    double dot = 0.0, rr = 0.0;
+    size_t n = std::min(ref.size(), est.size() - delay);
+    for (size_t i = 0; i < n; i++) {
+        dot += (double)ref[i] * est[i + delay];
+        rr += (double)ref[i] * ref[i];
+    }
+    double a = rr > 0 ? dot / rr : 0.0, sig = 0.0, err = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double s = a * ref[i], e = est[i + delay] - s;
+        sig += s * s;
+        err += e * e;
+    }
+    return 10.0 * log10((sig + 1e-9) / (err + 1e-9));
+}
+
+static void reportTiming() {
+    if (blockUs.empty()) return;
+    std::vector<double> v = blockUs;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    printf("per 10 ms block: %.1f us mean, %.1f us p95, %.1f us max (%zu blocks; device budget %d cycles = %d us at 240 MHz)\n",
+           sum / v.size(), v[v.size() * 95 / 100], v.back(), v.size(), PREPROC_BLOCK_CYCLE_BUDGET,
+           PREPROC_BLOCK_CYCLE_BUDGET / 240);
+}
+
+static int cmdSnr(int argc, char** argv) {
+    const char *cleanDir = nullptr, *noisePath = nullptr;
+    std::vector<double> snrs = { 0.0, 5.0, 10.0 };
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--clean") && i + 1 < argc) cleanDir = argv[++i];
+        else if (!strcmp(argv[i], "--noise") && i + 1 < argc) noisePath = argv[++i];
+        else if (!strcmp(argv[i], "--snr-db") && i + 1 < argc) {
+            snrs.clear();
+            for (char* tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ",")) snrs.push_back(atof(tok));
+        } else if (!strcmp(argv[i], "--no-ns")) useNs = false;
+        else if (!strcmp(argv[i], "--no-agc")) useAgc = false;
+    }
+    std::vector<int16_t> noise;
+    if (!cleanDir || !noisePath || !readWav(noisePath, noise) || noise.empty()) {
+        fprintf(stderr, "snr needs --clean DIR and a readable --noise WAV\n");
+        return 2;
+    }
+
+    const size_t lead = PREPROC_RATE / 2;
+    const size_t delay = useNs ? PREPROC_BLOCK : 0;
+    std::vector<std::string> files = listWavs(cleanDir);
+    printf("%zu clean clips, ns=%d agc=%d\n", files.size(), useNs, useAgc);
+    printf("%8s %12s %12s %12s\n", "SNR dB", "SI-SNR in", "SI-SNR out", "gain dB");
+    size_t noiseOff = 0;
+    for (double snr : snrs) {
+        double inSum = 0.0, outSum = 0.0;
+        int clips = 0;
+        for (const std::string& path : files) {
+            std::vector<int16_t> clean;
+            if (!readWav(path, clean) || clean.empty()) continue;
+            double ce = 0.0, ne = 0.0;
+            for (size_t i = 0; i < clean.size(); i++) {
+                double nv = noise[(noiseOff + lead + i) % noise.size()];
+                ce += (double)clean[i] * clean[i];
+                ne += nv * nv;
+            }
+            double scale = ne > 0 ? sqrt(ce / ne / pow(10.0, snr / 10.0)) : 0.0;
+
+            std::vector<int16_t> ref(lead + clean.size(), 0);
+            std::vector<int16_t> mix(ref.size());
+            for (size_t i = 0; i < mix.size(); i++) {
+                if (i >= lead) ref[i] = clean[i - lead];
+                double v = ref[i] + scale * noise[(noiseOff + i) % noise.size()];
+                mix[i] = (int16_t)std::max(-32768.0, std::min(32767.0, v));
+            }
+            noiseOff += clean.size();
+
+            // Score only the speech part, after the settling lead-in; the
+            // input score is the mix through the same filters
+            std::vector<int16_t> mixFiltered = mix;
+            runChain(ref, false, false, false);
+            runChain(mixFiltered, false, false, false);
+            runChain(mix, useNs, useAgc, true);
+            std::vector<int16_t> mixSpeech(mixFiltered.begin() + lead, mixFiltered.end());
+            std::vector<int16_t> refSpeech(ref.begin() + lead, ref.end());
+            std::vector<int16_t> outSpeech(mix.begin() + lead, mix.end());
+            inSum += siSnr(refSpeech, mixSpeech, 0);
+            outSum += siSnr(refSpeech, outSpeech, delay);
+            clips++;
+        }
+        if (clips) printf("%8.1f %12.2f %12.2f %12.2f\n", snr, inSum / clips, outSum / clips, (outSum - inSum) / clips);
+    }
+    reportTiming();
+    return 0;
+}
+
+static int cmdProcess(int argc, char** argv) {
+    for (int i = 4; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-ns")) useNs = false;
+        else if (!strcmp(argv[i], "--no-agc")) useAgc = false;
+    }
+    std::vector<int16_t> pcm;
+    if (!readWav(argv[2], pcm)) return 1;
+    runChain(pcm, useNs, useAgc, true);
+    if (!writeWav(argv[3], pcm)) {
+        perror(argv[3]);
+        return 1;
+    }
+    reportTiming();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[1], "snr")) return cmdSnr(argc, argv);
+    if (argc >= 4 && !strcmp(argv[1], "process")) return cmdProcess(argc, argv);
+    fprintf(stderr, "usage: %s snr --clean DIR --noise NOISE.wav [--snr-db 0,5,10] [--no-ns] [--no-agc]\n"
+                    "       %s process IN.wav OUT.wav [--no-ns] [--no-agc]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,222 @@
+// Lock-free ring stress test and throughput check (env:native-ring-stress).
+//
+//   program [--items N] [--producers P] [--capacity C] [--seconds S]
+//
+// Runs producer and consumer threads flat out against lockfree_ring.h:
+// SPSC through random-length writeSpan()/readSpan() runs, MPSC with P
+// producers pushing single items and short spans. Every item carries its
+// producer and sequence number, so a lost, duplicated, torn or reordered
+// item fails the run. The same traffic through a mutex-guarded ring
+// (what a FreeRTOS queue does per item) is timed alongside for scale.
+// Exits non-zero on the first violation.
+#include "../lockfree_ring.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+struct Item {
+    uint32_t producer;
+    uint32_t seq;
+    uint32_t check; // seq ^ producer * odd constant, catches torn copies
+};
+
+static uint32_t itemCheck(uint32_t producer, uint32_t seq) {
+    return seq ^ (producer * 0x9E3779B1u);
+}
+
+static uint32_t xorshift(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+static double seconds(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static bool report(const char* name, uint64_t items, double secs, uint64_t errors) {
+    printf("%-24s %10.1f Mitems/s  %s\n", name, items / secs / 1e6, errors ? "FAIL" : "ok");
+    return errors == 0;
+}
+
+// ==========================================
+// SPSC: random span lengths on both sides
+// ==========================================
+static bool runSpsc(uint32_t capacity, uint64_t items) {
+    SpscRing<Item> ring;
+    std::vector<uint8_t> mem(SpscRing<Item>::bytesFor(capacity));
+    ring.init(mem.data(), capacity);
+    std::atomic<uint64_t> errors{0};
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        uint32_t rnd = 1;
+        uint64_t next = 0;
+        Item* span;
+        while (next < items) {
+            uint32_t k = ring.writeSpan(&span, 1 + xorshift(rnd) % 64);
+            if (k > items - next) k = (uint32_t)(items - next);
+            for (uint32_t i = 0; i < k; i++) {
+                uint32_t s = (uint32_t)(next + i);
+                span[i] = { 0, s, itemCheck(0, s) };
+            }
+            if (k) ring.commitWrite(k);
+            else std::this_thread::yield(); // full: single-core hosts need the consumer to run
+            next += k;
+        }
+    });
+    uint32_t rnd = 7;
+    uint64_t seen = 0;
+    const Item* span;
+    while (seen < items) {
+        uint32_t k = ring.readSpan(&span, 1 + xorshift(rnd) % 64);
+        for (uint32_t i = 0; i < k; i++) {
+            uint32_t s = (uint32_t)(seen + i);
+            if (span[i].seq != s || span[i].check != itemCheck(0, s)) errors++;
+        }
+        if (k) ring.commitRead(k);
+        else std::this_thread::yield();
+        seen += k;
+    }
+    producer.join();
+    if (ring.size() != 0) errors++;
+    return report("spsc spans", items, seconds(t0), errors);
+}
+
+// ==========================================
+// MPSC: P producers, items and short spans
+// ==========================================
+static bool runMpsc(uint32_t capacity, uint64_t items, uint32_t producers) {
+    MpscRing<Item> ring;
+    std::vector<uint8_t> mem(MpscRing<Item>::bytesFor(capacity));
+    ring.init(mem.data(), capacity);
+    uint64_t perProducer = items / producers;
+    std::atomic<uint64_t> errors{0};
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            uint32_t rnd = 11 + p;
+            uint64_t next = 0;
+            while (next < perProducer) {
+                Item* span;
+                uint32_t pos;
+                uint32_t want = (xorshift(rnd) & 3) ? 1 : 1 + xorshift(rnd) % 16;
+                if (want > perProducer - next) want = (uint32_t)(perProducer - next);
+                uint32_t k = ring.reserve(&span, &pos, want);
+                for (uint32_t i = 0; i < k; i++) {
+                    uint32_t s = (uint32_t)(next + i);
+                    span[i] = { p, s, itemCheck(p, s) };
+                }
+                if (k) ring.commit(pos, k);
+                else std::this_thread::yield();
+                next += k;
+            }
+        });
+    }
+    std::vector<uint64_t> expect(producers, 0);
+    uint64_t total = perProducer * producers, seen = 0;
+    const Item* span;
+    while (seen < total) {
+        uint32_t k = ring.readSpan(&span);
+        for (uint32_t i = 0; i < k; i++) {
+            const Item& it = span[i];
+            // Per producer, items arrive in the order they were pushed
+            if (it.producer >= producers || it.seq != (uint32_t)expect[it.producer] ||
+                it.check != itemCheck(it.producer, it.seq)) {
+                errors++;
+                if (it.producer < producers) expect[it.producer] = it.seq;
+            }
+            if (it.producer < producers) expect[it.producer]++;
+        }
+        if (k) ring.commitRead(k);
+        else std::this_thread::yield();
+        seen += k;
+    }
+    for (auto& t : threads) t.join();
+    for (uint32_t p = 0; p < producers; p++) {
+        if (expect[p] != perProducer) errors++;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "mpsc %u producers", producers);
+    return report(name, total, seconds(t0), errors);
+}
+
+// ==========================================
+// BASELINE: mutex around every item
+// ==========================================
+static bool runLocked(uint32_t capacity, uint64_t items) {
+    std::vector<Item> buf(capacity);
+    uint32_t head = 0, tail = 0;
+    std::mutex lock;
+    std::atomic<uint64_t> errors{0};
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint64_t next = 0; next < items;) {
+            {
+                std::lock_guard<std::mutex> g(lock);
+                if (head - tail != capacity) {
+                    uint32_t s = (uint32_t)next++;
+                    buf[head++ & (capacity - 1)] = { 0, s, itemCheck(0, s) };
+                    continue;
+                }
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (uint64_t seen = 0; seen < items;) {
+        {
+            std::lock_guard<std::mutex> g(lock);
+            if (head != tail) {
+                const Item& it = buf[tail++ & (capacity - 1)];
+                if (it.seq != (uint32_t)seen++) errors++;
+                continue;
+            }
+        }
+        std::this_thread::yield();
+    }
+    producer.join();
+    return report("mutex per item", items, seconds(t0), errors);
+}
+
+int main(int argc, char** argv) {
+    uint64_t items = 20000000;
+    uint32_t producers = 4, capacity = 1024;
+    double duration = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--items") && i + 1 < argc) items = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--producers") && i + 1 < argc) producers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--capacity") && i + 1 < argc) capacity = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) duration = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--items N] [--producers P] [--capacity C] [--seconds S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!capacity || (capacity & (capacity - 1)) || !producers || !items) {
+        fprintf(stderr, "capacity must be a power of two; producers and items non-zero\n");
+        return 2;
+    }
+
+    // --seconds repeats the rounds until the time is up (soak)
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = true;
+    int rounds = 0;
+    do {
+        ok = runSpsc(capacity, items) && ok;
+        ok = runMpsc(capacity, items, producers) && ok;
+        ok = runMpsc(capacity, items, 1) && ok;
+        if (!rounds) ok = runLocked(capacity, items / 4) && ok;
+        rounds++;
+    } while (ok && seconds(t0) < duration);
+    printf("%d round%s, %s\n", rounds, rounds == 1 ? "" : "s", ok ? "all ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Telemetry blob check (env:native-telemetry-check).
+//
+//   program
+//
+// Encodes a worst-case interval (every stage spread over every bucket at
+// full counts, every counter, heap and RSSI, a long firmware string) and a
+// typical one, and walks the CBOR: the blob must stay within
+// TELEMETRY_MAX_BYTES and be well formed, the user-facing stages must be
+// the ones that go in, and the stages left out must still be there after
+// the commit and go out with the next heartbeat. Exits non-zero if any
+// check fails.
+#include "../telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Minimal CBOR walk: the item at p, its end, and (for the top map) the
+// stage keys in map 11. False on anything the encoder shouldn't write.
+struct Walk {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint32_t       stages; // bit per key in map 11
+
+    bool arg(uint8_t ai, uint32_t& v) {
+        if (ai < 24) v = ai;
+        else if (ai == 24 && p < end) v = *p++;
+        else if (ai == 25 && end - p >= 2) v = p[0] << 8 | p[1], p += 2;
+        else if (ai == 26 && end - p >= 4) v = (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3], p += 4;
+        else return false;
+        return true;
+    }
+    bool item(int depth, int key) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        uint8_t major = b >> 5, ai = b & 31;
+        uint32_t v;
+        if (major == 5 && ai == 31) {
+            // Indefinite map of integer keys
+            for (;;) {
+                if (p >= end) return false;
+                if (*p == 0xFF) {
+                    p++;
+                    return true;
+                }
+                const uint8_t* k = p;
+                uint32_t kv;
+                if ((*k >> 5) != 0) return false;
+                p++;
+                if (!arg(*k & 31, kv)) return false;
+                if (depth == 1 && key == 11) stages |= 1u << kv;
+                if (!item(depth + 1, (int)kv)) return false;
+            }
+        }
+        if (!arg(ai, v)) return false;
+        if (major == 0 || major == 1) return true;
+        if (major == 3) {
+            if ((uint32_t)(end - p) < v) return false;
+            p += v;
+            return true;
+        }
+        if (major == 4) {
+            for (uint32_t i = 0; i < v; i++) {
+                if (!item(depth + 1, -1)) return false;
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+static bool wellFormed(const uint8_t* blob, size_t len, uint32_t& stages) {
+    Walk w = { blob, blob + len, 0 };
+    bool ok = w.item(0, -1) && w.p == w.end;
+    stages = w.stages;
+    return ok;
+}
+
+static void fill(Telemetry& t, bool wide) {
+    telemetryInit(t, 0);
+    t.seq = 123456;
+    t.turns = t.failedTurns = 60000;
+    for (int st = 0; st < TELE_STAGE_COUNT; st++) {
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+            if (wide || (b >= 10 && b < 14)) t.stages[st].counts[b] = wide ? 65000 : 3;
+        }
+        t.stages[st].maxMs = wide ? 4000000000u : 900;
+    }
+    uint32_t values[TELE_COUNTER_COUNT];
+    for (int c = 0; c < TELE_COUNTER_COUNT; c++) values[c] = wide ? 4000000000u : 2;
+    telemetryCounters(t, values);
+    telemetrySample(t, 4000000000u, 4000000000u, 4000000000u, -90);
+    telemetrySample(t, 4000000000u, 4000000000u, 4000000000u, -30);
+}
+
+int main() {
+    static const TelemetryStage USER_FACING[] = { TELE_REPLY, TELE_PLAYBACK };
+    uint8_t blob[TELEMETRY_MAX_BYTES];
+    char firmware[64];
+    memset(firmware, '9', sizeof(firmware) - 1);
+    firmware[sizeof(firmware) - 1] = '\0';
+    TelemetryInfo info = { firmware, 4000000000u, 255 };
+
+    Telemetry t;
+    fill(t, true);
+    uint32_t sent, walked;
+    size_t len = telemetryEncode(t, 4000000000u, info, blob, sizeof(blob), &sent);
+    printf("worst case %zu bytes, stages sent 0x%02x\n", len, (unsigned)sent);
+    check(len > 0 && len <= TELEMETRY_MAX_BYTES, "worst case within TELEMETRY_MAX_BYTES");
+    check(wellFormed(blob, len, walked), "worst case is well-formed CBOR");
+    check(walked == sent, "stages in the blob match stagesSent");
+    bool facing = true;
+    for (TelemetryStage st : USER_FACING) facing &= (sent >> st) & 1;
+    check(facing, "user-facing stages go in first");
+    check(sent != (1u << TELE_STAGE_COUNT) - 1, "worst case drops some stages");
+
+    // Delivered: what was left out stays for the next heartbeat
+    Telemetry snap = t;
+    telemetryCommit(t, snap, sent, 60000);
+    bool kept = true;
+    for (int st = 0; st < TELE_STAGE_COUNT; st++) {
+        bool any = false;
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) any |= t.stages[st].counts[b] != 0;
+        kept &= any == !((sent >> st) & 1);
+    }
+    check(kept, "commit keeps only the stages left out");
+    uint32_t next;
+    len = telemetryEncode(t, 120000, info, blob, sizeof(blob), &next);
+    check(len && wellFormed(blob, len, walked) && walked == (((1u << TELE_STAGE_COUNT) - 1) & ~sent),
+          "left-out stages go with the next heartbeat");
+
+    fill(t, false);
+    len = telemetryEncode(t, 60000, info, blob, sizeof(blob), &sent);
+    printf("typical %zu bytes\n", len);
+    check(len && wellFormed(blob, len, walked) && walked == (1u << TELE_STAGE_COUNT) - 1,
+          "typical interval: every stage fits");
+
+    len = telemetryEncode(t, 60000, info, blob, 8, &sent);
+    check(len == 0 && sent == 0, "no room for the fixed part: nothing");
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+// 16 kHz mono PCM16 WAV reading/writing and directory listing for the
+// host audio tools. Header-only.
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static inline uint32_t wavLe32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static inline uint16_t wavLe16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+// Anything but `rate` Hz mono 16-bit PCM is reported and rejected.
+static inline bool readWav(const std::string& path, std::vector<int16_t>& out, uint32_t rate = 16000) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot read\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> b;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) b.insert(b.end(), buf, buf + n);
+    fclose(f);
+
+    if (b.size() < 12 || memcmp(b.data(), "RIFF", 4) || memcmp(b.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path.c_str());
+        return false;
+    }
+    bool fmtOk = false;
+    size_t off = 12;
+    while (off + 8 <= b.size()) {
+        uint32_t size = wavLe32(b.data() + off + 4);
+        const uint8_t* body = b.data() + off + 8;
+        size_t avail = std::min<size_t>(size, b.size() - off - 8);
+        if (!memcmp(b.data() + off, "fmt ", 4) && avail >= 16) {
+            fmtOk = wavLe16(body) == 1 && wavLe16(body + 2) == 1 && wavLe32(body + 4) == rate &&
+                    wavLe16(body + 14) == 16;
+        } else if (!memcmp(b.data() + off, "data", 4)) {
+            if (!fmtOk) break;
+            out.resize(avail / 2);
+            for (size_t i = 0; i < out.size(); i++) out[i] = (int16_t)wavLe16(body + 2 * i);
+            return true;
+        }
+        off += 8 + size + (size & 1);
+    }
+    fprintf(stderr, "%s: need %u Hz mono 16-bit PCM\n", path.c_str(), (unsigned)rate);
+    return false;
+}
+
+static inline bool writeWav(const std::string& path, const std::vector<int16_t>& pcm, uint32_t rate = 16000) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    uint32_t dataLen = (uint32_t)pcm.size() * 2;
+    uint8_t h[44];
+    auto put32 = [&](int at, uint32_t v) { for (int i = 0; i < 4; i++) h[at + i] = (uint8_t)(v >> (8 * i)); };
+    auto put16 = [&](int at, uint16_t v) { h[at] = (uint8_t)v; h[at + 1] = (uint8_t)(v >> 8); };
+    memcpy(h, "RIFF", 4);
+    put32(4, 36 + dataLen);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);
+    put16(22, 1);
+    put32(24, rate);
+    put32(28, rate * 2);
+    put16(32, 2);
+    put16(34, 16);
+    memcpy(h + 36, "data", 4);
+    put32(40, dataLen);
+    bool ok = fwrite(h, 1, sizeof(h), f) == sizeof(h);
+    for (int16_t s : pcm) {
+        uint8_t le[2] = { (uint8_t)s, (uint8_t)((uint16_t)s >> 8) };
+        ok = ok && fwrite(le, 1, 2, f) == 2;
+    }
+    return fclose(f) == 0 && ok;
+}
+
+// Sorted *.wav paths in dir.
+static inline std::vector<std::string> listWavs(const char* dir) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return files;
+    }
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0) {
+            files.push_back(std::string(dir) + "/" + name);
+        }
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+}
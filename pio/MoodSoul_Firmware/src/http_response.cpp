@@ -0,0 +1,111 @@
+#include "http_response.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void httpHeadReset(HttpResponseHead& head) {
+    memset(&head, 0, sizeof(head));
+    head.contentLength = -1;
+    head.quotaRemaining = -1;
+    head.retryAfterS = -1;
+}
+
+static void copyValue(char* dst, size_t cap, const char* line, size_t len, const char* v) {
+    size_t n = len - (v - line);
+    if (n >= cap) n = cap - 1;
+    memcpy(dst, v, n);
+    dst[n] = '\0';
+}
+
+// Case-insensitive "name:" match, returns pointer to the trimmed value.
+static const char* headerValue(const char* line, size_t len, const char* name) {
+    size_t n = strlen(name);
+    if (len <= n || line[n] != ':') return nullptr;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)line[i]) != name[i]) return nullptr;
+    }
+    const char* v = line + n + 1;
+    while (*v == ' ' || *v == '\t') v++;
+    return v;
+}
+
+// Server-Timing: gemini;dur=812.3, tts;dur=420
+static uint32_t serverTimingDur(const char* value, const char* metric) {
+    size_t n = strlen(metric);
+    const char* p = value;
+    while ((p = strstr(p, metric)) != nullptr) {
+        bool startOk = (p == value) || p[-1] == ' ' || p[-1] == ',';
+        if (startOk && p[n] == ';') {
+            const char* dur = strstr(p, "dur=");
+            const char* comma = strchr(p, ',');
+            if (dur && (!comma || dur < comma)) return (uint32_t)atof(dur + 4);
+        }
+        p += n;
+    }
+    return 0;
+}
+
+uint32_t httpDateParse(const char* value) {
+    static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char mon[4] = {};
+    int d, y, hh, mm, ss;
+    const char* comma = strchr(value, ',');
+    if (!comma || sscanf(comma + 1, " %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) return 0;
+    const char* m = strstr(MONTHS, mon);
+    if (!m || strlen(mon) != 3 || (m - MONTHS) % 3 || y < 1970) return 0;
+    // Days from civil (proleptic Gregorian), March-based year
+    int month = (int)(m - MONTHS) / 3 + 1;
+    int yy = month <= 2 ? y - 1 : y;
+    int era = yy / 400;
+    int yoe = yy - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = (long)era * 146097 + doe - 719468;
+    return (uint32_t)(days * 86400 + hh * 3600 + mm * 60 + ss);
+}
+
+bool httpHeadFeedLine(HttpResponseHead& head, const char* line, size_t len) {
+    if (head.complete) return true;
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+
+    if (head.status == 0) {
+        // "HTTP/1.1 200 OK"
+        if (len > 9 && strncmp(line, "HTTP/", 5) == 0) {
+            const char* sp = (const char*)memchr(line, ' ', len);
+            if (sp) head.status = atoi(sp + 1);
+        }
+        if (head.status == 0 && len == 0) head.complete = true;
+        return head.complete;
+    }
+
+    if (len == 0) {
+        head.complete = true;
+        return true;
+    }
+
+    const char* v;
+    if ((v = headerValue(line, len, "content-length"))) {
+        head.contentLength = atol(v);
+    } else if ((v = headerValue(line, len, "transfer-encoding"))) {
+        head.chunked = strstr(v, "chunked") != nullptr;
+    } else if ((v = headerValue(line, len, "content-type"))) {
+        copyValue(head.contentType, sizeof(head.contentType), line, len, v);
+    } else if ((v = headerValue(line, len, "server-timing"))) {
+        head.serverGeminiMs = serverTimingDur(v, "gemini");
+        head.serverTtsMs = serverTimingDur(v, "tts");
+    } else if ((v = headerValue(line, len, "x-persona-id"))) {
+        copyValue(head.persona, sizeof(head.persona), line, len, v);
+    } else if ((v = headerValue(line, len, "x-feature"))) {
+        copyValue(head.feature, sizeof(head.feature), line, len, v);
+    } else if ((v = headerValue(line, len, "x-quota-remaining"))) {
+        head.quotaRemaining = atol(v);
+    } else if ((v = headerValue(line, len, "x-quota-reset-in"))) {
+        head.quotaResetS = (uint32_t)atol(v);
+    } else if ((v = headerValue(line, len, "retry-after"))) {
+        if (isdigit((unsigned char)*v)) head.retryAfterS = atol(v);
+    } else if ((v = headerValue(line, len, "date"))) {
+        head.serverTimeS = httpDateParse(v);
+    }
+    return false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// HTTP RESPONSE HEAD PARSER
+// ==========================================
+// Fed one NUL-terminated line at a time (with or without the trailing
+// "\r"), so it works with readStringUntil('\n') on the device and with
+// plain sockets on host.
+
+struct HttpResponseHead {
+    int      status;        // 0 until the status line is seen
+    long     contentLength; // -1 if absent
+    bool     chunked;       // Transfer-Encoding: chunked (reply_segments.h decodes it)
+    uint32_t serverGeminiMs; // Server-Timing: gemini;dur=..
+    uint32_t serverTtsMs;    // Server-Timing: tts;dur=..
+    char     contentType[48];
+    char     persona[40];       // X-Persona-Id, "" if absent
+    char     feature[16];       // X-Feature (dashboard app), "" if absent
+    int32_t  quotaRemaining;    // X-Quota-Remaining, -1 if absent
+    uint32_t quotaResetS;       // X-Quota-Reset-In: seconds to the daily reset
+    int32_t  retryAfterS;       // Retry-After (delta-seconds form), -1 if absent
+    uint32_t serverTimeS;       // Date, Unix seconds, 0 if absent
+    bool     complete;       // blank line reached
+};
+
+void httpHeadReset(HttpResponseHead& head);
+// Returns true once the blank line ending the head has been fed.
+bool httpHeadFeedLine(HttpResponseHead& head, const char* line, size_t len);
+// "Sun, 18 Oct 2026 09:30:00 GMT" to Unix seconds, 0 if malformed.
+uint32_t httpDateParse(const char* value);
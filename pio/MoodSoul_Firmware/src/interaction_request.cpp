@@ -0,0 +1,134 @@
+#include "interaction_request.h"
+#include "reply_segments.h"
+#include <stdio.h>
+#include <string.h>
+
+// Part headers before the image (or audio, when there is no image).
+static int formatHead(char* out, size_t cap, const InteractionParts& p) {
+    int len = snprintf(out, cap,
+                       "--%s\r\n"
+                       "Content-Disposition: form-data; name=\"deviceId\"\r\n\r\n"
+                       "%s\r\n",
+                       p.boundary, p.deviceId ? p.deviceId : "");
+    if (p.trigger && p.trigger[0]) {
+        len += snprintf(out + len, cap - len,
+                        "--%s\r\n"
+                        "Content-Disposition: form-data; name=\"trigger\"\r\n\r\n"
+                        "%s\r\n",
+                        p.boundary, p.trigger);
+    }
+    if (p.image) {
+        len += snprintf(out + len, cap - len,
+                        "--%s\r\n"
+                        "Content-Disposition: form-data; name=\"image\"; filename=\"capture.jpg\"\r\n"
+                        "Content-Type: image/jpeg\r\n\r\n",
+                        p.boundary);
+    }
+    return len;
+}
+
+// Closes the image part (if any) and opens the audio part.
+static int formatMid(char* out, size_t cap, const InteractionParts& p) {
+    return snprintf(out, cap,
+                    "%s--%s\r\n"
+                    "Content-Disposition: form-data; name=\"audio\"; filename=\"audio.pcm\"\r\n"
+                    "Content-Type: application/octet-stream\r\n\r\n",
+                    p.image ? "\r\n" : "", p.boundary);
+}
+
+static int formatTail(char* out, size_t cap, const InteractionParts& p) {
+    return snprintf(out, cap, "\r\n--%s--\r\n", p.boundary);
+}
+
+size_t interactionBodyLength(const InteractionParts& p) {
+    char buf[512];
+    size_t len = formatHead(buf, sizeof(buf), p);
+    len += formatMid(buf, sizeof(buf), p);
+    len += formatTail(buf, sizeof(buf), p);
+    return len + (p.image ? p.imageLen : 0) + p.audioLen;
+}
+
+static bool writeAll(ByteSink& sink, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = len > INTERACTION_CHUNK_SIZE ? INTERACTION_CHUNK_SIZE : len;
+        if (sink.write(data, n) != n) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeStr(ByteSink& sink, const char* s, int len) {
+    return len >= 0 && sink.write((const uint8_t*)s, len) == (size_t)len;
+}
+
+static int formatRequestHead(char* out, size_t cap, const InteractionParts& p, bool chunked) {
+    int len = snprintf(out, cap, "POST %s HTTP/1.1\r\nHost: %s\r\n", p.path, p.host);
+    if (chunked) {
+        len += snprintf(out + len, cap - len, "Transfer-Encoding: chunked\r\n");
+    } else {
+        len += snprintf(out + len, cap - len, "Content-Length: %u\r\n", (unsigned)interactionBodyLength(p));
+    }
+    len += snprintf(out + len, cap - len, "Content-Type: multipart/form-data; boundary=%s\r\n", p.boundary);
+    // Sentence-by-sentence reply if the server can; one MP3 otherwise
+    len += snprintf(out + len, cap - len, "Accept: " SEGMENT_CONTENT_TYPE ", audio/mpeg\r\n");
+    if (p.traceId && p.traceId[0]) {
+        len += snprintf(out + len, cap - len, "X-Trace-Id: %s\r\n", p.traceId);
+    }
+    if (p.audioCaps && p.audioCaps[0]) {
+        len += snprintf(out + len, cap - len, "X-Audio-Caps: %s\r\n", p.audioCaps);
+    }
+    len += snprintf(out + len, cap - len, "\r\n");
+    return len;
+}
+
+static bool writeBody(ByteSink& sink, const InteractionParts& p) {
+    char buf[512];
+    if (!writeStr(sink, buf, formatHead(buf, sizeof(buf), p))) return false;
+    if (p.image && !writeAll(sink, p.image, p.imageLen)) return false;
+    if (!writeStr(sink, buf, formatMid(buf, sizeof(buf), p))) return false;
+    if (!writeAll(sink, p.audio, p.audioLen)) return false;
+    return writeStr(sink, buf, formatTail(buf, sizeof(buf), p));
+}
+
+bool interactionWriteRequest(ByteSink& sink, const InteractionParts& p) {
+    char buf[512];
+    if (!writeStr(sink, buf, formatRequestHead(buf, sizeof(buf), p, false))) return false;
+    return writeBody(sink, p);
+}
+
+// Frames every write as one HTTP/1.1 chunk, emitted with a single inner
+// write so each chunk stays one TLS record.
+struct ChunkedSink : ByteSink {
+    ByteSink& inner;
+    uint8_t   frame[INTERACTION_CHUNK_SIZE + 16];
+    explicit ChunkedSink(ByteSink& s) : inner(s) {}
+    size_t write(const uint8_t* data, size_t len) override {
+        if (len == 0) return 0;
+        if (len > INTERACTION_CHUNK_SIZE) {
+            size_t done = 0;
+            while (done < len) {
+                size_t n = len - done > INTERACTION_CHUNK_SIZE ? INTERACTION_CHUNK_SIZE : len - done;
+                if (write(data + done, n) != n) return done;
+                done += n;
+            }
+            return len;
+        }
+        int n = snprintf((char*)frame, sizeof(frame), "%x\r\n", (unsigned)len);
+        memcpy(frame + n, data, len);
+        memcpy(frame + n + len, "\r\n", 2);
+        size_t total = n + len + 2;
+        return inner.write(frame, total) == total ? len : 0;
+    }
+};
+
+bool interactionWriteChunkedHead(ByteSink& sink, const InteractionParts& p) {
+    char buf[512];
+    return writeStr(sink, buf, formatRequestHead(buf, sizeof(buf), p, true));
+}
+
+bool interactionWriteChunkedBody(ByteSink& sink, const InteractionParts& p) {
+    ChunkedSink chunked(sink);
+    if (!writeBody(chunked, p)) return false;
+    return sink.write((const uint8_t*)"0\r\n\r\n", 5) == 5;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// INTERACTION REQUEST BUILDER
+// ==========================================
+// Streams the multipart POST to /api/interact through any ByteSink, so the
+// device (WiFiClientSecure) and host tools (sockets, benchmarks) share one
+// implementation of the wire format.
+
+struct ByteSink {
+    // Returns bytes accepted; anything short of `len` aborts the request.
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+    virtual ~ByteSink() {}
+};
+
+#if defined(ARDUINO)
+#include <Client.h>
+
+// Adapts an Arduino Client to the request builder.
+struct ClientSink : ByteSink {
+    Client& client;
+    explicit ClientSink(Client& c) : client(c) {}
+    size_t write(const uint8_t* data, size_t len) override { return client.write(data, len); }
+};
+#endif
+
+struct InteractionParts {
+    const char*    host;
+    const char*    path;
+    const char*    boundary;  // unique per request
+    const char*    deviceId;
+    const char*    trigger;   // "" or nullptr for a normal touch turn
+    const char*    traceId;   // "" or nullptr to omit X-Trace-Id
+    const char*    audioCaps; // X-Audio-Caps (reply_decoder.h), "" or nullptr to omit
+    const uint8_t* image;     // JPEG, nullptr when there is no frame
+    size_t         imageLen;
+    const uint8_t* audio;     // 16-bit PCM
+    size_t         audioLen;
+};
+
+#define INTERACTION_CHUNK_SIZE 1024
+
+// Length of the multipart body (what goes in Content-Length).
+size_t interactionBodyLength(const InteractionParts& p);
+
+// Writes request line, headers and body. Returns false on a short write.
+bool interactionWriteRequest(ByteSink& sink, const InteractionParts& p);
+
+// Split form for connections opened before the payload exists: the head
+// needs only host, path, boundary, traceId and audioCaps and declares
+// "Transfer-Encoding: chunked"; the body then goes out as chunks.
+bool interactionWriteChunkedHead(ByteSink& sink, const InteractionParts& p);
+bool interactionWriteChunkedBody(ByteSink& sink, const InteractionParts& p);
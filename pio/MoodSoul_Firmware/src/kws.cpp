@@ -0,0 +1,54 @@
+#include "kws.h"
+#include <string.h>
+
+void kwsInit(KwsDetector& k, KwsModel* model) {
+    kwsFrontendInit();
+    k.model = model;
+    kwsReset(k);
+}
+
+void kwsReset(KwsDetector& k) {
+    kwsFrontendReset(k.fe);
+    k.filled = 0;
+    k.sinceInfer = 0;
+    k.recentPos = 0;
+    k.recentCount = 0;
+}
+
+KwsResult kwsPush(KwsDetector& k, const int16_t* hop) {
+    KwsResult r = { false, 0.0f };
+    int16_t mfcc[KWS_MFCC];
+    kwsFrontendFrame(k.fe, hop, mfcc);
+
+    // Slide by one frame (490 bytes, cheaper than indexing a ring in the model)
+    memmove(k.window, k.window + KWS_MFCC, (KWS_FRAMES - 1) * KWS_MFCC);
+    kwsModelQuantize(*k.model, mfcc, k.window + (KWS_FRAMES - 1) * KWS_MFCC);
+    if (k.filled < KWS_FRAMES) k.filled++;
+
+    if (k.filled < KWS_FRAMES || ++k.sinceInfer < KWS_INFER_EVERY) return r;
+    k.sinceInfer = 0;
+
+    k.recent[k.recentPos] = kwsModelRun(*k.model, k.window);
+    k.recentPos = (k.recentPos + 1) % KWS_SMOOTH;
+    if (k.recentCount < KWS_SMOOTH) k.recentCount++;
+    float sum = 0.0f;
+    for (int i = 0; i < k.recentCount; i++) sum += k.recent[i];
+    r.ran = true;
+    r.score = sum / k.recentCount;
+    return r;
+}
+
+void kwsTriggerInit(KwsTrigger& t, float threshold) {
+    t.threshold = threshold;
+    t.quietHops = 0;
+}
+
+bool kwsTriggerUpdate(KwsTrigger& t, const KwsResult& r) {
+    if (t.quietHops > 0) {
+        t.quietHops--;
+        return false;
+    }
+    if (!r.ran || r.score < t.threshold) return false;
+    t.quietHops = KWS_REFRACTORY;
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "kws_frontend.h"
+#include "kws_model.h"
+
+// ==========================================
+// KEYWORD SPOTTER
+// ==========================================
+// Streams 20 ms hops through the front end into a sliding window of
+// KWS_FRAMES quantized frames, runs the model every KWS_INFER_EVERY hops
+// once the window is full, and averages the last few keyword
+// probabilities. KwsTrigger turns that score stream into detections; it is
+// separate so the host harness can sweep thresholds over one pass.
+
+#define KWS_INFER_EVERY  2   // 40 ms between inferences
+#define KWS_SMOOTH       3   // inferences averaged into the score
+#define KWS_REFRACTORY   50  // hops (1 s) of silence after a detection
+
+struct KwsDetector {
+    KwsFrontend fe;
+    KwsModel*   model;
+    int8_t      window[KWS_FRAMES * KWS_MFCC]; // oldest frame first
+    uint16_t    filled;                        // frames in the window
+    uint16_t    sinceInfer;
+    float       recent[KWS_SMOOTH];
+    uint8_t     recentPos, recentCount;
+};
+
+struct KwsResult {
+    bool  ran;   // an inference ran on this hop
+    float score; // smoothed keyword probability (valid when ran)
+};
+
+struct KwsTrigger {
+    float    threshold;
+    uint16_t quietHops; // refractory countdown
+};
+
+void kwsInit(KwsDetector& k, KwsModel* model);
+// Forget audio history (after a gap in the stream or a turn).
+void kwsReset(KwsDetector& k);
+KwsResult kwsPush(KwsDetector& k, const int16_t* hop);
+
+void kwsTriggerInit(KwsTrigger& t, float threshold);
+// Call once per hop with that hop's result. True on a detection.
+bool kwsTriggerUpdate(KwsTrigger& t, const KwsResult& r);
@@ -0,0 +1,111 @@
+#include "kws_frontend.h"
+#include "dsp_q15.h"
+#include <math.h>
+#include <string.h>
+
+#define KWS_BINS    (KWS_FFT / 2 + 1)
+#define MEL_LOW_HZ  20.0f
+#define MEL_HIGH_HZ 7600.0f
+#define NO_BAND     0xFF
+
+static bool     ready = false;
+static int16_t  window[KWS_WINDOW];     // Hann, Q15
+static uint8_t  melEdge[KWS_BINS];      // j: bin sits between mel points j and j+1
+static uint16_t melFall[KWS_BINS];      // Q15 share for band j-1; band j gets the rest
+alignas(16) static int16_t dct[KWS_MFCC][KWS_MEL_BANDS]; // orthonormal DCT-II, Q15
+
+static float hzToMel(float hz) { return 1127.0f * logf(1.0f + hz / 700.0f); }
+static float melToHz(float mel) { return 700.0f * (expf(mel / 1127.0f) - 1.0f); }
+
+void kwsFrontendInit() {
+    if (ready) return;
+    for (int i = 0; i < KWS_WINDOW; i++) {
+        window[i] = (int16_t)lrintf((0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / KWS_WINDOW)) * 32767.0f);
+    }
+
+    // Low edge, 40 band centres, high edge
+    float point[KWS_MEL_BANDS + 2];
+    float lo = hzToMel(MEL_LOW_HZ), hi = hzToMel(MEL_HIGH_HZ);
+    for (int j = 0; j < KWS_MEL_BANDS + 2; j++) {
+        point[j] = melToHz(lo + (hi - lo) * j / (KWS_MEL_BANDS + 1));
+    }
+    for (int k = 0; k < KWS_BINS; k++) {
+        float hz = (float)k * KWS_SAMPLE_RATE / KWS_FFT;
+        melEdge[k] = NO_BAND;
+        melFall[k] = 0;
+        for (int j = 0; j <= KWS_MEL_BANDS; j++) {
+            if (hz >= point[j] && hz < point[j + 1]) {
+                melEdge[k] = (uint8_t)j;
+                melFall[k] = (uint16_t)lrintf((point[j + 1] - hz) / (point[j + 1] - point[j]) * 32768.0f);
+                break;
+            }
+        }
+    }
+
+    for (int j = 0; j < KWS_MFCC; j++) {
+        float scale = sqrtf((j == 0 ? 1.0f : 2.0f) / KWS_MEL_BANDS);
+        for (int i = 0; i < KWS_MEL_BANDS; i++) {
+            dct[j][i] = (int16_t)lrintf(scale * cosf((float)M_PI * j * (i + 0.5f) / KWS_MEL_BANDS) * 32767.0f);
+        }
+    }
+
+    dspInit();
+    ready = true;
+}
+
+void kwsFrontendReset(KwsFrontend& fe) {
+    memset(fe.prev, 0, sizeof(fe.prev));
+}
+
+void kwsFrontendFrame(KwsFrontend& fe, const int16_t* hop, int16_t* mfcc) {
+    const int keep = KWS_WINDOW - KWS_HOP;
+    auto sample = [&](int i) -> int32_t { return i < keep ? fe.prev[i] : hop[i - keep]; };
+
+    int32_t sum = 0;
+    for (int i = 0; i < KWS_WINDOW; i++) sum += sample(i);
+    int32_t mean = sum / KWS_WINDOW;
+    int32_t peak = 0;
+    for (int i = 0; i < KWS_WINDOW; i++) {
+        int32_t v = sample(i) - mean;
+        if (v < 0) v = -v;
+        if (v > peak) peak = v;
+    }
+
+    // Block scaling: bring the peak to ~14 bits so quiet frames keep their
+    // FFT precision; undone in the log domain below.
+    int shift = 0;
+    while (peak && (peak << shift) < (1 << 13)) shift++;
+    while (shift <= 0 && (peak >> -shift) >= (1 << 14)) shift--;
+
+    int16_t* d = fe.fft;
+    for (int i = 0; i < KWS_WINDOW; i++) {
+        int32_t v = sample(i) - mean;
+        v = shift >= 0 ? v << shift : v >> -shift;
+        d[2 * i] = (int16_t)((v * window[i]) >> 15);
+        d[2 * i + 1] = 0;
+    }
+    memset(d + 2 * KWS_WINDOW, 0, (KWS_FFT - KWS_WINDOW) * 2 * sizeof(int16_t));
+    memcpy(fe.prev, hop + KWS_HOP - keep, keep * sizeof(int16_t));
+
+    dspFft(d, KWS_FFT);
+
+    uint64_t band[KWS_MEL_BANDS] = {};
+    for (int k = 0; k < KWS_BINS; k++) {
+        int j = melEdge[k];
+        if (j == NO_BAND) continue;
+        int32_t re = d[2 * k], im = d[2 * k + 1];
+        uint64_t p = (uint32_t)(re * re) + (uint32_t)(im * im);
+        uint32_t w = melFall[k];
+        if (j > 0) band[j - 1] += p * w;
+        if (j < KWS_MEL_BANDS) band[j] += p * (32768 - w);
+    }
+
+    // Bands are Q15 and scaled by 4^shift; a floor of one unscaled unit
+    // keeps silence finite and independent of the block scaling
+    alignas(16) int16_t logMel[KWS_MEL_BANDS];
+    const int unit = 15 + 2 * shift;
+    for (int b = 0; b < KWS_MEL_BANDS; b++) {
+        logMel[b] = (int16_t)(dspLog2Q6(band[b] + (1ull << unit)) - unit * 64);
+    }
+    for (int j = 0; j < KWS_MFCC; j++) mfcc[j] = dspDot16(dct[j], logMel, KWS_MEL_BANDS);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// KEYWORD SPOTTER FRONT END (fixed-point MFCC)
+// ==========================================
+// One feature frame per 20 ms mic hand-off: 30 ms Hann window, 512-point
+// int16 FFT, 40 triangular mel bands (20-7600 Hz), log2, DCT-II to 10
+// coefficients. The FFT and the DCT dot products are dsp_q15 kernels
+// (esp-dsp's S3 SIMD versions on the device).
+//
+// Output is log2 of band power in Q6 (1/64 octave), after an orthonormal
+// DCT, so c0 carries loudness and c1..c9 the spectral shape. Models must be
+// trained on these exact features: the host harness can dump them.
+
+#define KWS_SAMPLE_RATE 16000
+#define KWS_WINDOW      480  // 30 ms
+#define KWS_HOP         320  // 20 ms, one MIC_STREAM_CHUNK
+#define KWS_FFT         512
+#define KWS_MEL_BANDS   40
+#define KWS_MFCC        10
+#define KWS_MFCC_FRAC   6    // Q6
+
+struct KwsFrontend {
+    int16_t prev[KWS_WINDOW - KWS_HOP]; // overlap carried into the next window
+    int16_t fft[KWS_FFT * 2];           // interleaved re/im work buffer
+};
+
+// Builds the shared tables (window, mel weights, log and DCT tables).
+// Idempotent; call before the first frame.
+void kwsFrontendInit();
+void kwsFrontendReset(KwsFrontend& fe);
+// Consumes KWS_HOP new samples and writes KWS_MFCC coefficients.
+void kwsFrontendFrame(KwsFrontend& fe, const int16_t* hop, int16_t* mfcc);
@@ -0,0 +1,259 @@
+#include "kws_model.h"
+#include "kws_frontend.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CHANNELS 256 // per-pixel scratch in the conv loops
+#define MAX_LABELS   64
+
+static size_t align4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+static bool fail(KwsModel& m, const char* why) {
+    m.error = why;
+    return false;
+}
+
+bool kwsModelLoad(KwsModel& m, const uint8_t* blob, size_t len) {
+    memset(&m, 0, sizeof(m));
+    if (((uintptr_t)blob & 3) != 0) return fail(m, "blob not 4-byte aligned");
+    if (len < sizeof(KwsBlobHeader)) return fail(m, "truncated header");
+    memcpy(&m.header, blob, sizeof(KwsBlobHeader));
+    const KwsBlobHeader& h = m.header;
+    if (memcmp(h.magic, "MSKW", 4) != 0 || h.version != 1) return fail(m, "not an MSKW v1 blob");
+    if (h.frames != KWS_FRAMES || h.coeffs != KWS_MFCC) return fail(m, "input shape does not match the front end");
+    if (h.layerCount == 0 || h.layerCount > KWS_MAX_LAYERS) return fail(m, "bad layer count");
+    if (!(h.inputScale > 0.0f) || !(h.outputScale > 0.0f)) return fail(m, "bad scale");
+    m.inputMulQ16 = (int32_t)lrintf(65536.0f / (64.0f * h.inputScale));
+
+    size_t off = sizeof(KwsBlobHeader);
+    uint16_t inH = KWS_FRAMES, inW = KWS_MFCC, inC = 1;
+    int32_t inZp = h.inputZeroPoint;
+    size_t largest = (size_t)inH * inW * inC;
+    for (int i = 0; i < h.layerCount; i++) {
+        KwsLayer& L = m.layers[i];
+        if (off + sizeof(KwsLayerDesc) > len) return fail(m, "truncated layer");
+        memcpy(&L.d, blob + off, sizeof(KwsLayerDesc));
+        off += sizeof(KwsLayerDesc);
+        L.inH = inH;
+        L.inW = inW;
+        L.inC = inC;
+        L.inZeroPoint = inZp;
+
+        const KwsLayerDesc& d = L.d;
+        size_t weightCount;
+        switch (d.type) {
+        case KWS_CONV:
+            if (!d.kh || !d.kw || !d.sh || !d.sw) return fail(m, "bad conv geometry");
+            weightCount = (size_t)d.outC * d.kh * d.kw * inC;
+            break;
+        case KWS_DWCONV:
+            if (!d.kh || !d.kw || !d.sh || !d.sw || d.outC != inC) return fail(m, "bad depthwise geometry");
+            weightCount = (size_t)d.kh * d.kw * inC;
+            break;
+        case KWS_AVGPOOL:
+            if (d.outH != 1 || d.outW != 1 || d.outC != inC) return fail(m, "bad pool geometry");
+            weightCount = 0;
+            break;
+        case KWS_FC:
+            if (d.outH != 1 || d.outW != 1) return fail(m, "bad fc geometry");
+            weightCount = (size_t)d.outC * inH * inW * inC;
+            break;
+        default:
+            return fail(m, "unknown layer type");
+        }
+        if (d.outH == 0 || d.outW == 0 || d.outC == 0) return fail(m, "empty layer output");
+        if (inC > MAX_CHANNELS || d.outC > MAX_CHANNELS) return fail(m, "too many channels");
+
+        if (d.type == KWS_AVGPOOL) {
+            L.d.outZeroPoint = inZp; // pooling keeps the quantization
+        } else {
+            size_t need = align4(weightCount) + 2 * 4 * (size_t)d.outC + align4(d.outC);
+            if (off + need > len) return fail(m, "truncated weights");
+            L.weights = (const int8_t*)(blob + off);
+            off += align4(weightCount);
+            L.bias = (const int32_t*)(blob + off);
+            off += 4 * (size_t)d.outC;
+            L.mult = (const int32_t*)(blob + off);
+            off += 4 * (size_t)d.outC;
+            L.shift = (const int8_t*)(blob + off);
+            off += align4(d.outC);
+            for (int c = 0; c < d.outC; c++) {
+                if (L.shift[c] < -31 || L.shift[c] > 30) return fail(m, "requant shift out of range");
+            }
+        }
+
+        inH = d.outH;
+        inW = d.outW;
+        inC = d.outC;
+        inZp = L.d.outZeroPoint;
+        size_t bytes = (size_t)inH * inW * inC;
+        if (bytes > largest) largest = bytes;
+    }
+    if (inH * inW != 1 || inC != h.labelCount || h.labelCount > MAX_LABELS || h.keywordLabel >= h.labelCount) {
+        return fail(m, "last layer does not match the label count");
+    }
+    if (off != len) return fail(m, "trailing bytes after the last layer");
+
+    m.activationBytes = align4(largest);
+    m.arena = (int8_t*)malloc(2 * m.activationBytes);
+    if (!m.arena) return fail(m, "out of memory");
+    return true;
+}
+
+void kwsModelFree(KwsModel& m) {
+    free(m.arena);
+    m.arena = nullptr;
+}
+
+static int8_t clamp8(int32_t v) {
+    return (int8_t)(v < -128 ? -128 : v > 127 ? 127 : v);
+}
+
+void kwsModelQuantize(const KwsModel& m, const int16_t* mfcc, int8_t* out) {
+    for (int i = 0; i < KWS_MFCC; i++) {
+        int32_t q = (int32_t)(((int64_t)mfcc[i] * m.inputMulQ16 + 32768) >> 16);
+        out[i] = clamp8(q + m.header.inputZeroPoint);
+    }
+}
+
+// acc * mult * 2^shift with mult a Q31 fraction, rounded (TFLite's
+// MultiplyByQuantizedMultiplier up to tie-breaking).
+static inline int32_t requant(int32_t acc, int32_t mult, int shift) {
+    int total = 31 - shift;
+    int64_t v = (int64_t)acc * mult;
+    return (int32_t)((v + ((int64_t)1 << (total - 1))) >> total);
+}
+
+static inline int8_t finish(const KwsLayer& L, int32_t acc, int oc) {
+    int32_t v = requant(acc, L.mult[oc], L.shift[oc]) + L.d.outZeroPoint;
+    if (L.d.relu && v < L.d.outZeroPoint) v = L.d.outZeroPoint;
+    return clamp8(v);
+}
+
+static void runConv(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const KwsLayerDesc& d = L.d;
+    const int inC = L.inC;
+    const int32_t zp = L.inZeroPoint;
+
+    if (d.kh == 1 && d.kw == 1 && d.sh == 1 && d.sw == 1 && !d.padTop && !d.padLeft &&
+        d.outH == L.inH && d.outW == L.inW) {
+        // Pointwise, the bulk of a DS-CNN: centre the pixel once, then one
+        // dot product per output channel with four accumulators.
+        int16_t x[MAX_CHANNELS];
+        for (int p = 0; p < d.outH * d.outW; p++) {
+            const int8_t* src = in + p * inC;
+            for (int c = 0; c < inC; c++) x[c] = (int16_t)(src[c] - zp);
+            for (int oc = 0; oc < d.outC; oc++) {
+                const int8_t* w = L.weights + oc * inC;
+                int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+                int c = 0;
+                for (; c + 4 <= inC; c += 4) {
+                    a0 += x[c] * w[c];
+                    a1 += x[c + 1] * w[c + 1];
+                    a2 += x[c + 2] * w[c + 2];
+                    a3 += x[c + 3] * w[c + 3];
+                }
+                for (; c < inC; c++) a0 += x[c] * w[c];
+                out[p * d.outC + oc] = finish(L, L.bias[oc] + a0 + a1 + a2 + a3, oc);
+            }
+        }
+        return;
+    }
+
+    for (int oy = 0; oy < d.outH; oy++) {
+        for (int ox = 0; ox < d.outW; ox++) {
+            int8_t* dst = out + (oy * d.outW + ox) * d.outC;
+            for (int oc = 0; oc < d.outC; oc++) {
+                int32_t acc = L.bias[oc];
+                for (int ky = 0; ky < d.kh; ky++) {
+                    int iy = oy * d.sh - d.padTop + ky;
+                    if (iy < 0 || iy >= L.inH) continue; // padding is zero point: adds nothing
+                    for (int kx = 0; kx < d.kw; kx++) {
+                        int ix = ox * d.sw - d.padLeft + kx;
+                        if (ix < 0 || ix >= L.inW) continue;
+                        const int8_t* src = in + (iy * L.inW + ix) * inC;
+                        const int8_t* w = L.weights + ((oc * d.kh + ky) * d.kw + kx) * inC;
+                        for (int c = 0; c < inC; c++) acc += (src[c] - zp) * w[c];
+                    }
+                }
+                dst[oc] = finish(L, acc, oc);
+            }
+        }
+    }
+}
+
+static void runDepthwise(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const KwsLayerDesc& d = L.d;
+    const int C = L.inC;
+    const int32_t zp = L.inZeroPoint;
+    int32_t acc[MAX_CHANNELS];
+    for (int oy = 0; oy < d.outH; oy++) {
+        for (int ox = 0; ox < d.outW; ox++) {
+            // Channel-innermost so every tap is a contiguous run
+            for (int c = 0; c < C; c++) acc[c] = L.bias[c];
+            for (int ky = 0; ky < d.kh; ky++) {
+                int iy = oy * d.sh - d.padTop + ky;
+                if (iy < 0 || iy >= L.inH) continue;
+                for (int kx = 0; kx < d.kw; kx++) {
+                    int ix = ox * d.sw - d.padLeft + kx;
+                    if (ix < 0 || ix >= L.inW) continue;
+                    const int8_t* src = in + (iy * L.inW + ix) * C;
+                    const int8_t* w = L.weights + (ky * d.kw + kx) * C;
+                    for (int c = 0; c < C; c++) acc[c] += (src[c] - zp) * w[c];
+                }
+            }
+            int8_t* dst = out + (oy * d.outW + ox) * C;
+            for (int c = 0; c < C; c++) dst[c] = finish(L, acc[c], c);
+        }
+    }
+}
+
+static void runAvgPool(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int n = L.inH * L.inW;
+    for (int c = 0; c < L.inC; c++) {
+        int32_t sum = 0;
+        for (int p = 0; p < n; p++) sum += in[p * L.inC + c];
+        out[c] = clamp8(sum >= 0 ? (sum + n / 2) / n : (sum - n / 2) / n);
+    }
+}
+
+static void runFc(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int n = L.inH * L.inW * L.inC;
+    for (int oc = 0; oc < L.d.outC; oc++) {
+        const int8_t* w = L.weights + oc * n;
+        int32_t acc = L.bias[oc];
+        for (int i = 0; i < n; i++) acc += (in[i] - L.inZeroPoint) * w[i];
+        out[oc] = finish(L, acc, oc);
+    }
+}
+
+float kwsModelRun(KwsModel& m, const int8_t* input) {
+    const int8_t* in = input;
+    int8_t* bufs[2] = { m.arena, m.arena + m.activationBytes };
+    int8_t* out = bufs[0];
+    for (int i = 0; i < m.header.layerCount; i++) {
+        const KwsLayer& L = m.layers[i];
+        out = bufs[i & 1];
+        switch (L.d.type) {
+        case KWS_CONV:    runConv(L, in, out); break;
+        case KWS_DWCONV:  runDepthwise(L, in, out); break;
+        case KWS_AVGPOOL: runAvgPool(L, in, out); break;
+        case KWS_FC:      runFc(L, in, out); break;
+        }
+        in = out;
+    }
+
+    // Softmax over the few labels, in float
+    const KwsLayer& last = m.layers[m.header.layerCount - 1];
+    const int n = m.header.labelCount;
+    float peak = -1e30f;
+    float logit[MAX_LABELS];
+    for (int i = 0; i < n; i++) {
+        logit[i] = (out[i] - last.d.outZeroPoint) * m.header.outputScale;
+        if (logit[i] > peak) peak = logit[i];
+    }
+    float total = 0.0f;
+    for (int i = 0; i < n; i++) total += expf(logit[i] - peak);
+    return expf(logit[m.header.keywordLabel] - peak) / total;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// KEYWORD SPOTTER MODEL (int8 DS-CNN)
+// ==========================================
+// A small int8 network over the last KWS_FRAMES feature frames, run by a
+// plain loop per layer type: no interpreter, no allocations after load.
+// Quantization follows TFLite's int8 scheme (asymmetric activations,
+// symmetric per-channel weights, Q31 multiplier + exponent per channel),
+// so a model trained and quantized there converts layer by layer.
+//
+// Blob format "MSKW" v1, little endian, every section 4-byte aligned:
+//   KwsBlobHeader
+//   per layer: KwsLayerDesc, then for CONV/DWCONV/FC
+//     int8  weights   CONV [outC][kh][kw][inC], DWCONV [kh][kw][C], FC [outC][inLen]
+//     int32 bias[outC], int32 mult[outC], int8 shift[outC] (each padded to 4)
+// Activations are NHWC with H = frames, W = MFCC coefficients.
+
+#define KWS_FRAMES     49   // ~1 s of 20 ms frames
+#define KWS_MAX_LAYERS 16
+
+enum KwsLayerType : uint8_t {
+    KWS_CONV = 1,    // standard 2-D conv (1x1 = pointwise)
+    KWS_DWCONV = 2,  // depthwise, multiplier 1
+    KWS_AVGPOOL = 3, // global average pool, keeps scale and zero point
+    KWS_FC = 4,      // fully connected over the flattened input
+};
+
+struct KwsBlobHeader {
+    char     magic[4];        // "MSKW"
+    uint16_t version;         // 1
+    uint16_t layerCount;
+    uint16_t frames;          // must be KWS_FRAMES
+    uint16_t coeffs;          // must be KWS_MFCC
+    uint16_t labelCount;      // outputs of the last layer
+    uint16_t keywordLabel;    // output index of the wake word
+    float    inputScale;      // input q = round(mfcc / 64 / inputScale) + inputZeroPoint
+    int32_t  inputZeroPoint;
+    float    outputScale;     // dequantizes the last layer for the softmax
+    uint32_t reserved;
+};
+
+struct KwsLayerDesc {
+    uint8_t  type;            // KwsLayerType
+    uint8_t  relu;            // clamp at the output zero point
+    uint8_t  kh, kw;
+    uint8_t  sh, sw;
+    uint8_t  padTop, padLeft; // bottom/right padding follows from outH/outW
+    uint16_t outH, outW, outC;
+    uint16_t reserved;
+    int32_t  outZeroPoint;
+};
+
+struct KwsLayer {
+    KwsLayerDesc   d;
+    uint16_t       inH, inW, inC;
+    int32_t        inZeroPoint;
+    const int8_t*  weights;
+    const int32_t* bias;
+    const int32_t* mult;
+    const int8_t*  shift;
+};
+
+struct KwsModel {
+    KwsBlobHeader header;
+    KwsLayer      layers[KWS_MAX_LAYERS];
+    int32_t       inputMulQ16; // folds /64 and /inputScale into one multiply
+    size_t        activationBytes;
+    int8_t*       arena;       // two activation buffers
+    const char*   error;       // why kwsModelLoad() failed
+};
+
+// Parses a blob (which must stay valid and 4-byte aligned) and allocates
+// the activation arena. False with model.error set on a malformed blob.
+bool kwsModelLoad(KwsModel& model, const uint8_t* blob, size_t len);
+void kwsModelFree(KwsModel& model);
+// Quantizes one frame of MFCCs into the model's int8 input.
+void kwsModelQuantize(const KwsModel& model, const int16_t* mfcc, int8_t* out);
+// Runs the network over KWS_FRAMES x KWS_MFCC int8 features and returns
+// the softmax probability of the keyword label.
+float kwsModelRun(KwsModel& model, const int8_t* input);
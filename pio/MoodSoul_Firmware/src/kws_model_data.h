@@ -0,0 +1,11 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Wake-word model blob (kws_model.h format). No trained model ships with
+// the firmware: train on features from `native-kws-tool features`, convert
+// to MSKW, check it with `native-kws-tool eval`, then replace this file
+// with the output of `native-kws-tool embed model.bin`. While the size is
+// 0 the wake word stays unavailable.
+alignas(4) static const uint8_t KWS_MODEL_DATA[] = { 0 };
+static const size_t KWS_MODEL_SIZE = 0;
@@ -0,0 +1,35 @@
+#include "lipsync.h"
+
+int lipSyncLevel(const uint8_t* buf, size_t len) {
+    if (len == 0) return 0;
+    // Four independent accumulators keep the loop free of a serial
+    // dependency chain; same result as the straightforward sum.
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        int8_t a = (int8_t)buf[i], b = (int8_t)buf[i + 1];
+        int8_t c = (int8_t)buf[i + 2], d = (int8_t)buf[i + 3];
+        s0 += a < 0 ? -a : a;
+        s1 += b < 0 ? -b : b;
+        s2 += c < 0 ? -c : c;
+        s3 += d < 0 ? -d : d;
+    }
+    for (; i < len; i++) {
+        int8_t a = (int8_t)buf[i];
+        s0 += a < 0 ? -a : a;
+    }
+    return (int)((s0 + s1 + s2 + s3) / len);
+}
+
+int lipSyncLevelPcm(const int16_t* pcm, size_t n) {
+    if (n == 0) return 0;
+    uint32_t s0 = 0, s1 = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        int32_t a = pcm[i], b = pcm[i + 1];
+        s0 += a < 0 ? -a : a;
+        s1 += b < 0 ? -b : b;
+    }
+    if (i < n) s0 += pcm[i] < 0 ? -pcm[i] : pcm[i];
+    return (int)((s0 + s1) / n >> 8);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// LIP SYNC LEVEL
+// ==========================================
+// Mean absolute value of the chunk read as signed 8-bit samples, the input
+// drawMouth() scales into a mouth height. Runs once per received chunk.
+int lipSyncLevel(const uint8_t* buf, size_t len);
+// Same scale from decoded 16-bit PCM (the top byte of each sample).
+int lipSyncLevelPcm(const int16_t* pcm, size_t n);
@@ -0,0 +1,266 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ==========================================
+// LOCK-FREE RINGS (task and ISR hand-off)
+// ==========================================
+// Header-only rings for passing samples, frames or bytes between tasks, or
+// from an ISR to a task, without the lock and per-item copy of a FreeRTOS
+// queue.
+//
+//   SpscRing<T>  one producer, one consumer. writeSpan() hands out the
+//                largest contiguous free run to fill in place and
+//                commitWrite() publishes it; readSpan()/commitRead() do the
+//                same on the consumer side. push()/pop() copy for callers
+//                that don't need spans.
+//   MpscRing<T>  any number of producers (tasks or ISRs), one consumer.
+//                Producers claim slots with a CAS and may publish them out
+//                of order; the consumer takes the published prefix. A
+//                producer preempted between reserve() and commit() holds
+//                up the consumer, never another producer.
+//
+// The caller owns the storage (bytesFor() says how much), so a ring lives
+// in PSRAM or internal RAM as it chooses:
+//
+//   static SpscRing<int16_t> ring;
+//   ring.init(heap_caps_malloc(SpscRing<int16_t>::bytesFor(4096), MALLOC_CAP_SPIRAM), 4096);
+//
+// Nothing blocks, allocates or calls FreeRTOS, and the methods are forced
+// inline, so both ends work from an IRAM ISR; one that runs with the flash
+// cache off needs the ring and its storage in internal RAM. Capacity is a
+// power of two, positions are free-running uint32_t, and T must be
+// trivially copyable. Head and tail sit on separate cache lines, and each
+// side keeps a cached copy of the other's index so it only touches the
+// shared line when the ring looks full (or empty).
+
+#ifdef ARDUINO
+#define RING_CACHE_LINE 32 // ESP32-S3 data cache line
+#else
+#define RING_CACHE_LINE 64
+#endif
+
+#define RING_FN __attribute__((always_inline)) inline
+
+template <typename T>
+struct SpscRing {
+    static size_t bytesFor(uint32_t capacity) { return (size_t)capacity * sizeof(T); }
+
+    // Not thread-safe: call before either side starts.
+    bool init(void* mem, uint32_t capacity) {
+        if (!mem || !capacity || (capacity & (capacity - 1))) return false;
+        buf = (T*)mem;
+        mask = capacity - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        cachedHead = cachedTail = 0;
+        return true;
+    }
+
+    RING_FN uint32_t capacity() const { return mask + 1; }
+    // Queued items, a snapshot from either side
+    RING_FN uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // ---- producer ----
+    // Up to `want` free slots, contiguous, starting at *span.
+    RING_FN uint32_t writeSpan(T** span, uint32_t want = UINT32_MAX) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t free = mask + 1 - (h - cachedTail);
+        if (free < want) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            free = mask + 1 - (h - cachedTail);
+        }
+        uint32_t run = mask + 1 - (h & mask);
+        uint32_t n = want < free ? want : free;
+        *span = buf + (h & mask);
+        return n < run ? n : run;
+    }
+    RING_FN void commitWrite(uint32_t n) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+    // Copies in as many as fit; returns that count.
+    RING_FN uint32_t push(const T* items, uint32_t n) {
+        uint32_t done = 0;
+        T* span;
+        while (done < n) {
+            uint32_t k = writeSpan(&span, n - done);
+            if (!k) break;
+            memcpy(span, items + done, k * sizeof(T));
+            commitWrite(k);
+            done += k;
+        }
+        return done;
+    }
+    RING_FN bool push(const T& item) {
+        T* span;
+        if (!writeSpan(&span, 1)) return false;
+        *span = item;
+        commitWrite(1);
+        return true;
+    }
+
+    // ---- consumer ----
+    // Up to `want` queued items, contiguous, starting at *span.
+    RING_FN uint32_t readSpan(const T** span, uint32_t want = UINT32_MAX) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t avail = cachedHead - t;
+        if (avail < want) {
+            cachedHead = head.load(std::memory_order_acquire);
+            avail = cachedHead - t;
+        }
+        uint32_t run = mask + 1 - (t & mask);
+        uint32_t n = want < avail ? want : avail;
+        *span = buf + (t & mask);
+        return n < run ? n : run;
+    }
+    RING_FN void commitRead(uint32_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+    RING_FN uint32_t pop(T* out, uint32_t n) {
+        uint32_t done = 0;
+        const T* span;
+        while (done < n) {
+            uint32_t k = readSpan(&span, n - done);
+            if (!k) break;
+            memcpy(out + done, span, k * sizeof(T));
+            commitRead(k);
+            done += k;
+        }
+        return done;
+    }
+    RING_FN bool pop(T& item) {
+        const T* span;
+        if (!readSpan(&span, 1)) return false;
+        item = *span;
+        commitRead(1);
+        return true;
+    }
+    // Drops everything published so far (consumer side).
+    RING_FN void discard() {
+        cachedHead = head.load(std::memory_order_acquire);
+        tail.store(cachedHead, std::memory_order_release);
+    }
+
+    T*       buf = nullptr;
+    uint32_t mask = 0;
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> head{0}; // written by the producer
+    uint32_t cachedTail = 0;                                // producer's copy of tail
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> tail{0}; // written by the consumer
+    uint32_t cachedHead = 0;                                // consumer's copy of head
+};
+
+template <typename T>
+struct MpscRing {
+    // Slots, then one publish marker per slot
+    static size_t bytesFor(uint32_t capacity) {
+        return seqOffset(capacity) + (size_t)capacity * sizeof(std::atomic<uint32_t>);
+    }
+
+    // Not thread-safe: call before anyone uses the ring.
+    bool init(void* mem, uint32_t capacity) {
+        if (!mem || !capacity || (capacity & (capacity - 1))) return false;
+        slots = (T*)mem;
+        seq = (std::atomic<uint32_t>*)((uint8_t*)mem + seqOffset(capacity));
+        mask = capacity - 1;
+        // Slot i holds position p once seq[i] == p + 1
+        for (uint32_t i = 0; i < capacity; i++) seq[i].store(i - capacity + 1, std::memory_order_relaxed);
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_release);
+        return true;
+    }
+
+    RING_FN uint32_t capacity() const { return mask + 1; }
+    // Claimed items, published or not; a snapshot
+    RING_FN uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // ---- producers ----
+    // Claims up to `want` contiguous slots at *span; pass *pos to commit().
+    RING_FN uint32_t reserve(T** span, uint32_t* pos, uint32_t want = 1) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t n;
+        do {
+            uint32_t free = mask + 1 - (h - tail.load(std::memory_order_acquire));
+            uint32_t run = mask + 1 - (h & mask);
+            n = want < free ? want : free;
+            if (n > run) n = run;
+            if (!n) return 0;
+        } while (!head.compare_exchange_weak(h, h + n, std::memory_order_relaxed, std::memory_order_relaxed));
+        *span = slots + (h & mask);
+        *pos = h;
+        return n;
+    }
+    RING_FN void commit(uint32_t pos, uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) seq[(pos + i) & mask].store(pos + i + 1, std::memory_order_release);
+    }
+    RING_FN uint32_t push(const T* items, uint32_t n) {
+        uint32_t done = 0, pos;
+        T* span;
+        while (done < n) {
+            uint32_t k = reserve(&span, &pos, n - done);
+            if (!k) break;
+            memcpy(span, items + done, k * sizeof(T));
+            commit(pos, k);
+            done += k;
+        }
+        return done;
+    }
+    RING_FN bool push(const T& item) {
+        uint32_t pos;
+        T* span;
+        if (!reserve(&span, &pos, 1)) return false;
+        *span = item;
+        commit(pos, 1);
+        return true;
+    }
+
+    // ---- consumer ----
+    // Published items in order, contiguous, starting at *span.
+    RING_FN uint32_t readSpan(const T** span, uint32_t want = UINT32_MAX) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t run = mask + 1 - (t & mask);
+        uint32_t limit = want < run ? want : run;
+        uint32_t n = 0;
+        while (n < limit && seq[(t + n) & mask].load(std::memory_order_acquire) == t + n + 1) n++;
+        *span = slots + (t & mask);
+        return n;
+    }
+    RING_FN void commitRead(uint32_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+    RING_FN uint32_t pop(T* out, uint32_t n) {
+        uint32_t done = 0;
+        const T* span;
+        while (done < n) {
+            uint32_t k = readSpan(&span, n - done);
+            if (!k) break;
+            memcpy(out + done, span, k * sizeof(T));
+            commitRead(k);
+            done += k;
+        }
+        return done;
+    }
+    RING_FN bool pop(T& item) {
+        const T* span;
+        if (!readSpan(&span, 1)) return false;
+        item = *span;
+        commitRead(1);
+        return true;
+    }
+
+    static size_t seqOffset(uint32_t capacity) {
+        return ((size_t)capacity * sizeof(T) + alignof(std::atomic<uint32_t>) - 1) &
+               ~(alignof(std::atomic<uint32_t>) - 1);
+    }
+
+    T*                     slots = nullptr;
+    std::atomic<uint32_t>* seq = nullptr;
+    uint32_t               mask = 0;
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> head{0}; // claimed by producers
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> tail{0}; // written by the consumer
+};
@@ -1,10 +1,44 @@
 #include <M5CoreS3.h>
 #include <WiFi.h>
+#include <WiFiClientSecure.h>
 #include <WiFiManager.h> // You need to install this library
 #include <esp_camera.h>
 #include <HTTPClient.h>
-#include <Update.h>
 #include <Preferences.h>
+#include "trace.h"
+#include "http_response.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "interaction_request.h"
+#include "lipsync.h"
+#include "motion.h"
+#include "ota.h"
+#include "boot.h"
+#include "wifi_cache.h"
+#include "wifi_link.h"
+#include "prewarm.h"
+#include "mic_stream.h"
+#include "wake_word.h"
+#include "audio_preproc.h"
+#include "audio_duplex.h"
+#include "filler.h"
+#include "reaction_cache.h"
+#include "asset_store.h"
+#include "turn_quota.h"
+#include "wooden_fish.h"
+#include "proximity.h"
+#include "presence.h"
+#include "camera_power.h"
+#include "reply_segments.h"
+#include "reply_decoder.h"
+#include "heartbeat.h"
+#include "factory_test.h"
+#include "viewfinder.h"
+#include <sys/time.h>
+#include <time.h>
+#ifdef MOODSOUL_BENCH
+#include "bench.h"
+#endif
 
 // ==========================================
 // CONFIGURATION
@@ -20,13 +54,83 @@ const char* CURRENT_VERSION = "1.3";
 #define RECORD_TIME_SEC 3
 #define SAMPLE_RATE     16000
 #define AUDIO_BUF_SIZE  (RECORD_TIME_SEC * SAMPLE_RATE * 2) // 16-bit PCM
-uint8_t* audioBuffer = nullptr;
+#define AUDIO_PREROLL_MAX_BYTES (MIC_PREROLL_MAX_MS * SAMPLE_RATE / 1000 * 2)
+uint8_t* audioBuffer = nullptr; // AUDIO_BUF_SIZE plus room for pre-roll
+
+// Always-on mic (serial "mic on|off|preroll <ms>|stats", kept in NVS)
+bool     micAlwaysOn  = false;
+uint32_t micPreRollMs = 300;
+
+// Wake word on top of the always-on mic (serial "wake ...", kept in NVS)
+bool    wakeWordOn       = false;
+uint8_t wakeThresholdPct = 85;
+
+// Capture NS/AGC (serial "preproc on|off|stats", kept in NVS)
+bool audioPreprocOn = true;
+
+// Barge-in: talk over the reply to interrupt it (serial "barge ...", kept
+// in NVS). A detection leaves the next turn's start in bargeInMark.
+#define BARGE_PREROLL_MS 150
+bool     bargeInOn      = false;
+bool     bargeInPending = false;
+uint32_t bargeInMark    = 0;
+
+// Mirror of the server's throttle and daily quota (turn_quota.h), synced
+// from every reply and kept in NVS. A turn it refuses never uploads: the
+// "tired" reply comes from flash, unprompted photos are skipped.
+#define QUOTA_WAIT_MAX_MS 2000 // a voice turn waits out a throttle this short
+TurnQuota turnQuota;
+
+// Unix time, 0 until SNTP (or a reply's Date) has set the clock
+uint32_t clockNowS() {
+    time_t t = time(nullptr);
+    return t > 1600000000 ? (uint32_t)t : 0;
+}
 
 const char* BINDING_CHECK_PATH = "/api/check_binding";
+const char* REACTIONS_PATH     = "/api/reactions";
+const char* MERIT_PATH         = "/api/merit";
+const char* PING_PATH          = "/api/ping";
 Preferences preferences;
 int current_rotation = 0;
 
 void drawIcon(const char* label, uint16_t color, const char* iconType);
+void saveFillerPersona();
+void saveTurnQuota();
+
+// ==========================================
+// METRICS
+// ==========================================
+// Scrape http://<device-ip>/metrics during soak tests.
+Counter   metricConnectFailures("moodsoul_connect_failures_total", "Interaction connects that failed (TCP or TLS)");
+Counter   metricSendFailures("moodsoul_send_failures_total", "Interactions whose request upload was cut short");
+Counter   metricTimeouts("moodsoul_response_timeouts_total", "Interactions that timed out waiting for the response head");
+Counter   metricTurnsThrottled("moodsoul_turns_throttled_total", "Turns held back locally by the throttle mirror");
+Counter   metricTurnsOverQuota("moodsoul_turns_over_quota_total", "Turns answered locally because the daily quota is used up");
+Gauge     metricQuotaRemaining("moodsoul_quota_remaining", "Counted turns left today, -1 until the first reply");
+Counter   metricUnderruns("moodsoul_playback_underruns_total", "Times the response stream ran dry mid-playback");
+Counter   metricBindingPollErrors("moodsoul_binding_poll_errors_total", "Binding polls that did not return 200");
+Gauge     metricRssi("moodsoul_wifi_rssi_dbm", "Wi-Fi RSSI");
+Gauge     metricFreePsram("moodsoul_free_psram_bytes", "Free PSRAM");
+Gauge     metricFreeHeap("moodsoul_free_heap_bytes", "Free internal heap");
+Gauge     metricBattery("moodsoul_battery_percent", "Battery level");
+Gauge     metricBatteryCurrent("moodsoul_battery_current_ma", "Battery current (negative = discharging), mA");
+Histogram metricUploadMs("moodsoul_upload_ms", "Request body upload time after TLS, ms");
+Histogram metricTtfbMs("moodsoul_ttfb_ms", "Last request byte to first response byte, ms");
+Histogram metricDecodeUs("moodsoul_decode_us", "Per-chunk response decode/render time, us");
+Histogram metricSegmentWaitMs("moodsoul_segment_wait_ms", "End of one reply sentence to the next one's first audio byte, ms");
+// Per reply codec, indexed by SEGMENT_CODEC_*
+Histogram metricReplyFirstAudioMs[] = {
+    { "moodsoul_reply_first_audio_ms{codec=\"mp3\"}", "Last request byte to first decoded reply audio, ms" },
+    { "moodsoul_reply_first_audio_ms{codec=\"pcm16\"}", "Last request byte to first decoded reply audio, ms" },
+    { "moodsoul_reply_first_audio_ms{codec=\"ima-adpcm\"}", "Last request byte to first decoded reply audio, ms" },
+};
+Histogram metricReplyDecodePermille[] = {
+    { "moodsoul_reply_decode_permille{codec=\"mp3\"}", "Decode CPU time per reply, permille of its audio duration" },
+    { "moodsoul_reply_decode_permille{codec=\"pcm16\"}", "Decode CPU time per reply, permille of its audio duration" },
+    { "moodsoul_reply_decode_permille{codec=\"ima-adpcm\"}", "Decode CPU time per reply, permille of its audio duration" },
+};
+Histogram metricBargeInTeardownUs("moodsoul_barge_in_teardown_us", "Closing an interrupted response connection, us");
 
 // ==========================================
 // DEVICE HANDSHAKE (BINDING)
@@ -36,15 +140,11 @@ void checkBinding() {
     bool isBound = preferences.getBool("is_bound", false);
     
     if (isBound) {
-        drawIcon("Welcome Back", BLUE, "none");
-        delay(1000);
-        preferences.end();
+        preferences.end(); // Straight to Touch Me
         return;
     }
 
     // Not bound: Start Binding Flow
-    DEVICE_ID = WiFi.macAddress();
-    DEVICE_ID.replace(":", ""); // Clean MAC for ID
     
     String bindUrl = "https://" + String(SERVER_HOST) + "/bind?deviceId=" + DEVICE_ID;
     
@@ -88,13 +188,13 @@ void checkBinding() {
             }
         }
 
-        // Check WiFi Status
+        // Check WiFi Status (the link manager reconnects in the background)
         if (WiFi.status() != WL_CONNECTED) {
              M5.Lcd.fillRect(0, 210, 320, 30, BLACK);
              M5.Lcd.setTextColor(RED);
-             M5.Lcd.drawString("WiFi Lost! Resetting...", 160, 220);
-             delay(2000);
-             ESP.restart();
+             M5.Lcd.drawString("WiFi Lost! Reconnecting...", 160, 220);
+             delay(1000);
+             continue;
         }
 
         WiFiClientSecure client;
@@ -128,6 +228,7 @@ void checkBinding() {
                  M5.Lcd.setTextColor(GREEN);
                  M5.Lcd.drawString("Status: 200 OK", 160, 232);
             } else {
+                 metricBindingPollErrors.inc();
                  M5.Lcd.setTextColor(RED);
                  String errStr = (code < 0) ? http.errorToString(code) : String(code);
                  M5.Lcd.drawString("Err: " + errStr, 160, 232);
@@ -149,6 +250,7 @@ void checkBinding() {
                 }
             }
         } else {
+            metricBindingPollErrors.inc();
             M5.Lcd.setTextColor(RED);
             M5.Lcd.drawString("Begin Failed", 160, 232);
         }
@@ -217,6 +319,17 @@ void drawMouth(int volume) {
     M5.Lcd.fillEllipse(cx, cy, 30, height/2, BLACK); // Inner mouth
 }
 
+// The sentence being spoken, under the mouth
+void drawCaption(const char* text) {
+    int h = M5.Lcd.height();
+    M5.Lcd.fillRect(0, h - 64, M5.Lcd.width(), 64, BLACK);
+    M5.Lcd.setTextColor(WHITE);
+    M5.Lcd.setTextSize(1);
+    M5.Lcd.setTextDatum(TL_DATUM);
+    M5.Lcd.setCursor(8, h - 60);
+    M5.Lcd.print(text); // wraps at the screen edge
+}
+
 void setMoodcubeOrientation(int mode) {
     sensor_t* s = esp_camera_sensor_get();
     if (mode == 0) {
@@ -237,249 +350,982 @@ void setMoodcubeOrientation(int mode) {
 // ==========================================
 // OTA UPDATE CHECK
 // ==========================================
-void checkUpdate() {
-    drawIcon("Check Update", YELLOW, "load");
-    
-    HTTPClient http;
-    // Append current version to query
-    String url = String(UPDATE_URL) + "?current_version=" + String(CURRENT_VERSION);
-    http.begin(url);
-    
-    int httpCode = http.GET();
-    
-    if (httpCode == 200) {
-        int contentLength = http.getSize();
-        if (contentLength > 0) {
-            drawIcon("UPDATING...", MAGENTA, "load");
-            
-            bool canBegin = Update.begin(contentLength);
-            if (canBegin) {
-                WiFiClient *stream = http.getStreamPtr();
-                size_t written = Update.writeStream(*stream);
-                
-                if (written == contentLength) {
-                    if (Update.end()) {
-                        if (Update.isFinished()) {
-                            drawIcon("REBOOTING!", GREEN, "none");
-                            delay(1000);
-                            ESP.restart();
-                        } else {
-                             drawIcon("Upd Error", RED, "none");
-                        }
-                    } else {
-                         drawIcon("Upd Fail", RED, "none");
-                    }
-                } else {
-                     drawIcon("Wrt Fail", RED, "none");
-                }
-            }
-        }
-    } else if (httpCode == 304) {
-        // Up to date
-        drawIcon("Up to Date", GREEN, "none");
-        delay(1000);
-    } else {
-        drawIcon("Check Fail", RED, "none");
-        delay(1000);
-    }
-    
-    http.end();
+// Runs in the background after boot so a slow or dead update endpoint
+// never holds up "Touch Me". A verified image is applied by loop() between
+// turns.
+volatile bool otaRebootPending = false;
+
+void otaTask(void*) {
+    bootPhaseBegin(BOOT_OTA);
+    OtaStats stats;
+    OtaResult result = otaRun(UPDATE_URL, CURRENT_VERSION, nullptr, stats);
+    bootPhaseNote(BOOT_OTA, result == OTA_READY_TO_REBOOT ? "updated" : result == OTA_UP_TO_DATE ? "current" : "failed");
+    bootPhaseEnd(BOOT_OTA);
+    if (result == OTA_READY_TO_REBOOT) otaRebootPending = true;
+    vTaskDelete(nullptr);
 }
 
 // ==========================================
 // NETWORK TASK
 // ==========================================
-void sendInteraction(camera_fb_t* fb, uint8_t* audioData, size_t audioLen, const char* trigger = "") {
-    WiFiClient client;
-    
-    if (!client.connect(SERVER_HOST, SERVER_PORT)) {
-        drawIcon("Conn Fail", RED, "none");
-        delay(2000);
-        return;
+// Marks the link busy for the length of a turn (no roaming scans, no
+// modem sleep, no reaction prefetch).
+struct LinkBusyScope {
+    LinkBusyScope() {
+        wifiLinkSetBusy(true);
+        reactionPrefetchAllow(false);
     }
+    ~LinkBusyScope() { wifiLinkSetBusy(false); }
+};
 
-    String boundary = "------------------------" + String(millis());
-    
-    // Prepare Headers (same as before)
-    // ... (Headers omitted for brevity, keeping existing logic)
-    String head = "--" + boundary + "\r\n";
-    head += "Content-Disposition: form-data; name=\"deviceId\"\r\n\r\n";
-    head += String(DEVICE_ID) + "\r\n";
-    
-    if (strlen(trigger) > 0) {
-        head += "--" + boundary + "\r\n";
-        head += "Content-Disposition: form-data; name=\"trigger\"\r\n\r\n";
-        head += String(trigger) + "\r\n";
+// Hands a pre-warmed connection back however the turn ends.
+struct PrewarmScope {
+    bool taken = false;
+    ~PrewarmScope() { if (taken) prewarmRelease(); }
+};
+
+// Holds the speaker for a reply: the duplex engine when barge-in is on
+// (the mic keeps listening), otherwise M5.Speaker, which needs the codec.
+// Fillers play through it, so they stop first.
+struct SpeakerScope {
+    bool duplex;
+    explicit SpeakerScope(bool bargeIn) {
+        duplex = bargeIn && duplexStart(SAMPLE_RATE);
+        if (!duplex) {
+            micStreamPause();
+            M5.Speaker.begin();
+            M5.Speaker.setVolume(128);
+        }
     }
-    
-    if (fb) {
-        head += "--" + boundary + "\r\n";
-        head += "Content-Disposition: form-data; name=\"image\"; filename=\"capture.jpg\"\r\n";
-        head += "Content-Type: image/jpeg\r\n\r\n";
+    ~SpeakerScope() {
+        fillerStop();
+        if (duplex) {
+            duplexStop();
+        } else if (micStreamRunning()) {
+            M5.Speaker.end();
+            micStreamResume();
+        }
     }
-    
-    String mid = "";
-    if (fb) mid = "\r\n--" + boundary + "\r\n";
-    else mid = "--" + boundary + "\r\n";
-    
-    mid += "Content-Disposition: form-data; name=\"audio\"; filename=\"audio.pcm\"\r\n";
-    mid += "Content-Type: application/octet-stream\r\n\r\n";
-    
-    String tail = "\r\n--" + boundary + "--\r\n";
-    
-    size_t fbLen = fb ? fb->len : 0;
-    size_t totalLen = head.length() + fbLen + mid.length() + audioLen + tail.length();
+};
 
-    // Send Request
-    client.println("POST " + String(SERVER_PATH) + " HTTP/1.1");
-    client.println("Host: " + String(SERVER_HOST));
-    client.println("Content-Length: " + String(totalLen));
-    client.println("Content-Type: multipart/form-data; boundary=" + boundary);
-    client.println(); 
+// Reply audio as it arrives: one body in the codec the Content-Type names,
+// or sentence after sentence from a segmented reply (reply_segments.h).
+// Each segment is encoded on its own, so the decoder is flushed at its end
+// (an ADPCM sentence ends in a short block) while the speaker keeps going.
+// Decoded PCM goes to fillerReply(), which crossfades it in over the filler
+// and feeds the speaker or, in barge-in mode, the AEC's reference.
+struct ReplyPlayer : SegmentEvents, PcmSink {
+    ReplyDecoder* decoder = nullptr;
+    int           codec = -1;
+    bool          firstAudio = true;
+    bool          broken = false;   // undecodable audio: the rest is skipped
+    unsigned long sentMs = 0;       // last request byte
+    unsigned long segmentEndMs = 0;
+    uint32_t      decodeUs = 0, waitUs = 0, samples = 0;
+    int           level = 0;
 
-    client.print(head);
-    
-    if (fb) {
-        uint8_t* fbBuf = fb->buf;
-        size_t chunkSize = 1024;
-        while (fbLen > 0) {
-            size_t toWrite = (fbLen > chunkSize) ? chunkSize : fbLen;
-            client.write(fbBuf, toWrite);
-            fbBuf += toWrite;
-            fbLen -= toWrite;
+    void begin(int c) {
+        if (c == codec && decoder) return;
+        finish();
+        codec = c;
+        decoder = c >= 0 ? replyDecoder((uint8_t)c) : nullptr;
+        if (!decoder) Serial.printf("reply: no decoder for codec %d\n", c);
+    }
+
+    void play(const uint8_t* data, size_t len) {
+        if (!decoder || broken) return;
+        unsigned long decodeStart = micros();
+        uint32_t before = samples;
+        waitUs = 0;
+        level = 0;
+        if (!decoder->decode(data, len, *this)) {
+            Serial.printf("reply: bad %s data\n", replyCodecName(codec));
+            broken = true;
+        }
+        uint32_t us = micros() - decodeStart - waitUs; // not the time the speaker made us wait
+        decodeUs += us;
+        metricDecodeUs.record(us);
+        if (samples != before) drawMouth(level * 2); // Animate Mouth
+    }
+
+    // Decoded audio, handed on as soon as the speaker has room
+    void pcm(const int16_t* s, size_t n) override {
+        if (firstAudio) {
+            traceMark(TRACE_FIRST_AUDIO);
+            fillerReplyReady();
+            if (codec >= 0) metricReplyFirstAudioMs[codec].record(millis() - sentMs);
+            firstAudio = false;
+        }
+        int l = lipSyncLevelPcm(s, n);
+        if (l > level) level = l;
+        samples += n;
+        unsigned long waitStart = micros();
+        while (n) {
+            size_t k = fillerReply(s, n);
+            s += k;
+            n -= k;
+            if (!k) {
+                if (!fillerRunning()) break;
+                delay(2);
+            }
+        }
+        waitUs += micros() - waitStart;
+    }
+
+    // Plays out a trailing partial frame and resets the decoder for the
+    // next segment or reply
+    void flush() {
+        if (!decoder) return;
+        unsigned long t0 = micros();
+        waitUs = 0;
+        decoder->flush(*this);
+        decodeUs += micros() - t0 - waitUs;
+    }
+
+    // End of the reply (or a codec switch): the decode cost against the
+    // audio it produced
+    void finish() {
+        if (!decoder) return;
+        flush();
+        if (samples) {
+            uint64_t audioUs = (uint64_t)samples * 1000000 / REPLY_RATE;
+            metricReplyDecodePermille[codec].record((uint32_t)((uint64_t)decodeUs * 1000 / audioUs));
         }
+        decoder = nullptr;
+        decodeUs = samples = 0;
     }
 
-    client.print(mid);
+    void segmentBegin(const SegmentHeader& h, const char* caption) override {
+        begin(h.codec);
+        if (caption[0]) drawCaption(caption);
+    }
+    void segmentAudio(const uint8_t* data, size_t len) override {
+        if (segmentEndMs) {
+            metricSegmentWaitMs.record(millis() - segmentEndMs);
+            segmentEndMs = 0;
+        }
+        play(data, len);
+    }
+    void segmentEnd(const SegmentHeader&) override {
+        flush();
+        segmentEndMs = millis();
+    }
+};
+
+void sendInteraction(camera_fb_t* fb, uint8_t* audioData, size_t audioLen, const char* trigger = "",
+                     bool usePrewarm = false) {
+    // Touch turns open their trace at touch-down; triggers start one here
+    if (!traceActive()) traceBegin(trigger);
 
-    uint8_t* audBuf = audioData;
-    size_t audLen = audioLen;
-    size_t chunkSize = 1024;
-    while (audLen > 0) {
-        size_t toWrite = (audLen > chunkSize) ? chunkSize : audLen;
-        client.write(audBuf, toWrite);
-        audBuf += toWrite;
-        audLen -= toWrite;
+    // Out of quota: the server would only say it's tired, so say it here.
+    // Unprompted photos just skip the turn.
+    bool quiet = strcmp(trigger, "AUTO_OBSERVE") == 0;
+    QuotaVerdict verdict = quotaCheck(turnQuota, millis(), clockNowS());
+    if (verdict == QUOTA_EXHAUSTED) {
+        metricTurnsOverQuota.inc();
+        bool played = false;
+        if (!quiet) {
+            SpeakerScope speaker(false);
+            drawIcon("Sleepy...", ORANGE, "tired");
+            played = fillerPlayTired();
+        }
+        if (quiet || played) {
+            if (usePrewarm) prewarmCancel();
+            traceCancel();
+            return;
+        }
+        verdict = QUOTA_OK; // no local clip: let the server say it
+    }
+    // Too soon after the last turn: the server would answer 429. A short
+    // wait is better than dropping what the user just said.
+    if (verdict == QUOTA_THROTTLED) {
+        uint32_t wait = quotaWaitMs(turnQuota, millis());
+        if (quiet || wait > QUOTA_WAIT_MAX_MS) {
+            metricTurnsThrottled.inc();
+            if (usePrewarm) prewarmCancel();
+            traceCancel();
+            if (!quiet) {
+                drawIcon("Slow down", ORANGE, "tired");
+                delay(1000);
+            }
+            return;
+        }
+        delay(wait);
     }
 
-    client.print(tail);
+    if (wifiLinkQuality().tier == LINK_DOWN) {
+        if (usePrewarm) prewarmCancel();
+        metricConnectFailures.inc();
+        traceEnd();
+        drawIcon("No WiFi", RED, "none");
+        delay(2000);
+        return;
+    }
+    LinkBusyScope busy;
+
+    // Touch turns usually find the connection open and the head already sent
+    PrewarmConn warm = {};
+    PrewarmScope warmScope;
+    warmScope.taken = usePrewarm && prewarmTake(warm, 3000);
+
+    WiFiClientSecure coldClient;
+    WiFiClientSecure& client = warmScope.taken ? *warm.client : coldClient;
+    String boundary;
+    if (warmScope.taken) {
+        boundary = warm.boundary;
+    } else {
+        client.setInsecure(); // Same as checkBinding(): no cert pinning yet
+
+        traceMark(TRACE_CONNECT);
+        if (!client.connect(SERVER_HOST, SERVER_PORT)) {
+            metricConnectFailures.inc();
+            traceEnd();
+            drawIcon("Conn Fail", RED, "none");
+            delay(2000);
+            return;
+        }
+        traceMark(TRACE_TLS_DONE); // connect() returns after the handshake
+        boundary = "------------------------" + String(millis());
+    }
+
+    InteractionParts parts = {};
+    parts.host     = SERVER_HOST;
+    parts.path     = SERVER_PATH;
+    parts.boundary = boundary.c_str();
+    parts.deviceId = DEVICE_ID.c_str();
+    parts.trigger  = trigger;
+    parts.traceId  = traceCurrentId();
+    parts.audioCaps = REPLY_AUDIO_CAPS;
+    parts.image    = fb ? fb->buf : nullptr;
+    parts.imageLen = fb ? fb->len : 0;
+    parts.audio    = audioData;
+    parts.audioLen = audioLen;
+
+    // Send Request. A prewarmed head went out during the touch; the turn's
+    // upload starts with the body.
+    traceMark(TRACE_REQUEST_START);
+    unsigned long uploadStart = millis();
+    ClientSink sink(client);
+    bool sent = warmScope.taken ? interactionWriteChunkedBody(sink, parts) : interactionWriteRequest(sink, parts);
+    if (!sent) {
+        metricSendFailures.inc();
+        traceEnd();
+        drawIcon("Send Fail", RED, "none");
+        client.stop();
+        delay(2000);
+        return;
+    }
+    traceMark(TRACE_LAST_BYTE_SENT);
+    unsigned long uploadEnd = millis();
+    metricUploadMs.record(uploadEnd - uploadStart);
+    // The server stamps the turn about when the upload ends
+    quotaSpend(turnQuota, millis(), !quiet);
+    if (!quiet) saveTurnQuota();
 
     // ==========================================
     // LATENCY MASKING
     // ==========================================
-    // Play "Thinking" sound from SD Card immediately after sending
-    // M5.Speaker.tone(400, 100); // Simple beep fallback
-    // Ideally: playWav("/sounds/hmm.wav"); 
-    
+    // The speaker comes up now rather than at the first reply byte, so
+    // persona fillers cover the Gemini + TTS wait. Barge-in keeps the mic
+    // listening through both.
+    SpeakerScope speaker(bargeInOn);
+    fillerStart();
+
     // ==========================================
     // RECEIVE RESPONSE (Audio Stream)
     // ==========================================
     unsigned long timeout = millis();
+    HttpResponseHead respHead;
+    httpHeadReset(respHead);
+    bool firstByte = true;
     while (client.connected()) {
         String line = client.readStringUntil('\n');
-        if (line == "\r") break; 
+        if (firstByte && line.length() > 0) {
+            traceMark(TRACE_FIRST_RESPONSE_BYTE);
+            metricTtfbMs.record(millis() - timeout);
+            firstByte = false;
+        }
+        if (httpHeadFeedLine(respHead, line.c_str(), line.length())) break;
         if (millis() - timeout > 8000) { // Increased timeout for GenAI
+            metricTimeouts.inc();
+            traceEnd();
             drawIcon("Timeout", RED, "none");
             client.stop();
             return;
         }
     }
+    traceSetHttpStatus(respHead.status);
+    traceSetServerTiming(respHead.serverGeminiMs, respHead.serverTtsMs);
+    // Until SNTP answers, the reply's Date sets the clock the quota reset needs
+    if (!clockNowS() && respHead.serverTimeS) {
+        timeval tv = { (time_t)respHead.serverTimeS, 0 };
+        settimeofday(&tv, nullptr);
+    }
+    if (quotaSync(turnQuota, millis(), clockNowS(), respHead.status, respHead.quotaRemaining,
+                  respHead.quotaResetS, respHead.retryAfterS, !quiet)) {
+        saveTurnQuota();
+    }
+    if (respHead.status != 200) {
+        // 429 and errors carry JSON, not audio
+        traceEnd();
+        drawIcon(respHead.status == 429 ? "Slow down" : "Server Err", ORANGE, "none");
+        client.stop();
+        delay(1000);
+        return;
+    }
 
     // Lip Sync Loop
     drawIcon("Speaking...", GREEN, "mouth");
-    M5.Speaker.begin();
-    M5.Speaker.setVolume(128);
 
     uint8_t playBuf[1024];
-    while (client.connected() && client.available()) {
+    ReplyPlayer player;
+    player.sentMs = uploadEnd;
+    bool segmented = strncmp(respHead.contentType, SEGMENT_CONTENT_TYPE, strlen(SEGMENT_CONTENT_TYPE)) == 0;
+    // Servers that predate X-Audio-Caps send MP3 whatever they call it
+    int bodyCodec = replyCodecForType(respHead.contentType);
+    if (!segmented) player.begin(bodyCodec >= 0 ? bodyCodec : SEGMENT_CODEC_MP3);
+    ChunkedDecoder chunks;
+    chunkedInit(chunks);
+    SegmentParser segments;
+    segmentParserInit(segments);
+    long bodyRead = 0;
+    bool starved = false;
+    unsigned long lastData = millis();
+    // Keep going until the body is complete (or the server closes). Running
+    // dry before that is an underrun, not the end of the response; between
+    // sentences it means the next one wasn't synthesized in time.
+    bool interrupted = false;
+    while (client.connected() || client.available()) {
+        if (respHead.chunked ? chunks.state >= CHUNK_DONE
+                             : respHead.contentLength >= 0 && bodyRead >= respHead.contentLength) break;
+        if (segmented && segments.state >= SEG_DONE) break;
+        // The user talked over the reply, or touched the screen: stop here
+        if (speaker.duplex && duplexBargedIn(&bargeInMark)) {
+            bargeInPending = true;
+            interrupted = true;
+            break;
+        }
+        M5.update();
+        if (M5.Touch.getCount() > 0 && M5.Touch.getDetail(0).wasPressed()) {
+            interrupted = true;
+            break;
+        }
+        if (!client.available()) {
+            if (!starved && !player.firstAudio) {
+                metricUnderruns.inc();
+                starved = true;
+            }
+            if (millis() - lastData > 3000) break; // stalled
+            delay(2);
+            continue;
+        }
         int bytesRead = client.read(playBuf, sizeof(playBuf));
         if (bytesRead > 0) {
-            // Calculate approx volume for Lip Sync
-            long sum = 0;
-            for(int i=0; i<bytesRead; i++) sum += abs((int8_t)playBuf[i]); // Simple PCM avg
-            int avgVol = sum / bytesRead;
-            
-            drawMouth(avgVol * 2); // Animate Mouth
-            
-            // Play Audio (Placeholder for actual PCM write)
-            // M5.Speaker.playRaw(playBuf, bytesRead, SAMPLE_RATE); 
-            // Note: playRaw might block, so we might need a buffer or separate task for smooth animation
-            // For MVP, we just animate based on read chunks
+            bodyRead += bytesRead;
+            lastData = millis();
+            starved = false;
+            size_t n = respHead.chunked ? chunkedDecode(chunks, playBuf, bytesRead) : bytesRead;
+            if (segmented) segmentFeed(segments, playBuf, n, player);
+            else if (n) player.play(playBuf, n);
         }
     }
+    if (segmented && segments.state == SEG_ERROR) {
+        Serial.printf("reply: bad segment stream after %lu segments\n", (unsigned long)segments.segments);
+    }
+    // Let the queued tail play out; an interruption cuts it
+    if (!interrupted) {
+        player.finish();
+        fillerReplyDrain(REPLY_BUFFER_MS * 4);
+    }
+    traceMark(TRACE_PLAYBACK_END);
+    traceEnd();
 
+    // On an interruption the unread body is simply dropped: closing with
+    // data pending sends a RST, which also stops the server streaming TTS
+    unsigned long stopStart = micros();
     client.stop();
+    if (interrupted) metricBargeInTeardownUs.record(micros() - stopStart);
+
+    // A persona switch on the dashboard shows up here: swap the clips
+    // between turns
+    if (respHead.persona[0] && strcmp(respHead.persona, fillerPersona()) != 0) {
+        fillerLoad(respHead.persona);
+        saveFillerPersona();
+    }
+    if (respHead.persona[0]) reactionCacheSetPersona(respHead.persona);
+    if (respHead.feature[0]) {
+        fishSetActive(strcmp(respHead.feature, FISH_FEATURE) == 0);
+        viewfinderSetFeature(strcmp(respHead.feature, VIEW_FEATURE) == 0);
+    }
+}
+
+// Shake/flip from the prefetched clips: no round trip. False on a miss.
+bool playReaction(ReactionTrigger t) {
+    ReactionClip clip;
+    if (!reactionTake(t, clip)) return false;
+    SpeakerScope speaker(false);
+    reactionPlayClip(clip);
+    return true;
 }
 
 // ==========================================
 // FACTORY TEST MODE
 // ==========================================
+// Hold the screen for 5 s at boot, or "factory run" on the serial console,
+// which reboots into it: the suite needs the radio, the LCD and I2S to
+// itself, before any of the background tasks start. Results stay up until
+// a tap reboots.
+bool takeFactoryBoot() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    bool run = p.getBool("factory_next", false);
+    if (run) p.remove("factory_next");
+    p.end();
+    return run;
+}
+
 void runFactoryTest() {
-    M5.Lcd.fillScreen(BLACK);
-    M5.Lcd.setTextColor(WHITE);
-    M5.Lcd.setTextSize(2);
-    M5.Lcd.setCursor(10, 10);
-    M5.Lcd.println("FACTORY TEST MODE");
-    delay(1000);
-
-    // 1. RGB Screen Test
-    M5.Lcd.fillScreen(RED);
-    delay(500);
-    M5.Lcd.fillScreen(GREEN);
-    delay(500);
-    M5.Lcd.fillScreen(BLUE);
-    delay(500);
-    M5.Lcd.fillScreen(BLACK);
-    
-    // 2. Audio Loopback
-    M5.Lcd.setCursor(10, 50);
-    M5.Lcd.println("Audio Loopback...");
-    M5.Mic.record(audioBuffer, AUDIO_BUF_SIZE, SAMPLE_RATE);
-    while (M5.Mic.isRecording()) delay(10);
-    M5.Speaker.begin();
-    M5.Speaker.setVolume(128);
-    // Note: M5CoreS3 speaker playback needs raw data handling or wav
-    // For simple test, we just beep if recording finished
-    M5.Speaker.tone(1000, 500); 
-
-    // 3. Camera Test
-    M5.Lcd.setCursor(10, 90);
-    M5.Lcd.println("Camera Preview...");
-    if (CoreS3.Camera.get()) {
-        // Draw frame to screen (Simplified, normally needs scaling)
-        M5.Lcd.pushImage(0, 0, 320, 240, (uint16_t*)CoreS3.Camera.fb->buf); 
-        CoreS3.Camera.free();
-        delay(2000); // Show for 2 sec
+    FactoryReport report;
+    factoryTestRun(report, DEVICE_ID.c_str(), CURRENT_VERSION);
+    M5.Lcd.setTextSize(1);
+    M5.Lcd.setTextColor(BLACK);
+    M5.Lcd.drawString("tap to reboot", 160, 234);
+    // The hold that started the test may still be on the glass
+    do {
+        delay(50);
+        M5.update();
+    } while (M5.Touch.getCount() > 0);
+    while (M5.Touch.getCount() == 0) {
+        delay(50);
+        M5.update();
+    }
+    ESP.restart();
+}
+
+// ==========================================
+// VOICE TURN
+// ==========================================
+// Record (or cut from the always-on ring from `mark` back by preRoll
+// samples), grab a frame and send. Shared by touch release and the wake
+// word; the caller opens the trace and the pre-warm.
+//
+// With the viewfinder on, the press captured a frame of what the user aimed
+// at: that one is sent instead of a new capture.
+camera_fb_t* heldSnapshot = nullptr;
+
+void runVoiceTurn(uint32_t mark, uint32_t preRoll) {
+    camera_fb_t* snapshot = heldSnapshot;
+    heldSnapshot = nullptr;
+    size_t audioLen = AUDIO_BUF_SIZE;
+    drawIcon("Listening...", ORANGE, "ear");
+    if (micStreamRunning()) {
+        audioLen = micStreamCapture(mark, preRoll, AUDIO_BUF_SIZE / 2, (int16_t*)audioBuffer,
+                                    RECORD_TIME_SEC * 1000 + 1000) * 2;
     } else {
-        M5.Lcd.println("CAM FAIL");
+        M5.Mic.record((int16_t*)audioBuffer, AUDIO_BUF_SIZE / 2, SAMPLE_RATE);
+        while (M5.Mic.isRecording()) delay(10);
+        // No live stream to hook here: clean the clip in one go. The noise
+        // floor starts from the clip's first 100 ms instead of the room.
+        if (audioPreprocOn) {
+            static AudioPreproc pp;
+            audioPreprocInit(pp, true, true);
+            audioPreprocRun(pp, (int16_t*)audioBuffer, AUDIO_BUF_SIZE / 2);
+        }
+    }
+    traceMark(TRACE_RECORD_END);
+    if (audioLen == 0) {
+        if (snapshot) cameraRelease(snapshot);
+        prewarmCancel();
+        traceEnd();
+        drawIcon("Mic Fail", RED, "none");
+        delay(1000);
+        drawIcon("Touch Me", BLUE, "none");
+        return;
     }
 
-    // 4. WiFi Scan
-    M5.Lcd.fillScreen(BLACK);
-    M5.Lcd.setCursor(10, 10);
-    M5.Lcd.println("WiFi Scan...");
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
-    int n = WiFi.scanNetworks();
-    M5.Lcd.printf("Found: %d\n", n);
-    delay(2000);
+    drawIcon("Thinking...", PURPLE, "load");
+    if (camera_fb_t* fb = snapshot ? snapshot : cameraCapture()) {
+         traceMark(TRACE_CAMERA_FRAME);
+         sendInteraction(fb, audioBuffer, audioLen, "", true);
+         cameraRelease(fb);
+    } else {
+         prewarmCancel();
+         traceEnd();
+         drawIcon("Cam Fail", RED, "none");
+         delay(1000);
+    }
+    drawIcon("Touch Me", BLUE, "none");
+}
 
-    // RESULT
-    M5.Lcd.fillScreen(GREEN);
-    M5.Lcd.setTextColor(BLACK);
-    M5.Lcd.setTextSize(4);
-    M5.Lcd.drawCenterString("PASS", 160, 100, 1);
-    
-    while(1); // Stop here
+// ==========================================
+// PRESENCE (PROXIMITY PRE-WAKE)
+// ==========================================
+// The proximity sensor sees a hand or face before the touch. An approach
+// gets everything a turn waits on going: backlight, CPU clock, the
+// camera out of standby and the TLS handshake. With nobody around
+// the screen dims, then sleeps with the CPU and radio slowed (presence.h).
+#define PRESENCE_WARM_HOLD_MS  10000 // walk-by: drop the unused connection
+#define PRESENCE_DIM_LEVEL     24
+#define PRESENCE_DEEP_CPU_MHZ  80    // Wi-Fi's floor
+#define PRESENCE_DEEP_LOOP_MS  40    // loop() naps in DEEP; a held touch still wakes
+
+Presence presence;
+bool     presenceSensor = false;
+uint8_t  displayBrightness = 0;   // what M5.begin() set, restored on wake
+uint16_t presenceLastPs = 0;
+uint32_t presenceWakeAt = 0;      // waiting for ready, 0 when not
+uint32_t presenceWarmAt = 0;      // approach pre-warm nobody has used yet
+uint32_t presenceLastReadyMs = 0;
+
+Histogram metricWakeToReadyMs("moodsoul_presence_wake_to_ready_ms", "Approach seen to screen on and connection ready, ms");
+Counter   metricPresenceWakes("moodsoul_presence_wakes_total", "Wakes from dim or deep idle");
+Gauge     metricPresenceState("moodsoul_presence_state", "0 active, 1 dim, 2 deep");
+
+void presenceSetup() {
+    displayBrightness = M5.Display.getBrightness();
+    uint16_t ps = 0;
+    presenceSensor = proximityRead(&ps);
+    presenceInit(presence, ps, millis());
+}
+
+void presenceHandle(const PresenceEvents& ev) {
+    uint32_t now = millis();
+    if (ev.wake) {
+        metricPresenceWakes.inc();
+        M5.Display.wakeup();
+        M5.Display.setBrightness(displayBrightness);
+        setCpuFrequencyMhz(240);
+        proximitySetSlow(false);
+        wifiLinkSetIdle(false);
+    }
+    // Someone walked up: have the turn's slow parts done before the touch
+    if (ev.approach && !fishActive() && !traceActive()) {
+        presenceWakeAt = now;
+        cameraPrepare(); // out of standby, exposure settles before the touch
+        if (wifiLinkQuality().tier != LINK_DOWN && prewarmConnect(SERVER_HOST, SERVER_PORT)) {
+            presenceWarmAt = now;
+        }
+    }
+    if (ev.dim) M5.Display.setBrightness(PRESENCE_DIM_LEVEL);
+    if (ev.deep) {
+        M5.Display.setBrightness(0);
+        M5.Display.sleep();
+        cameraPowerOff();
+        // The wake word needs the full clock to keep up
+        if (!micStreamRunning()) setCpuFrequencyMhz(PRESENCE_DEEP_CPU_MHZ);
+        proximitySetSlow(true);
+        wifiLinkSetIdle(true);
+    }
+    if (ev.wake || ev.dim || ev.deep) metricPresenceState.set(presence.state);
+}
+
+// Touches, turns and wake words count as presence too.
+void presenceNote() {
+    presenceHandle(presenceActivity(presence, millis()));
+}
+
+void presencePoll() {
+    uint32_t now = millis();
+    if (M5.Touch.getCount() > 0 || traceActive()) presenceNote();
+
+    static uint32_t lastPoll = 0;
+    uint16_t ps;
+    if (presenceSensor && now - lastPoll >= presencePollMs(presence) && proximityRead(&ps)) {
+        lastPoll = now;
+        presenceLastPs = ps;
+        presenceHandle(presenceUpdate(presence, ps, now));
+    } else if (!presenceSensor) {
+        presenceHandle(presenceUpdate(presence, 0, now)); // timers only
+    }
+
+    if (presenceWakeAt && !prewarmInFlight()) {
+        presenceLastReadyMs = now - presenceWakeAt;
+        metricWakeToReadyMs.record(presenceLastReadyMs);
+        presenceWakeAt = 0;
+    }
+    if (presenceWarmAt && (now - presenceWarmAt > PRESENCE_WARM_HOLD_MS || traceActive())) {
+        if (!traceActive() && prewarmIdleConnected()) prewarmCancel();
+        presenceWarmAt = 0;
+    }
+    if (presence.state == PRESENCE_DEEP) delay(PRESENCE_DEEP_LOOP_MS);
+}
+
+// ==========================================
+// SERIAL CONSOLE
+// ==========================================
+// Line commands for bench debugging:
+//   trace  - dump the last interaction traces
+//   boot   - boot phase timings
+//   mic on|off|preroll <ms>|stats - always-on mic mode
+//   wake on|off|threshold <pct>|stats - wake word (needs the mic on)
+//   preproc on|off|stats - capture noise suppression and AGC
+//   barge on|off|stats - talk over replies to interrupt them (needs the mic on)
+//   reactions [clear] - shake/flip clip cache hit rate and flash use
+//   assets - asset pack version and contents
+//   fish on|off|stats - Cyber Zen wooden fish mode
+//   presence - proximity reading, idle state, wake latency, battery saved
+//   camera - power state, resume latency, streaming duty cycle
+//   view on|off|stats - live camera preview between turns
+void saveMicSettings() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("mic_always", micAlwaysOn);
+    p.putUInt("mic_preroll", micPreRollMs);
+    p.end();
+}
+
+void loadMicSettings() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    micAlwaysOn = p.getBool("mic_always", false);
+    micPreRollMs = std::min<uint32_t>(p.getUInt("mic_preroll", 300), MIC_PREROLL_MAX_MS);
+    p.end();
+}
+
+void saveWakeSettings() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("wake_on", wakeWordOn);
+    p.putUChar("wake_thresh", wakeThresholdPct);
+    p.end();
+}
+
+void loadWakeSettings() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    wakeWordOn = p.getBool("wake_on", false);
+    wakeThresholdPct = p.getUChar("wake_thresh", 85);
+    p.end();
+}
+
+void savePreprocSettings() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("preproc", audioPreprocOn);
+    p.end();
+}
+
+void loadPreprocSettings() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    audioPreprocOn = p.getBool("preproc", true);
+    p.end();
+}
+
+void saveBargeSettings() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("barge_on", bargeInOn);
+    p.end();
+}
+
+void loadBargeSettings() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    bargeInOn = p.getBool("barge_on", false);
+    p.end();
+}
+
+void saveFillerPersona() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putString("persona", fillerPersona());
+    p.end();
+}
+
+void saveTurnQuota() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putInt("quota_left", turnQuota.remaining);
+    p.putUInt("quota_reset", turnQuota.resetAtS);
+    p.end();
+    metricQuotaRemaining.set(turnQuota.remaining);
+}
+
+void loadTurnQuota() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    int32_t left = p.getInt("quota_left", -1);
+    uint32_t resetAt = p.getUInt("quota_reset", 0);
+    p.end();
+    quotaInit(turnQuota, millis(), left, resetAt);
+    metricQuotaRemaining.set(left);
+}
+
+void loadFillerPersona() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    String id = p.getString("persona", "default");
+    p.end();
+    fillerLoad(id.c_str());
+}
+
+void handleMicCommand(String arg) {
+    arg.trim();
+    if (arg == "on") {
+        micAlwaysOn = micStreamStart(SAMPLE_RATE);
+        saveMicSettings();
+    } else if (arg == "off") {
+        wakeWordStop(); // nothing left to listen to
+        wakeWordOn = false;
+        saveWakeSettings();
+        bargeInOn = false;
+        saveBargeSettings();
+        micStreamStop();
+        micAlwaysOn = false;
+        saveMicSettings();
+    } else if (arg.startsWith("preroll")) {
+        micPreRollMs = std::min<uint32_t>(arg.substring(7).toInt(), MIC_PREROLL_MAX_MS);
+        saveMicSettings();
+    }
+    // Compare battery current with the mode on and off for its power cost
+    MicStreamStats st = micStreamStats();
+    Serial.printf("mic always_on=%d preroll_ms=%lu cpu_permille=%lu overruns=%lu running_ms=%lu battery_ma=%ld\n",
+                  micStreamRunning(), (unsigned long)micPreRollMs, (unsigned long)st.cpuPermille,
+                  (unsigned long)st.overruns, (unsigned long)st.runningMs, (long)M5.Power.getBatteryCurrent());
+}
+
+void handleWakeCommand(String arg) {
+    arg.trim();
+    if (arg == "on") {
+        if (!micStreamRunning()) {
+            micAlwaysOn = micStreamStart(SAMPLE_RATE);
+            saveMicSettings();
+        }
+        wakeWordOn = wakeWordStart(wakeThresholdPct);
+        if (!wakeWordOn) Serial.println("wake: unavailable (no model in kws_model_data.h, or mic failed)");
+        saveWakeSettings();
+    } else if (arg == "off") {
+        wakeWordStop();
+        wakeWordOn = false;
+        saveWakeSettings();
+    } else if (arg.startsWith("threshold")) {
+        wakeThresholdPct = std::min<int>(std::max<int>(arg.substring(9).toInt(), 1), 100);
+        wakeWordSetThreshold(wakeThresholdPct);
+        saveWakeSettings();
+    }
+    WakeWordStats st = wakeWordStats();
+    Serial.printf("wake on=%d threshold=%u detections=%lu inferences=%lu avg_infer_us=%lu last_score=%u\n",
+                  wakeWordRunning(), wakeThresholdPct, (unsigned long)st.detections,
+                  (unsigned long)st.inferences, (unsigned long)st.avgInferUs, st.lastScorePct);
+}
+
+void handlePreprocCommand(String arg) {
+    arg.trim();
+    if (arg == "on" || arg == "off") {
+        audioPreprocOn = arg == "on";
+        micStreamSetPreproc(audioPreprocOn);
+        savePreprocSettings();
+    }
+    // Cost per 10 ms block on the live stream (the mic must be on)
+    MicStreamStats st = micStreamStats();
+    Serial.printf("preproc on=%d p99_cycles=%lu max_cycles=%lu budget_cycles=%d over_budget=%lu\n",
+                  audioPreprocOn, (unsigned long)st.preprocP99Cycles, (unsigned long)st.preprocMaxCycles,
+                  PREPROC_BLOCK_CYCLE_BUDGET, (unsigned long)st.preprocOverBudget);
+}
+
+void handleBargeCommand(String arg) {
+    arg.trim();
+    if (arg == "on") {
+        if (!micStreamRunning()) {
+            micAlwaysOn = micStreamStart(SAMPLE_RATE);
+            saveMicSettings();
+        }
+        bargeInOn = micStreamRunning();
+        saveBargeSettings();
+    } else if (arg == "off") {
+        bargeInOn = false;
+        saveBargeSettings();
+    }
+    // AEC cost and reaction time come from the last replies played
+    DuplexStats st = duplexStats();
+    Serial.printf("barge on=%d barge_ins=%lu last_latency_ms=%lu aec_p99_cycles=%lu duplex_cpu_permille=%lu erle_db=%.1f\n",
+                  bargeInOn, (unsigned long)st.bargeIns, (unsigned long)st.lastLatencyMs,
+                  (unsigned long)st.aecP99Cycles, (unsigned long)st.cpuPermille, st.erleDb);
+}
+
+void handleReactionsCommand(String arg) {
+    arg.trim();
+    if (arg == "clear") reactionCacheClear();
+    ReactionCacheStats st = reactionCacheStats();
+    uint32_t plays = st.hits + st.misses;
+    Serial.printf("reactions hits=%lu misses=%lu hit_rate=%.2f clips=%u fresh=%u bytes=%lu budget=%lu fetches=%lu fetch_errors=%lu\n",
+                  (unsigned long)st.hits, (unsigned long)st.misses, plays ? (float)st.hits / plays : 0.0f,
+                  st.clips, st.fresh, (unsigned long)st.bytes, (unsigned long)st.budget,
+                  (unsigned long)st.fetches, (unsigned long)st.fetchErrors);
+}
+
+void handleAssetsCommand() {
+    const AssetPack* pack = assetStorePack();
+    if (!pack) {
+        Serial.println("assets: no pack");
+        return;
+    }
+    Serial.printf("assets version=%lu entries=%lu bytes=%lu\n", (unsigned long)pack->header->packVersion,
+                  (unsigned long)pack->header->count, (unsigned long)pack->header->totalSize);
+    assetForEach(*pack, [](const char* name, const AssetEntry& e, void*) {
+        Serial.printf("  %s %lu%s\n", name, (unsigned long)e.rawSize, (e.flags & ASSET_LZ4) ? " lz4" : "");
+    }, nullptr);
+}
+
+void handleFishCommand(String arg) {
+    arg.trim();
+    if (arg == "on") fishSetActive(true);
+    else if (arg == "off") fishSetActive(false);
+    FishStats st = fishStats();
+    Serial.printf("fish %s total=%lu acked=%lu pending=%lu uploads=%lu upload_errors=%lu server_total=%lu\n",
+                  fishActive() ? "on" : "off", (unsigned long)st.total, (unsigned long)st.acked,
+                  (unsigned long)st.pending, (unsigned long)st.uploads, (unsigned long)st.uploadErrors,
+                  (unsigned long)st.serverTotal);
+}
+
+// "factory run" (reboots into factory test mode), or "factory <host:port>"
+// for the station ("factory -" to go back to the gateway).
+void handleFactoryCommand(String arg) {
+    arg.trim();
+    if (arg == "run") {
+        Preferences p;
+        p.begin("moodsoul", false);
+        p.putBool("factory_next", true);
+        p.end();
+        Serial.println("factory: rebooting into factory test mode");
+        delay(100);
+        ESP.restart();
+    } else if (arg.length()) {
+        factorySetStation(arg == "-" ? "" : arg.c_str());
+        Serial.printf("factory station=%s\n", arg == "-" ? "gateway" : arg.c_str());
+    }
+}
+
+void handleHeartbeatCommand(String arg) {
+    arg.trim();
+    if (arg == "now") heartbeatNow();
+    HeartbeatStats st = heartbeatStats();
+    Serial.printf("heartbeat sent=%lu failed=%lu last_status=%d last_bytes=%lu next_in_s=%lu\n",
+                  (unsigned long)st.sent, (unsigned long)st.failed, st.lastStatus,
+                  (unsigned long)st.lastBytes, (unsigned long)(st.nextInMs / 1000));
+}
+
+void handlePresenceCommand() {
+    Serial.printf("presence state=%s sensor=%d ps=%u baseline=%ld near=%d wakes=%lu wake_to_ready_ms=%lu\n",
+                  presenceStateName(presence.state), presenceSensor, presenceLastPs,
+                  (long)(presence.baselineQ >> PRESENCE_BASELINE_SHIFT), presence.near,
+                  (unsigned long)presence.wakes, (unsigned long)presenceLastReadyMs);
+    for (int st = 0; st < PRESENCE_STATES; st++) {
+        uint64_t ms = presence.msIn[st];
+        Serial.printf("  %-6s %8lu s  avg %5.1f mA\n", presenceStateName((PresenceState)st),
+                      (unsigned long)(ms / 1000), ms ? (double)presence.maMsIn[st] / ms : 0.0);
+    }
+    Serial.printf("  saved %.2f mAh versus staying active\n", presenceSavedMah(presence));
+}
+
+void handleCameraCommand() {
+    CameraStats st = cameraStats();
+    Serial.printf("camera state=%s resumes=%lu cold_starts=%lu last_resume_ms=%lu settle_frames=%lu over_budget=%lu duty_permille=%lu\n",
+                  cameraPowerName(st.state), (unsigned long)st.resumes, (unsigned long)st.coldStarts,
+                  (unsigned long)st.lastResumeMs, (unsigned long)st.lastSettleFrames,
+                  (unsigned long)st.budgetMisses, (unsigned long)st.dutyPermille);
+}
+
+void handleViewCommand(String arg) {
+    arg.trim();
+    if (arg == "on" || arg == "off") {
+        viewfinderSetEnabled(arg == "on");
+        if (!viewfinderOn()) drawIcon("Touch Me", BLUE, "none");
+    }
+    ViewStats st = viewfinderStats();
+    Serial.printf("view %s frames=%lu late=%lu fps=%.1f frame_us=%lu shrink=%u format=%s\n", st.on ? "on" : "off",
+                  (unsigned long)st.frames, (unsigned long)st.late, st.fps10 / 10.0, (unsigned long)st.lastFrameUs,
+                  st.shrink, st.jpeg ? "jpeg" : "rgb565");
+}
+
+void handleSerialCommand() {
+    if (!Serial.available()) return;
+    String cmd = Serial.readStringUntil('\n');
+    cmd.trim();
+
+    if (cmd == "trace") {
+        traceDump([](const char* line) { Serial.println(line); });
+    } else if (cmd == "boot") {
+        bootReport([](const char* line) { Serial.println(line); });
+    } else if (cmd.startsWith("mic")) {
+        handleMicCommand(cmd.substring(3));
+    } else if (cmd.startsWith("wake")) {
+        handleWakeCommand(cmd.substring(4));
+    } else if (cmd.startsWith("preproc")) {
+        handlePreprocCommand(cmd.substring(7));
+    } else if (cmd.startsWith("barge")) {
+        handleBargeCommand(cmd.substring(5));
+    } else if (cmd.startsWith("reactions")) {
+        handleReactionsCommand(cmd.substring(9));
+    } else if (cmd == "assets") {
+        handleAssetsCommand();
+    } else if (cmd.startsWith("fish")) {
+        handleFishCommand(cmd.substring(4));
+    } else if (cmd.startsWith("factory")) {
+        handleFactoryCommand(cmd.substring(7));
+    } else if (cmd.startsWith("heartbeat")) {
+        handleHeartbeatCommand(cmd.substring(9));
+    } else if (cmd == "presence") {
+        handlePresenceCommand();
+    } else if (cmd == "camera") {
+        handleCameraCommand();
+    } else if (cmd.startsWith("view")) {
+        handleViewCommand(cmd.substring(4));
+    } else if (cmd.length() > 0) {
+        Serial.println("unknown command: " + cmd);
+    }
+}
+
+// ==========================================
+// BOOT STEPS (run in parallel by setup())
+// ==========================================
+// Camera, IMU and mic codec all sit on the internal I2C bus, so they stay
+// in one task; Wi-Fi and the PSRAM buffer don't touch it.
+void initPeripherals() {
+    cameraPowerBegin(); // left in standby until a frame is wanted
+    M5.Imu.begin();
+    M5.Mic.begin();
+    proximityBegin();
+}
+
+void initAudioBuffer() {
+    audioBuffer = (uint8_t*)heap_caps_malloc(AUDIO_BUF_SIZE + AUDIO_PREROLL_MAX_BYTES, MALLOC_CAP_SPIRAM);
+}
+
+void initWifiFast() {
+    WiFi.mode(WIFI_STA);
+    DEVICE_ID = WiFi.macAddress();
+    DEVICE_ID.replace(":", ""); // Clean MAC for ID
+    bool fast = wifiFastConnect(3000, SERVER_HOST);
+    bootPhaseNote(BOOT_WIFI, fast ? "fast" : "no cache");
 }
 
 void setup() {
     M5.begin();
     auto cfg = M5.config();
     CoreS3.begin(cfg);
-    CoreS3.Camera.begin();
-    
-    // FACTORY TEST TRIGGER: Hold Screen on Boot
+
+#ifdef MOODSOUL_BENCH
+    // Benchmark image (env:m5stack-cores3-bench): run the same kernels as
+    // the host suite, print the JSON report on serial, then idle.
+    drawIcon("Benchmarking", YELLOW, "load");
+    delay(2000); // let the serial monitor attach
+    benchRunAll(nullptr, "m5stack-cores3-bench", [](const char* line) { Serial.println(line); });
+    drawIcon("Bench Done", GREEN, "none");
+    while (1) delay(1000);
+#endif
+
+    drawIcon("Waking Up", YELLOW, "load");
+    static const BootStep initSteps[] = {
+        { "boot_periph", BOOT_PERIPHERALS, initPeripherals, 4096, 1 },
+        { "boot_psram",  BOOT_PSRAM,       initAudioBuffer, 2048, 1 },
+        { "boot_wifi",   BOOT_WIFI,        initWifiFast,    4096, 0 },
+    };
+    bootRunParallel(initSteps, sizeof(initSteps) / sizeof(initSteps[0]));
+
+    // FACTORY TEST TRIGGER: Hold Screen on Boot, or "factory run"
+    if (takeFactoryBoot()) runFactoryTest();
     if (M5.Touch.getCount() > 0) {
         unsigned long startHold = millis();
         while (M5.Touch.getCount() > 0) {
@@ -491,57 +1337,144 @@ void setup() {
         }
     }
     
-    // Init IMU & Mic
-    M5.Imu.begin();
-    M5.Mic.begin();
-
-    // Allocate Audio Buffer
-    audioBuffer = (uint8_t*)heap_caps_malloc(AUDIO_BUF_SIZE, MALLOC_CAP_SPIRAM);
     if (!audioBuffer) {
         drawIcon("Mem Fail", RED, "none");
         while(1);
     }
 
+    loadPreprocSettings();
+    micStreamSetPreproc(audioPreprocOn);
+    loadMicSettings();
+    if (micAlwaysOn) micStreamStart(SAMPLE_RATE);
+    loadWakeSettings();
+    if (wakeWordOn && micStreamRunning()) wakeWordStart(wakeThresholdPct);
+    loadBargeSettings();
+    bargeInOn = bargeInOn && micStreamRunning();
+    assetStoreBegin();
+    loadFillerPersona();
+    loadTurnQuota();
+
     // ------------------------------------------
-    // 1. WiFi Provisioning (WiFiManager)
+    // 1. WiFi Provisioning (WiFiManager), only if the fast join failed
     // ------------------------------------------
-    drawIcon("Setup WiFi", YELLOW, "load");
-    // Resize QR: 160px box, centered, top margin 20
-    // x = (320-160)/2 = 80
-    M5.Lcd.qrcode("WIFI:S:MoodSoul_Setup;T:nopass;;", 80, 20, 160, 6);
-    
-    M5.Lcd.setTextDatum(MC_DATUM);
-    M5.Lcd.setTextSize(2);
-    M5.Lcd.setTextColor(CYAN);
-    M5.Lcd.drawString("Scan to Setup WiFi", 160, 200);
-    
-    WiFiManager wm;
-    bool res = wm.autoConnect("MoodSoul_Setup"); 
-    if(!res) {
-        drawIcon("WiFi Fail", RED, "none");
-        // ESP.restart();
-    } 
-    else {
-        drawIcon("Connected!", GREEN, "none");
-        delay(1000);
+    if (WiFi.status() != WL_CONNECTED) {
+        drawIcon("Setup WiFi", YELLOW, "load");
+        // Resize QR: 160px box, centered, top margin 20
+        // x = (320-160)/2 = 80
+        M5.Lcd.qrcode("WIFI:S:MoodSoul_Setup;T:nopass;;", 80, 20, 160, 6);
+
+        M5.Lcd.setTextDatum(MC_DATUM);
+        M5.Lcd.setTextSize(2);
+        M5.Lcd.setTextColor(CYAN);
+        M5.Lcd.drawString("Scan to Setup WiFi", 160, 200);
+
+        WiFiManager wm;
+        bool res = wm.autoConnect("MoodSoul_Setup");
+        bootPhaseNote(BOOT_WIFI, res ? "scan+dhcp" : "failed");
+        bootPhaseEnd(BOOT_WIFI);
+        if (!res) {
+            drawIcon("WiFi Fail", RED, "none");
+            // ESP.restart();
+        } else {
+            wifiSaveCache();
+        }
     }
-    
-    // Check for Updates on Boot
-    checkUpdate();
-    
-    // Check Binding Status
+    bool online = WiFi.status() == WL_CONNECTED;
+    if (online) metricsServerStart();
+    configTime(0, 0, "pool.ntp.org", "time.google.com"); // UTC, for the quota reset
+    wifiLinkStart(); // from here on drops are repaired in place
+
+    // Check Binding Status (instant once bound)
+    bootPhaseBegin(BOOT_BINDING);
     checkBinding();
+    bootPhaseEnd(BOOT_BINDING);
 
+    bootPhaseEnd(BOOT_INTERACTIVE);
+    drawIcon("Touch Me", BLUE, "none");
+    bootReport([](const char* line) { Serial.println(line); });
+
+    // Shake/flip clips for the active persona, refilled while charging
+    reactionCacheInit(fillerPersona(), SERVER_HOST, REACTIONS_PATH, DEVICE_ID.c_str());
+    // Wooden fish counts, flushed in the background
+    fishBegin(SERVER_HOST, MERIT_PATH, DEVICE_ID.c_str());
+    // Liveness plus fleet telemetry, between turns
+    heartbeatBegin(SERVER_HOST, PING_PATH, DEVICE_ID.c_str(), CURRENT_VERSION);
+    viewfinderBegin();
+    presenceSetup();
+
+    // Check for Updates in the background
+    if (online) xTaskCreatePinnedToCore(otaTask, "ota", 12288, nullptr, 1, nullptr, 0);
+}
+
+// Cyber Zen takes the screen, touch and speaker (the mic pauses, as for a
+// reply) until the dashboard or a long press switches it off.
+void fishModeEnter() {
+    prewarmCancel();
+    if (micStreamRunning()) micStreamPause();
+    M5.Speaker.begin();
+    M5.Speaker.setVolume(128);
+    fishScreen();
+}
+
+void fishModeExit() {
+    if (micStreamRunning()) {
+        M5.Speaker.end();
+        micStreamResume();
+    }
     drawIcon("Touch Me", BLUE, "none");
 }
 
 void loop() {
     M5.update();
+    handleSerialCommand();
+    presencePoll();
+    cameraIdle(millis());
+
+    // Taps are counted and drawn in this pass; nothing else runs meanwhile
+    static bool fishOn = false;
+    if (fishActive() != fishOn) {
+        fishOn = !fishOn;
+        if (fishOn) fishModeEnter();
+        else fishModeExit();
+    }
+    if (fishOn && !otaRebootPending) {
+        if (M5.Touch.getCount() > 0) {
+            auto t = M5.Touch.getDetail(0);
+            if (t.wasPressed()) fishTap(t.x, t.y);
+            if (t.wasHold()) fishSetActive(false);
+        }
+        fishAnimate(millis());
+        return;
+    }
+
+    // Between turns is the safe moment to boot a freshly verified image
+    if (otaRebootPending) {
+        drawIcon("REBOOTING!", GREEN, "none");
+        delay(1000);
+        ESP.restart();
+    }
 
     // ------------------------------------------
     // 4. Low Battery Logic
     // ------------------------------------------
     int battery = M5.Power.getBatteryLevel();
+
+    static unsigned long lastGaugeUpdate = 0;
+    if (millis() - lastGaugeUpdate > 1000) {
+        lastGaugeUpdate = millis();
+        metricBattery.set(battery);
+        int32_t current = M5.Power.getBatteryCurrent();
+        metricBatteryCurrent.set(current);
+        presenceAccount(presence, current < 0 ? -current : 0, millis());
+        micStreamStats(); // refreshes the capture CPU gauge
+        cameraStats();    // and the camera duty gauge
+        metricRssi.set(WiFi.RSSI());
+        metricFreePsram.set(heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+        metricFreeHeap.set(heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        heartbeatSample();
+        // Offline at boot: serve metrics from the first time the link is up
+        if (WiFi.status() == WL_CONNECTED) metricsServerStart();
+    }
     if (battery < 20) {
         drawIcon("LOW BATT", RED, "tired");
         // Block high energy features
@@ -552,61 +1485,77 @@ void loop() {
     float accX, accY, accZ;
     M5.Imu.getAccelData(&accX, &accY, &accZ);
 
+    static MotionState motion = { 0, 0, false, 0, -1, false };
+    MotionEvents ev = motionUpdate(motion, accX, accY, accZ, millis(),
+                                   M5.Power.isCharging(), current_rotation);
+
     // 4. Proactive Vision (Auto Observe)
-    // Detect subtle vibration (e.g., sitting down) when plugged in
-    static unsigned long lastAutoObserveTime = 0;
-    static unsigned long vibrationStartTime = 0;
-    static bool isVibrating = false;
-
-    // Only active if battery is charging (plugged in) or high enough
-    // And don't spam: wait at least 5 minutes between proactive checks
-    if (M5.Power.isCharging() && millis() - lastAutoObserveTime > 300000) {
-        // Simple vibration threshold (lower than shake)
-        if (abs(accX) > 1.2 || abs(accY) > 1.2) {
-             if (!isVibrating) {
-                 isVibrating = true;
-                 vibrationStartTime = millis();
-             } else {
-                 // If vibration stops or settles after 2 seconds
-                 if (millis() - vibrationStartTime > 2000) {
-                      // Trigger Auto Observe
-                      lastAutoObserveTime = millis();
-                      isVibrating = false;
-                      
-                      // Silent Capture (Don't change screen)
-                      if (CoreS3.Camera.get()) {
-                           // Send with specific trigger
-                           // Send empty audio buffer
-                           memset(audioBuffer, 0, 1024);
-                           sendInteraction(CoreS3.Camera.fb, audioBuffer, 1024, "AUTO_OBSERVE");
-                           CoreS3.Camera.free();
-                      }
-                 }
-             }
-        } else {
-            isVibrating = false;
+    // Unprompted photo uploads wait for a decent link, and for a turn the
+    // server would take (no camera work for one it would refuse)
+    if (ev.autoObserve && !heldSnapshot && wifiLinkQuality().tier >= LINK_FAIR &&
+        quotaCheck(turnQuota, millis(), clockNowS()) == QUOTA_OK) {
+        // Silent Capture (Don't change screen)
+        if (camera_fb_t* fb = cameraCapture()) {
+            traceBegin("AUTO_OBSERVE");
+            traceMark(TRACE_CAMERA_FRAME);
+            // Send with specific trigger
+            // Send empty audio buffer
+            memset(audioBuffer, 0, 1024);
+            sendInteraction(fb, audioBuffer, 1024, "AUTO_OBSERVE");
+            cameraRelease(fb);
         }
     }
 
+    // Reaction clips are fetched in the background while it sits idle on
+    // the charger
+    reactionPrefetchAllow(M5.Power.isCharging() && M5.Touch.getCount() == 0);
+
+    // Picked up, shaken or turned: someone's there
+    if (ev.shake || ev.upsideDown || ev.orientation >= 0) presenceNote();
+
     // 1. Shake Detection (Explicit High-G Shake)
-    static unsigned long lastShakeTime = 0;
-    if (abs(accX) > 2.5 && millis() - lastShakeTime > 3000) { 
-        lastShakeTime = millis();
+    if (ev.shake) {
         drawIcon("DIZZY!", ORANGE, "dizzy");
-        memset(audioBuffer, 0, 1024); 
-        sendInteraction(nullptr, audioBuffer, 1024, "SHAKE_EVENT");
+        if (!playReaction(REACT_SHAKE)) {
+            memset(audioBuffer, 0, 1024); 
+            sendInteraction(nullptr, audioBuffer, 1024, "SHAKE_EVENT");
+        }
         delay(2000); 
         drawIcon("Touch Me", BLUE, "none");
     }
 
+    // Turned face down
+    if (ev.upsideDown) {
+        if (!playReaction(REACT_UPSIDE_DOWN)) {
+            memset(audioBuffer, 0, 1024); 
+            sendInteraction(nullptr, audioBuffer, 1024, "UPSIDE_DOWN");
+        }
+    }
+
     // 2. Orientation
-    static int lastMode = -1;
-    int targetMode = current_rotation;
-    if (accY > 0.8) targetMode = 0;
-    else if (accY < -0.8) targetMode = 2;
-    if (targetMode != lastMode) {
-        setMoodcubeOrientation(targetMode);
-        lastMode = targetMode;
+    if (ev.orientation >= 0) {
+        setMoodcubeOrientation(ev.orientation);
+    }
+
+    // 5. Wake Word (hands-free turn; the request starts where the keyword ended)
+    uint32_t wakeMark;
+    if (wakeWordPoll(&wakeMark)) {
+        presenceNote();
+        traceBegin("WAKE_WORD");
+        traceMark(TRACE_TOUCH_RELEASE);
+        if (wifiLinkQuality().tier != LINK_DOWN) prewarmBegin(SERVER_HOST, SERVER_PORT, SERVER_PATH);
+        runVoiceTurn(wakeMark, 0);
+        wakeWordRearm();
+    }
+
+    // 6. Barge-in (the user talked over the last reply: that's the next turn)
+    if (bargeInPending) {
+        bargeInPending = false;
+        traceBegin("BARGE_IN");
+        traceMark(TRACE_TOUCH_RELEASE);
+        if (wifiLinkQuality().tier != LINK_DOWN) prewarmBegin(SERVER_HOST, SERVER_PORT, SERVER_PATH);
+        runVoiceTurn(bargeInMark, BARGE_PREROLL_MS * SAMPLE_RATE / 1000);
+        wakeWordRearm();
     }
 
     // 3. Touch Interaction
@@ -614,32 +1563,39 @@ void loop() {
         auto detail = M5.Touch.getDetail(0);
         
         if (detail.wasPressed()) {
-             M5.Speaker.tone(800, 50); 
+             // Most presses become turns: get the connection ready now
+             if (wifiLinkQuality().tier != LINK_DOWN) {
+                 traceBegin("");
+                 traceMark(TRACE_TOUCH_DOWN);
+                 prewarmBegin(SERVER_HOST, SERVER_PORT, SERVER_PATH);
+             }
+             // A fresh frame, left on screen: the one this turn will send
+             if (viewfinderOn() && !heldSnapshot) heldSnapshot = viewfinderSnapshot();
+             // No click in always-on mode: it would land in the pre-roll
+             if (!micStreamRunning()) M5.Speaker.tone(800, 50); 
              M5.Lcd.drawCircle(detail.x, detail.y, 20, WHITE);
         }
         
         if (detail.wasReleased()) {
                 if (abs(detail.x - 160) < 80 && abs(detail.y - 120) < 80) {
+                    prewarmCancel();
+                    traceCancel();
+                    if (heldSnapshot) {
+                        cameraRelease(heldSnapshot);
+                        heldSnapshot = nullptr;
+                    }
                     setMoodcubeOrientation(current_rotation == 0 ? 2 : 0);
                     drawIcon("Touch Me", BLUE, "none");
                     return;
                 }
-            drawIcon("Listening...", ORANGE, "ear");
-            M5.Mic.record(audioBuffer, AUDIO_BUF_SIZE, SAMPLE_RATE);
-            while (M5.Mic.isRecording()) delay(10);
-
-            // 2. Latency Masking: Play "Thinking" sound immediately
-            // playThinkingSound(); // (Pseudocode)
-
-            drawIcon("Thinking...", PURPLE, "load");
-            if (CoreS3.Camera.get()) {
-                 sendInteraction(CoreS3.Camera.fb, audioBuffer, AUDIO_BUF_SIZE);
-                 CoreS3.Camera.free();
-            } else {
-                 drawIcon("Cam Fail", RED, "none");
-                 delay(1000);
-            }
-            drawIcon("Touch Me", BLUE, "none");
+            if (!traceActive()) traceBegin("");
+            traceMark(TRACE_TOUCH_RELEASE);
+            // Always-on mic: keep the last preroll ms before the release
+            runVoiceTurn(micStreamMark(), micPreRollMs * SAMPLE_RATE / 1000);
+            wakeWordRearm(); // a keyword said during the turn is not a new one
         }
     }
+
+    // Live preview while nobody's touching and the screen is fully on
+    if (M5.Touch.getCount() == 0 && presence.state == PRESENCE_ACTIVE) viewfinderPoll(millis());
 }
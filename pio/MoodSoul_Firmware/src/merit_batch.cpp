@@ -0,0 +1,58 @@
+#include "merit_batch.h"
+
+void meritInit(MeritBatch& m, uint32_t total, uint32_t acked, uint32_t seq, uint32_t inflight) {
+    m.total = total;
+    m.acked = acked;
+    m.seq = seq;
+    m.inflight = inflight;
+    if (m.acked + m.inflight > m.total) m.inflight = m.total - m.acked; // torn save: trust total
+    // Saved before the cap: the server never took that seq, so it can shrink
+    if (m.inflight > MERIT_MAX_BATCH) m.inflight = MERIT_MAX_BATCH;
+    m.oldestMs = 0;
+    m.retryAtMs = 0;
+    m.backoffMs = 0;
+}
+
+uint32_t meritPending(const MeritBatch& m) {
+    return m.total - m.acked - m.inflight;
+}
+
+void meritAdd(MeritBatch& m, uint32_t taps, uint32_t nowMs) {
+    if (!taps) return;
+    if (!meritPending(m)) m.oldestMs = nowMs;
+    m.total += taps;
+}
+
+bool meritDue(MeritBatch& m, uint32_t nowMs, MeritUpload& up, bool* cut) {
+    *cut = false;
+    if (m.backoffMs && (int32_t)(nowMs - m.retryAtMs) < 0) return false;
+    if (!m.inflight) {
+        uint32_t pending = meritPending(m);
+        if (!pending || (pending < MERIT_FLUSH_TAPS && nowMs - m.oldestMs < MERIT_FLUSH_MS)) return false;
+        m.seq++;
+        m.inflight = pending < MERIT_MAX_BATCH ? pending : MERIT_MAX_BATCH;
+        *cut = true;
+    }
+    up.seq = m.seq;
+    up.taps = m.inflight;
+    return true;
+}
+
+void meritAcked(MeritBatch& m, uint32_t seq) {
+    if (!m.inflight || seq != m.seq) return;
+    m.acked += m.inflight;
+    m.inflight = 0;
+    m.backoffMs = 0;
+}
+
+void meritFailed(MeritBatch& m, uint32_t nowMs) {
+    m.backoffMs = m.backoffMs ? m.backoffMs * 2 : MERIT_RETRY_MS;
+    if (m.backoffMs > MERIT_RETRY_MAX_MS) m.backoffMs = MERIT_RETRY_MAX_MS;
+    m.retryAtMs = nowMs + m.backoffMs;
+}
+
+bool meritAdoptSeq(MeritBatch& m, uint32_t serverSeq) {
+    if (m.inflight || serverSeq <= m.seq) return false;
+    m.seq = serverSeq;
+    return true;
+}
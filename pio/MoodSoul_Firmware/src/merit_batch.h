@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// MERIT BATCHING (Cyber Zen taps)
+// ==========================================
+// Wooden-fish taps are counted on the device and sent as coalesced
+// deltas: a batch goes out once MERIT_FLUSH_TAPS are pending or the
+// oldest pending tap is MERIT_FLUSH_MS old. Each batch has a sequence
+// number and is resent, unchanged, until the server acks it; the server
+// applies a seq only once, so retries and reboots never double count
+// (at-least-once delivery, exactly-once effect). Taps made while a batch
+// is in flight wait for the next one, and a batch carries at most
+// MERIT_MAX_BATCH taps (the server's cap) so a long offline run drains
+// over several.
+//
+// The persisted part (total, acked, seq, inflight) must be saved before a
+// batch is first sent, so after a reboot the same seq carries the same
+// delta.
+
+#define MERIT_FLUSH_MS      10000
+#define MERIT_FLUSH_TAPS    100
+#define MERIT_MAX_BATCH     10000  // /api/merit MAX_BATCH_TAPS: bigger batches get a 400
+#define MERIT_RETRY_MS      2000   // first retry after a failed upload, doubling
+#define MERIT_RETRY_MAX_MS  60000
+#define MERIT_SAVE_MS       5000   // NVS cadence for new taps: bounds flash wear and loss on power-off
+
+struct MeritBatch {
+    // Persisted
+    uint32_t total;          // taps counted on this device, ever
+    uint32_t acked;          // taps the server has confirmed
+    uint32_t seq;            // last batch cut (0 = none yet)
+    uint32_t inflight;       // taps in batch `seq` awaiting its ack, 0 if none
+    // Not persisted
+    uint32_t oldestMs;       // millis() of the oldest tap not yet in a batch
+    uint32_t retryAtMs;
+    uint32_t backoffMs;
+};
+
+struct MeritUpload {
+    uint32_t seq;
+    uint32_t taps;
+};
+
+void meritInit(MeritBatch& m, uint32_t total, uint32_t acked, uint32_t seq, uint32_t inflight);
+void meritAdd(MeritBatch& m, uint32_t taps, uint32_t nowMs);
+uint32_t meritPending(const MeritBatch& m); // counted, not yet in a batch
+// True if a batch should go out now: the one in flight again, or a new
+// one cut from the pending taps (*cut set, persist before sending).
+bool meritDue(MeritBatch& m, uint32_t nowMs, MeritUpload& up, bool* cut);
+// Server acked `seq`. Stale or unknown acks are ignored.
+void meritAcked(MeritBatch& m, uint32_t seq);
+void meritFailed(MeritBatch& m, uint32_t nowMs);
+// The server's last applied seq. A device whose flash was wiped starts
+// over at seq 1, which the server would ack without applying: jump past
+// it (only between batches). True if seq moved.
+bool meritAdoptSeq(MeritBatch& m, uint32_t serverSeq);
@@ -0,0 +1,188 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+static Metric* head = nullptr;
+static Metric* tail = nullptr;
+
+// Registration runs from static constructors, before any task exists.
+Metric::Metric(const char* name, const char* help, MetricType type)
+    : name(name), help(help), type(type), next(nullptr) {
+    if (tail) tail->next = this;
+    else head = this;
+    tail = this;
+}
+
+Metric* metricsFirst() {
+    return head;
+}
+
+// ==========================================
+// HISTOGRAM
+// ==========================================
+uint32_t histBucketIndex(uint32_t v) {
+    const uint32_t sub = 1u << HIST_SUB_BITS;
+    if (v < sub) return v;
+    if (v >= (1u << HIST_MAX_EXP)) return HIST_BUCKETS - 1;
+    uint32_t e = 31 - __builtin_clz(v);            // >= HIST_SUB_BITS
+    uint32_t m = v >> (e - HIST_SUB_BITS);         // sub .. 2*sub-1
+    return (e - HIST_SUB_BITS) * sub + m;
+}
+
+uint32_t histBucketLow(uint32_t idx) {
+    const uint32_t sub = 1u << HIST_SUB_BITS;
+    if (idx < sub) return idx;
+    uint32_t e = idx / sub + HIST_SUB_BITS - 1;
+    uint32_t m = idx % sub + sub;
+    return m << (e - HIST_SUB_BITS);
+}
+
+uint32_t histBucketHigh(uint32_t idx) {
+    if (idx + 1 >= HIST_BUCKETS) return 0xFFFFFFFFu;
+    return histBucketLow(idx + 1) - 1;
+}
+
+Histogram::Histogram(const char* name, const char* help)
+    : Metric(name, help, METRIC_HISTOGRAM) {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::record(uint32_t v) {
+    buckets[histBucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    uint32_t m = max.load(std::memory_order_relaxed);
+    while (v > m && !max.compare_exchange_weak(m, v, std::memory_order_relaxed)) {
+    }
+}
+
+uint32_t Histogram::quantile(float q) const {
+    // Sum the buckets rather than trusting `count`, which may be a few
+    // records ahead of them while a writer is mid-update.
+    uint32_t total = 0;
+    for (const auto& b : buckets) total += b.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+
+    uint32_t rank = (uint32_t)(q * total + 0.5f);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint32_t lo = histBucketLow(i);
+            uint32_t hi = histBucketHigh(i);
+            uint32_t mid = lo + (hi - lo) / 2;
+            uint32_t mx = max.load(std::memory_order_relaxed);
+            return mid < mx ? mid : mx;
+        }
+    }
+    return max.load(std::memory_order_relaxed);
+}
+
+double Histogram::sum() const {
+    double s = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        uint32_t n = buckets[i].load(std::memory_order_relaxed);
+        if (!n) continue;
+        // The overflow bucket is open-ended; cap it at the observed max
+        double hi = (i + 1 == HIST_BUCKETS) ? max.load(std::memory_order_relaxed) : histBucketHigh(i);
+        s += (double)n * ((double)histBucketLow(i) + hi) / 2.0;
+    }
+    return s;
+}
+
+void Histogram::reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+// ==========================================
+// EXPOSITION
+// ==========================================
+// Length of the metric name without its {label} suffix.
+static size_t baseLen(const char* name) {
+    const char* brace = strchr(name, '{');
+    return brace ? (size_t)(brace - name) : strlen(name);
+}
+
+// Writes `name` with an extra label appended inside (or as) its label set.
+static int writeLabeled(char* out, size_t cap, const char* name, const char* suffix,
+                        const char* extraLabel) {
+    size_t base = baseLen(name);
+    const char* labels = name + base; // "" or "{...}"
+    if (!extraLabel) {
+        return snprintf(out, cap, "%.*s%s%s", (int)base, name, suffix, labels);
+    }
+    if (*labels) {
+        // name{a="b"} -> name_suffix{a="b",quantile="0.5"}
+        size_t inner = strlen(labels) - 2;
+        return snprintf(out, cap, "%.*s%s{%.*s,%s}", (int)base, name, suffix,
+                        (int)inner, labels + 1, extraLabel);
+    }
+    return snprintf(out, cap, "%.*s%s{%s}", (int)base, name, suffix, extraLabel);
+}
+
+size_t metricsRender(char* buf, size_t cap) {
+    static const char* TYPE_NAMES[] = { "counter", "gauge", "summary" };
+    static const float QUANTILES[] = { 0.5f, 0.9f, 0.99f };
+
+    size_t len = 0;
+    const Metric* prev = nullptr;
+    // Past the end everything is measured (snprintf with no room) but not
+    // written, so the return value is the full page's length
+    auto room = [&]() -> size_t { return len < cap ? cap - len : 0; };
+    auto at = [&]() -> char* { return len < cap ? buf + len : nullptr; };
+    auto advance = [&](int n) { if (n > 0) len += (size_t)n; };
+
+    for (const Metric* m = head; m; m = m->next) {
+        size_t base = baseLen(m->name);
+        bool sameFamily = prev && baseLen(prev->name) == base &&
+                          strncmp(prev->name, m->name, base) == 0;
+        if (!sameFamily) {
+            advance(snprintf(at(), room(), "# HELP %.*s %s\n# TYPE %.*s %s\n",
+                             (int)base, m->name, m->help, (int)base, m->name,
+                             TYPE_NAMES[m->type]));
+        }
+        prev = m;
+
+        if (m->type == METRIC_COUNTER) {
+            advance(writeLabeled(at(), room(), m->name, "", nullptr));
+            advance(snprintf(at(), room(), " %lu\n",
+                             (unsigned long)static_cast<const Counter*>(m)->get()));
+        } else if (m->type == METRIC_GAUGE) {
+            advance(writeLabeled(at(), room(), m->name, "", nullptr));
+            advance(snprintf(at(), room(), " %ld\n",
+                             (long)static_cast<const Gauge*>(m)->get()));
+        } else {
+            const Histogram* h = static_cast<const Histogram*>(m);
+            for (float q : QUANTILES) {
+                char label[24];
+                snprintf(label, sizeof(label), "quantile=\"%g\"", q);
+                advance(writeLabeled(at(), room(), m->name, "", label));
+                advance(snprintf(at(), room(), " %lu\n", (unsigned long)h->quantile(q)));
+            }
+            advance(writeLabeled(at(), room(), m->name, "_sum", nullptr));
+            advance(snprintf(at(), room(), " %.0f\n", h->sum()));
+            advance(writeLabeled(at(), room(), m->name, "_count", nullptr));
+            advance(snprintf(at(), room(), " %lu\n",
+                             (unsigned long)h->count.load(std::memory_order_relaxed)));
+        }
+    }
+    // snprintf keeps the buffer NUL-terminated when it truncates
+    return len;
+}
+
+const char* metricsRenderPage(MetricsPage& page) {
+    size_t need = metricsRender(page.buf, page.cap);
+    while (need >= page.cap) {
+        size_t cap = need + METRICS_HEADROOM;
+        char* buf = (char*)page.grow(page.buf, cap);
+        if (!buf) return "";
+        page.buf = buf;
+        page.cap = cap;
+        need = metricsRender(page.buf, page.cap);
+    }
+    return page.buf;
+}
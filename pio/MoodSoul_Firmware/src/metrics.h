@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// METRICS REGISTRY
+// ==========================================
+// Counters, gauges and log-linear (HDR-style) histograms. Updates are
+// single relaxed atomic ops, so any task or ISR can record while the
+// metrics server task renders. Metrics are globals that register
+// themselves on construction; define them next to the code they measure:
+//
+//   Counter metricConnectFailures("moodsoul_connect_failures_total", "...");
+//
+// Names may carry a Prometheus label set, e.g. name{phase="wifi"}.
+
+enum MetricType : uint8_t { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+struct Metric {
+    const char* name;
+    const char* help;
+    MetricType  type;
+    Metric*     next;
+    Metric(const char* name, const char* help, MetricType type);
+};
+
+struct Counter : Metric {
+    std::atomic<uint32_t> value{0};
+    Counter(const char* name, const char* help) : Metric(name, help, METRIC_COUNTER) {}
+    void inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct Gauge : Metric {
+    std::atomic<int32_t> value{0};
+    Gauge(const char* name, const char* help) : Metric(name, help, METRIC_GAUGE) {}
+    void set(int32_t v) { value.store(v, std::memory_order_relaxed); }
+    int32_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// 16 linear sub-buckets per power of two (~6% relative error), exact below
+// 16, values clamped at 2^24. 336 buckets, ~1.3 KB per histogram.
+#define HIST_SUB_BITS   4
+#define HIST_MAX_EXP    24
+#define HIST_BUCKETS    ((HIST_MAX_EXP - HIST_SUB_BITS) * (1 << HIST_SUB_BITS) + (1 << HIST_SUB_BITS))
+
+struct Histogram : Metric {
+    std::atomic<uint32_t> buckets[HIST_BUCKETS];
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> max{0};
+    Histogram(const char* name, const char* help);
+    void record(uint32_t v);
+    // Value at quantile q (0..1), bucket-midpoint accurate. 0 when empty.
+    uint32_t quantile(float q) const;
+    // Approximate sum reconstructed from bucket midpoints.
+    double sum() const;
+    void reset();
+};
+
+uint32_t histBucketIndex(uint32_t v);
+uint32_t histBucketLow(uint32_t idx);
+uint32_t histBucketHigh(uint32_t idx); // inclusive
+
+Metric* metricsFirst();
+
+// Prometheus text exposition (0.0.4). Histograms are emitted as summaries
+// (p50/p90/p99 plus _sum/_count) to keep the page small. Like snprintf:
+// writes at most cap - 1 bytes plus the NUL and returns the length of the
+// whole page, so a result >= cap means it was cut (and `buf` may be null
+// with cap 0 to measure).
+size_t metricsRender(char* buf, size_t cap);
+
+// A page buffer that grows to fit: rendered into as is, and reallocated
+// through `grow` to the measured length plus METRICS_HEADROOM when the page
+// no longer fits (values gain digits, metrics register late).
+#define METRICS_HEADROOM 4096
+
+struct MetricsPage {
+    char*  buf;
+    size_t cap;
+    void* (*grow)(void* p, size_t n); // realloc-like
+};
+
+// The whole page, never cut short; "" if the buffer can't grow.
+const char* metricsRenderPage(MetricsPage& page);
@@ -0,0 +1,44 @@
+#include "metrics_server.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <WebServer.h>
+
+#define METRICS_PORT 80
+
+static WebServer   server(METRICS_PORT);
+static bool        started = false;
+// Sized on the first scrape, only touched by the server task
+static MetricsPage page = { nullptr, 0, [](void* p, size_t n) {
+    return heap_caps_realloc(p, n, MALLOC_CAP_SPIRAM);
+} };
+
+static void handleMetrics() {
+    server.send(200, "text/plain; version=0.0.4", metricsRenderPage(page));
+}
+
+static void handleIndex() {
+    String html = "<!DOCTYPE html><html><head><meta http-equiv=\"refresh\" content=\"5\">"
+                  "<title>MoodSoul metrics</title></head><body><pre>";
+    html += metricsRenderPage(page);
+    html += "</pre></body></html>";
+    server.send(200, "text/html", html);
+}
+
+static void metricsTask(void*) {
+    for (;;) {
+        server.handleClient();
+        delay(5);
+    }
+}
+
+void metricsServerStart() {
+    if (started) return;
+    started = true;
+
+    server.on("/metrics", HTTP_GET, handleMetrics);
+    server.on("/", HTTP_GET, handleIndex);
+    server.onNotFound([]() { server.send(404, "text/plain", "not found"); });
+    server.begin();
+
+    xTaskCreatePinnedToCore(metricsTask, "metrics", 6144, nullptr, 1, nullptr, 0);
+}
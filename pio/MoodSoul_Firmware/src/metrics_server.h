@@ -0,0 +1,11 @@
+#pragma once
+
+// ==========================================
+// METRICS HTTP SERVER (LAN, READ-ONLY)
+// ==========================================
+// GET /metrics -> Prometheus text, GET / -> auto-refreshing HTML view.
+// Runs in its own task so scrapes are answered during a turn.
+
+// Once the link is up (boot, or the first time the link manager gets it
+// up); later calls do nothing.
+void metricsServerStart();
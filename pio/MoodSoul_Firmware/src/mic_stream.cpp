@@ -0,0 +1,172 @@
+#include "mic_stream.h"
+#include "audio_preproc.h"
+#include "audio_ring.h"
+#include "metrics.h"
+#include <M5Unified.h>
+#include <esp_timer.h>
+
+static AudioRing         ring;
+static int16_t*          ringBuf = nullptr;
+static int16_t           chunk[2][MIC_STREAM_CHUNK];
+static TaskHandle_t      task = nullptr;
+static uint32_t          rate = 16000;
+static volatile bool     runFlag = false;
+static volatile bool     pauseReq = false;
+static volatile bool     paused = false;
+static volatile uint64_t busyUs = 0;
+static volatile uint32_t overruns = 0;
+static int64_t           startUs = 0;
+static AudioPreproc      preproc;
+static volatile bool     preprocOn = false;
+static volatile bool     preprocResetReq = true;
+
+static Gauge   metricMicCpu("moodsoul_mic_stream_cpu_permille", "Always-on mic capture task CPU, per mille of one core");
+static Counter metricMicOverruns("moodsoul_mic_stream_overruns_total", "Mic hand-offs that came too late (audio gap)");
+static Histogram metricPreprocCycles("moodsoul_preproc_cycles", "Capture NS/AGC CPU cycles per 10 ms block");
+static Counter metricPreprocOverBudget("moodsoul_preproc_over_budget_total", "Capture pre-processing blocks over the cycle budget");
+
+// NS/AGC in place on fresh audio, one 10 ms block at a time so the cycle
+// budget is checked per block
+static void preprocChunk(int16_t* samples, size_t n) {
+    if (preprocResetReq) {
+        preprocResetReq = false;
+        audioPreprocReset(preproc);
+    }
+    for (size_t off = 0; off + PREPROC_BLOCK <= n; off += PREPROC_BLOCK) {
+        uint32_t c0 = ESP.getCycleCount();
+        audioPreprocRun(preproc, samples + off, PREPROC_BLOCK);
+        uint32_t cycles = ESP.getCycleCount() - c0;
+        metricPreprocCycles.record(cycles);
+        if (cycles > PREPROC_BLOCK_CYCLE_BUDGET) metricPreprocOverBudget.inc();
+    }
+}
+
+static void micTask(void*) {
+    int cur = 0;
+    bool queued = false;
+    while (runFlag) {
+        if (pauseReq) {
+            // Let queued DMA finish, then hand the codec over
+            while (M5.Mic.isRecording()) vTaskDelay(1);
+            queued = false;
+            M5.Mic.end();
+            paused = true;
+            while (pauseReq && runFlag) vTaskDelay(pdMS_TO_TICKS(5));
+            paused = false;
+            continue;
+        }
+        if (!queued) {
+            if (!M5.Mic.isEnabled()) M5.Mic.begin();
+            M5.Mic.record(chunk[0], MIC_STREAM_CHUNK, rate);
+            M5.Mic.record(chunk[1], MIC_STREAM_CHUNK, rate);
+            cur = 0;
+            queued = true;
+        }
+
+        // chunk[cur] is done once fewer than two records are pending
+        size_t pending;
+        while ((pending = M5.Mic.isRecording()) >= 2) vTaskDelay(1);
+        int64_t t0 = esp_timer_get_time();
+        if (pending == 0) {
+            overruns++;
+            metricMicOverruns.inc();
+        }
+        if (preprocOn) preprocChunk(chunk[cur], MIC_STREAM_CHUNK);
+        audioRingWrite(ring, chunk[cur], MIC_STREAM_CHUNK);
+        M5.Mic.record(chunk[cur], MIC_STREAM_CHUNK, rate);
+        cur ^= 1;
+        busyUs += esp_timer_get_time() - t0;
+    }
+    while (M5.Mic.isRecording()) vTaskDelay(1);
+    paused = true;
+    task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool micStreamStart(uint32_t sampleRate) {
+    if (task) return true;
+    if (!ringBuf) {
+        ringBuf = (int16_t*)heap_caps_calloc(MIC_STREAM_RING_SAMPLES, sizeof(int16_t), MALLOC_CAP_SPIRAM);
+        if (!ringBuf) return false;
+    }
+    audioRingInit(ring, ringBuf, MIC_STREAM_RING_SAMPLES);
+    rate = sampleRate;
+    busyUs = 0;
+    overruns = 0;
+    startUs = esp_timer_get_time();
+    runFlag = true;
+    pauseReq = false;
+    paused = false;
+    preprocResetReq = true;
+    // Above loop() so a busy turn never starves the DMA hand-off
+    if (xTaskCreatePinnedToCore(micTask, "mic_stream", 4096, nullptr, 3, &task, 1) != pdPASS) {
+        runFlag = false;
+        return false;
+    }
+    return true;
+}
+
+void micStreamStop() {
+    if (!task) return;
+    runFlag = false;
+    while (task) delay(2);
+    metricMicCpu.set(0);
+}
+
+bool micStreamRunning() {
+    return task != nullptr;
+}
+
+uint32_t micStreamMark() {
+    return audioRingPos(ring);
+}
+
+size_t micStreamCapture(uint32_t mark, uint32_t preRoll, uint32_t samples, int16_t* out, uint32_t timeoutMs) {
+    if (!task) return 0;
+    unsigned long start = millis();
+    while ((int32_t)(audioRingPos(ring) - (mark + samples)) < 0) {
+        if (millis() - start > timeoutMs) return 0;
+        delay(10);
+    }
+    return audioRingCopy(ring, mark - preRoll, preRoll + samples, out) ? preRoll + samples : 0;
+}
+
+void micStreamPause() {
+    if (!task) return;
+    pauseReq = true;
+    while (!paused && task) delay(1);
+}
+
+void micStreamResume() {
+    pauseReq = false;
+}
+
+void micStreamInject(int16_t* samples, size_t n) {
+    if (!task || !paused) return;
+    if (preprocOn) preprocChunk(samples, n);
+    audioRingWrite(ring, samples, n);
+}
+
+void micStreamSetPreproc(bool on) {
+    static bool ready = false;
+    if (!ready) {
+        audioPreprocInit(preproc, true, true);
+        ready = true;
+    }
+    preprocResetReq = true;
+    preprocOn = on;
+}
+
+MicStreamStats micStreamStats() {
+    MicStreamStats s = {};
+    if (!task) return s;
+    uint64_t wall = esp_timer_get_time() - startUs;
+    s.cpuPermille = wall ? (uint32_t)(busyUs * 1000 / wall) : 0;
+    s.overruns = overruns;
+    s.runningMs = (uint32_t)(wall / 1000);
+    s.preprocP99Cycles = metricPreprocCycles.quantile(0.99f);
+    s.preprocMaxCycles = metricPreprocCycles.max.load();
+    s.preprocOverBudget = metricPreprocOverBudget.get();
+    metricMicCpu.set(s.cpuPermille);
+    return s;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// ALWAYS-ON MIC WITH PRE-ROLL
+// ==========================================
+// Optional mode: the mic streams continuously (M5.Mic's I2S DMA, 20 ms
+// hand-offs) into an ~8 s PSRAM ring. A touch or trigger marks a ring
+// position and the clip starts preRoll samples before it, so a user who
+// talks straight away keeps the first syllable and the turn pays no I2S
+// start-up. The stream pauses while the speaker has the codec.
+
+#define MIC_STREAM_RING_SAMPLES (1u << 17) // 8.2 s at 16 kHz, 256 KB of PSRAM
+#define MIC_STREAM_CHUNK        320        // samples per DMA hand-off (20 ms)
+#define MIC_PREROLL_MAX_MS      1000
+
+struct MicStreamStats {
+    uint32_t cpuPermille;  // ring hand-off task busy time per wall time
+                           // (M5.Mic's own I2S task is not included)
+    uint32_t overruns;     // hand-offs where both DMA buffers had drained
+    uint32_t runningMs;
+    uint32_t preprocP99Cycles; // NS/AGC per 10 ms block
+    uint32_t preprocMaxCycles;
+    uint32_t preprocOverBudget;
+};
+
+bool micStreamStart(uint32_t sampleRate);
+void micStreamStop();
+bool micStreamRunning();
+// Current ring position (sample count), to pass to micStreamCapture().
+uint32_t micStreamMark();
+// Copies preRoll samples before `mark` and `samples` after it into `out`,
+// waiting up to timeoutMs for the tail to be recorded. Returns the number
+// of samples written, 0 on timeout or if the range was overwritten.
+size_t micStreamCapture(uint32_t mark, uint32_t preRoll, uint32_t samples, int16_t* out, uint32_t timeoutMs);
+// Releases the codec for playback (blocks until the mic is off).
+void micStreamPause();
+void micStreamResume();
+// While paused, whoever holds the codec (audio_duplex) keeps the ring going:
+// n <= AUDIO_RING_MAX_WRITE samples, a multiple of 160, processed in place
+// like mic audio.
+void micStreamInject(int16_t* samples, size_t n);
+// Runs audio_preproc (high-pass, noise suppression, AGC) on each hand-off
+// before it enters the ring, so wake word and turns both get clean audio.
+void micStreamSetPreproc(bool on);
+MicStreamStats micStreamStats();
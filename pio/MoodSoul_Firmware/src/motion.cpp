@@ -0,0 +1,57 @@
+#include "motion.h"
+#include <math.h>
+
+void motionInit(MotionState& st) {
+    st.lastAutoObserveMs = 0;
+    st.vibrationStartMs = 0;
+    st.isVibrating = false;
+    st.lastShakeMs = 0;
+    st.lastMode = -1;
+    st.faceDown = false;
+}
+
+MotionEvents motionUpdate(MotionState& st, float ax, float ay, float az,
+                          uint32_t nowMs, bool charging, int currentRotation) {
+    MotionEvents ev = { false, false, false, -1 };
+
+    // Proactive vision: subtle but sustained vibration (e.g. sitting down)
+    // while plugged in, at most once per MOTION_OBSERVE_GAP_MS
+    if (charging && nowMs - st.lastAutoObserveMs > MOTION_OBSERVE_GAP_MS) {
+        if (fabsf(ax) > MOTION_VIBRATION_G || fabsf(ay) > MOTION_VIBRATION_G) {
+            if (!st.isVibrating) {
+                st.isVibrating = true;
+                st.vibrationStartMs = nowMs;
+            } else if (nowMs - st.vibrationStartMs > MOTION_VIBRATION_HOLD_MS) {
+                st.lastAutoObserveMs = nowMs;
+                st.isVibrating = false;
+                ev.autoObserve = true;
+            }
+        } else {
+            st.isVibrating = false;
+        }
+    }
+
+    // Explicit high-g shake
+    if (fabsf(ax) > MOTION_SHAKE_G && nowMs - st.lastShakeMs > MOTION_SHAKE_COOLDOWN_MS) {
+        st.lastShakeMs = nowMs;
+        ev.shake = true;
+    }
+
+    // Face down, with hysteresis so lying still doesn't retrigger
+    if (!st.faceDown && az < -MOTION_FACE_DOWN_G) {
+        st.faceDown = true;
+        ev.upsideDown = true;
+    } else if (st.faceDown && az > MOTION_FACE_UP_G) {
+        st.faceDown = false;
+    }
+
+    // Orientation, with a dead band so a flat cube keeps its rotation
+    int targetMode = currentRotation;
+    if (ay > MOTION_ORIENT_G) targetMode = 0;
+    else if (ay < -MOTION_ORIENT_G) targetMode = 2;
+    if (targetMode != st.lastMode) {
+        st.lastMode = targetMode;
+        ev.orientation = targetMode;
+    }
+    return ev;
+}
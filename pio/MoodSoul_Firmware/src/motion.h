@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// MOTION CLASSIFIER (IMU)
+// ==========================================
+// Turns one accelerometer sample (in g) per loop() into the events the
+// main loop reacts to: sustained vibration while charging (AUTO_OBSERVE),
+// a high-g shake (SHAKE_EVENT), being turned face down (UPSIDE_DOWN) and
+// the screen orientation.
+
+#define MOTION_SHAKE_G            2.5f
+#define MOTION_SHAKE_COOLDOWN_MS  3000
+#define MOTION_VIBRATION_G        1.2f
+#define MOTION_VIBRATION_HOLD_MS  2000
+#define MOTION_OBSERVE_GAP_MS     300000 // 5 min between proactive checks
+#define MOTION_ORIENT_G           0.8f
+#define MOTION_FACE_DOWN_G        0.9f  // z below -this: face down
+#define MOTION_FACE_UP_G          0.5f  // z above this: back up, re-arms
+
+struct MotionState {
+    uint32_t lastAutoObserveMs;
+    uint32_t vibrationStartMs;
+    bool     isVibrating;
+    uint32_t lastShakeMs;
+    int      lastMode; // -1 until the first sample
+    bool     faceDown;
+};
+
+struct MotionEvents {
+    bool autoObserve;
+    bool shake;
+    bool upsideDown;  // just turned face down
+    int  orientation; // new rotation mode (0 or 2), -1 if unchanged
+};
+
+void motionInit(MotionState& st);
+MotionEvents motionUpdate(MotionState& st, float ax, float ay, float az,
+                          uint32_t nowMs, bool charging, int currentRotation);
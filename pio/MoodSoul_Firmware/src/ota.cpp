@@ -0,0 +1,473 @@
+#include "ota.h"
+#include "ota_key.h"
+#include "ota_manifest.h"
+#include "delta_patch.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <new>
+#include <mbedtls/base64.h>
+#include <mbedtls/ecdsa.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+
+#define OTA_SECTOR          4096
+#define OTA_BLOCK           65536
+#define OTA_CHECKPOINT      (64 * 1024) // NVS progress granularity, block aligned
+#define OTA_HTTP_TIMEOUT_MS 15000
+#define OTA_STALL_MS        15000
+#define OTA_BUF_SIZE        4096
+
+static Counter metricOtaBytes("moodsoul_ota_bytes_downloaded_total", "OTA body bytes downloaded (manifest, patch, image)");
+static Counter metricOtaFailures("moodsoul_ota_failures_total", "OTA attempts that failed in transfer or verification");
+static Gauge   metricOtaLastBytes("moodsoul_ota_last_bytes_downloaded", "Bytes downloaded by the last installed update");
+static Gauge   metricOtaLastFlashMs("moodsoul_ota_last_flash_write_ms", "Flash erase+write time of the last installed update, ms");
+
+// ==========================================
+// FLASH WRITER (erase as we go, hash what we write)
+// ==========================================
+struct FlashWriter {
+    const esp_partition_t* part;
+    uint32_t written;
+    uint32_t erasedTo;
+    uint32_t flashUs;
+    mbedtls_sha256_context sha;
+};
+
+// Starts at `resumeAt` (block aligned), re-hashing what is already there.
+static bool writerBegin(FlashWriter& w, const esp_partition_t* part, uint32_t resumeAt, uint8_t* buf) {
+    w.part = part;
+    w.written = resumeAt;
+    w.erasedTo = resumeAt;
+    w.flashUs = 0;
+    mbedtls_sha256_init(&w.sha);
+    mbedtls_sha256_starts(&w.sha, 0);
+    for (uint32_t off = 0; off < resumeAt; off += OTA_BUF_SIZE) {
+        uint32_t n = resumeAt - off < OTA_BUF_SIZE ? resumeAt - off : OTA_BUF_SIZE;
+        if (esp_partition_read(part, off, buf, n) != ESP_OK) return false;
+        mbedtls_sha256_update(&w.sha, buf, n);
+    }
+    return true;
+}
+
+static bool writerWrite(FlashWriter& w, const uint8_t* data, size_t len) {
+    if (w.written + len > w.part->size) return false;
+    uint32_t t0 = micros();
+    while (w.erasedTo < w.written + len) {
+        // 64 KB block erase is much faster than 16 sector erases
+        uint32_t step = (w.erasedTo % OTA_BLOCK == 0 && w.erasedTo + OTA_BLOCK <= w.part->size) ? OTA_BLOCK : OTA_SECTOR;
+        if (esp_partition_erase_range(w.part, w.erasedTo, step) != ESP_OK) return false;
+        w.erasedTo += step;
+    }
+    if (esp_partition_write(w.part, w.written, data, len) != ESP_OK) return false;
+    w.flashUs += micros() - t0;
+    mbedtls_sha256_update(&w.sha, data, len);
+    w.written += len;
+    return true;
+}
+
+static void writerFinish(FlashWriter& w, uint8_t out[32]) {
+    mbedtls_sha256_finish(&w.sha, out);
+    mbedtls_sha256_free(&w.sha);
+}
+
+// ==========================================
+// HTTP
+// ==========================================
+struct OtaHttp {
+    WiFiClientSecure client;
+    HTTPClient       http;
+};
+
+static int httpGet(OtaHttp& h, const String& url, uint32_t rangeFrom) {
+    h.client.setInsecure(); // Integrity comes from the signed manifest, not TLS
+    h.client.setHandshakeTimeout(OTA_HTTP_TIMEOUT_MS / 1000);
+    h.http.setConnectTimeout(OTA_HTTP_TIMEOUT_MS);
+    h.http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+    h.http.setReuse(false);
+    if (!h.http.begin(h.client, url)) return -1;
+    const char* keys[] = { "Content-Range", "X-Manifest-Signature" };
+    h.http.collectHeaders(keys, 2);
+    if (rangeFrom) h.http.addHeader("Range", "bytes=" + String(rangeFrom) + "-");
+    return h.http.GET();
+}
+
+typedef bool (*ChunkFn)(void* ctx, const uint8_t* data, size_t len);
+
+// Reads exactly `len` body bytes into `fn`, giving up after a stall.
+static bool streamBody(OtaHttp& h, uint32_t len, ChunkFn fn, void* ctx, uint8_t* buf, OtaStats& stats) {
+    WiFiClient* s = h.http.getStreamPtr();
+    uint32_t got = 0;
+    unsigned long lastData = millis();
+    while (got < len) {
+        int avail = s->available();
+        if (avail <= 0) {
+            if (!s->connected() || millis() - lastData > OTA_STALL_MS) return false;
+            delay(2);
+            continue;
+        }
+        size_t want = len - got < OTA_BUF_SIZE ? len - got : OTA_BUF_SIZE;
+        if ((size_t)avail < want) want = avail;
+        int n = s->read(buf, want);
+        if (n <= 0) continue;
+        lastData = millis();
+        got += n;
+        stats.bytesDownloaded += n;
+        metricOtaBytes.inc(n);
+        if (!fn(ctx, buf, n)) return false;
+    }
+    return true;
+}
+
+// ==========================================
+// MANIFEST SIGNATURE
+// ==========================================
+static bool verifySignature(const String& body, const String& sigB64) {
+    if (sizeof(OTA_PUBLIC_KEY_PEM) <= 1) {
+        Serial.println("OTA: no public key in ota_key.h, refusing to update");
+        return false;
+    }
+    uint8_t sig[MBEDTLS_ECDSA_MAX_LEN];
+    size_t sigLen = 0;
+    if (mbedtls_base64_decode(sig, sizeof(sig), &sigLen, (const uint8_t*)sigB64.c_str(), sigB64.length()) != 0) {
+        return false;
+    }
+    uint8_t hash[32];
+    mbedtls_sha256((const uint8_t*)body.c_str(), body.length(), hash, 0);
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    bool ok = mbedtls_pk_parse_public_key(&pk, (const uint8_t*)OTA_PUBLIC_KEY_PEM, sizeof(OTA_PUBLIC_KEY_PEM)) == 0 &&
+              mbedtls_pk_can_do(&pk, MBEDTLS_PK_ECKEY) &&
+              mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, sigLen) == 0;
+    mbedtls_pk_free(&pk);
+    return ok;
+}
+
+// ==========================================
+// RESUME STATE (NVS "ota")
+// ==========================================
+// Progress is only valid for the exact image it was recorded for.
+static uint32_t loadResume(const OtaManifest& m) {
+    Preferences p;
+    p.begin("ota", true);
+    uint8_t sha[32];
+    bool same = p.getString("ver", "") == m.version &&
+                p.getBytes("sha", sha, sizeof(sha)) == sizeof(sha) && memcmp(sha, m.sha256, 32) == 0;
+    uint32_t done = same ? p.getUInt("done", 0) : 0;
+    p.end();
+    if (done >= m.size || done % OTA_CHECKPOINT) done = 0;
+    return done;
+}
+
+static void saveResume(const OtaManifest& m, uint32_t done) {
+    Preferences p;
+    p.begin("ota", false);
+    p.putString("ver", m.version);
+    p.putBytes("sha", m.sha256, 32);
+    p.putUInt("done", done);
+    p.end();
+}
+
+static void clearResume() {
+    Preferences p;
+    p.begin("ota", false);
+    p.clear();
+    p.end();
+}
+
+// ==========================================
+// ANTI-ROLLBACK FLOOR (NVS "moodsoul", outside the resume state)
+// ==========================================
+// The newest version this device has run. A signed manifest stays valid
+// forever, so only a version newer than both it and the running one is
+// installed: a replayed old manifest can't take the device back.
+static String rollbackFloor(const char* currentVersion) {
+    Preferences p;
+    p.begin("moodsoul", false);
+    String floor = p.getString("ota_floor", "");
+    int cmp;
+    if (!floor.length() || (otaVersionCompare(currentVersion, floor.c_str(), cmp) && cmp > 0)) {
+        floor = currentVersion;
+        p.putString("ota_floor", floor);
+    }
+    p.end();
+    return floor;
+}
+
+static bool isNewer(const OtaManifest& m, const char* currentVersion) {
+    String floor = rollbackFloor(currentVersion);
+    int vsCurrent, vsFloor;
+    return otaVersionCompare(m.version, currentVersion, vsCurrent) && vsCurrent > 0 &&
+           otaVersionCompare(m.version, floor.c_str(), vsFloor) && vsFloor > 0;
+}
+
+// ==========================================
+// DELTA PATH
+// ==========================================
+struct DeltaCtx {
+    DeltaDecoder*          dec;
+    const esp_partition_t* running;
+    FlashWriter*           w;
+    const OtaManifest*     m;
+    OtaProgressFn          progress;
+    uint8_t*               scratch;
+    bool                   baseOk;
+};
+
+static bool deltaReadOld(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+    DeltaCtx* c = (DeltaCtx*)ctx;
+    return esp_partition_read(c->running, offset, buf, len) == ESP_OK;
+}
+
+static bool deltaWriteOut(void* ctx, const uint8_t* buf, size_t len) {
+    DeltaCtx* c = (DeltaCtx*)ctx;
+    if (!writerWrite(*c->w, buf, len)) return false;
+    if (c->progress) c->progress(c->w->written, c->m->size);
+    return true;
+}
+
+// The patch must be built against exactly the bytes we are running and
+// must produce exactly the image the manifest promises.
+static bool checkDeltaHeader(DeltaCtx& c) {
+    const DeltaHeader& hd = c.dec->header;
+    if (hd.targetSize != c.m->size || memcmp(hd.targetSha256, c.m->sha256, 32) != 0) return false;
+    if (hd.baseSize > c.running->size) return false;
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    for (uint32_t off = 0; off < hd.baseSize; off += OTA_BUF_SIZE) {
+        uint32_t n = hd.baseSize - off < OTA_BUF_SIZE ? hd.baseSize - off : OTA_BUF_SIZE;
+        if (esp_partition_read(c.running, off, c.scratch, n) != ESP_OK) {
+            mbedtls_sha256_free(&sha);
+            return false;
+        }
+        mbedtls_sha256_update(&sha, c.scratch, n);
+    }
+    uint8_t h[32];
+    mbedtls_sha256_finish(&sha, h);
+    mbedtls_sha256_free(&sha);
+    return memcmp(h, hd.baseSha256, 32) == 0;
+}
+
+static bool deltaChunk(void* ctx, const uint8_t* data, size_t len) {
+    DeltaCtx* c = (DeltaCtx*)ctx;
+    // Feed the header on its own so the base is checked before any write
+    if (!deltaHeaderReady(*c->dec)) {
+        size_t n = DELTA_HEADER_SIZE - c->dec->headerLen;
+        if (n > len) n = len;
+        DeltaStatus st = deltaFeed(*c->dec, data, n);
+        if (st != DELTA_OK && st != DELTA_DONE) return false;
+        data += n;
+        len -= n;
+        if (!deltaHeaderReady(*c->dec)) return true;
+        c->baseOk = checkDeltaHeader(*c);
+        if (!c->baseOk) {
+            Serial.println("OTA: patch does not match running image or manifest");
+            return false;
+        }
+    }
+    if (len == 0) return true;
+    DeltaStatus st = deltaFeed(*c->dec, data, len);
+    return st == DELTA_OK || st == DELTA_DONE;
+}
+
+static bool runDelta(const String& base, const OtaManifest& m, const esp_partition_t* target,
+                     OtaProgressFn progress, uint8_t* buf, FlashWriter& w, OtaStats& stats) {
+    OtaHttp h;
+    int code = httpGet(h, base + "&delta=1", 0);
+    int len = h.http.getSize();
+    if (code != 200 || len <= DELTA_HEADER_SIZE) {
+        Serial.printf("OTA: delta fetch failed (%d)\n", code);
+        h.http.end();
+        return false;
+    }
+
+    DeltaCtx c;
+    c.dec = new (std::nothrow) DeltaDecoder;
+    if (!c.dec) {
+        h.http.end();
+        return false;
+    }
+    c.running = esp_ota_get_running_partition();
+    c.w = &w;
+    c.m = &m;
+    c.progress = progress;
+    c.scratch = (uint8_t*)malloc(OTA_BUF_SIZE);
+    c.baseOk = false;
+    deltaInit(*c.dec, deltaReadOld, deltaWriteOut, &c);
+
+    // A patch is small and starts over on failure; only the full image resumes
+    clearResume();
+    bool ok = c.scratch && writerBegin(w, target, 0, buf) &&
+              streamBody(h, len, deltaChunk, &c, buf, stats) &&
+              c.dec->status == DELTA_DONE;
+    if (!ok) Serial.printf("OTA: delta failed (decoder %d, %u/%u B written)\n", c.dec->status, w.written, m.size);
+    free(c.scratch);
+    delete c.dec;
+    h.http.end();
+    return ok;
+}
+
+// ==========================================
+// FULL IMAGE PATH
+// ==========================================
+struct FullCtx {
+    FlashWriter*       w;
+    const OtaManifest* m;
+    OtaProgressFn      progress;
+    uint32_t           checkpoint;
+};
+
+static bool fullChunk(void* ctx, const uint8_t* data, size_t len) {
+    FullCtx* c = (FullCtx*)ctx;
+    if (!writerWrite(*c->w, data, len)) return false;
+    uint32_t cp = c->w->written / OTA_CHECKPOINT * OTA_CHECKPOINT;
+    if (cp > c->checkpoint) {
+        c->checkpoint = cp;
+        saveResume(*c->m, cp);
+    }
+    if (c->progress) c->progress(c->w->written, c->m->size);
+    return true;
+}
+
+static bool runFull(const String& base, const OtaManifest& m, const esp_partition_t* target,
+                    OtaProgressFn progress, uint8_t* buf, FlashWriter& w, OtaStats& stats) {
+    uint32_t resumeAt = loadResume(m);
+    if (resumeAt == 0) saveResume(m, 0);
+
+    OtaHttp h;
+    int code = httpGet(h, base, resumeAt);
+    if (code == 206) {
+        // Content-Range: bytes <start>-<end>/<total>
+        String cr = h.http.header("Content-Range");
+        int dash = cr.indexOf('-'), slash = cr.indexOf('/');
+        if (!cr.startsWith("bytes ") || dash < 0 || slash < 0 ||
+            (uint32_t)cr.substring(6, dash).toInt() != resumeAt || (uint32_t)cr.substring(slash + 1).toInt() != m.size) {
+            Serial.printf("OTA: bad Content-Range '%s'\n", cr.c_str());
+            h.http.end();
+            return false;
+        }
+    } else if (code == 200) {
+        resumeAt = 0; // server ignored the Range header
+    } else {
+        Serial.printf("OTA: image fetch failed (%d)\n", code);
+        h.http.end();
+        return false;
+    }
+    if (h.http.getSize() != (int)(m.size - resumeAt)) {
+        Serial.printf("OTA: image length %d, expected %u\n", h.http.getSize(), m.size - resumeAt);
+        h.http.end();
+        return false;
+    }
+
+    stats.resumedFrom = resumeAt;
+    FullCtx c = { &w, &m, progress, resumeAt };
+    bool ok = writerBegin(w, target, resumeAt, buf) && streamBody(h, m.size - resumeAt, fullChunk, &c, buf, stats);
+    if (!ok) Serial.printf("OTA: image download stopped at %u/%u B, resumes from %u next time\n", w.written, m.size, c.checkpoint);
+    h.http.end();
+    return ok;
+}
+
+// ==========================================
+// ENTRY POINT
+// ==========================================
+static bool fetchManifest(const String& base, OtaManifest& m, bool& upToDate, OtaStats& stats) {
+    OtaHttp h;
+    int code = httpGet(h, base + "&manifest=1", 0);
+    upToDate = code == 304;
+    if (code != 200) {
+        h.http.end();
+        return false;
+    }
+    String body = h.http.getString();
+    String sig = h.http.header("X-Manifest-Signature");
+    h.http.end();
+    stats.bytesDownloaded += body.length();
+    metricOtaBytes.inc(body.length());
+
+    if (!verifySignature(body, sig)) {
+        Serial.println("OTA: manifest signature invalid");
+        return false;
+    }
+    if (!otaParseManifest(body.c_str(), body.length(), m)) {
+        Serial.println("OTA: manifest malformed");
+        return false;
+    }
+    return true;
+}
+
+OtaResult otaRun(const char* updateUrl, const char* currentVersion, OtaProgressFn progress, OtaStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+    unsigned long start = millis();
+    String base = String(updateUrl) + "?current_version=" + currentVersion;
+
+    OtaManifest m;
+    bool upToDate = false;
+    if (!fetchManifest(base, m, upToDate, stats)) {
+        if (upToDate) return OTA_UP_TO_DATE;
+        metricOtaFailures.inc();
+        return OTA_FAILED;
+    }
+    if (!isNewer(m, currentVersion)) {
+        if (strcmp(m.version, currentVersion) != 0) Serial.printf("OTA: not installing %s over %s\n", m.version, currentVersion);
+        return OTA_UP_TO_DATE;
+    }
+
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (!target || m.size > target->size) {
+        Serial.printf("OTA: no slot for a %u B image\n", m.size);
+        metricOtaFailures.inc();
+        return OTA_FAILED;
+    }
+    uint8_t* buf = (uint8_t*)malloc(OTA_BUF_SIZE);
+    if (!buf) return OTA_FAILED;
+
+    FlashWriter w = {};
+    uint8_t sha[32];
+    bool ok = false;
+    uint32_t flashUs = 0;
+    if (m.deltaFrom[0] && strcmp(m.deltaFrom, currentVersion) == 0) {
+        ok = runDelta(base, m, target, progress, buf, w, stats);
+        flashUs += w.flashUs;
+        if (w.part) writerFinish(w, sha);
+        ok = ok && w.written == m.size && memcmp(sha, m.sha256, 32) == 0;
+        stats.delta = ok; // a failed patch falls back to the full image
+    }
+    if (!ok) {
+        w = {};
+        ok = runFull(base, m, target, progress, buf, w, stats);
+        flashUs += w.flashUs;
+        if (w.part) writerFinish(w, sha);
+        if (ok && (w.written != m.size || memcmp(sha, m.sha256, 32) != 0)) {
+            Serial.println("OTA: image sha256 mismatch, discarding");
+            clearResume();
+            ok = false;
+        }
+    }
+    free(buf);
+
+    stats.flashWriteMs = flashUs / 1000;
+    stats.totalMs = millis() - start;
+    if (ok && esp_ota_set_boot_partition(target) != ESP_OK) {
+        Serial.println("OTA: new image failed boot validation");
+        ok = false;
+    }
+    if (!ok) {
+        metricOtaFailures.inc();
+        return OTA_FAILED;
+    }
+
+    clearResume();
+    metricOtaLastBytes.set(stats.bytesDownloaded);
+    metricOtaLastFlashMs.set(stats.flashWriteMs);
+    Serial.printf("OTA: %s -> %s via %s, %u B downloaded (resumed at %u), flash write %u ms, total %u ms\n",
+                  currentVersion, m.version, stats.delta ? "delta" : "full image", stats.bytesDownloaded,
+                  stats.resumedFrom, stats.flashWriteMs, stats.totalMs);
+    return OTA_READY_TO_REBOOT;
+}
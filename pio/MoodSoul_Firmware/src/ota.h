@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// OTA ENGINE
+// ==========================================
+// 1. Fetch the manifest (ota_manifest.h) and check its ECDSA signature
+//    against the key in ota_key.h. No key or a bad signature: no update.
+//    Only a version newer than the running one and than any version this
+//    device has run before is installed (no downgrades, no replays).
+// 2. If the server has a patch from our version, stream it through the
+//    delta decoder against the running partition into the next OTA slot.
+// 3. Otherwise, or if the delta fails, download the full image, resuming
+//    with an HTTP Range request from the last 64 KB checkpoint in NVS.
+// Every byte written is hashed; the boot partition only changes when the
+// result matches the manifest's size and sha256.
+
+enum OtaResult {
+    OTA_UP_TO_DATE = 0,
+    OTA_READY_TO_REBOOT, // new image verified and selected for next boot
+    OTA_FAILED,
+};
+
+struct OtaStats {
+    bool     delta;           // the installed image came from a patch
+    uint32_t resumedFrom;     // full image: bytes kept from an earlier attempt
+    uint32_t bytesDownloaded; // body bytes over the wire, all attempts this run
+    uint32_t flashWriteMs;    // erase + write time
+    uint32_t totalMs;
+};
+
+typedef void (*OtaProgressFn)(uint32_t done, uint32_t total);
+
+// Blocking; every request has connect/read timeouts and a stall timeout.
+OtaResult otaRun(const char* updateUrl, const char* currentVersion, OtaProgressFn progress, OtaStats& stats);
@@ -0,0 +1,20 @@
+#pragma once
+
+// ECDSA P-256 public key for /api/firmware manifests. To set one up:
+//   openssl ecparam -name prime256v1 -genkey -noout -out ota_signing.pem
+//   openssl ec -in ota_signing.pem -pubout
+// Define OTA_PUBLIC_KEY below as the public PEM (one string, "\n" line
+// ends) and put the contents of ota_signing.pem in the server's
+// FIRMWARE_SIGNING_KEY env var. Without a key the device refuses every
+// update, and a release build (env:m5stack-cores3-release) won't compile.
+//
+// #define OTA_PUBLIC_KEY "-----BEGIN PUBLIC KEY-----\n...\n-----END PUBLIC KEY-----\n"
+
+#ifdef OTA_PUBLIC_KEY
+static const char OTA_PUBLIC_KEY_PEM[] = OTA_PUBLIC_KEY;
+#else
+#ifdef MOODSOUL_RELEASE
+#error "release build without OTA_PUBLIC_KEY in ota_key.h: it could never update"
+#endif
+static const char OTA_PUBLIC_KEY_PEM[] = "";
+#endif
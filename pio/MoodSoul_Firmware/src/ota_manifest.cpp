@@ -0,0 +1,96 @@
+#include "ota_manifest.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool otaParseHex(const char* hex, size_t hexLen, uint8_t* out, size_t outLen) {
+    if (hexLen != outLen * 2) return false;
+    for (size_t i = 0; i < outLen; i++) {
+        int hi = hexNibble(hex[2 * i]), lo = hexNibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+static bool copyStr(char* dst, size_t cap, const char* src, size_t len) {
+    if (len == 0 || len >= cap) return false;
+    memcpy(dst, src, len);
+    dst[len] = 0;
+    return true;
+}
+
+static bool parseU32(const char* s, size_t len, uint32_t& out) {
+    if (len == 0 || len > 10) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    if (v > 0xFFFFFFFFull) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+bool otaParseManifest(const char* text, size_t len, OtaManifest& m) {
+    memset(&m, 0, sizeof(m));
+    bool haveVersion = false, haveSize = false, haveSha = false;
+
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && text[end] != '\n') end++;
+        size_t lineEnd = end;
+        if (lineEnd > pos && text[lineEnd - 1] == '\r') lineEnd--;
+
+        const char* line = text + pos;
+        const char* eq = (const char*)memchr(line, '=', lineEnd - pos);
+        if (eq) {
+            size_t keyLen = eq - line;
+            const char* val = eq + 1;
+            size_t valLen = text + lineEnd - val;
+            if (keyLen == 7 && !memcmp(line, "version", 7)) {
+                haveVersion = copyStr(m.version, sizeof(m.version), val, valLen);
+            } else if (keyLen == 4 && !memcmp(line, "size", 4)) {
+                haveSize = parseU32(val, valLen, m.size);
+            } else if (keyLen == 6 && !memcmp(line, "sha256", 6)) {
+                haveSha = otaParseHex(val, valLen, m.sha256, 32);
+            } else if (keyLen == 10 && !memcmp(line, "delta_from", 10)) {
+                if (!copyStr(m.deltaFrom, sizeof(m.deltaFrom), val, valLen)) m.deltaFrom[0] = 0;
+            } else if (keyLen == 10 && !memcmp(line, "delta_size", 10)) {
+                if (!parseU32(val, valLen, m.deltaSize)) m.deltaSize = 0;
+            }
+        }
+        pos = end + 1;
+    }
+    if (m.deltaSize == 0) m.deltaFrom[0] = 0;
+    return haveVersion && haveSize && haveSha && m.size > 0;
+}
+
+#define VERSION_PARTS 4
+
+static bool parseVersion(const char* s, uint32_t parts[VERSION_PARTS]) {
+    memset(parts, 0, VERSION_PARTS * sizeof(uint32_t));
+    for (int i = 0; i < VERSION_PARTS; i++) {
+        size_t len = strspn(s, "0123456789");
+        if (!parseU32(s, len, parts[i])) return false;
+        s += len;
+        if (*s == 0) return true;
+        if (*s++ != '.') return false;
+    }
+    return false;
+}
+
+bool otaVersionCompare(const char* a, const char* b, int& result) {
+    uint32_t pa[VERSION_PARTS], pb[VERSION_PARTS];
+    if (!parseVersion(a, pa) || !parseVersion(b, pb)) return false;
+    result = 0;
+    for (int i = 0; i < VERSION_PARTS && !result; i++) result = pa[i] < pb[i] ? -1 : pa[i] > pb[i] ? 1 : 0;
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// OTA MANIFEST
+// ==========================================
+// GET /api/firmware?manifest=1 returns key=value lines, e.g.
+//   version=1.4
+//   size=1456320
+//   sha256=<64 hex>
+//   delta_from=1.3
+//   delta_size=48211
+// signed (ECDSA P-256 / SHA-256 over the exact body) in the
+// X-Manifest-Signature header. Unknown keys are ignored so the server can
+// grow the format.
+
+struct OtaManifest {
+    char     version[16];
+    uint32_t size;
+    uint8_t  sha256[32];
+    char     deltaFrom[16]; // empty when no patch exists for this device
+    uint32_t deltaSize;
+};
+
+// False when version, size or sha256 is missing or malformed.
+bool otaParseManifest(const char* text, size_t len, OtaManifest& m);
+bool otaParseHex(const char* hex, size_t hexLen, uint8_t* out, size_t outLen);
+// Dotted numeric versions: "1.3" < "1.10" < "1.10.1", missing parts count
+// as 0. `result` is <0, 0 or >0 as a is older, the same or newer than b.
+// False when either isn't a version (up to 4 parts).
+bool otaVersionCompare(const char* a, const char* b, int& result);
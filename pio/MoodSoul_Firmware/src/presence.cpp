@@ -0,0 +1,95 @@
+#include "presence.h"
+
+static int32_t baseline(const Presence& p) {
+    return p.baselineQ >> PRESENCE_BASELINE_SHIFT;
+}
+
+void presenceInit(Presence& p, uint16_t firstReading, uint32_t nowMs) {
+    p = {};
+    p.state = PRESENCE_ACTIVE;
+    p.baselineQ = (int32_t)firstReading << PRESENCE_BASELINE_SHIFT;
+    p.lastActivityMs = nowMs;
+    p.accountedMs = nowMs;
+}
+
+static PresenceEvents wakeUp(Presence& p, uint32_t nowMs) {
+    PresenceEvents ev = {};
+    p.lastActivityMs = nowMs;
+    if (p.state != PRESENCE_ACTIVE) {
+        p.state = PRESENCE_ACTIVE;
+        p.wakes++;
+        ev.wake = true;
+    }
+    return ev;
+}
+
+PresenceEvents presenceUpdate(Presence& p, uint16_t reading, uint32_t nowMs) {
+    PresenceEvents ev = {};
+    int32_t over = (int32_t)reading - baseline(p);
+    if (!p.near) {
+        p.nearRun = over >= PRESENCE_NEAR_DELTA ? p.nearRun + 1 : 0;
+        if (p.nearRun >= PRESENCE_NEAR_SAMPLES) {
+            p.near = true;
+            p.steadyRef = reading;
+            p.steadySinceMs = nowMs;
+            ev = wakeUp(p, nowMs);
+            ev.approach = true;
+        } else if (over < PRESENCE_NEAR_DELTA) {
+            // Only far readings move the baseline, so a visitor isn't learned
+            p.baselineQ += over;
+        }
+    } else if (over < PRESENCE_FAR_DELTA) {
+        p.near = false;
+        p.nearRun = 0;
+    } else {
+        int32_t moved = (int32_t)reading - p.steadyRef;
+        if (moved > PRESENCE_STEADY_BAND || moved < -PRESENCE_STEADY_BAND) {
+            p.steadyRef = reading;
+            p.steadySinceMs = nowMs;
+        }
+        uint32_t still = nowMs - p.steadySinceMs;
+        // Someone near moves; a thing left there doesn't
+        if (still < PRESENCE_DIM_MS) p.lastActivityMs = nowMs;
+        if (still >= PRESENCE_LEARN_MS) p.baselineQ += over;
+    }
+
+    uint32_t idle = nowMs - p.lastActivityMs;
+    if (p.state == PRESENCE_ACTIVE && idle >= PRESENCE_DIM_MS) {
+        p.state = PRESENCE_DIM;
+        ev.dim = true;
+    } else if (p.state == PRESENCE_DIM && idle >= PRESENCE_DEEP_MS) {
+        p.state = PRESENCE_DEEP;
+        ev.deep = true;
+    }
+    return ev;
+}
+
+PresenceEvents presenceActivity(Presence& p, uint32_t nowMs) {
+    return wakeUp(p, nowMs);
+}
+
+uint32_t presencePollMs(const Presence& p) {
+    return p.state == PRESENCE_DEEP ? PRESENCE_DEEP_POLL_MS : PRESENCE_POLL_MS;
+}
+
+void presenceAccount(Presence& p, int32_t dischargeMa, uint32_t nowMs) {
+    uint32_t dt = nowMs - p.accountedMs;
+    p.accountedMs = nowMs;
+    p.msIn[p.state] += dt;
+    p.maMsIn[p.state] += (int64_t)dischargeMa * dt;
+}
+
+float presenceSavedMah(const Presence& p) {
+    if (!p.msIn[PRESENCE_ACTIVE]) return 0;
+    double activeMa = (double)p.maMsIn[PRESENCE_ACTIVE] / p.msIn[PRESENCE_ACTIVE];
+    double saved = 0;
+    for (int s = PRESENCE_DIM; s < PRESENCE_STATES; s++) {
+        saved += activeMa * p.msIn[s] - p.maMsIn[s]; // mA x ms
+    }
+    return (float)(saved / 3600000.0);
+}
+
+const char* presenceStateName(PresenceState s) {
+    static const char* const NAMES[] = { "active", "dim", "deep" };
+    return s < PRESENCE_STATES ? NAMES[s] : "?";
+}
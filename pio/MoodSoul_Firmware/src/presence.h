@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// PRESENCE (PROXIMITY PRE-WAKE)
+// ==========================================
+// Turns proximity readings (proximity.h, 11-bit counts) into power states.
+// Someone approaching is a reading clearly above a slowly tracked baseline
+// (the room, the desk, a wall behind the cube); leaving needs it to drop
+// back most of the way, so a hand hovering at the edge doesn't flap.
+// A near reading that stops moving (a mug set down next to the cube, a
+// wall after it was moved) stops counting as activity after
+// PRESENCE_DIM_MS, and after PRESENCE_LEARN_MS the baseline creeps up to
+// it, so the object becomes part of the room.
+//
+//   ACTIVE  someone near, or a touch/turn within PRESENCE_DIM_MS
+//   DIM     backlight low, radio still in light power save
+//   DEEP    display off, CPU slowed, radio in max power save
+//
+// An approach from DIM or DEEP is a wake: main.cpp restores the backlight,
+// warms the camera and pre-opens the server connection before the finger
+// lands. Time and battery current are tallied per state to show what
+// idling saves.
+
+#define PRESENCE_NEAR_DELTA    80     // counts over baseline: a hand or face within ~25 cm
+#define PRESENCE_FAR_DELTA     30     // back under this: gone
+#define PRESENCE_NEAR_SAMPLES  2      // consecutive readings to call an approach
+#define PRESENCE_BASELINE_SHIFT 5     // baseline moves 1/32 of the way per far reading
+#define PRESENCE_STEADY_BAND   20     // near readings within this of each other are one still object
+#define PRESENCE_LEARN_MS      120000 // still that long: learned into the baseline
+#define PRESENCE_DIM_MS        30000
+#define PRESENCE_DEEP_MS       180000
+#define PRESENCE_POLL_MS       100    // ACTIVE and DIM
+#define PRESENCE_DEEP_POLL_MS  250
+
+enum PresenceState : uint8_t {
+    PRESENCE_ACTIVE = 0,
+    PRESENCE_DIM,
+    PRESENCE_DEEP,
+    PRESENCE_STATES
+};
+
+struct Presence {
+    PresenceState state;
+    bool     near;
+    uint8_t  nearRun;
+    int32_t  baselineQ;       // far-reading average << PRESENCE_BASELINE_SHIFT
+    uint16_t steadyRef;       // near: the reading it has stayed around
+    uint32_t steadySinceMs;   // near: since when
+    uint32_t lastActivityMs;  // near, touch or turn
+    // Tallies for the savings report
+    uint64_t msIn[PRESENCE_STATES];
+    int64_t  maMsIn[PRESENCE_STATES]; // mA x ms, battery discharge
+    uint32_t accountedMs;
+    uint32_t wakes;
+};
+
+struct PresenceEvents {
+    bool approach;  // someone just came near
+    bool wake;      // back to ACTIVE from DIM or DEEP
+    bool dim;       // ACTIVE -> DIM
+    bool deep;      // DIM -> DEEP
+};
+
+void presenceInit(Presence& p, uint16_t firstReading, uint32_t nowMs);
+PresenceEvents presenceUpdate(Presence& p, uint16_t reading, uint32_t nowMs);
+// Touch, wake word, a turn: counts as presence.
+PresenceEvents presenceActivity(Presence& p, uint32_t nowMs);
+uint32_t presencePollMs(const Presence& p);
+// Books the time since the last call to the current state at dischargeMa.
+void presenceAccount(Presence& p, int32_t dischargeMa, uint32_t nowMs);
+// Estimated mAh saved by DIM/DEEP versus staying ACTIVE; 0 until ACTIVE
+// has a measured draw.
+float presenceSavedMah(const Presence& p);
+const char* presenceStateName(PresenceState s);
@@ -0,0 +1,206 @@
+#include "prewarm.h"
+#include "interaction_request.h"
+#include "reply_decoder.h"
+#include "metrics.h"
+#include "trace.h"
+#include <Arduino.h>
+
+enum PrewarmState : uint8_t {
+    PW_IDLE = 0,
+    PW_CONNECTING, // task running
+    PW_CONNECTED,  // prewarmConnect() done, no turn yet
+    PW_READY,      // head sent, waiting for the body
+    PW_TAKEN,      // in use by sendInteraction()
+    PW_FAILED,
+};
+
+static WiFiClientSecure      client;
+static volatile PrewarmState state = PW_IDLE;
+static volatile bool         cancelled = false;
+static volatile bool         headWanted = false; // a turn claimed the connection
+static portMUX_TYPE          handoff = portMUX_INITIALIZER_UNLOCKED;
+static char     host[64], path[48], boundary[40], traceId[TRACE_ID_LEN + 1];
+static uint16_t port;
+static uint32_t warmMs; // connect + TLS + head, however far apart
+// Stamped by the task, applied to the trace by prewarmTake() on loop(), and
+// only if they fall inside the turn that claimed the connection
+static uint64_t connectAt, tlsAt, turnAt;
+
+static Counter   metricPrewarmHits("moodsoul_prewarm_hits_total", "Turns sent on a pre-warmed connection");
+static Counter   metricPrewarmMisses("moodsoul_prewarm_misses_total", "Turns that wanted a pre-warm but connected cold");
+static Counter   metricPrewarmCancels("moodsoul_prewarm_cancels_total", "Pre-warms abandoned (taps that were not turns)");
+static Histogram metricPrewarmSavedMs("moodsoul_prewarm_saved_ms", "Connect+TLS+head time hidden behind the touch, ms");
+
+static void prewarmTask(void*) {
+    bool ok = true;
+    if (!client.connected()) {
+        uint32_t t0 = millis();
+        client.setInsecure(); // Same as sendInteraction(): no cert pinning yet
+        client.setHandshakeTimeout(10);
+        connectAt = traceNow();
+        ok = client.connect(host, port);
+        if (ok) tlsAt = traceNow();
+        warmMs += millis() - t0;
+    }
+    // Connect-only: park unless a turn claimed it meanwhile
+    bool park = false;
+    portENTER_CRITICAL(&handoff);
+    if (ok && !cancelled && !headWanted) {
+        state = PW_CONNECTED;
+        park = true;
+    }
+    portEXIT_CRITICAL(&handoff);
+    if (park) {
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    if (ok && !cancelled) {
+        uint32_t t0 = millis();
+        InteractionParts p = {};
+        p.host = host;
+        p.path = path;
+        p.boundary = boundary;
+        p.traceId = traceId;
+        p.audioCaps = REPLY_AUDIO_CAPS;
+        ClientSink sink(client);
+        ok = interactionWriteChunkedHead(sink, p);
+        warmMs += millis() - t0;
+    }
+    if (!ok || cancelled) {
+        client.stop();
+        state = cancelled ? PW_IDLE : PW_FAILED;
+    } else {
+        state = PW_READY;
+    }
+    vTaskDelete(nullptr);
+}
+
+// Drops a finished pre-warm nobody is going to use.
+static void reapIdle() {
+    if (state == PW_READY || state == PW_FAILED || state == PW_CONNECTED) {
+        client.stop();
+        state = PW_IDLE;
+    }
+}
+
+static void setTurn(const char* pa) {
+    strlcpy(path, pa, sizeof(path));
+    strlcpy(traceId, traceCurrentId(), sizeof(traceId));
+    turnAt = traceNow();
+    snprintf(boundary, sizeof(boundary), "------------------------%lu", (unsigned long)millis());
+}
+
+static bool startTask() {
+    if (xTaskCreatePinnedToCore(prewarmTask, "prewarm", 8192, nullptr, 1, nullptr, 0) != pdPASS) {
+        client.stop();
+        state = PW_IDLE;
+        return false;
+    }
+    return true;
+}
+
+bool prewarmBegin(const char* h, uint16_t p, const char* pa) {
+    // Still handshaking for a walk-up: the task sends the head when done
+    // (the fields are unused until headWanted is set)
+    if (state == PW_CONNECTING && !headWanted && !cancelled) {
+        setTurn(pa);
+        bool claimed = false;
+        portENTER_CRITICAL(&handoff);
+        if (state == PW_CONNECTING) {
+            headWanted = true;
+            claimed = true;
+        }
+        portEXIT_CRITICAL(&handoff);
+        if (claimed) return true;
+    }
+
+    if (state == PW_CONNECTED && port == p && !strcmp(host, h)) {
+        setTurn(pa);
+        headWanted = true;
+        state = PW_CONNECTING; // the task reconnects if the server hung up
+        return startTask();
+    }
+    reapIdle();
+    if (state != PW_IDLE) return false;
+
+    strlcpy(host, h, sizeof(host));
+    setTurn(pa);
+    port = p;
+    cancelled = false;
+    headWanted = true;
+    warmMs = 0;
+    connectAt = tlsAt = 0;
+    state = PW_CONNECTING;
+    return startTask();
+}
+
+bool prewarmConnect(const char* h, uint16_t p) {
+    reapIdle();
+    if (state != PW_IDLE) return false;
+    strlcpy(host, h, sizeof(host));
+    port = p;
+    cancelled = false;
+    headWanted = false;
+    warmMs = 0;
+    connectAt = tlsAt = 0;
+    state = PW_CONNECTING;
+    return startTask();
+}
+
+bool prewarmInFlight() {
+    return state == PW_CONNECTING;
+}
+
+bool prewarmIdleConnected() {
+    return state == PW_CONNECTED;
+}
+
+bool prewarmTake(PrewarmConn& out, uint32_t waitMs) {
+    unsigned long t0 = millis();
+    while (state == PW_CONNECTING && millis() - t0 < waitMs) delay(2);
+    uint32_t waited = millis() - t0;
+
+    if (state != PW_READY || cancelled || !client.connected()) {
+        if (state == PW_CONNECTING) cancelled = true; // the task cleans up
+        else reapIdle();
+        metricPrewarmMisses.inc();
+        return false;
+    }
+    state = PW_TAKEN;
+
+    // Without the pre-warm this turn would have paid warmMs after recording;
+    // it only paid what it had to wait here.
+    uint32_t saved = warmMs > waited ? warmMs - waited : 0;
+    metricPrewarmHits.inc();
+    metricPrewarmSavedMs.record(saved);
+    traceSetPrewarmSaved(saved);
+    if (!strcmp(traceId, traceCurrentId())) {
+        if (connectAt >= turnAt) traceMarkAt(TRACE_CONNECT, connectAt);
+        if (tlsAt >= turnAt) traceMarkAt(TRACE_TLS_DONE, tlsAt);
+    }
+    Serial.printf("prewarm: saved %lu ms (warm-up %lu ms, waited %lu ms)\n",
+                  (unsigned long)saved, (unsigned long)warmMs, (unsigned long)waited);
+
+    out.client = &client;
+    out.boundary = boundary;
+    return true;
+}
+
+void prewarmRelease() {
+    if (state != PW_TAKEN) return;
+    client.stop();
+    state = PW_IDLE;
+}
+
+void prewarmCancel() {
+    if (state == PW_CONNECTING) {
+        cancelled = true;
+        metricPrewarmCancels.inc();
+    } else if (state == PW_READY || state == PW_CONNECTED) {
+        metricPrewarmCancels.inc();
+        reapIdle();
+    } else {
+        reapIdle();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <WiFiClientSecure.h>
+
+// ==========================================
+// SPECULATIVE CONNECTION PRE-WARM
+// ==========================================
+// On touch-down a background task resolves the host, completes the TLS
+// handshake and sends the request head (chunked, see
+// interaction_request.h) while the user is still pressing and speaking.
+// sendInteraction() then only streams the body. A tap that turns out not
+// to be a turn cancels it; the cost is one idle handshake.
+//
+// Someone walking up (presence.h) starts it earlier still: prewarmConnect()
+// does only the handshake, with no turn or trace yet, and the touch-down's
+// prewarmBegin() then just sends the head on that connection.
+
+struct PrewarmConn {
+    WiFiClientSecure* client;   // connected, head already sent
+    const char*       boundary; // the body must use this boundary
+};
+
+// Starts a pre-warm for a turn whose trace is already open, on the
+// prewarmConnect() connection if there is one. False if one is still in
+// flight or being torn down.
+bool prewarmBegin(const char* host, uint16_t port, const char* path);
+// Connect and TLS only, ahead of any turn. False if a pre-warm is already
+// under way.
+bool prewarmConnect(const char* host, uint16_t port);
+// The background task is still connecting or sending.
+bool prewarmInFlight();
+// A prewarmConnect() connection no turn has claimed yet.
+bool prewarmIdleConnected();
+// Waits up to waitMs for the pre-warm to finish. On success the caller
+// owns the connection until prewarmRelease().
+bool prewarmTake(PrewarmConn& out, uint32_t waitMs);
+void prewarmRelease();
+// Abandons a pre-warm (center tap, cancelled turn, a walk-by that never
+// touched). Never blocks.
+void prewarmCancel();
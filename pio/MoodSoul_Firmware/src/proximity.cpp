@@ -0,0 +1,47 @@
+#include "proximity.h"
+#include <M5Unified.h>
+
+#define LTR553_ADDR        0x23
+#define LTR553_PS_CONTR    0x81
+#define LTR553_PS_LED      0x82
+#define LTR553_PS_N_PULSES 0x83
+#define LTR553_PS_MEAS     0x84
+#define LTR553_PART_ID     0x86
+#define LTR553_PS_DATA_0   0x8D
+#define LTR553_I2C_HZ      400000
+
+#define LTR553_MEAS_100MS  0x02
+#define LTR553_MEAS_200MS  0x03
+
+static bool present = false;
+
+static bool writeReg(uint8_t reg, uint8_t value) {
+    return M5.In_I2C.writeRegister8(LTR553_ADDR, reg, value, LTR553_I2C_HZ);
+}
+
+bool proximityBegin() {
+    uint8_t id = M5.In_I2C.readRegister8(LTR553_ADDR, LTR553_PART_ID, LTR553_I2C_HZ);
+    if (id != 0x92) {
+        Serial.printf("[PROX] LTR-553 not found (part id 0x%02x)\n", id);
+        return false;
+    }
+    present = writeReg(LTR553_PS_LED, 0x7B) &&     // 60 kHz, 100% duty, 50 mA
+              writeReg(LTR553_PS_N_PULSES, 4) &&   // enough for a face at arm's length
+              writeReg(LTR553_PS_MEAS, LTR553_MEAS_100MS) &&
+              writeReg(LTR553_PS_CONTR, 0x03);     // PS active, gain x16
+    if (!present) Serial.println("[PROX] LTR-553 setup failed");
+    return present;
+}
+
+void proximitySetSlow(bool slow) {
+    if (present) writeReg(LTR553_PS_MEAS, slow ? LTR553_MEAS_200MS : LTR553_MEAS_100MS);
+}
+
+bool proximityRead(uint16_t* ps) {
+    uint8_t b[2];
+    if (!present || !M5.In_I2C.readRegister(LTR553_ADDR, LTR553_PS_DATA_0, b, 2, LTR553_I2C_HZ)) {
+        return false;
+    }
+    *ps = (b[0] | b[1] << 8) & 0x07FF; // bit 15 is the saturation flag
+    return true;
+}
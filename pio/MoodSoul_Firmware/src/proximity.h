@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// PROXIMITY SENSOR (LTR-553ALS)
+// ==========================================
+// The CoreS3's proximity/ambient light sensor above the display, on the
+// internal I2C bus. It measures on its own at the programmed rate; reading
+// the latest result is one short I2C transaction, so loop() polls it
+// (presencePollMs()) rather than wiring up its interrupt, whose line is
+// shared on the CoreS3's IO expander.
+
+bool proximityBegin();
+// Slow: fewer IR LED pulses per second while nobody is around.
+void proximitySetSlow(bool slow);
+// Latest 11-bit reading (bigger is nearer). False if the sensor is absent
+// or the read failed.
+bool proximityRead(uint16_t* ps);
@@ -0,0 +1,351 @@
+#include "reaction_cache.h"
+#include "api_post.h"
+#include "clip_store.h"
+#include "metrics.h"
+#include "wifi_link.h"
+#include <M5Unified.h>
+#include <mutex>
+
+#define INDEX_PATH      "/reactions/index.bin"
+#define TMP_PATH        "/reactions/fetch.tmp"
+#define INDEX_MAGIC     0x31435852  // "RXC1"
+#define MAX_CLIP_LEN    (REACT_MAX_CLIP_MS * CLIP_RATE / 1000)
+#define MAX_FILE_BYTES  (MAX_CLIP_LEN * 2 + 512)
+#define TYPICAL_BYTES   (2 * CLIP_RATE * 2)    // a 2 s exclamation, to plan room
+#define POLL_MS         2000
+#define RETRY_MS        60000       // after a failed fetch
+#define FETCH_TIMEOUT_MS 20000      // Gemini + TTS on the server side
+#define SPK_CHANNEL     0
+
+struct IndexFile {
+    uint32_t      magic;
+    char          persona[40];
+    ReactionIndex index;
+};
+
+// The lock only guards memory (index, armed clips) and is never held
+// across file I/O, so reactionTake() on loop() doesn't wait on flash. Files
+// are only touched by the prefetch task (and init, before it starts).
+static std::mutex        lock;
+static IndexFile         state;
+static bool              indexDirty = false;  // under lock: index.bin is behind
+static bool              sweepWanted = false; // under lock: clip files to drop
+static fs::FS*           fs = nullptr;
+static ReactionClip      armed[REACT_TRIGGERS];
+static int8_t            armedSlot[REACT_TRIGGERS];
+static TaskHandle_t      task = nullptr;
+static volatile bool     allowed = false;
+static String            url;
+static String            deviceId;
+static uint32_t          hits = 0, misses = 0, fetches = 0, fetchErrors = 0;
+
+static Counter metricHits("moodsoul_reaction_cache_hits_total", "Shake/flip reactions played from the flash cache");
+static Counter metricMisses("moodsoul_reaction_cache_misses_total", "Shake/flip reactions that had to go to the server");
+static Gauge   metricBytes("moodsoul_reaction_cache_bytes", "Reaction clips on flash, bytes");
+static Counter metricFetches("moodsoul_reaction_prefetch_total", "Reaction clips prefetched while idle");
+
+static const char* TRIGGER_NAMES[REACT_TRIGGERS] = { "SHAKE_EVENT", "UPSIDE_DOWN" };
+
+const char* reactionTriggerName(ReactionTrigger t) {
+    return t < REACT_TRIGGERS ? TRIGGER_NAMES[t] : "";
+}
+
+static String clipPath(uint16_t id) {
+    return String("/reactions/") + id + ".wav";
+}
+
+static void disarm(int t) {
+    clipStoreFree(armed[t].pcm);
+    armed[t] = { nullptr, 0 };
+    armedSlot[t] = -1;
+}
+
+// Removes clip files the index doesn't name (a wiped persona's).
+static void sweepFiles(const ReactionIndex& index) {
+    File d = fs->open("/reactions");
+    if (!d || !d.isDirectory()) return;
+    String doomed[REACT_MAX_ENTRIES * 2];
+    int n = 0;
+    File f;
+    while ((f = d.openNextFile()) && n < REACT_MAX_ENTRIES * 2) {
+        String name = f.name();
+        int slash = name.lastIndexOf('/');
+        if (slash >= 0) name = name.substring(slash + 1);
+        f.close();
+        if (!name.endsWith(".wav")) continue;
+        long id = name.toInt();
+        bool named = false;
+        for (int i = 0; i < REACT_MAX_ENTRIES && !named; i++) named = id && index.e[i].id == id;
+        if (!named) doomed[n++] = "/reactions/" + name;
+    }
+    d.close();
+    for (int i = 0; i < n; i++) fs->remove(doomed[i]);
+}
+
+// Writes index.bin if it changed, from a copy taken under the lock.
+static void flushIndex() {
+    IndexFile snap;
+    bool sweep;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        if (!indexDirty && !sweepWanted) return;
+        snap = state;
+        sweep = sweepWanted;
+        indexDirty = sweepWanted = false;
+    }
+    if (sweep) sweepFiles(snap.index);
+    File f = fs->open(INDEX_PATH, "w");
+    if (f) {
+        f.write((const uint8_t*)&snap, sizeof(snap));
+        f.close();
+    }
+    metricBytes.set(rlruBytes(snap.index));
+}
+
+// Callers hold the lock. The files go at the next flushIndex().
+static void wipe(const char* persona) {
+    for (int t = 0; t < REACT_TRIGGERS; t++) disarm(t);
+    state.magic = INDEX_MAGIC;
+    strncpy(state.persona, persona, sizeof(state.persona) - 1);
+    state.persona[sizeof(state.persona) - 1] = '\0';
+    rlruInit(state.index, REACT_BUDGET_BYTES);
+    indexDirty = sweepWanted = true;
+}
+
+// Loads the next clip for each trigger that has none in RAM. The load is
+// outside the lock; the clip is swapped in after if its entry still stands.
+static void armAll() {
+    for (int t = 0; t < REACT_TRIGGERS; t++) {
+        int slot;
+        uint16_t id;
+        {
+            std::lock_guard<std::mutex> g(lock);
+            slot = rlruPick(state.index, t);
+            if (slot == armedSlot[t]) continue;
+            disarm(t);
+            if (slot < 0) continue;
+            id = state.index.e[slot].id;
+        }
+        ReactionClip clip = { nullptr, 0 };
+        bool ok = clipStoreLoadWav(*fs, clipPath(id).c_str(), MAX_CLIP_LEN, &clip.pcm, &clip.len);
+        bool current;
+        {
+            std::lock_guard<std::mutex> g(lock);
+            current = state.index.e[slot].id == id && !armed[t].pcm;
+            if (current && ok) {
+                armed[t] = clip;
+                armedSlot[t] = slot;
+                clip.pcm = nullptr;
+            } else if (current) {
+                state.index.e[slot].id = 0; // unreadable: forget it
+                indexDirty = true;
+            }
+        }
+        if (clip.pcm) clipStoreFree(clip.pcm);
+        if (current && !ok) fs->remove(clipPath(id));
+    }
+}
+
+// One clip for `trigger` into TMP_PATH. Returns its size, 0 on failure.
+static uint32_t fetchClip(int trigger, String& persona) {
+    WiFiClientSecure client;
+    HTTPClient http;
+    const char* keys[] = { "X-Persona-Id" };
+    if (!apiPostBegin(http, client, url, FETCH_TIMEOUT_MS, "application/json", keys, 1)) return 0;
+    int code = http.POST(String("{\"deviceId\":\"") + deviceId + "\",\"trigger\":\"" + TRIGGER_NAMES[trigger] + "\"}");
+    int len = http.getSize();
+    if (code != 200 || len <= 44 || len > MAX_FILE_BYTES) {
+        Serial.printf("[REACT] fetch %s: HTTP %d, %d bytes\n", TRIGGER_NAMES[trigger], code, len);
+        http.end();
+        return 0;
+    }
+    persona = http.header("X-Persona-Id");
+
+    File f = fs->open(TMP_PATH, "w");
+    WiFiClient* s = http.getStreamPtr();
+    uint8_t buf[1024];
+    int got = 0;
+    unsigned long lastData = millis();
+    // A turn starting mid-download wins the link: drop the clip
+    while (f && got < len && allowed) {
+        int n = s->available();
+        if (n <= 0) {
+            if (!s->connected() || millis() - lastData > 5000) break;
+            delay(5);
+            continue;
+        }
+        n = s->readBytes(buf, std::min<int>(std::min(n, (int)sizeof(buf)), len - got));
+        f.write(buf, n);
+        got += n;
+        lastData = millis();
+    }
+    if (f) f.close();
+    http.end();
+    return got == len ? (uint32_t)len : 0;
+}
+
+// False if there was no room after all (the clip is dropped). The index
+// changes under the lock, the files after it.
+static bool storeClip(int trigger, uint32_t bytes, const String& persona) {
+    uint16_t evicted[REACT_MAX_ENTRIES];
+    int n;
+    uint16_t id = 0;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        // Clips are rendered for whoever is active on the server right now
+        if (persona.length() && persona != state.persona) wipe(persona.c_str());
+        n = rlruMakeRoom(state.index, bytes, evicted);
+        if (n >= 0) {
+            for (int t = 0; t < REACT_TRIGGERS; t++) {
+                if (armedSlot[t] >= 0 && state.index.e[armedSlot[t]].id == 0) disarm(t);
+            }
+            int slot = rlruInsert(state.index, trigger, bytes);
+            id = state.index.e[slot].id;
+            indexDirty = true;
+        }
+    }
+    if (n < 0) {
+        fs->remove(TMP_PATH);
+        return false;
+    }
+    for (int i = 0; i < n; i++) fs->remove(clipPath(evicted[i]));
+    fs->rename(TMP_PATH, clipPath(id));
+    return true;
+}
+
+static void prefetchTask(void*) {
+    armAll();
+    uint32_t retryAt = 0;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(POLL_MS));
+        armAll(); // after a play, or a persona change
+        flushIndex();
+        if (!allowed || wifiLinkQuality().tier < LINK_FAIR) continue;
+        if (retryAt && (int32_t)(millis() - retryAt) < 0) continue;
+        int t;
+        {
+            std::lock_guard<std::mutex> g(lock);
+            t = rlruWanted(state.index, TYPICAL_BYTES);
+        }
+        if (t < 0) continue;
+
+        String persona;
+        uint32_t bytes = fetchClip(t, persona);
+        if (!bytes) {
+            fetchErrors++;
+            fs->remove(TMP_PATH);
+            if (allowed) retryAt = millis() + RETRY_MS;
+            continue;
+        }
+        retryAt = 0;
+        if (!storeClip(t, bytes, persona)) {
+            retryAt = millis() + RETRY_MS;
+            continue;
+        }
+        flushIndex();
+        fetches++;
+        metricFetches.inc();
+        Serial.printf("[REACT] cached a %s clip (%u bytes)\n", TRIGGER_NAMES[t], (unsigned)bytes);
+    }
+}
+
+void reactionCacheInit(const char* persona, const char* host, const char* path, const char* id) {
+    if (task) return;
+    fs = clipStoreFs(false);
+    if (!fs) {
+        Serial.println("[REACT] no LittleFS: reaction cache off");
+        return;
+    }
+    url = String("https://") + host + path;
+    deviceId = id;
+    for (int t = 0; t < REACT_TRIGGERS; t++) disarm(t);
+    fs->mkdir("/reactions");
+
+    File f = fs->open(INDEX_PATH, "r");
+    bool ok = f && f.read((uint8_t*)&state, sizeof(state)) == sizeof(state) && state.magic == INDEX_MAGIC &&
+              strncmp(state.persona, persona, sizeof(state.persona)) == 0;
+    if (f) f.close();
+    if (ok) {
+        state.index.budget = REACT_BUDGET_BYTES;
+        for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+            if (state.index.e[i].id && !fs->exists(clipPath(state.index.e[i].id))) state.index.e[i].id = 0;
+        }
+        indexDirty = true;
+    } else {
+        wipe(persona);
+    }
+    flushIndex();
+    // Low priority on core 0, like the OTA check
+    xTaskCreatePinnedToCore(prefetchTask, "react", 8192, nullptr, 1, &task, 0);
+}
+
+void reactionCacheSetPersona(const char* persona) {
+    if (!fs) return;
+    std::lock_guard<std::mutex> g(lock);
+    if (strncmp(state.persona, persona, sizeof(state.persona)) == 0) return;
+    Serial.printf("[REACT] persona now '%s': cache dropped\n", persona);
+    wipe(persona);
+    if (task) xTaskNotifyGive(task); // the task drops the files
+}
+
+void reactionCacheClear() {
+    if (!fs) return;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        wipe(state.persona);
+    }
+    if (task) xTaskNotifyGive(task);
+}
+
+void reactionPrefetchAllow(bool allow) {
+    allowed = allow;
+}
+
+bool reactionTake(ReactionTrigger t, ReactionClip& clip) {
+    bool hit = false;
+    if (fs && t < REACT_TRIGGERS) {
+        std::lock_guard<std::mutex> g(lock);
+        if (armed[t].pcm) {
+            clip = armed[t];
+            armed[t] = { nullptr, 0 };
+            rlruTouch(state.index, armedSlot[t]);
+            armedSlot[t] = -1;
+            indexDirty = true; // written by the task
+            hit = true;
+        }
+    }
+    if (hit) {
+        hits++;
+        metricHits.inc();
+        if (task) xTaskNotifyGive(task); // arm the next one
+    } else {
+        misses++;
+        metricMisses.inc();
+    }
+    return hit;
+}
+
+void reactionPlayClip(ReactionClip& clip) {
+    if (!clip.pcm) return;
+    M5.Speaker.playRaw(clip.pcm, clip.len, CLIP_RATE, false, 1, SPK_CHANNEL);
+    while (M5.Speaker.isPlaying(SPK_CHANNEL)) delay(10);
+    clipStoreFree(clip.pcm);
+    clip = { nullptr, 0 };
+}
+
+ReactionCacheStats reactionCacheStats() {
+    ReactionCacheStats s = {};
+    s.hits = hits;
+    s.misses = misses;
+    s.fetches = fetches;
+    s.fetchErrors = fetchErrors;
+    s.budget = REACT_BUDGET_BYTES;
+    if (!fs) return s;
+    std::lock_guard<std::mutex> g(lock);
+    s.bytes = rlruBytes(state.index);
+    for (int t = 0; t < REACT_TRIGGERS; t++) {
+        s.clips += rlruCount(state.index, t, false);
+        s.fresh += rlruCount(state.index, t, true);
+    }
+    return s;
+}
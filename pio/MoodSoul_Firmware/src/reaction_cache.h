@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include "reaction_lru.h"
+
+// ==========================================
+// REACTION CLIP CACHE
+// ==========================================
+// Shake and flip are reflexes: waiting on Gemini + TTS for "STOP IT!"
+// makes the cube feel dead. While it sits idle on the charger, a background
+// task asks the server (/api/reactions) for a few reaction clips per
+// trigger for the active persona and keeps them on LittleFS:
+//   /reactions/<id>.wav   16 kHz mono PCM16
+//   /reactions/index.bin  persona + LRU index (reaction_lru.h)
+// The next clip for each trigger is held in PSRAM, so a reaction starts
+// playing in the same loop() pass that saw the event. A persona change
+// drops the whole cache.
+
+#define REACT_BUDGET_BYTES (512 * 1024)
+#define REACT_MAX_CLIP_MS  4000
+
+struct ReactionCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t bytes;    // clip files on flash
+    uint32_t budget;
+    uint8_t  clips;
+    uint8_t  fresh;    // clips not played yet
+    uint32_t fetches;
+    uint32_t fetchErrors;
+};
+
+// Loads the index (dropped if it belongs to another persona) and starts
+// the prefetch task. Reactions are fetched from https://host/path.
+void reactionCacheInit(const char* persona, const char* host, const char* path, const char* deviceId);
+// The active persona changed: empty the cache.
+void reactionCacheSetPersona(const char* persona);
+void reactionCacheClear();
+// Prefetch only runs while this is set: idle between turns, on the charger.
+void reactionPrefetchAllow(bool allow);
+
+struct ReactionClip {
+    int16_t* pcm;
+    uint32_t len;
+};
+
+// The trigger's next clip, already in RAM. False on a miss (nothing cached
+// for it yet). Counts as a hit or a miss either way.
+bool reactionTake(ReactionTrigger t, ReactionClip& clip);
+// Plays a taken clip to the end on M5.Speaker (the caller holds the
+// speaker), then frees it.
+void reactionPlayClip(ReactionClip& clip);
+ReactionCacheStats reactionCacheStats();
+const char* reactionTriggerName(ReactionTrigger t);
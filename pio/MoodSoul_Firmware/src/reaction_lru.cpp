@@ -0,0 +1,118 @@
+#include "reaction_lru.h"
+#include <string.h>
+
+void rlruInit(ReactionIndex& x, uint32_t budget) {
+    memset(&x, 0, sizeof(x));
+    x.nextId = 1;
+    x.budget = budget;
+}
+
+uint32_t rlruBytes(const ReactionIndex& x) {
+    uint32_t total = 0;
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        if (x.e[i].id) total += x.e[i].bytes;
+    }
+    return total;
+}
+
+int rlruCount(const ReactionIndex& x, uint8_t trigger, bool freshOnly) {
+    int n = 0;
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        const ReactionEntry& e = x.e[i];
+        if (e.id && e.trigger == trigger && (!freshOnly || e.plays == 0)) n++;
+    }
+    return n;
+}
+
+int rlruPick(const ReactionIndex& x, uint8_t trigger) {
+    int best = -1;
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        const ReactionEntry& e = x.e[i];
+        if (!e.id || e.trigger != trigger) continue;
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        const ReactionEntry& b = x.e[best];
+        bool fresh = e.plays == 0, bestFresh = b.plays == 0;
+        if (fresh != bestFresh ? fresh : e.lastUse < b.lastUse) best = i;
+    }
+    return best;
+}
+
+void rlruTouch(ReactionIndex& x, int slot) {
+    ReactionEntry& e = x.e[slot];
+    if (e.plays < 255) e.plays++;
+    e.lastUse = ++x.clock;
+}
+
+// Room for `bytes` once every played clip is gone?
+static bool canFit(const ReactionIndex& x, uint32_t bytes) {
+    uint32_t used = 0, reclaim = 0;
+    bool slot = false;
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        const ReactionEntry& e = x.e[i];
+        if (!e.id) {
+            slot = true;
+            continue;
+        }
+        used += e.bytes;
+        if (e.plays > 0) {
+            reclaim += e.bytes;
+            slot = true;
+        }
+    }
+    return used - reclaim + bytes <= x.budget && slot;
+}
+
+int rlruWanted(const ReactionIndex& x, uint32_t clipBytes) {
+    if (!canFit(x, clipBytes)) return -1;
+    int best = -1, bestFresh = REACT_POOL;
+    for (int t = 0; t < REACT_TRIGGERS; t++) {
+        int fresh = rlruCount(x, t, true);
+        if (fresh < bestFresh) {
+            bestFresh = fresh;
+            best = t;
+        }
+    }
+    return best;
+}
+
+// Least recently used played clip.
+static int victim(const ReactionIndex& x) {
+    int best = -1;
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        const ReactionEntry& e = x.e[i];
+        if (!e.id || e.plays == 0) continue;
+        if (best < 0 || e.lastUse < x.e[best].lastUse) best = i;
+    }
+    return best;
+}
+
+int rlruMakeRoom(ReactionIndex& x, uint32_t bytes, uint16_t* evicted) {
+    if (!canFit(x, bytes)) return -1;
+    int n = 0;
+    for (;;) {
+        bool freeSlot = false;
+        for (int i = 0; i < REACT_MAX_ENTRIES && !freeSlot; i++) freeSlot = x.e[i].id == 0;
+        if (freeSlot && rlruBytes(x) + bytes <= x.budget) return n;
+        int v = victim(x);
+        evicted[n++] = x.e[v].id;
+        x.e[v].id = 0;
+    }
+}
+
+int rlruInsert(ReactionIndex& x, uint8_t trigger, uint32_t bytes) {
+    for (int i = 0; i < REACT_MAX_ENTRIES; i++) {
+        ReactionEntry& e = x.e[i];
+        if (e.id) continue;
+        e.id = x.nextId++;
+        if (x.nextId == 0) x.nextId = 1;
+        e.trigger = trigger;
+        e.plays = 0;
+        e.bytes = bytes;
+        e.lastUse = ++x.clock;
+        return i;
+    }
+    return -1;
+}
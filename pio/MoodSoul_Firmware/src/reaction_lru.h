@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// REACTION CLIP INDEX (LRU)
+// ==========================================
+// Bookkeeping for the on-flash reaction cache (reaction_cache.h): which
+// clips exist for which trigger, how often each was played, and what to
+// evict when a new one doesn't fit the byte budget. Each trigger wants
+// REACT_POOL clips nobody has heard yet; played clips stay around as a
+// fallback until space runs out. Eviction is least recently used among
+// played clips: an unheard clip is never dropped for another one.
+
+#define REACT_MAX_ENTRIES 16
+#define REACT_POOL        3
+
+enum ReactionTrigger : uint8_t {
+    REACT_SHAKE = 0,
+    REACT_UPSIDE_DOWN,
+    REACT_TRIGGERS
+};
+
+struct ReactionEntry {
+    uint16_t id;       // clip file id, 0 = free slot
+    uint8_t  trigger;
+    uint8_t  plays;
+    uint32_t bytes;
+    uint32_t lastUse;  // index clock at insert or last play
+};
+
+struct ReactionIndex {
+    ReactionEntry e[REACT_MAX_ENTRIES];
+    uint32_t clock;
+    uint16_t nextId;
+    uint32_t budget;   // bytes of clip files
+};
+
+void rlruInit(ReactionIndex& x, uint32_t budget);
+uint32_t rlruBytes(const ReactionIndex& x);
+int rlruCount(const ReactionIndex& x, uint8_t trigger, bool freshOnly);
+// Slot to play next for the trigger: the oldest unplayed clip, else the
+// least recently played one. -1 if there's none.
+int rlruPick(const ReactionIndex& x, uint8_t trigger);
+void rlruTouch(ReactionIndex& x, int slot);
+// The trigger furthest below its pool of fresh clips, -1 if all are full
+// or a clip of `clipBytes` couldn't be made room for.
+int rlruWanted(const ReactionIndex& x, uint32_t clipBytes);
+// Evicts played clips until `bytes` more fit the budget and a slot is
+// free. Evicted ids go to `evicted` (REACT_MAX_ENTRIES long). Returns how
+// many, or -1 (nothing evicted) if it can't make room.
+int rlruMakeRoom(ReactionIndex& x, uint32_t bytes, uint16_t* evicted);
+// Adds a clip (after rlruMakeRoom). Returns its slot; the id is e[slot].id.
+int rlruInsert(ReactionIndex& x, uint8_t trigger, uint32_t bytes);
@@ -0,0 +1,307 @@
+#include "reply_decoder.h"
+#include <string.h>
+#include <strings.h>
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include "libhelix-mp3/mp3dec.h"
+#endif
+
+#define OUT_BLOCK 256 // samples handed to the sink at a time
+
+// ==========================================
+// PCM16
+// ==========================================
+struct Pcm16Decoder : ReplyDecoder {
+    uint8_t odd;
+    bool    hasOdd;
+
+    void reset() override { hasOdd = false; }
+
+    bool decode(const uint8_t* data, size_t len, PcmSink& out) override {
+        int16_t buf[OUT_BLOCK];
+        size_t n = 0;
+        if (hasOdd && len) {
+            buf[n++] = (int16_t)(odd | data[0] << 8);
+            data++;
+            len--;
+            hasOdd = false;
+        }
+        for (; len >= 2; data += 2, len -= 2) {
+            buf[n++] = (int16_t)(data[0] | data[1] << 8);
+            if (n == OUT_BLOCK) {
+                out.pcm(buf, n);
+                n = 0;
+            }
+        }
+        if (n) out.pcm(buf, n);
+        if (len) {
+            odd = data[0];
+            hasOdd = true;
+        }
+        return true;
+    }
+};
+
+// ==========================================
+// IMA-ADPCM
+// ==========================================
+static const int16_t STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767,
+};
+static const int8_t INDEX_STEP[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static inline int clampIndex(int i) {
+    return i < 0 ? 0 : i > 88 ? 88 : i;
+}
+
+static inline int16_t imaExpand(int code, int& pred, int& index) {
+    int step = STEPS[index];
+    int diff = step >> 3;
+    if (code & 1) diff += step >> 2;
+    if (code & 2) diff += step >> 1;
+    if (code & 4) diff += step;
+    pred += (code & 8) ? -diff : diff;
+    pred = pred < -32768 ? -32768 : pred > 32767 ? 32767 : pred;
+    index = clampIndex(index + INDEX_STEP[code & 7]);
+    return (int16_t)pred;
+}
+
+struct ImaAdpcmDecoder : ReplyDecoder {
+    uint8_t block[REPLY_ADPCM_BLOCK];
+    size_t  have;
+    bool    bad;
+
+    void reset() override {
+        have = 0;
+        bad = false;
+    }
+
+    void decodeBlock(size_t len, PcmSink& out) {
+        int16_t buf[OUT_BLOCK];
+        int pred = (int16_t)(block[0] | block[1] << 8);
+        int index = block[2];
+        if (index > 88) {
+            bad = true;
+            return;
+        }
+        size_t n = 0;
+        buf[n++] = (int16_t)pred;
+        for (size_t i = 4; i < len; i++) {
+            buf[n++] = imaExpand(block[i] & 0x0F, pred, index);
+            buf[n++] = imaExpand(block[i] >> 4, pred, index);
+            if (n >= OUT_BLOCK - 1) {
+                out.pcm(buf, n);
+                n = 0;
+            }
+        }
+        if (n) out.pcm(buf, n);
+    }
+
+    bool decode(const uint8_t* data, size_t len, PcmSink& out) override {
+        while (len && !bad) {
+            size_t take = REPLY_ADPCM_BLOCK - have;
+            if (take > len) take = len;
+            memcpy(block + have, data, take);
+            have += take;
+            data += take;
+            len -= take;
+            if (have == REPLY_ADPCM_BLOCK) {
+                decodeBlock(have, out);
+                have = 0;
+            }
+        }
+        return !bad;
+    }
+
+    void flush(PcmSink& out) override {
+        if (have >= 4 && !bad) decodeBlock(have, out);
+        reset();
+    }
+};
+
+size_t imaAdpcmEncodeBlock(const int16_t* pcm, size_t n, int& index, uint8_t* out) {
+    if (n == 0) return 0;
+    if (n > REPLY_ADPCM_SAMPLES) n = REPLY_ADPCM_SAMPLES;
+    int pred = pcm[0];
+    index = clampIndex(index);
+    out[0] = (uint8_t)(pred & 0xFF);
+    out[1] = (uint8_t)((pred >> 8) & 0xFF);
+    out[2] = (uint8_t)index;
+    out[3] = 0;
+    size_t len = 4;
+    for (size_t i = 1; i < n; i += 2) {
+        uint8_t byte = 0;
+        for (size_t k = 0; k < 2; k++) {
+            // The encoder runs the decoder's own update so both stay in step
+            int target = i + k < n ? pcm[i + k] : pred;
+            int diff = target - pred;
+            int step = STEPS[index];
+            int code = 0;
+            if (diff < 0) {
+                code = 8;
+                diff = -diff;
+            }
+            if (diff >= step) { code |= 4; diff -= step; }
+            if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+            if (diff >= step >> 2) code |= 1;
+            imaExpand(code, pred, index);
+            byte |= (uint8_t)(code << (4 * k));
+        }
+        out[len++] = byte;
+    }
+    return len;
+}
+
+// ==========================================
+// MP3 (device)
+// ==========================================
+#if defined(ARDUINO)
+#define MP3_IN_BUF 4096 // a max-size frame (MAINBUF_SIZE) plus a socket read
+
+struct Mp3Decoder : ReplyDecoder {
+    HMP3Decoder helix = nullptr;
+    uint8_t     in[MP3_IN_BUF];
+    size_t      have;
+    int16_t     frame[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+    bool        warned;
+
+    void reset() override {
+        have = 0;
+        warned = false;
+        // Forget the bit reservoir of the last reply
+        if (helix) MP3FreeDecoder(helix);
+        helix = MP3InitDecoder();
+    }
+
+    ~Mp3Decoder() {
+        if (helix) MP3FreeDecoder(helix);
+    }
+
+    void emit(PcmSink& out) {
+        MP3FrameInfo info;
+        MP3GetLastFrameInfo(helix, &info);
+        if (info.samprate != REPLY_RATE && !warned) {
+            // We ask for 16 kHz; anything else plays at the wrong pitch
+            Serial.printf("reply: mp3 at %d Hz, expected %d\n", info.samprate, REPLY_RATE);
+            warned = true;
+        }
+        size_t n = info.outputSamps;
+        if (info.nChans == 2) {
+            n /= 2;
+            for (size_t i = 0; i < n; i++) frame[i] = (int16_t)((frame[2 * i] + frame[2 * i + 1]) / 2);
+        }
+        for (size_t off = 0; off < n; off += OUT_BLOCK) out.pcm(frame + off, n - off < OUT_BLOCK ? n - off : OUT_BLOCK);
+    }
+
+    bool decode(const uint8_t* data, size_t len, PcmSink& out) override {
+        if (!helix) return false; // out of memory at reset()
+        while (len) {
+            size_t take = MP3_IN_BUF - have;
+            if (take > len) take = len;
+            memcpy(in + have, data, take);
+            have += take;
+            data += take;
+            len -= take;
+
+            unsigned char* p = in;
+            int left = (int)have;
+            for (;;) {
+                int sync = MP3FindSyncWord(p, left);
+                if (sync < 0) {
+                    left = 0;
+                    break;
+                }
+                p += sync;
+                left -= sync;
+                unsigned char* frameStart = p;
+                int leftBefore = left;
+                int err = MP3Decode(helix, &p, &left, frame, 0);
+                if (err == ERR_MP3_NONE) {
+                    emit(out);
+                } else if (err == ERR_MP3_INDATA_UNDERFLOW) {
+                    // Frame not all here yet
+                    p = frameStart;
+                    left = leftBefore;
+                    break;
+                } else if (err != ERR_MP3_MAINDATA_UNDERFLOW) {
+                    // Not a real frame header: step past it and resync
+                    p = frameStart + 1;
+                    left = leftBefore - 1;
+                }
+                if (left <= 0) break;
+            }
+            memmove(in, p, left);
+            have = left;
+        }
+        return true;
+    }
+};
+#endif
+
+// ==========================================
+// SELECTION
+// ==========================================
+static Pcm16Decoder    pcm16;
+static ImaAdpcmDecoder imaAdpcm;
+#if defined(ARDUINO)
+static Mp3Decoder*     mp3 = nullptr; // ~30 KB with helix, only once an MP3 shows up
+#endif
+
+ReplyDecoder* replyDecoder(uint8_t codec) {
+    ReplyDecoder* d = nullptr;
+    switch (codec) {
+    case SEGMENT_CODEC_PCM16:
+        d = &pcm16;
+        break;
+    case SEGMENT_CODEC_IMA_ADPCM:
+        d = &imaAdpcm;
+        break;
+#if defined(ARDUINO)
+    case SEGMENT_CODEC_MP3:
+        if (!mp3) mp3 = new Mp3Decoder();
+        d = mp3;
+        break;
+#endif
+    default:
+        break;
+    }
+    if (d) d->reset();
+    return d;
+}
+
+ReplyDecoder* replyDecoderCreate(uint8_t codec) {
+    ReplyDecoder* d = nullptr;
+    if (codec == SEGMENT_CODEC_PCM16) d = new Pcm16Decoder();
+    else if (codec == SEGMENT_CODEC_IMA_ADPCM) d = new ImaAdpcmDecoder();
+#if defined(ARDUINO)
+    else if (codec == SEGMENT_CODEC_MP3) d = new Mp3Decoder();
+#endif
+    if (d) d->reset();
+    return d;
+}
+
+int replyCodecForType(const char* type) {
+    if (!strncasecmp(type, "audio/mpeg", 10)) return SEGMENT_CODEC_MP3;
+    if (!strncasecmp(type, "audio/L16", 9)) return SEGMENT_CODEC_PCM16;
+    if (!strncasecmp(type, "audio/x-ima-adpcm", 17)) return SEGMENT_CODEC_IMA_ADPCM;
+    return -1;
+}
+
+static const char* const NAMES[] = { "mp3", "pcm16", "ima-adpcm" };
+
+const char* replyCodecName(uint8_t codec) {
+    return codec < sizeof(NAMES) / sizeof(NAMES[0]) ? NAMES[codec] : "?";
+}
+
+int replyCodecFromName(const char* name, size_t len) {
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (strlen(NAMES[i]) == len && !strncasecmp(name, NAMES[i], len)) return (int)i;
+    }
+    return -1;
+}
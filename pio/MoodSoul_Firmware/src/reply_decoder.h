@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "reply_segments.h"
+
+// ==========================================
+// REPLY AUDIO DECODING
+// ==========================================
+// The server used to send MP3 only. The S3 can play 16 kHz PCM as is, or
+// IMA-ADPCM for a quarter of the bytes at a few cycles a sample, so every
+// request now says what it takes:
+//
+//   X-Audio-Caps: codecs=ima-adpcm,pcm16,mp3; rate=16000; channels=1;
+//                 buffer-ms=256; adpcm-block=256
+//
+// codecs in order of preference, buffer-ms is how much reply audio the
+// device queues ahead of the speaker (fillerReply()'s ring). The server
+// answers with one of them, named by the Content-Type of a whole-body
+// reply or by the codec byte of each segment:
+//
+//   codec                 Content-Type                    segment codec
+//   MP3                   audio/mpeg                      SEGMENT_CODEC_MP3
+//   16-bit LE PCM         audio/L16;rate=16000            SEGMENT_CODEC_PCM16
+//   IMA-ADPCM (WAV/MS)    audio/x-ima-adpcm;rate=16000    SEGMENT_CODEC_IMA_ADPCM
+//
+// IMA-ADPCM is mono blocks of REPLY_ADPCM_BLOCK bytes: int16 first sample,
+// uint8 step index, one reserved byte, then 4-bit codes low nibble first.
+// The last block of a reply may be short. Servers that ignore the header
+// keep sending MP3.
+//
+// All decoders push 16 kHz mono PCM into a PcmSink, whatever the socket
+// handed them, keeping partial frames for the next call. MP3 uses libhelix
+// and is device-only; the host tools get PCM and ADPCM.
+
+#define REPLY_RATE           16000
+#define REPLY_BUFFER_MS      256
+#define REPLY_ADPCM_BLOCK    256
+#define REPLY_ADPCM_SAMPLES  ((REPLY_ADPCM_BLOCK - 4) * 2 + 1) // 505
+
+#if defined(ARDUINO)
+#define REPLY_CODECS "ima-adpcm,pcm16,mp3"
+#else
+#define REPLY_CODECS "ima-adpcm,pcm16"
+#endif
+#define REPLY_AUDIO_CAPS "codecs=" REPLY_CODECS "; rate=16000; channels=1; buffer-ms=256; adpcm-block=256"
+
+struct PcmSink {
+    virtual void pcm(const int16_t* samples, size_t n) = 0;
+    virtual ~PcmSink() {}
+};
+
+struct ReplyDecoder {
+    virtual void reset() = 0;
+    // Decodes what it can of data[0..len). False on data it can't make
+    // sense of (the rest of the reply is best skipped).
+    virtual bool decode(const uint8_t* data, size_t len, PcmSink& out) = 0;
+    // End of the reply: plays out a trailing partial frame, then resets.
+    virtual void flush(PcmSink& out) { (void)out; reset(); }
+    virtual ~ReplyDecoder() {}
+};
+
+// The decoder for a SEGMENT_CODEC_* value, reset. nullptr when it isn't
+// built in. One shared instance per codec: one reply at a time.
+ReplyDecoder* replyDecoder(uint8_t codec);
+// A fresh one the caller deletes, for host tools decoding many replies at once.
+ReplyDecoder* replyDecoderCreate(uint8_t codec);
+// SEGMENT_CODEC_* for a whole-body Content-Type, -1 if it isn't audio.
+int replyCodecForType(const char* contentType);
+const char* replyCodecName(uint8_t codec);
+// Caps codec name ("pcm16") to SEGMENT_CODEC_*, -1 if unknown.
+int replyCodecFromName(const char* name, size_t len);
+
+// Encodes up to REPLY_ADPCM_SAMPLES samples as one block (shorter only for
+// the last one) and returns its length. `index` carries the step index
+// from block to block; start it at 0. For the host tools and benchmarks.
+size_t imaAdpcmEncodeBlock(const int16_t* pcm, size_t n, int& index, uint8_t* out);
@@ -0,0 +1,180 @@
+#include "reply_segments.h"
+#include <string.h>
+
+static uint16_t le16(const uint8_t* p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void segmentWriteHeader(uint8_t* b, const SegmentHeader& h) {
+    b[0] = SEGMENT_MAGIC & 0xFF;
+    b[1] = SEGMENT_MAGIC >> 8;
+    b[2] = h.flags;
+    b[3] = h.codec;
+    b[4] = h.seq & 0xFF;
+    b[5] = h.seq >> 8;
+    b[6] = h.captionLen & 0xFF;
+    b[7] = h.captionLen >> 8;
+    for (int i = 0; i < 4; i++) b[8 + i] = (uint8_t)(h.audioLen >> (8 * i));
+}
+
+void segmentParserInit(SegmentParser& p) {
+    memset(&p, 0, sizeof(p));
+}
+
+// Caption and audio both done: close the segment
+static void finishSegment(SegmentParser& p, SegmentEvents& ev) {
+    ev.segmentEnd(p.hdr);
+    p.segments++;
+    p.nextSeq++;
+    p.have = 0;
+    p.state = (p.hdr.flags & SEGMENT_LAST) ? SEG_DONE : SEG_HEADER;
+}
+
+static void captionDone(SegmentParser& p, SegmentEvents& ev) {
+    p.caption[p.have < SEGMENT_CAPTION_MAX ? p.have : SEGMENT_CAPTION_MAX] = '\0';
+    ev.segmentBegin(p.hdr, p.caption);
+    p.left = p.hdr.audioLen;
+    p.state = SEG_AUDIO;
+    if (!p.left) finishSegment(p, ev);
+}
+
+size_t segmentFeed(SegmentParser& p, const uint8_t* data, size_t len, SegmentEvents& ev) {
+    size_t used = 0;
+    while (used < len) {
+        size_t avail = len - used;
+        switch (p.state) {
+        case SEG_HEADER: {
+            size_t n = SEGMENT_HEADER_LEN - p.have;
+            if (n > avail) n = avail;
+            memcpy(p.raw + p.have, data + used, n);
+            p.have += n;
+            used += n;
+            if (p.have < SEGMENT_HEADER_LEN) break;
+            p.hdr.flags = p.raw[2];
+            p.hdr.codec = p.raw[3];
+            p.hdr.seq = le16(p.raw + 4);
+            p.hdr.captionLen = le16(p.raw + 6);
+            p.hdr.audioLen = le32(p.raw + 8);
+            if (le16(p.raw) != SEGMENT_MAGIC || p.hdr.seq != p.nextSeq) {
+                p.state = SEG_ERROR;
+                return used;
+            }
+            p.have = 0;
+            p.left = p.hdr.captionLen;
+            p.state = SEG_CAPTION;
+            if (!p.left) captionDone(p, ev);
+            break;
+        }
+        case SEG_CAPTION: {
+            size_t n = p.left < avail ? p.left : avail;
+            if (p.have < SEGMENT_CAPTION_MAX) {
+                size_t keep = SEGMENT_CAPTION_MAX - p.have;
+                memcpy(p.caption + p.have, data + used, n < keep ? n : keep);
+            }
+            p.have += n;
+            p.left -= n;
+            used += n;
+            if (!p.left) captionDone(p, ev);
+            break;
+        }
+        case SEG_AUDIO: {
+            size_t n = p.left < avail ? p.left : avail;
+            ev.segmentAudio(data + used, n);
+            p.left -= n;
+            used += n;
+            if (!p.left) finishSegment(p, ev);
+            break;
+        }
+        default:
+            return used;
+        }
+    }
+    return used;
+}
+
+void chunkedInit(ChunkedDecoder& d) {
+    memset(&d, 0, sizeof(d));
+}
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+size_t chunkedDecode(ChunkedDecoder& d, uint8_t* buf, size_t len) {
+    size_t in = 0, out = 0;
+    while (in < len && d.state != CHUNK_DONE && d.state != CHUNK_ERROR) {
+        uint8_t c = buf[in];
+        switch (d.state) {
+        case CHUNK_SIZE: {
+            int v = hexValue(c);
+            if (v >= 0 && d.digits < 7) {
+                d.left = d.left << 4 | v;
+                d.digits++;
+            } else if (d.digits && (c == ';' || c == ' ' || c == '\t')) {
+                d.state = CHUNK_EXT;
+            } else if (d.digits && c == '\r') {
+                d.state = CHUNK_SIZE_LF;
+            } else {
+                d.state = CHUNK_ERROR;
+            }
+            in++;
+            break;
+        }
+        case CHUNK_EXT:
+            if (c == '\r') d.state = CHUNK_SIZE_LF;
+            in++;
+            break;
+        case CHUNK_SIZE_LF:
+            if (c != '\n') {
+                d.state = CHUNK_ERROR;
+                break;
+            }
+            in++;
+            d.digits = 0;
+            if (d.left) {
+                d.state = CHUNK_DATA;
+            } else {
+                d.state = CHUNK_TRAILER;
+                d.lineEmpty = true;
+            }
+            break;
+        case CHUNK_DATA: {
+            size_t n = len - in < d.left ? len - in : d.left;
+            memmove(buf + out, buf + in, n);
+            out += n;
+            in += n;
+            d.left -= n;
+            if (!d.left) d.state = CHUNK_DATA_CR;
+            break;
+        }
+        case CHUNK_DATA_CR:
+            d.state = c == '\r' ? CHUNK_DATA_LF : CHUNK_ERROR;
+            in++;
+            break;
+        case CHUNK_DATA_LF:
+            d.state = c == '\n' ? CHUNK_SIZE : CHUNK_ERROR;
+            in++;
+            break;
+        case CHUNK_TRAILER:
+            // Trailer fields are ignored; a blank line ends the body
+            if (c == '\n') {
+                if (d.lineEmpty) d.state = CHUNK_DONE;
+                d.lineEmpty = true;
+            } else if (c != '\r') {
+                d.lineEmpty = false;
+            }
+            in++;
+            break;
+        default:
+            break;
+        }
+    }
+    return out;
+}
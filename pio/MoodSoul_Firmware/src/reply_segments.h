@@ -0,0 +1,107 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// SEGMENTED REPLY STREAM
+// ==========================================
+// /api/interact can answer one sentence at a time, so playback starts when
+// the first sentence is synthesized instead of after the whole reply. The
+// device asks for it with "Accept: application/x-moodsoul-segments"; the
+// body (usually Transfer-Encoding: chunked) is a run of frames:
+//
+//   offset  size  field (little-endian)
+//   0       2     magic 0x4753 ("SG")
+//   2       1     flags: SEGMENT_LAST on the final frame
+//   3       1     codec: SEGMENT_CODEC_*
+//   4       2     seq, 0, 1, 2... in order
+//   6       2     caption length (UTF-8 bytes)
+//   8       4     audio length
+//   12            caption, then audio
+//
+// The last frame may carry audio or be empty. Each segment's audio is
+// encoded on its own, as the server synthesizes it sentence by sentence:
+// whole MP3 frames, or ADPCM blocks ending in a short one. Players flush
+// their decoder at each segment end and keep the speaker going: no gap.
+//
+// Both decoders below are push parsers fed whatever the socket returned,
+// shared by the firmware, the mock server and the load generator.
+
+#define SEGMENT_CONTENT_TYPE "application/x-moodsoul-segments"
+#define SEGMENT_MAGIC        0x4753
+#define SEGMENT_HEADER_LEN   12
+#define SEGMENT_CAPTION_MAX  160   // longer captions are cut (audio isn't)
+#define SEGMENT_LAST         0x01
+#define SEGMENT_CODEC_MP3       0   // codecs: see reply_decoder.h
+#define SEGMENT_CODEC_PCM16     1
+#define SEGMENT_CODEC_IMA_ADPCM 2
+
+struct SegmentHeader {
+    uint8_t  flags;
+    uint8_t  codec;
+    uint16_t seq;
+    uint16_t captionLen;
+    uint32_t audioLen;
+};
+
+// Fills buf (SEGMENT_HEADER_LEN bytes) for a frame.
+void segmentWriteHeader(uint8_t* buf, const SegmentHeader& h);
+
+struct SegmentEvents {
+    // Caption is NUL-terminated, cut to SEGMENT_CAPTION_MAX
+    virtual void segmentBegin(const SegmentHeader& h, const char* caption) = 0;
+    virtual void segmentAudio(const uint8_t* data, size_t len) = 0;
+    virtual void segmentEnd(const SegmentHeader& h) = 0;
+    virtual ~SegmentEvents() {}
+};
+
+enum SegmentParserState : uint8_t {
+    SEG_HEADER = 0,
+    SEG_CAPTION,
+    SEG_AUDIO,
+    SEG_DONE,   // SEGMENT_LAST seen
+    SEG_ERROR,  // bad magic or out-of-order seq
+};
+
+struct SegmentParser {
+    SegmentParserState state;
+    SegmentHeader      hdr;
+    uint8_t            raw[SEGMENT_HEADER_LEN];
+    uint32_t           have;     // header or caption bytes so far
+    uint32_t           left;     // of the current caption or audio
+    uint16_t           nextSeq;
+    uint32_t           segments; // finished
+    char               caption[SEGMENT_CAPTION_MAX + 1];
+};
+
+void segmentParserInit(SegmentParser& p);
+// Consumes body bytes. Returns how many were used: all of them, or fewer
+// once the stream is done or broken (check p.state).
+size_t segmentFeed(SegmentParser& p, const uint8_t* data, size_t len, SegmentEvents& ev);
+
+// ==========================================
+// CHUNKED TRANSFER DECODING
+// ==========================================
+enum ChunkedState : uint8_t {
+    CHUNK_SIZE = 0,
+    CHUNK_EXT,       // ";name=value" after the size
+    CHUNK_SIZE_LF,
+    CHUNK_DATA,
+    CHUNK_DATA_CR,
+    CHUNK_DATA_LF,
+    CHUNK_TRAILER,   // after the 0-size chunk, up to the blank line
+    CHUNK_DONE,
+    CHUNK_ERROR,
+};
+
+struct ChunkedDecoder {
+    ChunkedState state;
+    uint32_t     left;     // of the current chunk
+    uint8_t      digits;
+    bool         lineEmpty; // trailer: nothing on this line yet
+};
+
+void chunkedInit(ChunkedDecoder& d);
+// Decodes in place: the payload bytes in buf[0..len) are moved to the
+// front and their count returned. Stops at CHUNK_DONE or CHUNK_ERROR.
+size_t chunkedDecode(ChunkedDecoder& d, uint8_t* buf, size_t len);
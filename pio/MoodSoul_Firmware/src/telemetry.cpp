@@ -0,0 +1,240 @@
+#include "telemetry.h"
+#include <string.h>
+
+static const char* const COUNTER_NAMES[TELE_COUNTER_COUNT] = {
+    "moodsoul_wifi_reconnects_total",
+    "moodsoul_wifi_roams_total",
+    "moodsoul_playback_underruns_total",
+    "moodsoul_connect_failures_total",
+    "moodsoul_send_failures_total",
+    "moodsoul_response_timeouts_total",
+    "moodsoul_prewarm_misses_total",
+    "moodsoul_barge_in_total",
+    "moodsoul_mic_stream_overruns_total",
+};
+
+const char* telemetryCounterName(TelemetryCounter c) {
+    return c < TELE_COUNTER_COUNT ? COUNTER_NAMES[c] : "?";
+}
+
+static void resetGauges(Telemetry& t) {
+    t.minHeap = t.heapLowWater = t.minPsram = UINT32_MAX;
+    t.rssiMin = 0;
+    t.rssiMax = -128;
+    t.rssiSum = 0;
+    t.rssiSamples = 0;
+}
+
+void telemetryInit(Telemetry& t, uint32_t nowMs) {
+    memset(&t, 0, sizeof(t));
+    t.startMs = nowMs;
+    resetGauges(t);
+}
+
+uint8_t telemetryBucket(uint32_t ms) {
+    if (ms == 0) return 0;
+    uint32_t e = 31 - __builtin_clz(ms);
+    // Upper half of the octave from 2^e * sqrt(2)
+    bool upper = (uint64_t)ms * ms >= (uint64_t)2 << (2 * e);
+    uint32_t b = 1 + 2 * e + (upper ? 1 : 0);
+    return b < TELEMETRY_HIST_BUCKETS ? (uint8_t)b : TELEMETRY_HIST_BUCKETS - 1;
+}
+
+static void record(TeleHist& h, const uint64_t* stamp, TraceStage from, TraceStage to, uint32_t ticksPerUs) {
+    if (!stamp[from] || !stamp[to] || stamp[to] < stamp[from]) return;
+    uint32_t ms = (uint32_t)((stamp[to] - stamp[from]) / ticksPerUs / 1000);
+    uint16_t& c = h.counts[telemetryBucket(ms)];
+    if (c < UINT16_MAX) c++;
+    if (ms > h.maxMs) h.maxMs = ms;
+}
+
+void telemetryTrace(Telemetry& t, const TraceRecord& rec, uint32_t ticksPerUs) {
+    const uint64_t* s = rec.stamp;
+    record(t.stages[TELE_CONNECT], s, TRACE_CONNECT, TRACE_TLS_DONE, ticksPerUs);
+    // Not from TLS_DONE: a prewarmed link is up while the user is still talking
+    record(t.stages[TELE_UPLOAD], s, TRACE_REQUEST_START, TRACE_LAST_BYTE_SENT, ticksPerUs);
+    record(t.stages[TELE_SERVER], s, TRACE_LAST_BYTE_SENT, TRACE_FIRST_RESPONSE_BYTE, ticksPerUs);
+    record(t.stages[TELE_DECODE], s, TRACE_FIRST_RESPONSE_BYTE, TRACE_FIRST_AUDIO, ticksPerUs);
+    record(t.stages[TELE_REPLY], s, TRACE_RECORD_END, TRACE_FIRST_AUDIO, ticksPerUs);
+    record(t.stages[TELE_PLAYBACK], s, TRACE_FIRST_AUDIO, TRACE_PLAYBACK_END, ticksPerUs);
+    if (t.turns < UINT16_MAX) t.turns++;
+    if (rec.httpStatus != 200 && t.failedTurns < UINT16_MAX) t.failedTurns++;
+}
+
+void telemetrySample(Telemetry& t, uint32_t freeHeap, uint32_t heapLowWater, uint32_t freePsram, int rssi) {
+    if (freeHeap < t.minHeap) t.minHeap = freeHeap;
+    if (heapLowWater < t.heapLowWater) t.heapLowWater = heapLowWater;
+    if (freePsram < t.minPsram) t.minPsram = freePsram;
+    if (rssi == 0 || t.rssiSamples == UINT16_MAX) return;
+    if (t.rssiSamples == 0 || rssi < t.rssiMin) t.rssiMin = (int8_t)rssi;
+    if (rssi > t.rssiMax) t.rssiMax = (int8_t)rssi;
+    t.rssiSum += rssi;
+    t.rssiSamples++;
+}
+
+void telemetryCounters(Telemetry& t, const uint32_t* values) {
+    memcpy(t.counters, values, sizeof(t.counters));
+}
+
+// ==========================================
+// CBOR
+// ==========================================
+struct CborOut {
+    uint8_t* buf;
+    size_t   cap, len;
+    bool     full;
+
+    void byte(uint8_t b) {
+        if (len < cap) buf[len++] = b;
+        else full = true;
+    }
+    // Major type + argument, shortest form
+    void head(uint8_t major, uint32_t v) {
+        major <<= 5;
+        if (v < 24) {
+            byte(major | v);
+        } else if (v <= 0xFF) {
+            byte(major | 24);
+            byte((uint8_t)v);
+        } else if (v <= 0xFFFF) {
+            byte(major | 25);
+            byte((uint8_t)(v >> 8));
+            byte((uint8_t)v);
+        } else {
+            byte(major | 26);
+            for (int i = 3; i >= 0; i--) byte((uint8_t)(v >> (8 * i)));
+        }
+    }
+    void uint(uint32_t v) { head(0, v); }
+    void sint(int32_t v) { v < 0 ? head(1, (uint32_t)(-1 - v)) : head(0, (uint32_t)v); }
+    void text(const char* s) {
+        size_t n = strlen(s);
+        head(3, (uint32_t)n);
+        for (size_t i = 0; i < n; i++) byte((uint8_t)s[i]);
+    }
+    void array(uint32_t n) { head(4, n); }
+    void mapOpen() { byte(0xBF); }
+    void mapClose() { byte(0xFF); }
+};
+
+// Optional sections go in whole or not at all. One opened after the
+// fixed part overflowed leaves that overflow reported.
+struct Section {
+    CborOut& out;
+    size_t   mark;
+    bool     wasFull;
+    explicit Section(CborOut& o) : out(o), mark(o.len), wasFull(o.full) {}
+    ~Section() {
+        if (out.full && !wasFull) {
+            out.len = mark;
+            out.full = false;
+        }
+    }
+};
+
+static const TelemetryStage STAGE_PRIORITY[TELE_STAGE_COUNT] = {
+    TELE_REPLY, TELE_PLAYBACK, TELE_SERVER, TELE_CONNECT, TELE_UPLOAD, TELE_DECODE,
+};
+
+size_t telemetryEncode(const Telemetry& t, uint32_t nowMs, const TelemetryInfo& info, uint8_t* buf, size_t cap,
+                       uint32_t* stagesSent) {
+    *stagesSent = 0;
+    if (cap > TELEMETRY_MAX_BYTES) cap = TELEMETRY_MAX_BYTES;
+    if (cap < 3) return 0;
+    CborOut out = { buf, cap - 2, 0, false }; // room for the two closing breaks
+    out.mapOpen();
+    out.uint(0);
+    out.uint(TELEMETRY_VERSION);
+    out.uint(1);
+    out.uint(t.seq);
+    out.uint(2);
+    out.uint((nowMs - t.startMs) / 1000);
+    out.uint(3);
+    out.uint(info.uptimeS);
+    {
+        Section s(out);
+        out.uint(4);
+        out.text(info.firmware ? info.firmware : "");
+    }
+    out.uint(5);
+    out.uint(info.resetReason);
+    out.uint(6);
+    out.uint(t.turns);
+    out.uint(7);
+    out.uint(t.failedTurns);
+    if (t.minHeap != UINT32_MAX) {
+        Section s(out);
+        out.uint(8);
+        out.array(3);
+        out.uint(t.minHeap);
+        out.uint(t.heapLowWater);
+        out.uint(t.minPsram);
+    }
+    if (t.rssiSamples) {
+        Section s(out);
+        out.uint(9);
+        out.array(3);
+        out.sint(t.rssiMin);
+        out.sint(t.rssiSum / t.rssiSamples);
+        out.sint(t.rssiMax);
+    }
+    {
+        Section s(out);
+        out.uint(10);
+        out.mapOpen();
+        for (int c = 0; c < TELE_COUNTER_COUNT; c++) {
+            uint32_t delta = t.counters[c] - t.counterBase[c];
+            if (!delta) continue;
+            out.uint(c);
+            out.uint(delta);
+        }
+        out.mapClose();
+    }
+    // Stages one by one, most wanted first: as many as fit
+    out.uint(11);
+    out.mapOpen();
+    uint32_t sent = 0;
+    for (int i = 0; i < TELE_STAGE_COUNT; i++) {
+        int st = STAGE_PRIORITY[i];
+        const TeleHist& h = t.stages[st];
+        int first = 0, last = TELEMETRY_HIST_BUCKETS - 1;
+        while (first <= last && !h.counts[first]) first++;
+        while (last >= first && !h.counts[last]) last--;
+        if (first > last) {
+            sent |= 1u << st; // nothing to keep
+            continue;
+        }
+        Section s(out);
+        out.uint(st);
+        out.array(2 + last - first + 1);
+        out.uint(h.maxMs);
+        out.uint(first);
+        for (int b = first; b <= last; b++) out.uint(h.counts[b]);
+        if (!out.full) sent |= 1u << st;
+    }
+    out.cap++;
+    out.mapClose();
+    out.cap++;
+    out.mapClose();
+    if (out.full) return 0; // even the fixed part didn't fit
+    *stagesSent = sent;
+    return out.len;
+}
+
+void telemetryCommit(Telemetry& t, const Telemetry& sent, uint32_t stagesSent, uint32_t nowMs) {
+    for (int st = 0; st < TELE_STAGE_COUNT; st++) {
+        if (!(stagesSent & (1u << st))) continue; // still in t for next time
+        bool any = false;
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+            t.stages[st].counts[b] -= sent.stages[st].counts[b];
+            any |= t.stages[st].counts[b] != 0;
+        }
+        if (!any) t.stages[st].maxMs = 0;
+    }
+    t.turns -= sent.turns;
+    t.failedTurns -= sent.failedTurns;
+    memcpy(t.counterBase, sent.counters, sizeof(t.counterBase));
+    resetGauges(t);
+    t.startMs = nowMs;
+    t.seq = sent.seq + 1;
+}
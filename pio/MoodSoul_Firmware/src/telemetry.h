@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "trace.h"
+
+// ==========================================
+// FLEET TELEMETRY
+// ==========================================
+// What /metrics shows one device at a time, rolled up for the whole fleet:
+// per-stage turn latencies, counter deltas, the lowest free heap and the
+// RSSI spread since the last heartbeat, sent as one small CBOR map on
+// /api/ping (heartbeat.h). Everything is fixed-size, so a device that
+// can't reach the server for a day sends one longer interval, not a
+// backlog.
+//
+// Latencies go into half-octave ms buckets: 0 is < 1 ms, odd 2k+1 starts
+// at 2^k ms, even 2k+2 at 2^k * 1.41 ms; the last one is open-ended
+// (>= 8192 ms).
+//
+// Blob (CBOR, indefinite-length maps with small integer keys so sections
+// can be dropped to fit TELEMETRY_MAX_BYTES, lowest priority last):
+//   0 version          1 seq            2 interval s      3 uptime s
+//   4 firmware         5 reset reason   6 turns           7 failed turns
+//   8 heap [min free internal, boot low-water, min free PSRAM] bytes
+//   9 rssi [min, mean, max] dBm
+//   10 counters {TelemetryCounter: delta}, non-zero only
+//   11 stages {TelemetryStage: [max ms, first bucket, counts...]}
+//
+// Stages go in by priority, what the user waits on first: REPLY,
+// PLAYBACK, SERVER, CONNECT, UPLOAD, DECODE. Six widely spread histograms
+// don't all fit; those left out stay recorded for the next heartbeat.
+
+#define TELEMETRY_VERSION      1
+#define TELEMETRY_HIST_BUCKETS 28
+#define TELEMETRY_MAX_BYTES    512
+
+enum TelemetryStage : uint8_t {
+    TELE_CONNECT = 0,  // TCP + TLS
+    TELE_UPLOAD,       // first to last request byte of the turn
+    TELE_SERVER,       // last request byte to first response byte
+    TELE_DECODE,       // first response byte to first audio
+    TELE_REPLY,        // end of recording to first audio: what the user waits
+    TELE_PLAYBACK,     // first audio to end of playback
+    TELE_STAGE_COUNT
+};
+
+// Registry counters (metrics.h) sent as deltas
+enum TelemetryCounter : uint8_t {
+    TELE_WIFI_RECONNECTS = 0,
+    TELE_WIFI_ROAMS,
+    TELE_UNDERRUNS,
+    TELE_CONNECT_FAILURES,
+    TELE_SEND_FAILURES,
+    TELE_TIMEOUTS,
+    TELE_PREWARM_MISSES,
+    TELE_BARGE_INS,
+    TELE_MIC_OVERRUNS,
+    TELE_COUNTER_COUNT
+};
+
+struct TeleHist {
+    uint16_t counts[TELEMETRY_HIST_BUCKETS];
+    uint32_t maxMs;
+};
+
+struct Telemetry {
+    uint32_t startMs;   // interval start
+    uint32_t seq;       // heartbeats delivered
+    TeleHist stages[TELE_STAGE_COUNT];
+    uint16_t turns, failedTurns;
+    uint32_t counterBase[TELE_COUNTER_COUNT]; // cumulative values at interval start
+    uint32_t counters[TELE_COUNTER_COUNT];    // latest cumulative values
+    uint32_t minHeap, heapLowWater, minPsram;
+    int8_t   rssiMin, rssiMax;
+    int32_t  rssiSum;
+    uint16_t rssiSamples;
+};
+
+struct TelemetryInfo {
+    const char* firmware;
+    uint32_t    uptimeS;
+    uint8_t     resetReason;
+};
+
+void telemetryInit(Telemetry& t, uint32_t nowMs);
+// A finished turn (trace.h), stamps in trace ticks.
+void telemetryTrace(Telemetry& t, const TraceRecord& rec, uint32_t ticksPerUs);
+// Once a second or so. rssi 0 = not connected (ignored).
+void telemetrySample(Telemetry& t, uint32_t freeHeap, uint32_t heapLowWater, uint32_t freePsram, int rssi);
+// Current cumulative values, indexed by TelemetryCounter (0 for one that
+// isn't in this build).
+void telemetryCounters(Telemetry& t, const uint32_t* values);
+const char* telemetryCounterName(TelemetryCounter c);
+// Writes the blob, at most `cap` bytes (<= TELEMETRY_MAX_BYTES).
+// *stagesSent gets a bit per TelemetryStage that went in.
+size_t telemetryEncode(const Telemetry& t, uint32_t nowMs, const TelemetryInfo& info, uint8_t* out, size_t cap,
+                       uint32_t* stagesSent);
+// `sent` (a copy taken when encoding) was delivered: start the next
+// interval, keeping whatever was recorded since the copy and the stages
+// that didn't fit.
+void telemetryCommit(Telemetry& t, const Telemetry& sent, uint32_t stagesSent, uint32_t nowMs);
+uint8_t telemetryBucket(uint32_t ms);
@@ -0,0 +1,157 @@
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <esp_timer.h>
+#else
+#include <chrono>
+#include <random>
+#endif
+
+static TraceRecord ring[TRACE_RING_SIZE];
+static uint32_t    ringCount = 0; // total traces ever pushed
+static TraceRecord current;
+static bool        currentOpen = false;
+static void      (*endHook)(const TraceRecord&) = nullptr;
+
+static const char* STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "touch_down", "touch_release", "record_end", "camera_frame", "connect", "tls_done",
+    "request_start", "last_byte_sent", "first_response_byte", "first_audio", "playback_end"
+};
+
+// ==========================================
+// CLOCK
+// ==========================================
+#if defined(ARDUINO)
+// esp_timer, not CCOUNT: the cycle counter is per core and runs at the CPU
+// clock, which presence drops to 80 MHz when idle (and marks come from
+// both cores).
+uint64_t traceNow() {
+    return (uint64_t)esp_timer_get_time();
+}
+
+uint32_t traceTicksPerUs() {
+    return 1;
+}
+
+static uint32_t randomWord() {
+    return esp_random();
+}
+#else
+uint64_t traceNow() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t traceTicksPerUs() {
+    return 1000;
+}
+
+static uint32_t randomWord() {
+    static std::mt19937 rng(std::random_device{}());
+    return rng();
+}
+#endif
+
+// ==========================================
+// RECORDING
+// ==========================================
+const char* traceBegin(const char* trigger) {
+    memset(&current, 0, sizeof(current));
+    snprintf(current.id, sizeof(current.id), "%08lx%08lx",
+             (unsigned long)randomWord(), (unsigned long)randomWord());
+    strncpy(current.trigger, (trigger && trigger[0]) ? trigger : "TOUCH",
+            sizeof(current.trigger) - 1);
+    currentOpen = true;
+    return current.id;
+}
+
+void traceMark(TraceStage stage) {
+    traceMarkAt(stage, traceNow());
+}
+
+void traceMarkAt(TraceStage stage, uint64_t ticks) {
+    if (!currentOpen || stage >= TRACE_STAGE_COUNT) return;
+    current.stamp[stage] = ticks;
+}
+
+void traceSetHttpStatus(int status) {
+    if (currentOpen) current.httpStatus = status;
+}
+
+void traceSetServerTiming(uint32_t geminiMs, uint32_t ttsMs) {
+    if (!currentOpen) return;
+    current.serverGeminiMs = geminiMs;
+    current.serverTtsMs = ttsMs;
+}
+
+void traceSetPrewarmSaved(uint32_t ms) {
+    if (currentOpen) current.prewarmSavedMs = ms;
+}
+
+void traceEnd() {
+    if (!currentOpen) return;
+    ring[ringCount % TRACE_RING_SIZE] = current;
+    ringCount++;
+    currentOpen = false;
+    if (endHook) endHook(current);
+}
+
+void traceSetEndHook(void (*hook)(const TraceRecord& rec)) {
+    endHook = hook;
+}
+
+void traceCancel() {
+    currentOpen = false;
+}
+
+const char* traceCurrentId() {
+    return currentOpen ? current.id : "";
+}
+
+bool traceActive() {
+    return currentOpen;
+}
+
+const char* traceStageName(TraceStage stage) {
+    return stage < TRACE_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+// ==========================================
+// DUMP
+// ==========================================
+// Format (one line per turn, times in ms relative to the first stamp):
+// trace id=.. trigger=.. status=.. touch_down=0.000 ... gemini_ms=.. tts_ms=.. prewarm_saved_ms=..
+void traceDump(void (*out)(const char* line)) {
+    char line[512];
+    uint32_t n = ringCount < TRACE_RING_SIZE ? ringCount : TRACE_RING_SIZE;
+    uint32_t ticksPerUs = traceTicksPerUs();
+
+    for (uint32_t i = ringCount - n; i < ringCount; i++) {
+        const TraceRecord& r = ring[i % TRACE_RING_SIZE];
+
+        uint64_t origin = 0;
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            if (r.stamp[s] && (!origin || r.stamp[s] < origin)) origin = r.stamp[s];
+        }
+
+        int len = snprintf(line, sizeof(line), "trace id=%s trigger=%s status=%d",
+                           r.id, r.trigger, r.httpStatus);
+        for (int s = 0; s < TRACE_STAGE_COUNT && len < (int)sizeof(line); s++) {
+            if (r.stamp[s]) {
+                double ms = (double)(r.stamp[s] - origin) / ticksPerUs / 1000.0;
+                len += snprintf(line + len, sizeof(line) - len, " %s=%.3f", STAGE_NAMES[s], ms);
+            } else {
+                len += snprintf(line + len, sizeof(line) - len, " %s=-", STAGE_NAMES[s]);
+            }
+        }
+        if (len < (int)sizeof(line)) {
+            snprintf(line + len, sizeof(line) - len, " gemini_ms=%lu tts_ms=%lu prewarm_saved_ms=%lu",
+                     (unsigned long)r.serverGeminiMs, (unsigned long)r.serverTtsMs,
+                     (unsigned long)r.prewarmSavedMs);
+        }
+        out(line);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// INTERACTION TRACING
+// ==========================================
+// One trace per turn. Each stage is stamped with a 64-bit tick count
+// (microseconds on the device, whatever the CPU clock) so sub-ms gaps
+// (connect vs TLS, last byte vs first byte) are visible.
+// Finished traces go into a small RAM ring that can be dumped over serial.
+
+enum TraceStage : uint8_t {
+    TRACE_TOUCH_DOWN = 0,
+    TRACE_TOUCH_RELEASE,
+    TRACE_RECORD_END,
+    TRACE_CAMERA_FRAME,
+    TRACE_CONNECT,
+    TRACE_TLS_DONE,
+    TRACE_REQUEST_START,     // first byte of this turn's upload
+    TRACE_LAST_BYTE_SENT,
+    TRACE_FIRST_RESPONSE_BYTE,
+    TRACE_FIRST_AUDIO,
+    TRACE_PLAYBACK_END,
+    TRACE_STAGE_COUNT
+};
+
+#define TRACE_ID_LEN      16  // hex chars, sent as X-Trace-Id
+#define TRACE_RING_SIZE   16  // finished turns kept for dumping
+
+struct TraceRecord {
+    char     id[TRACE_ID_LEN + 1];
+    char     trigger[16];
+    uint64_t stamp[TRACE_STAGE_COUNT]; // 0 = stage not reached
+    int      httpStatus;
+    uint32_t serverGeminiMs;           // from Server-Timing, 0 if absent
+    uint32_t serverTtsMs;
+    uint32_t prewarmSavedMs;           // connect+TLS+headers hidden behind the touch
+};
+
+// Starts a new trace (discarding an unfinished one) and returns its id.
+const char* traceBegin(const char* trigger);
+// Stamps a stage of the current trace. No-op when no trace is open.
+void traceMark(TraceStage stage);
+// Same with a traceNow() taken earlier, e.g. by a task on the other core:
+// loop() applies it, so only loop() ever writes the open trace.
+void traceMarkAt(TraceStage stage, uint64_t ticks);
+void traceSetHttpStatus(int status);
+void traceSetServerTiming(uint32_t geminiMs, uint32_t ttsMs);
+void traceSetPrewarmSaved(uint32_t ms);
+// Closes the current trace and pushes it into the ring.
+void traceEnd();
+// Called with every trace traceEnd() records (heartbeat.h rolls them up).
+void traceSetEndHook(void (*hook)(const TraceRecord& rec));
+// Drops the current trace without recording it (e.g. a tap that was not a turn).
+void traceCancel();
+
+const char* traceCurrentId();
+bool traceActive();
+
+// Current time in trace ticks, and the tick rate.
+uint64_t traceNow();
+uint32_t traceTicksPerUs();
+
+// Writes one line per finished trace, oldest first, through `out`.
+void traceDump(void (*out)(const char* line));
+
+const char* traceStageName(TraceStage stage);
@@ -0,0 +1,70 @@
+#include "turn_quota.h"
+
+#define DAY_S 86400
+
+static void refill(TurnQuota& q, uint32_t nowMs) {
+    uint32_t cap = QUOTA_BURST * QUOTA_INTERVAL_MS;
+    uint32_t add = nowMs - q.refillAtMs;
+    q.creditMs = add >= cap - q.creditMs ? cap : q.creditMs + add;
+    q.refillAtMs = nowMs;
+    if (q.retryArmed && (int32_t)(nowMs - q.retryAtMs) >= 0) q.retryArmed = false;
+}
+
+void quotaInit(TurnQuota& q, uint32_t nowMs, int32_t remaining, uint32_t resetAtS) {
+    q.creditMs = QUOTA_BURST * QUOTA_INTERVAL_MS;
+    q.refillAtMs = nowMs;
+    q.retryAtMs = 0;
+    q.retryArmed = false;
+    q.remaining = remaining;
+    q.resetAtS = resetAtS;
+}
+
+QuotaVerdict quotaCheck(TurnQuota& q, uint32_t nowMs, uint32_t nowS) {
+    refill(q, nowMs);
+    if (q.resetAtS && nowS >= q.resetAtS) {
+        q.remaining = QUOTA_DAILY;
+        q.resetAtS += ((nowS - q.resetAtS) / DAY_S + 1) * DAY_S;
+    }
+    // Out of turns: the server would only play its "tired" reply, to
+    // uncounted turns too. Without a clock the reset can't be placed, so
+    // stay out until the clock is set.
+    if (q.remaining == 0 && q.resetAtS && (!nowS || nowS < q.resetAtS)) return QUOTA_EXHAUSTED;
+    if (q.retryArmed || q.creditMs < QUOTA_INTERVAL_MS) return QUOTA_THROTTLED;
+    return QUOTA_OK;
+}
+
+uint32_t quotaWaitMs(TurnQuota& q, uint32_t nowMs) {
+    refill(q, nowMs);
+    uint32_t wait = q.creditMs < QUOTA_INTERVAL_MS ? QUOTA_INTERVAL_MS - q.creditMs : 0;
+    if (q.retryArmed && q.retryAtMs - nowMs > wait) wait = q.retryAtMs - nowMs;
+    return wait;
+}
+
+void quotaSpend(TurnQuota& q, uint32_t nowMs, bool counted) {
+    refill(q, nowMs);
+    q.creditMs = q.creditMs > QUOTA_INTERVAL_MS ? q.creditMs - QUOTA_INTERVAL_MS : 0;
+    if (counted && q.remaining > 0) q.remaining--;
+}
+
+bool quotaSync(TurnQuota& q, uint32_t nowMs, uint32_t nowS, int status, int32_t remaining,
+               uint32_t resetInS, int32_t retryAfterS, bool counted) {
+    int32_t oldRemaining = q.remaining;
+    uint32_t oldResetAt = q.resetAtS;
+    refill(q, nowMs);
+    if (status == 429) {
+        // Refused before it was counted: the throttle restarts from now
+        uint32_t waitMs = retryAfterS >= 0 ? (uint32_t)retryAfterS * 1000 : QUOTA_INTERVAL_MS;
+        q.retryAtMs = nowMs + waitMs;
+        q.retryArmed = waitMs > 0;
+        q.creditMs = 0;
+        if (remaining < 0 && counted && q.remaining >= 0 && q.remaining < QUOTA_DAILY) q.remaining++;
+    }
+    if (remaining >= 0) q.remaining = remaining > QUOTA_DAILY ? QUOTA_DAILY : remaining;
+    // Minute granularity: the countdown in every reply shouldn't mean a
+    // flash write every turn
+    if (resetInS && nowS) {
+        uint32_t at = nowS + resetInS;
+        if (!q.resetAtS || at + 60 < q.resetAtS || at > q.resetAtS + 60) q.resetAtS = at;
+    }
+    return q.remaining != oldRemaining || q.resetAtS != oldResetAt;
+}
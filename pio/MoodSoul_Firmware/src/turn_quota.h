@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// TURN QUOTA MIRROR
+// ==========================================
+// The device-side copy of /api/interact's limits, so a turn the server
+// would refuse never uploads its photo and audio:
+//   - throttle: one turn per QUOTA_INTERVAL_MS, kept as a token bucket,
+//     plus any Retry-After the server sent with a 429
+//   - daily quota: QUOTA_DAILY counted turns, resetting at a known Unix
+//     time; persisted (main.cpp keeps remaining/resetAtS in NVS)
+// Every reply re-syncs both from its headers (X-Quota-Remaining,
+// X-Quota-Reset-In, Retry-After), so the mirror can't drift for long.
+// Uncounted turns (AUTO_OBSERVE) take a throttle token but never touch
+// the daily count.
+
+#define QUOTA_DAILY       50
+#define QUOTA_INTERVAL_MS 5000 // server throttle, one turn per 5 s
+#define QUOTA_BURST       1    // bucket depth in turns, the server allows no burst
+
+enum QuotaVerdict : uint8_t {
+    QUOTA_OK = 0,
+    QUOTA_THROTTLED, // try again in quotaWaitMs()
+    QUOTA_EXHAUSTED, // out of turns until resetAtS
+};
+
+struct TurnQuota {
+    uint32_t creditMs;   // bucket level; a turn costs QUOTA_INTERVAL_MS
+    uint32_t refillAtMs; // millis() the bucket was last topped up
+    uint32_t retryAtMs;  // server Retry-After deadline, millis()
+    bool     retryArmed;
+    int32_t  remaining;  // counted turns left today, -1 unknown
+    uint32_t resetAtS;   // Unix time of the next daily reset, 0 unknown
+};
+
+// Full bucket; remaining/resetAtS come from NVS (-1/0 if never synced).
+void quotaInit(TurnQuota& q, uint32_t nowMs, int32_t remaining, uint32_t resetAtS);
+// nowS is Unix time, 0 while the clock isn't set. Rolls the daily count
+// over once resetAtS has passed.
+QuotaVerdict quotaCheck(TurnQuota& q, uint32_t nowMs, uint32_t nowS);
+// How long a throttled turn has to wait.
+uint32_t quotaWaitMs(TurnQuota& q, uint32_t nowMs);
+// The turn went out (last request byte sent, when the server stamps it).
+void quotaSpend(TurnQuota& q, uint32_t nowMs, bool counted);
+// From a reply head; remaining/retryAfterS are -1 when the header was
+// absent. nowS is the clock, or the reply's Date while the clock isn't
+// set. True if remaining or resetAtS changed (time to persist).
+bool quotaSync(TurnQuota& q, uint32_t nowMs, uint32_t nowS, int status, int32_t remaining,
+               uint32_t resetInS, int32_t retryAfterS, bool counted);
@@ -0,0 +1,82 @@
+#include "view_convert.h"
+#include <string.h>
+
+// Drops each channel's low bit so a shifted sum can't carry into the next
+#define AVG_MASK16 0xF7DEu
+#define AVG_MASK32 0xF7DEF7DEu
+
+static inline uint32_t swap2(uint32_t w) {
+    return ((w & 0x00FF00FFu) << 8) | ((w >> 8) & 0x00FF00FFu);
+}
+
+static inline uint16_t swap1(uint16_t p) {
+    return (uint16_t)((p << 8) | (p >> 8));
+}
+
+// Per-channel floor((a + b) / 2) for both pixels of a word
+static inline uint32_t avg2(uint32_t a, uint32_t b) {
+    return (a & b) + (((a ^ b) & AVG_MASK32) >> 1);
+}
+
+static inline uint16_t avg1(uint16_t a, uint16_t b) {
+    return (uint16_t)((a & b) + (((a ^ b) & AVG_MASK16) >> 1));
+}
+
+int viewShrink(int srcW, int srcH, int dstW, int dstH) {
+    return srcW >= 2 * dstW && srcH >= 2 * dstH ? 2 : 1;
+}
+
+void viewCopy565(const uint16_t* src, uint16_t* dst, size_t n, bool swap) {
+    if (!swap) {
+        memcpy(dst, src, n * 2);
+        return;
+    }
+    const uint32_t* s = (const uint32_t*)src;
+    uint32_t* d = (uint32_t*)dst;
+    size_t words = n / 2;
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        uint32_t a = s[i], b = s[i + 1], c = s[i + 2], e = s[i + 3];
+        d[i] = swap2(a);
+        d[i + 1] = swap2(b);
+        d[i + 2] = swap2(c);
+        d[i + 3] = swap2(e);
+    }
+    for (; i < words; i++) d[i] = swap2(s[i]);
+    if (n & 1) dst[n - 1] = swap1(src[n - 1]);
+}
+
+void viewHalve565(const uint16_t* row0, const uint16_t* row1, uint16_t* dst, size_t n, bool srcBigEndian) {
+    const uint32_t* r0 = (const uint32_t*)row0;
+    const uint32_t* r1 = (const uint32_t*)row1;
+    uint32_t* d = (uint32_t*)dst;
+    // Four source columns (two words per row) make two output pixels
+    size_t pairs = n / 2;
+    for (size_t i = 0; i < pairs; i++) {
+        uint32_t a0 = r0[2 * i], a1 = r0[2 * i + 1];
+        uint32_t b0 = r1[2 * i], b1 = r1[2 * i + 1];
+        if (srcBigEndian) {
+            a0 = swap2(a0);
+            a1 = swap2(a1);
+            b0 = swap2(b0);
+            b1 = swap2(b1);
+        }
+        uint32_t v0 = avg2(a0, b0); // [col0, col1] averaged vertically
+        uint32_t v1 = avg2(a1, b1); // [col2, col3]
+        // Then horizontally: (col0, col1) and (col2, col3)
+        uint32_t even = (v0 & 0xFFFFu) | (v1 << 16);
+        uint32_t odd = (v0 >> 16) | (v1 & 0xFFFF0000u);
+        d[i] = swap2(avg2(even, odd));
+    }
+    if (n & 1) {
+        size_t c = 2 * (n - 1);
+        uint16_t a0 = row0[c], a1 = row0[c + 1], b0 = row1[c], b1 = row1[c + 1];
+        if (srcBigEndian) {
+            a0 = swap1(a0);
+            a1 = swap1(a1);
+            b0 = swap1(b0);
+            b1 = swap1(b1);
+        }
+        dst[n - 1] = swap1(avg1(avg1(a0, b0), avg1(a1, b1)));
+    }
+}
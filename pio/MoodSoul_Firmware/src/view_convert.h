@@ -0,0 +1,26 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// VIEWFINDER PIXEL KERNELS
+// ==========================================
+// Camera rows to screen rows, RGB565 in the LCD's byte order (big-endian,
+// what the sensor sends too) so a converted strip goes out by DMA as is.
+// esp-dsp has nothing for pixels, so these are SWAR: two pixels per 32-bit
+// word, byte swaps and channel averages done on both at once with masks.
+// Plain C, the same on the host (env:native-bench) and the S3.
+//
+// Rows should be 4-byte aligned; an odd last pixel is done on its own.
+
+// Downscale factor (1 or 2) for a src frame on a dst screen: 2 only when
+// the halved frame still covers the screen.
+int viewShrink(int srcW, int srcH, int dstW, int dstH);
+
+// n pixels, swapping the bytes of each when `swap` (little-endian source).
+void viewCopy565(const uint16_t* src, uint16_t* dst, size_t n, bool swap);
+
+// One output row from two source rows: each dst pixel is the 2x2 box
+// average (per channel, rounded down). src rows hold 2 * n pixels;
+// `srcBigEndian` is the source order, dst is always big-endian.
+void viewHalve565(const uint16_t* row0, const uint16_t* row1, uint16_t* dst, size_t n, bool srcBigEndian);
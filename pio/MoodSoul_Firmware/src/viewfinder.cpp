@@ -0,0 +1,163 @@
+#include "viewfinder.h"
+#include "camera_power.h"
+#include "metrics.h"
+#include "view_convert.h"
+#include <M5Unified.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#define SCREEN_W         320
+#define SCREEN_H         240
+#define FRAME_MS         (1000 / VIEW_FPS)
+#define CAPTURE_WAIT_MS  200   // a streaming sensor has one well within this
+#define STRIP_PIXELS     (SCREEN_W * VIEW_STRIP_ROWS)
+
+static bool      enabled = false;  // console
+static bool      feature = false;  // dashboard
+static uint16_t* strips[2] = { nullptr, nullptr };
+static uint32_t  dueMs = 0, lastMs = 0;
+static uint32_t  windowMs = 0, windowFrames = 0;
+static ViewStats stats = {};
+
+static Counter   metricFrames("moodsoul_view_frames_total", "Viewfinder frames drawn");
+static Counter   metricLate("moodsoul_view_late_total", "Viewfinder frames that missed their slot");
+static Gauge     metricFps("moodsoul_view_fps", "Viewfinder frames drawn over the last second");
+static Histogram metricFrameUs("moodsoul_view_frame_us", "Viewfinder capture, convert and push per frame, us");
+
+void viewfinderBegin() {
+    Preferences p;
+    p.begin("moodsoul", true);
+    enabled = p.getBool("view_on", false);
+    p.end();
+}
+
+void viewfinderSetEnabled(bool on) {
+    enabled = on;
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("view_on", on);
+    p.end();
+}
+
+void viewfinderSetFeature(bool on) {
+    feature = on;
+}
+
+bool viewfinderOn() {
+    return enabled || feature;
+}
+
+// Internal RAM: the SPI DMA reads it without going through the PSRAM cache
+static bool allocStrips() {
+    for (int i = 0; i < 2; i++) {
+        if (!strips[i]) strips[i] = (uint16_t*)heap_caps_malloc(STRIP_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!strips[i]) return false;
+    }
+    return true;
+}
+
+// The frame centered, cropped to the screen. Output columns start even so
+// source rows stay word aligned for the kernels.
+static void drawRaw(const camera_fb_t* fb, int k) {
+    int w = fb->width / k, h = fb->height / k;
+    int dw = (w < SCREEN_W ? w : SCREEN_W) & ~1;
+    int dh = h < SCREEN_H ? h : SCREEN_H;
+    int sx = ((w - dw) / 2) & ~1, sy = (h - dh) / 2;
+    int x = (SCREEN_W - dw) / 2, y = (SCREEN_H - dh) / 2;
+    const uint16_t* px = (const uint16_t*)fb->buf;
+
+    M5.Lcd.startWrite();
+    for (int row = 0, b = 0; row < dh; row += VIEW_STRIP_ROWS, b ^= 1) {
+        int rows = dh - row < VIEW_STRIP_ROWS ? dh - row : VIEW_STRIP_ROWS;
+        uint16_t* out = strips[b];
+        for (int r = 0; r < rows; r++) {
+            const uint16_t* src = px + (size_t)(sy + row + r) * k * fb->width + sx * k;
+            // Sensor order is big-endian, which is the LCD's
+            if (k == 2) viewHalve565(src, src + fb->width, out + r * dw, dw, true);
+            else viewCopy565(src, out + r * dw, dw, false);
+        }
+        M5.Lcd.waitDMA(); // the other strip is done with
+        M5.Lcd.pushImageDMA(x, y + row, dw, rows, (const lgfx::swap565_t*)out);
+    }
+    M5.Lcd.waitDMA();
+    M5.Lcd.endWrite();
+}
+
+// Scaled by the decoder as it goes, centered, and cropped through its
+// offsets: no full-size RGB copy of the frame.
+static void drawJpeg(const camera_fb_t* fb, int k) {
+    int w = fb->width / k, h = fb->height / k;
+    int x = w < SCREEN_W ? (SCREEN_W - w) / 2 : 0, y = h < SCREEN_H ? (SCREEN_H - h) / 2 : 0;
+    int ox = w > SCREEN_W ? (w - SCREEN_W) / 2 : 0, oy = h > SCREEN_H ? (h - SCREEN_H) / 2 : 0;
+    M5.Lcd.drawJpg(fb->buf, fb->len, x, y, SCREEN_W - x, SCREEN_H - y, ox, oy, 1.0f / k);
+}
+
+void viewfinderShow(const camera_fb_t* fb) {
+    int k = viewShrink(fb->width, fb->height, SCREEN_W, SCREEN_H);
+    stats.shrink = k;
+    stats.jpeg = fb->format == PIXFORMAT_JPEG;
+    if (fb->format == PIXFORMAT_JPEG) {
+        drawJpeg(fb, k);
+    } else if (fb->format == PIXFORMAT_RGB565) {
+        if (allocStrips()) {
+            drawRaw(fb, k);
+        } else {
+            // No DMA memory: one blocking push of the top-left corner
+            M5.Lcd.pushImage(0, 0, fb->width < SCREEN_W ? fb->width : SCREEN_W,
+                             fb->height < SCREEN_H ? fb->height : SCREEN_H, (const lgfx::swap565_t*)fb->buf);
+        }
+    }
+}
+
+camera_fb_t* viewfinderSnapshot() {
+    camera_fb_t* fb = cameraCapture(CAPTURE_WAIT_MS);
+    if (fb) viewfinderShow(fb);
+    return fb;
+}
+
+bool viewfinderPoll(uint32_t nowMs) {
+    stats.on = viewfinderOn();
+    // Back after a turn or a pause: a new schedule, not a late frame
+    bool resumed = stats.frames == 0 || nowMs - lastMs > 1000;
+    if (resumed) {
+        dueMs = nowMs;
+        windowMs = nowMs;
+        windowFrames = 0;
+    }
+    if (!stats.on || (int32_t)(nowMs - dueMs) < 0) return false;
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t* fb = cameraCapture(CAPTURE_WAIT_MS);
+    if (!fb) return false;
+    viewfinderShow(fb);
+    cameraRelease(fb);
+    stats.lastFrameUs = (uint32_t)(esp_timer_get_time() - t0);
+    metricFrameUs.record(stats.lastFrameUs);
+    stats.frames++;
+    metricFrames.inc();
+
+    // Fixed slots, so the rate holds even when frames take uneven time.
+    // Judged once the frame is out: one that overran its slot is late,
+    // and the next goes straight away.
+    uint32_t doneMs = millis();
+    dueMs += FRAME_MS;
+    if ((int32_t)(doneMs - dueMs) >= 0) {
+        stats.late++;
+        metricLate.inc();
+        dueMs = doneMs;
+    }
+    lastMs = doneMs;
+    windowFrames++;
+    if (doneMs - windowMs >= 1000) {
+        stats.fps10 = windowFrames * 10000 / (doneMs - windowMs);
+        metricFps.set(stats.fps10 / 10);
+        windowMs = doneMs;
+        windowFrames = 0;
+    }
+    return true;
+}
+
+ViewStats viewfinderStats() {
+    stats.on = viewfinderOn();
+    return stats;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <esp_camera.h>
+#include <stdint.h>
+
+// ==========================================
+// VIEWFINDER
+// ==========================================
+// Live camera preview between turns, so the cube can be aimed at a pet or
+// a palm before the press. Frames come from cameraCapture(), the same as a
+// turn's. The press captures one more, shows it and keeps it: that frame
+// is the turn's snapshot, with no mode switch and no capture at send time.
+//
+// Raw RGB565 frames are cropped (or halved, for sensors bigger than twice
+// the screen) by the view_convert.h kernels into two internal-RAM strips
+// pushed by DMA in turn: one strip is converted while the other goes out.
+// JPEG frames go to the display's decoder with a power-of-two scale, which
+// it applies while decoding. Frames are paced at VIEW_FPS; a frame that
+// can't keep up is counted late and the schedule restarts from it.
+//
+// On from the serial console (kept in NVS) or while the dashboard app is
+// VIEW_FEATURE.
+
+#define VIEW_FEATURE    "FORTUNE" // souls.current_feature
+#define VIEW_FPS        15
+#define VIEW_STRIP_ROWS 16
+
+struct ViewStats {
+    bool     on;
+    uint32_t frames;
+    uint32_t late;        // frames that missed their slot
+    uint32_t fps10;       // over the last second, x10
+    uint32_t lastFrameUs; // capture, convert and push
+    uint8_t  shrink;      // 1 or 2, last frame
+    bool     jpeg;        // last frame's format
+};
+
+// Loads the console setting.
+void viewfinderBegin();
+// Serial console; kept in NVS.
+void viewfinderSetEnabled(bool on);
+// Dashboard app (X-Feature on any reply); not kept.
+void viewfinderSetFeature(bool on);
+bool viewfinderOn();
+// Draws a frame when one is due. Call from loop() only while nothing else
+// has the screen; true when it drew.
+bool viewfinderPoll(uint32_t nowMs);
+// Draws a frame (RGB565 or JPEG) centered on the screen, as the live view
+// does.
+void viewfinderShow(const camera_fb_t* fb);
+// A fresh frame, drawn and left on screen: the press's snapshot. Waits
+// no longer than a live frame would. Hand it back with cameraRelease();
+// nullptr when the camera has nothing.
+camera_fb_t* viewfinderSnapshot();
+ViewStats viewfinderStats();
@@ -0,0 +1,137 @@
+#include "wake_word.h"
+#include "kws.h"
+#include "kws_model_data.h"
+#include "mic_stream.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+enum WakeState : uint8_t {
+    WAKE_ARMED,  // listening
+    WAKE_FIRED,  // detected, not yet picked up by loop()
+    WAKE_HELD,   // turn in progress, waiting for wakeWordRearm()
+};
+
+static KwsModel          model;
+static bool              modelLoaded = false;
+static KwsDetector       det;
+static KwsTrigger        trig;
+static TaskHandle_t      task = nullptr;
+static volatile bool     runFlag = false;
+static volatile bool     rearmReq = false;
+static volatile uint8_t  state = WAKE_ARMED;
+static volatile uint32_t firedMark = 0;
+static volatile float    threshold = 0.85f;
+static volatile uint32_t detections = 0;
+static volatile uint32_t inferences = 0;
+static volatile uint64_t inferUsTotal = 0;
+static volatile uint8_t  lastScorePct = 0;
+
+static Counter   metricWakeDetections("moodsoul_wake_detections_total", "Wake-word detections");
+static Histogram metricWakeInferUs("moodsoul_wake_infer_us", "Wake-word front end + model time per inference, us");
+
+static void wakeTask(void*) {
+    int16_t hop[KWS_HOP];
+    uint32_t next = micStreamMark();
+    while (runFlag) {
+        if (rearmReq) {
+            rearmReq = false;
+            kwsReset(det);
+            kwsTriggerInit(trig, threshold);
+            next = micStreamMark();
+            state = WAKE_ARMED;
+        }
+        if (state != WAKE_ARMED) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+            continue;
+        }
+        // Fails while playback has the codec or if we fell a ring behind:
+        // start over from live audio
+        if (micStreamCapture(next, 0, KWS_HOP, hop, 200) == 0) {
+            if (!micStreamRunning()) vTaskDelay(pdMS_TO_TICKS(100));
+            kwsReset(det);
+            next = micStreamMark();
+            continue;
+        }
+        next += KWS_HOP;
+
+        trig.threshold = threshold;
+        int64_t t0 = esp_timer_get_time();
+        KwsResult r = kwsPush(det, hop);
+        if (r.ran) {
+            uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+            metricWakeInferUs.record(us);
+            inferences++;
+            inferUsTotal += us;
+            lastScorePct = (uint8_t)(r.score * 100.0f);
+        }
+        if (kwsTriggerUpdate(trig, r)) {
+            firedMark = next;
+            detections++;
+            metricWakeDetections.inc();
+            Serial.printf("[WAKE] keyword, score %u%%\n", lastScorePct);
+            state = WAKE_FIRED;
+        }
+    }
+    task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool wakeWordStart(uint8_t thresholdPct) {
+    wakeWordSetThreshold(thresholdPct);
+    if (task) return true;
+    if (!micStreamRunning()) return false;
+    if (!modelLoaded) {
+        if (KWS_MODEL_SIZE == 0) return false;
+        if (!kwsModelLoad(model, KWS_MODEL_DATA, KWS_MODEL_SIZE)) {
+            Serial.printf("[WAKE] model rejected: %s\n", model.error);
+            return false;
+        }
+        modelLoaded = true;
+    }
+    kwsInit(det, &model);
+    kwsTriggerInit(trig, threshold);
+    state = WAKE_ARMED;
+    rearmReq = false;
+    runFlag = true;
+    // Core 0 beside Wi-Fi: core 1 already carries loop() and the mic task
+    if (xTaskCreatePinnedToCore(wakeTask, "wake_word", 4096, nullptr, 1, &task, 0) != pdPASS) {
+        runFlag = false;
+        return false;
+    }
+    return true;
+}
+
+void wakeWordStop() {
+    if (!task) return;
+    runFlag = false;
+    while (task) delay(2);
+}
+
+bool wakeWordRunning() {
+    return task != nullptr;
+}
+
+void wakeWordSetThreshold(uint8_t pct) {
+    threshold = (pct > 100 ? 100 : pct) / 100.0f;
+}
+
+bool wakeWordPoll(uint32_t* mark) {
+    if (state != WAKE_FIRED) return false;
+    *mark = firedMark;
+    state = WAKE_HELD;
+    return true;
+}
+
+void wakeWordRearm() {
+    if (task) rearmReq = true;
+}
+
+WakeWordStats wakeWordStats() {
+    WakeWordStats s;
+    s.detections = detections;
+    s.inferences = inferences;
+    s.avgInferUs = inferences ? (uint32_t)(inferUsTotal / inferences) : 0;
+    s.lastScorePct = lastScorePct;
+    return s;
+}
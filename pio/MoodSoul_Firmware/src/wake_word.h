@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// WAKE WORD
+// ==========================================
+// Keyword spotter task fed from the always-on mic ring (mic_stream.h must
+// be running). On a detection it stops listening and reports the ring
+// position where the keyword ended; loop() runs the turn from there and
+// re-arms it afterwards.
+
+struct WakeWordStats {
+    uint32_t detections;
+    uint32_t inferences;
+    uint32_t avgInferUs;  // front end + model, per inference
+    uint8_t  lastScorePct;
+};
+
+// False if no model is compiled in (kws_model_data.h) or it fails to load.
+bool wakeWordStart(uint8_t thresholdPct);
+void wakeWordStop();
+bool wakeWordRunning();
+void wakeWordSetThreshold(uint8_t pct);
+// True once per detection, with the mic ring position at the keyword end.
+bool wakeWordPoll(uint32_t* mark);
+// Drops any pending detection and listens again from the current audio.
+void wakeWordRearm();
+WakeWordStats wakeWordStats();
@@ -0,0 +1,121 @@
+#include "wifi_cache.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
+#include <time.h>
+
+#define WIFI_CACHE_MAGIC 0x57464332 // "WFC2"
+#define CLOCK_VALID_S    1700000000 // anything earlier is the unset RTC
+
+struct WifiCache {
+    uint32_t magic;
+    char     ssid[33];
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip, gateway, mask, dns;
+    uint32_t savedAt;  // time() of the lease, 0 if the clock wasn't set
+    uint16_t joins;    // fast joins on this lease
+};
+
+static uint32_t leaseSinceMs = 0;
+
+static uint32_t clockNow() {
+    time_t t = time(nullptr);
+    return t >= CLOCK_VALID_S ? (uint32_t)t : 0;
+}
+
+static bool loadCache(WifiCache& c) {
+    Preferences p;
+    p.begin("wifi", true);
+    bool have = p.getBytes("cache", &c, sizeof(c)) == sizeof(c) && c.magic == WIFI_CACHE_MAGIC;
+    p.end();
+    return have;
+}
+
+static void storeCache(const WifiCache& c) {
+    Preferences p;
+    p.begin("wifi", false);
+    p.putBytes("cache", &c, sizeof(c));
+    p.end();
+}
+
+uint32_t wifiCachedLeaseSince() {
+    return leaseSinceMs;
+}
+
+void wifiRenewLease() {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // starts the DHCP client
+    leaseSinceMs = 0;
+}
+
+void wifiClearCache() {
+    Preferences p;
+    p.begin("wifi", false);
+    p.remove("cache");
+    p.end();
+}
+
+void wifiSaveCache() {
+    WifiCache c = {};
+    c.magic = WIFI_CACHE_MAGIC;
+    strlcpy(c.ssid, WiFi.SSID().c_str(), sizeof(c.ssid));
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) return;
+    memcpy(c.bssid, bssid, 6);
+    c.channel = WiFi.channel();
+    c.ip = WiFi.localIP();
+    c.gateway = WiFi.gatewayIP();
+    c.mask = WiFi.subnetMask();
+    c.dns = WiFi.dnsIP();
+    // Still on the cached address (a roam): the lease is as old as it was
+    WifiCache old;
+    if (leaseSinceMs && loadCache(old) && old.ip == c.ip) {
+        c.savedAt = old.savedAt;
+        c.joins = old.joins;
+    } else {
+        c.savedAt = clockNow();
+    }
+    storeCache(c);
+}
+
+bool wifiFastConnect(uint32_t timeoutMs, const char* checkHost) {
+    WifiCache c;
+    if (!loadCache(c)) return false;
+    uint32_t now = clockNow();
+    if (c.joins >= WIFI_CACHE_MAX_JOINS || (now && c.savedAt && now - c.savedAt > WIFI_LEASE_MAX_AGE_S)) {
+        wifiClearCache(); // too old to trust: the normal join gets a fresh one
+        return false;
+    }
+
+    // The cache only applies to the network WiFiManager last saved
+    WiFi.mode(WIFI_STA);
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK ||
+        strncmp((const char*)conf.sta.ssid, c.ssid, sizeof(conf.sta.ssid)) != 0) {
+        wifiClearCache();
+        return false;
+    }
+
+    char pass[65] = {};
+    memcpy(pass, conf.sta.password, sizeof(conf.sta.password));
+
+    WiFi.config(IPAddress(c.ip), IPAddress(c.gateway), IPAddress(c.mask), IPAddress(c.dns));
+    WiFi.begin(c.ssid, pass, c.channel, c.bssid, true);
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) delay(10);
+    // Associated is not enough: a stale address still associates
+    IPAddress resolved;
+    if (WiFi.status() == WL_CONNECTED && (!checkHost || WiFi.hostByName(checkHost, resolved))) {
+        c.joins++;
+        storeCache(c);
+        leaseSinceMs = millis() ? millis() : 1;
+        return true;
+    }
+
+    // AP moved, channel changed or lease no longer ours: back to scan + DHCP
+    WiFi.disconnect();
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    wifiClearCache();
+    return false;
+}
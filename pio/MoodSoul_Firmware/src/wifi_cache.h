@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// WI-FI FAST RECONNECT
+// ==========================================
+// After a normal join, the AP's BSSID and channel and the DHCP lease
+// (IP, gateway, mask, DNS) are cached in NVS ("wifi"). The next boot joins
+// that AP directly with the cached address: no scan and no DHCP round
+// trip. A failed fast join drops the cache and the caller falls back to
+// WiFiManager. Credentials stay in the Wi-Fi driver's own NVS.
+//
+// The cached address is a DHCP lease nobody renews, so it is only reused
+// while young: up to WIFI_LEASE_MAX_AGE_S by the clock (kept across soft
+// resets), or WIFI_CACHE_MAX_JOINS cold boots when the clock can't tell,
+// and only if a DNS lookup through it works. A session running on it
+// switches to DHCP at the same age (wifi_link.h).
+
+#define WIFI_LEASE_MAX_AGE_S  (12 * 3600) // half the usual 24 h lease
+#define WIFI_CACHE_MAX_JOINS  16
+
+// Returns true once associated with an IP that resolves checkHost, within
+// timeoutMs (plus the lookup).
+bool wifiFastConnect(uint32_t timeoutMs, const char* checkHost);
+// Call after any successful join that did not come from the cache.
+void wifiSaveCache();
+void wifiClearCache();
+// millis() when the cached address went into use, 0 when on DHCP.
+uint32_t wifiCachedLeaseSince();
+// Hands the address back to DHCP, staying associated; the new lease shows
+// up as a GOT_IP (save it with wifiSaveCache()).
+void wifiRenewLease();
@@ -0,0 +1,244 @@
+#include "wifi_link.h"
+#include "wifi_cache.h"
+#include "metrics.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+
+#define LINK_POLL_MS           500
+#define LINK_BACKOFF_MIN_MS    500
+#define LINK_BACKOFF_MAX_MS    30000
+#define LINK_JOIN_TIMEOUT_MS   8000
+#define LINK_RSSI_GOOD         -62
+#define LINK_RSSI_POOR         -75
+#define LINK_TIER_HYST_DB      3
+#define LINK_ROAM_RSSI         -72   // consider roaming below this...
+#define LINK_ROAM_HOLD_MS      10000 // ...for this long
+#define LINK_ROAM_MIN_GAIN_DB  8
+#define LINK_ROAM_SCAN_GAP_MS  60000
+
+static Counter metricReconnects("moodsoul_wifi_reconnects_total", "In-place Wi-Fi reconnects after a drop");
+static Counter metricRoams("moodsoul_wifi_roams_total", "Switches to a stronger BSSID of the same SSID");
+static Gauge   metricTier("moodsoul_wifi_link_tier", "Link tier: 0 down, 1 poor, 2 fair, 3 good");
+static Histogram metricOutageMs("moodsoul_wifi_outage_ms", "Link down to link up again, ms");
+
+static volatile LinkTier linkTier = LINK_DOWN;
+static volatile int8_t   linkRssi = 0;
+static volatile uint32_t linkDownSince = 0;
+static volatile bool     linkBusy = false;
+static volatile bool     linkIdle = false;
+static volatile bool     gotIp = false;     // a DHCP lease arrived
+
+const char* wifiLinkTierName(LinkTier t) {
+    static const char* const NAMES[] = { "down", "poor", "fair", "good" };
+    return t <= LINK_GOOD ? NAMES[t] : "?";
+}
+
+LinkQuality wifiLinkQuality() {
+    LinkQuality q;
+    q.tier = linkTier;
+    q.rssi = linkRssi;
+    q.downSinceMs = linkDownSince;
+    return q;
+}
+
+static void applyRadioPolicy(LinkTier t);
+
+void wifiLinkSetBusy(bool busy) {
+    linkBusy = busy;
+    if (linkTier == LINK_DOWN) return;
+    // Radio sleep adds tens of ms to every round trip mid-turn
+    if (busy) esp_wifi_set_ps(WIFI_PS_NONE);
+    else applyRadioPolicy(linkTier);
+}
+
+bool wifiLinkBusy() {
+    return linkBusy;
+}
+
+void wifiLinkSetIdle(bool idle) {
+    linkIdle = idle;
+    if (linkTier != LINK_DOWN) applyRadioPolicy(linkTier);
+}
+
+// Tier with hysteresis so a signal hovering on a boundary doesn't flap
+static LinkTier tierFor(int rssi, LinkTier prev) {
+    int good = LINK_RSSI_GOOD - (prev == LINK_GOOD ? LINK_TIER_HYST_DB : 0);
+    int poor = LINK_RSSI_POOR + (prev == LINK_POOR ? LINK_TIER_HYST_DB : 0);
+    if (rssi > good) return LINK_GOOD;
+    if (rssi < poor) return LINK_POOR;
+    return LINK_FAIR;
+}
+
+// Strong signal: sleep between beacons and turn TX power down.
+// Weak signal: stay awake and shout.
+static void applyRadioPolicy(LinkTier t) {
+    if (linkBusy) return;
+    if (linkIdle && t != LINK_DOWN) {
+        // Latency doesn't matter until someone walks up; keep TX power for the tier
+        esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+        WiFi.setTxPower(t == LINK_POOR ? WIFI_POWER_19_5dBm : WIFI_POWER_15dBm);
+        return;
+    }
+    switch (t) {
+    case LINK_GOOD:
+        esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+        WiFi.setTxPower(WIFI_POWER_11dBm);
+        break;
+    case LINK_FAIR:
+        esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+        WiFi.setTxPower(WIFI_POWER_15dBm);
+        break;
+    default:
+        esp_wifi_set_ps(WIFI_PS_NONE);
+        WiFi.setTxPower(WIFI_POWER_19_5dBm);
+        break;
+    }
+}
+
+static bool waitConnected(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) delay(50);
+    return WiFi.status() == WL_CONNECTED;
+}
+
+// Looks for the same SSID on another BSSID that beats us by a margin and
+// moves there. Returns true if we ended up on a new AP.
+static bool tryRoam(int currentRssi) {
+    String ssid = WiFi.SSID();
+    String pass = WiFi.psk();
+    uint8_t current[6];
+    memcpy(current, WiFi.BSSID(), 6);
+
+    int n = WiFi.scanNetworks(false, false, false, 120);
+    int best = -1, bestRssi = currentRssi + LINK_ROAM_MIN_GAIN_DB - 1;
+    for (int i = 0; i < n; i++) {
+        if (WiFi.SSID(i) != ssid || memcmp(WiFi.BSSID(i), current, 6) == 0) continue;
+        if (WiFi.RSSI(i) > bestRssi) {
+            best = i;
+            bestRssi = WiFi.RSSI(i);
+        }
+    }
+    if (best < 0) {
+        WiFi.scanDelete();
+        return false;
+    }
+    uint8_t bssid[6];
+    memcpy(bssid, WiFi.BSSID(best), 6);
+    int32_t channel = WiFi.channel(best);
+    WiFi.scanDelete();
+
+    Serial.printf("wifi: roaming %d dBm -> %02x:%02x:%02x:%02x:%02x:%02x ch%d %d dBm\n", currentRssi,
+                  bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], (int)channel, bestRssi);
+    WiFi.begin(ssid.c_str(), pass.c_str(), channel, bssid, true);
+    if (waitConnected(LINK_JOIN_TIMEOUT_MS)) return true;
+    WiFi.begin(ssid.c_str(), pass.c_str()); // any AP of ours will do
+    return false;
+}
+
+static void linkTask(void*) {
+    uint32_t backoff = LINK_BACKOFF_MIN_MS;
+    unsigned long nextAttempt = 0;
+    unsigned long weakSince = 0, lastScan = 0;
+    int failures = 0;
+    float smooth = 0;
+    bool reseed = true;
+
+    for (;;) {
+        unsigned long now = millis();
+
+        if (WiFi.status() != WL_CONNECTED) {
+            if (linkTier != LINK_DOWN) {
+                linkTier = LINK_DOWN;
+                linkRssi = 0;
+                linkDownSince = now ? now : 1;
+                metricTier.set(LINK_DOWN);
+                nextAttempt = now; // first retry right away
+                backoff = LINK_BACKOFF_MIN_MS;
+                failures = 0;
+                Serial.println("wifi: link lost, reconnecting");
+            }
+            if ((long)(now - nextAttempt) >= 0) {
+                // A cached static IP can go stale; after one miss, ask DHCP
+                if (failures == 1) {
+                    wifiRenewLease();
+                    wifiClearCache();
+                }
+                WiFi.reconnect();
+                if (!waitConnected(LINK_JOIN_TIMEOUT_MS)) {
+                    failures++;
+                    nextAttempt = millis() + backoff + esp_random() % (backoff / 2 + 1);
+                    backoff = backoff * 2 > LINK_BACKOFF_MAX_MS ? LINK_BACKOFF_MAX_MS : backoff * 2;
+                }
+            }
+            delay(LINK_POLL_MS);
+            continue;
+        }
+
+        int rssi = WiFi.RSSI();
+        if (linkTier == LINK_DOWN) {
+            if (linkDownSince) {
+                metricReconnects.inc();
+                metricOutageMs.record(now - linkDownSince);
+                Serial.printf("wifi: back after %lu ms\n", (unsigned long)(now - linkDownSince));
+                if (failures >= 1) wifiSaveCache(); // DHCP gave us a fresh lease
+            }
+            linkDownSince = 0;
+            reseed = true;
+        }
+        if (reseed) {
+            smooth = rssi;
+            weakSince = 0;
+            reseed = false;
+        }
+        smooth += (rssi - smooth) * 0.2f;
+        linkRssi = (int8_t)smooth;
+
+        LinkTier t = tierFor(linkRssi, linkTier);
+        if (t != linkTier) {
+            linkTier = t;
+            metricTier.set(t);
+            applyRadioPolicy(t);
+        }
+
+        if (linkRssi < LINK_ROAM_RSSI) {
+            if (!weakSince) weakSince = now;
+        } else {
+            weakSince = 0;
+        }
+        // The cached address is a lease nobody renewed: hand it to DHCP
+        // between turns (still associated; the address is gone for the
+        // DHCP round trip) and cache the new one
+        uint32_t leaseSince = wifiCachedLeaseSince();
+        if (leaseSince && now - leaseSince > WIFI_LEASE_MAX_AGE_S * 1000ul && !linkBusy) {
+            Serial.println("wifi: cached address aged out, renewing through DHCP");
+            gotIp = false;
+            wifiRenewLease();
+        }
+        if (gotIp) {
+            gotIp = false;
+            if (!wifiCachedLeaseSince()) wifiSaveCache();
+        }
+
+        if (weakSince && now - weakSince > LINK_ROAM_HOLD_MS && !linkBusy &&
+            (!lastScan || now - lastScan > LINK_ROAM_SCAN_GAP_MS)) {
+            lastScan = now;
+            if (tryRoam(linkRssi)) {
+                metricRoams.inc();
+                wifiSaveCache();
+                reseed = true; // new AP, new signal
+            }
+            weakSince = 0;
+        }
+        delay(LINK_POLL_MS);
+    }
+}
+
+void wifiLinkStart() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+    WiFi.setAutoReconnect(false); // backoff is ours, not the driver's
+    WiFi.onEvent([](arduino_event_id_t, arduino_event_info_t) { gotIp = true; }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    xTaskCreatePinnedToCore(linkTask, "wifi_link", 4096, nullptr, 1, nullptr, 0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// WI-FI LINK MANAGER
+// ==========================================
+// Background task that owns the station link once boot has joined:
+// - reconnects in place with exponential backoff (no reboot)
+// - roams to a clearly stronger BSSID of the same SSID when the signal
+//   stays weak
+// - picks power-save and TX power for the current signal
+// - moves off a fast-join cached address to DHCP once it ages out
+// - publishes a smoothed RSSI and a quality tier for network code
+
+enum LinkTier : uint8_t {
+    LINK_DOWN = 0,
+    LINK_POOR,  // < -75 dBm: keep uploads minimal
+    LINK_FAIR,  // -75..-62 dBm
+    LINK_GOOD,  // > -62 dBm
+};
+
+struct LinkQuality {
+    LinkTier tier;
+    int8_t   rssi;          // smoothed dBm, 0 while down
+    uint32_t downSinceMs;   // millis() when the link dropped, 0 while up
+};
+
+void wifiLinkStart();
+LinkQuality wifiLinkQuality();
+// Hold off roaming scans and power-save while a turn is on the air.
+void wifiLinkSetBusy(bool busy);
+bool wifiLinkBusy();
+// Nobody around (presence.h DEEP): max power save whatever the signal,
+// so the radio only wakes for every DTIM-listen-interval beacon.
+void wifiLinkSetIdle(bool idle);
+const char* wifiLinkTierName(LinkTier t);
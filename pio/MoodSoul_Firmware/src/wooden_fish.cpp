@@ -0,0 +1,243 @@
+#include "wooden_fish.h"
+#include "api_post.h"
+#include "merit_batch.h"
+#include "clip_store.h"
+#include "metrics.h"
+#include "wifi_link.h"
+#include <M5Unified.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <atomic>
+
+#define POLL_MS          250
+#define SYNC_MS          60000  // dashboard check while the mode is on
+#define UPLOAD_TIMEOUT_MS 8000
+#define RIPPLES          4
+#define RIPPLE_FRAME_MS  16
+#define RIPPLE_STEP      6
+#define RIPPLE_MAX_R     70
+#define COUNT_REDRAW_MS  50
+#define SPK_CHANNEL      0
+#define POND_Y           24     // ripples stay between the title and the count
+#define POND_H           172
+
+struct Ripple {
+    int16_t  x, y;
+    int16_t  r;          // 0 = unused
+    uint32_t nextMs;
+};
+
+static std::atomic<uint32_t> tapTotal{0};  // loop() counts, the task drains
+static std::atomic<bool>     active{false};
+static MeritBatch            batch;        // upload task only
+static TaskHandle_t          task = nullptr;
+static String                url;
+static String                deviceId;
+static volatile uint32_t     uploads = 0, uploadErrors = 0, serverTotal = 0;
+static volatile uint32_t     ackedSnapshot = 0;
+static Ripple                ripples[RIPPLES];
+static uint32_t              shownTotal = UINT32_MAX;
+static uint32_t              countDrawnMs = 0;
+static const int16_t*        knock = nullptr;
+static uint32_t              knockLen = 0;
+
+static Histogram metricTapToPixel("moodsoul_fish_tap_to_pixel_us", "Wooden fish touch seen to first ripple drawn, us");
+static Counter   metricFishTaps("moodsoul_fish_taps_total", "Wooden fish taps counted on the device");
+static Counter   metricFishUploads("moodsoul_fish_uploads_total", "Merit batches acked by the server");
+static Counter   metricFishUploadErrors("moodsoul_fish_upload_errors_total", "Merit batch uploads that failed (resent later)");
+static Gauge     metricFishPending("moodsoul_fish_pending_taps", "Wooden fish taps not yet acked by the server");
+
+// The task is the only writer of the NVS counts.
+static void saveBatch() {
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putUInt("fish_total", batch.total);
+    p.putUInt("fish_acked", batch.acked);
+    p.putUInt("fish_seq", batch.seq);
+    p.putUInt("fish_flight", batch.inflight);
+    p.end();
+}
+
+// Sends one batch (taps 0 = just a dashboard check). False on any failure.
+static bool upload(const MeritUpload& up) {
+    WiFiClientSecure client;
+    HTTPClient http;
+    const char* keys[] = { "X-Merit-Ack", "X-Merit-Total", "X-Merit-Seq", "X-Feature" };
+    if (!apiPostBegin(http, client, url, UPLOAD_TIMEOUT_MS, "application/json", keys, 4)) return false;
+    int code = http.POST(String("{\"deviceId\":\"") + deviceId + "\",\"seq\":" + up.seq + ",\"taps\":" + up.taps + "}");
+    bool ok = code == 200 && http.hasHeader("X-Merit-Ack");
+    if (ok) {
+        uint32_t ack = strtoul(http.header("X-Merit-Ack").c_str(), nullptr, 10);
+        serverTotal = strtoul(http.header("X-Merit-Total").c_str(), nullptr, 10);
+        if (up.taps) meritAcked(batch, ack);
+        if (meritAdoptSeq(batch, strtoul(http.header("X-Merit-Seq").c_str(), nullptr, 10))) saveBatch();
+        String feature = http.header("X-Feature");
+        if (feature.length() && feature != FISH_FEATURE && active) {
+            Serial.printf("[FISH] dashboard switched to %s\n", feature.c_str());
+            fishSetActive(false);
+        }
+    } else {
+        Serial.printf("[FISH] upload seq %lu: HTTP %d\n", (unsigned long)up.seq, code);
+    }
+    http.end();
+    return ok;
+}
+
+static void uploadTask(void*) {
+    uint32_t savedMs = millis(), syncedMs = millis();
+    bool dirty = false;
+    // Fresh (or wiped) flash: learn the server's seq before the first batch
+    bool checkedIn = batch.seq != 0;
+    uint32_t checkInAt = 0;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+        uint32_t now = millis();
+        uint32_t total = tapTotal.load(std::memory_order_relaxed);
+        if (total != batch.total) {
+            meritAdd(batch, total - batch.total, now);
+            dirty = true;
+        }
+        // New taps reach flash in batches too: bounded wear, bounded loss
+        if (dirty && now - savedMs >= MERIT_SAVE_MS) {
+            saveBatch();
+            savedMs = now;
+            dirty = false;
+        }
+        metricFishPending.set(batch.total - batch.acked);
+        if (wifiLinkQuality().tier == LINK_DOWN) continue;
+
+        MeritUpload up;
+        bool cut;
+        if (!checkedIn) {
+            if ((int32_t)(now - checkInAt) >= 0) {
+                up = { 0, 0 };
+                checkedIn = upload(up);
+                syncedMs = millis();
+                checkInAt = syncedMs + SYNC_MS / 4;
+            }
+        } else if (meritDue(batch, now, up, &cut)) {
+            if (cut) saveBatch(); // the seq must outlive a reboot before it's sent
+            if (upload(up)) {
+                uploads++;
+                metricFishUploads.inc();
+                syncedMs = millis();
+            } else {
+                uploadErrors++;
+                metricFishUploadErrors.inc();
+                meritFailed(batch, millis());
+            }
+            saveBatch();
+            savedMs = millis();
+            dirty = false;
+        } else if (active && !batch.inflight && now - syncedMs >= SYNC_MS) {
+            // Nothing to send: an empty batch still brings X-Feature back
+            up = { batch.seq, 0 };
+            upload(up);
+            syncedMs = millis();
+        }
+        ackedSnapshot = batch.acked;
+    }
+}
+
+void fishBegin(const char* host, const char* path, const char* id) {
+    if (task) return;
+    url = String("https://") + host + path;
+    deviceId = id;
+    Preferences p;
+    p.begin("moodsoul", true);
+    meritInit(batch, p.getUInt("fish_total", 0), p.getUInt("fish_acked", 0), p.getUInt("fish_seq", 0),
+              p.getUInt("fish_flight", 0));
+    active = p.getBool("fish_on", false);
+    p.end();
+    tapTotal = batch.total;
+    ackedSnapshot = batch.acked;
+    clipStoreFindWav("fish/knock.wav", &knock, &knockLen);
+    xTaskCreatePinnedToCore(uploadTask, "fish", 6144, nullptr, 1, &task, 0);
+}
+
+void fishSetActive(bool on) {
+    if (active == on) return;
+    active = on;
+    Preferences p;
+    p.begin("moodsoul", false);
+    p.putBool("fish_on", on);
+    p.end();
+}
+
+bool fishActive() {
+    return active;
+}
+
+static void drawCount(uint32_t total) {
+    M5.Lcd.fillRect(0, 196, 320, 44, BLACK);
+    M5.Lcd.setTextDatum(MC_DATUM);
+    M5.Lcd.setTextColor(YELLOW);
+    M5.Lcd.setTextSize(3);
+    M5.Lcd.drawString(String("Merit +") + total, 160, 218);
+    shownTotal = total;
+}
+
+void fishScreen() {
+    memset(ripples, 0, sizeof(ripples));
+    M5.Lcd.fillScreen(BLACK);
+    M5.Lcd.setTextDatum(MC_DATUM);
+    M5.Lcd.setTextColor(DARKGREY);
+    M5.Lcd.setTextSize(1);
+    M5.Lcd.drawString("CYBER ZEN - tap to knock, hold to leave", 160, 12);
+    drawCount(tapTotal);
+}
+
+void fishTap(int x, int y) {
+    int64_t t0 = esp_timer_get_time();
+    tapTotal.fetch_add(1, std::memory_order_relaxed);
+    metricFishTaps.inc();
+    // A fast tapper restarts the knock rather than queueing them
+    if (knock) M5.Speaker.playRaw(knock, knockLen, CLIP_RATE, false, 1, SPK_CHANNEL, true);
+    else M5.Speaker.tone(800, 50);
+
+    // First ring now; fishAnimate() grows it frame by frame
+    int slot = 0;
+    for (int i = 1; i < RIPPLES; i++) {
+        if (!ripples[i].r || (ripples[slot].r && ripples[i].r > ripples[slot].r)) slot = i;
+    }
+    Ripple& rp = ripples[slot];
+    M5.Lcd.setClipRect(0, POND_Y, 320, POND_H);
+    if (rp.r) M5.Lcd.drawCircle(rp.x, rp.y, rp.r, BLACK);
+    rp = { (int16_t)x, (int16_t)y, 12, millis() + RIPPLE_FRAME_MS };
+    M5.Lcd.drawCircle(x, y, rp.r, WHITE);
+    M5.Lcd.clearClipRect();
+    metricTapToPixel.record((uint32_t)(esp_timer_get_time() - t0));
+}
+
+void fishAnimate(uint32_t nowMs) {
+    M5.Lcd.setClipRect(0, POND_Y, 320, POND_H);
+    for (Ripple& rp : ripples) {
+        if (!rp.r || (int32_t)(nowMs - rp.nextMs) < 0) continue;
+        M5.Lcd.drawCircle(rp.x, rp.y, rp.r, BLACK);
+        rp.r += RIPPLE_STEP;
+        if (rp.r > RIPPLE_MAX_R) {
+            rp.r = 0;
+            continue;
+        }
+        // Fades from white to grey as it spreads
+        M5.Lcd.drawCircle(rp.x, rp.y, rp.r, rp.r < RIPPLE_MAX_R / 2 ? WHITE : LIGHTGREY);
+        rp.nextMs = nowMs + RIPPLE_FRAME_MS;
+    }
+    M5.Lcd.clearClipRect();
+    uint32_t total = tapTotal.load(std::memory_order_relaxed);
+    if (total != shownTotal && nowMs - countDrawnMs >= COUNT_REDRAW_MS) {
+        drawCount(total);
+        countDrawnMs = nowMs;
+    }
+}
+
+FishStats fishStats() {
+    FishStats s;
+    s.total = tapTotal;
+    s.acked = ackedSnapshot;
+    s.pending = s.total - s.acked;
+    s.uploads = uploads;
+    s.uploadErrors = uploadErrors;
+    s.serverTotal = serverTotal;
+    return s;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================
+// CYBER ZEN (WOODEN FISH MODE)
+// ==========================================
+// Each touch is a knock on the wooden fish: a knock sound and a ripple
+// drawn in the same loop() pass that saw the touch, and the count goes up.
+// Counts are kept in NVS and reach the server (/api/merit) as coalesced
+// batches from a background task (merit_batch.h), so tapping ten times a
+// second costs about one request per ten seconds. While the mode is on, the
+// task also picks up dashboard changes (X-Feature) about once a minute.
+//
+// Sound: "fish/knock.wav" from the asset pack if it's there, else a tone.
+
+#define FISH_FEATURE "WOODEN_FISH" // souls.current_feature
+
+struct FishStats {
+    uint32_t total;      // taps on this device, ever
+    uint32_t acked;      // confirmed by the server
+    uint32_t pending;    // not yet uploaded
+    uint32_t uploads;
+    uint32_t uploadErrors;
+    uint32_t serverTotal; // the soul's count, from the last ack
+};
+
+// Loads the counts and starts the upload task (it runs with the mode off
+// too, to finish flushing).
+void fishBegin(const char* host, const char* path, const char* deviceId);
+// Switched from the dashboard (X-Feature on any reply) or the serial
+// console; kept in NVS. main.cpp polls fishActive() to hand over the
+// screen, touch and speaker.
+void fishSetActive(bool on);
+bool fishActive();
+// Draws the mode's screen.
+void fishScreen();
+// A touch at (x, y): count, knock, first ripple frame.
+void fishTap(int x, int y);
+// Grows the ripples and redraws the count; call every loop() pass.
+void fishAnimate(uint32_t nowMs);
+FishStats fishStats();